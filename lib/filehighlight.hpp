@@ -13,6 +13,13 @@ typedef struct mc_fhl_struct
 {
     mc_config_t *config;
     GPtrArray *filters;
+
+    /* Rules compiled for fast matching. Values are filter indexes + 1 */
+    GHashTable *ext_case;       /* extension -> first filter with this case sensitive extension */
+    GHashTable *ext_nocase;     /* lowercase extension -> first filter ignoring the case */
+    int *ftype_first;           /* file type -> index of the first filter for it or -1 */
+    GArray *regexps;            /* indexes of regexp filters in priority order */
+    unsigned int stamp;         /* identifies these rules in colors cached in file_entry_t */
 } mc_fhl_t;
 
 /*** global variables defined in .c file *********************************************************/
@@ -59,6 +59,26 @@ mc_fhl_array_free (mc_fhl_t * fhl)
         g_ptr_array_foreach (fhl->filters, (GFunc) mc_fhl_filter_free, NULL);
         fhl->filters = (GPtrArray *) g_ptr_array_free (fhl->filters, TRUE);
     }
+
+    if (fhl->ext_case != NULL)
+    {
+        g_hash_table_destroy (fhl->ext_case);
+        fhl->ext_case = NULL;
+    }
+
+    if (fhl->ext_nocase != NULL)
+    {
+        g_hash_table_destroy (fhl->ext_nocase);
+        fhl->ext_nocase = NULL;
+    }
+
+    MC_PTR_FREE (fhl->ftype_first);
+
+    if (fhl->regexps != NULL)
+    {
+        g_array_free (fhl->regexps, TRUE);
+        fhl->regexps = NULL;
+    }
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -154,13 +154,12 @@ mc_fhl_is_special (file_entry_t * fe)
 
 /* --------------------------------------------------------------------------------------------- */
 
-static int
-mc_fhl_get_color_filetype (mc_fhl_filter_t * mc_filter, mc_fhl_t * fhl, file_entry_t * fe)
+static gboolean
+mc_fhl_match_filetype (mc_flhgh_ftype_type file_type, file_entry_t * fe)
 {
     gboolean my_color = FALSE;
-    (void) fhl;
 
-    switch (mc_filter->file_type)
+    switch (file_type)
     {
     case MC_FLHGH_FTYPE_T_FILE:
         if (mc_fhl_is_file (fe))
@@ -226,62 +225,118 @@ mc_fhl_get_color_filetype (mc_fhl_filter_t * mc_filter, mc_fhl_t * fhl, file_ent
         break;
     }
 
-    return (my_color) ? mc_filter->color_pair_index : -1;
+    return my_color;
 }
 
 /* --------------------------------------------------------------------------------------------- */
 
-static int
-mc_fhl_get_color_regexp (mc_fhl_filter_t * mc_filter, mc_fhl_t * fhl, file_entry_t * fe)
+static gboolean
+mc_fhl_match_regexp (mc_fhl_filter_t * mc_filter, file_entry_t * fe)
 {
-    (void) fhl;
     if (mc_filter->search_condition == NULL)
-        return -1;
-
-    if (mc_search_run (mc_filter->search_condition, fe->fname, 0, strlen (fe->fname), NULL))
-        return mc_filter->color_pair_index;
+        return FALSE;
 
-    return -1;
+    return mc_search_run (mc_filter->search_condition, fe->fname, 0, strlen (fe->fname), NULL);
 }
 
 /* --------------------------------------------------------------------------------------------- */
+/** Look up all extensions of the name ("gz" and "tar.gz" for "a.tar.gz") in the
+ * extension tables.
+ *
+ * @return index of the first matching filter which is less than @best or @best
+ */
+
+static guint
+mc_fhl_match_extensions (mc_fhl_t * fhl, file_entry_t * fe, guint best)
+{
+    const char *dot;
+
+    for (dot = strchr (fe->fname, '.'); dot != NULL; dot = strchr (dot + 1, '.'))
+    {
+        guint index;
+        char *lower;
+
+        index = GPOINTER_TO_UINT (g_hash_table_lookup (fhl->ext_case, dot + 1));
+        if (index != 0 && index - 1 < best)
+            best = index - 1;
+
+        if (g_hash_table_size (fhl->ext_nocase) == 0)
+            continue;
+
+        lower = g_ascii_strdown (dot + 1, -1);
+        index = GPOINTER_TO_UINT (g_hash_table_lookup (fhl->ext_nocase, lower));
+        g_free (lower);
+        if (index != 0 && index - 1 < best)
+            best = index - 1;
+    }
+
+    return best;
+}
 
 /* --------------------------------------------------------------------------------------------- */
-/*** public functions ****************************************************************************/
-/* --------------------------------------------------------------------------------------------- */
+/** Find the first filter matching the entry.
+ *
+ * @return color of the filter or NORMAL_COLOR if no filter matches
+ */
 
-int
-mc_fhl_get_color (mc_fhl_t * fhl, file_entry_t * fe)
+static int
+mc_fhl_classify (mc_fhl_t * fhl, file_entry_t * fe)
 {
+    guint best;
     guint i;
-    int ret;
 
-    if (fhl == NULL)
-        return NORMAL_COLOR;
+    /* index of the first matching filter found so far */
+    best = fhl->filters->len;
+
+    for (i = 0; i < MC_FLHGH_FTYPE_T_COUNT; i++)
+        if (fhl->ftype_first[i] >= 0 && (guint) fhl->ftype_first[i] < best
+            && mc_fhl_match_filetype ((mc_flhgh_ftype_type) i, fe))
+            best = (guint) fhl->ftype_first[i];
+
+    best = mc_fhl_match_extensions (fhl, fe, best);
 
-    for (i = 0; i < fhl->filters->len; i++)
+    /* regexps are the most expensive: try only those that precede the best match */
+    for (i = 0; i < fhl->regexps->len; i++)
     {
-        mc_fhl_filter_t *mc_filter;
+        guint index;
 
-        mc_filter = (mc_fhl_filter_t *) g_ptr_array_index (fhl->filters, i);
-        switch (mc_filter->type)
-        {
-        case MC_FLHGH_T_FTYPE:
-            ret = mc_fhl_get_color_filetype (mc_filter, fhl, fe);
-            if (ret > 0)
-                return -ret;
-            break;
-        case MC_FLHGH_T_EXT:
-        case MC_FLHGH_T_FREGEXP:
-            ret = mc_fhl_get_color_regexp (mc_filter, fhl, fe);
-            if (ret > 0)
-                return -ret;
+        index = g_array_index (fhl->regexps, guint, i);
+        if (index >= best)
             break;
-        default:
+
+        if (mc_fhl_match_regexp ((mc_fhl_filter_t *) g_ptr_array_index (fhl->filters, index), fe))
+        {
+            best = index;
             break;
         }
     }
-    return NORMAL_COLOR;
+
+    if (best == fhl->filters->len)
+        return NORMAL_COLOR;
+
+    return -((mc_fhl_filter_t *) g_ptr_array_index (fhl->filters, best))->color_pair_index;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+int
+mc_fhl_get_color (mc_fhl_t * fhl, file_entry_t * fe)
+{
+    if (fhl == NULL || fhl->filters == NULL)
+        return NORMAL_COLOR;
+
+    /* the color is computed once per entry and rules */
+    if (fe->fhl_stamp != fhl->stamp)
+    {
+        fe->fhl_color = mc_fhl_classify (fhl, fe);
+        fe->fhl_stamp = fhl->stamp;
+    }
+
+    return fe->fhl_color;
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -28,7 +28,6 @@
 
 #include "lib/global.hpp"
 #include "lib/fileloc.hpp"
-#include "lib/strescape.hpp"
 #include "lib/skin.hpp"
 #include "lib/util.hpp"           /* exist_file() */
 #include "lib/filehighlight.hpp"
@@ -43,6 +42,9 @@
 
 /*** file scope variables ************************************************************************/
 
+/* Last stamp given to parsed rules */
+static unsigned int mc_fhl_last_stamp = 0;
+
 /*** file scope functions ************************************************************************/
 /* --------------------------------------------------------------------------------------------- */
 
@@ -92,6 +94,10 @@ mc_fhl_parse_get_file_type_id (mc_fhl_t * fhl, const gchar * group_name)
     mc_filter->file_type = (mc_flhgh_ftype_type) i;
     mc_fhl_parse_fill_color_info (mc_filter, fhl, group_name);
 
+    /* filters without color never match, so only the first colored one matters */
+    if (mc_filter->color_pair_index > 0 && fhl->ftype_first[i] == -1)
+        fhl->ftype_first[i] = (int) fhl->filters->len;
+
     g_ptr_array_add (fhl->filters, (gpointer) mc_filter);
     return TRUE;
 }
@@ -117,6 +123,14 @@ mc_fhl_parse_get_regexp (mc_fhl_t * fhl, const gchar * group_name)
     mc_filter->search_condition->search_type = MC_SEARCH_T_REGEX;
 
     mc_fhl_parse_fill_color_info (mc_filter, fhl, group_name);
+
+    if (mc_filter->color_pair_index > 0)
+    {
+        guint index = fhl->filters->len;
+
+        g_array_append_val (fhl->regexps, index);
+    }
+
     g_ptr_array_add (fhl->filters, (gpointer) mc_filter);
     g_free (regexp);
     return TRUE;
@@ -129,7 +143,9 @@ mc_fhl_parse_get_extensions (mc_fhl_t * fhl, const gchar * group_name)
 {
     mc_fhl_filter_t *mc_filter;
     gchar **exts, **exts_orig;
-    GString *buf;
+    gboolean case_sensitive;
+    GHashTable *table;
+    gpointer value;
 
     exts_orig = mc_config_get_string_list (fhl->config, group_name, "extensions", NULL);
     if (exts_orig == NULL || exts_orig[0] == NULL)
@@ -138,33 +154,29 @@ mc_fhl_parse_get_extensions (mc_fhl_t * fhl, const gchar * group_name)
         return FALSE;
     }
 
-    buf = g_string_sized_new (64);
+    mc_filter = g_new0 (mc_fhl_filter_t, 1);
+    mc_filter->type = MC_FLHGH_T_EXT;
+    mc_fhl_parse_fill_color_info (mc_filter, fhl, group_name);
 
-    for (exts = exts_orig; *exts != NULL; exts++)
+    /* Instead of a ".*\\.(ext1|ext2|...)$" regexp per filter, all extensions
+       go to one hash table, keeping the first filter for each extension */
+    case_sensitive = mc_config_get_bool (fhl->config, group_name, "extensions_case", FALSE);
+    table = case_sensitive ? fhl->ext_case : fhl->ext_nocase;
+    value = GUINT_TO_POINTER (fhl->filters->len + 1);
+
+    for (exts = exts_orig; mc_filter->color_pair_index > 0 && *exts != NULL; exts++)
     {
-        char *esc_ext;
+        char *ext;
 
-        esc_ext = strutils_regex_escape (*exts);
-        if (buf->len != 0)
-            g_string_append_c (buf, '|');
-        g_string_append (buf, esc_ext);
-        g_free (esc_ext);
+        ext = case_sensitive ? g_strdup (*exts) : g_ascii_strdown (*exts, -1);
+        if (g_hash_table_contains (table, ext))
+            g_free (ext);
+        else
+            g_hash_table_insert (table, ext, value);
     }
     g_strfreev (exts_orig);
 
-    g_string_prepend (buf, ".*\\.(");
-    g_string_append (buf, ")$");
-
-    mc_filter = g_new0 (mc_fhl_filter_t, 1);
-    mc_filter->type = MC_FLHGH_T_FREGEXP;
-    mc_filter->search_condition = mc_search_new_len (buf->str, buf->len, DEFAULT_CHARSET);
-    mc_filter->search_condition->is_case_sensitive =
-        mc_config_get_bool (fhl->config, group_name, "extensions_case", FALSE);
-    mc_filter->search_condition->search_type = MC_SEARCH_T_REGEX;
-
-    mc_fhl_parse_fill_color_info (mc_filter, fhl, group_name);
     g_ptr_array_add (fhl->filters, (gpointer) mc_filter);
-    g_string_free (buf, TRUE);
     return TRUE;
 }
 
@@ -221,9 +233,21 @@ mc_fhl_parse_ini_file (mc_fhl_t * fhl)
 {
     gchar **group_names, **orig_group_names;
     gboolean ok;
+    int i;
 
     mc_fhl_array_free (fhl);
     fhl->filters = g_ptr_array_new ();
+    fhl->ext_case = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    fhl->ext_nocase = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    fhl->ftype_first = g_new (int, MC_FLHGH_FTYPE_T_COUNT);
+    for (i = 0; i < MC_FLHGH_FTYPE_T_COUNT; i++)
+        fhl->ftype_first[i] = -1;
+    fhl->regexps = g_array_new (FALSE, FALSE, sizeof (guint));
+
+    /* invalidate colors cached with previous rules */
+    if (++mc_fhl_last_stamp == 0)
+        mc_fhl_last_stamp++;
+    fhl->stamp = mc_fhl_last_stamp;
 
     orig_group_names = mc_config_get_groups (fhl->config, NULL);
     ok = (*orig_group_names != NULL);
@@ -32,6 +32,8 @@ typedef enum
     MC_FLHGH_FTYPE_T_SPECIAL_DOOR,
 } mc_flhgh_ftype_type;
 
+#define MC_FLHGH_FTYPE_T_COUNT (MC_FLHGH_FTYPE_T_SPECIAL_DOOR + 1)
+
 /*** structures declarations (and typedefs of structures)*****************************************/
 
 typedef struct mc_fhl_filter_struct
@@ -107,3 +107,61 @@
 //}
 
 /* --------------------------------------------------------------------------------------------- */
+
+void
+mc_rate_window_reset (mc_rate_window_t * w)
+{
+    w->count = 0;
+    w->head = 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/**
+ * Remember the counter @value at @now if the newest sample is at least @step microseconds old.
+ * When the window is full, the oldest sample is dropped.
+ **/
+
+void
+mc_rate_window_add (mc_rate_window_t * w, uint64_t now, uintmax_t value, uint64_t step)
+{
+    int newest;
+
+    newest = (w->head + w->count - 1) % MC_RATE_WINDOW_SAMPLES;
+    if (w->count != 0 && now - w->time[newest] < step)
+        return;
+
+    if (w->count == MC_RATE_WINDOW_SAMPLES)
+    {
+        w->head = (w->head + 1) % MC_RATE_WINDOW_SAMPLES;
+        w->count--;
+    }
+
+    newest = (w->head + w->count) % MC_RATE_WINDOW_SAMPLES;
+    w->time[newest] = now;
+    w->value[newest] = value;
+    w->count++;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/**
+ * Rate of the counter between the oldest sample of the window and (@now, @value).
+ *
+ * @return: units per second, 0 if the rate is not known yet
+ **/
+
+uintmax_t
+mc_rate_window_rate (const mc_rate_window_t * w, uint64_t now, uintmax_t value)
+{
+    uint64_t dt;
+
+    if (w->count == 0 || now <= w->time[w->head] || value < w->value[w->head])
+        return 0;
+
+    dt = now - w->time[w->head];
+
+    return (uintmax_t) ((double) (value - w->value[w->head]) * G_USEC_PER_SEC / dt);
+}
+
+/* --------------------------------------------------------------------------------------------- */
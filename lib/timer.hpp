@@ -5,6 +5,34 @@
 #pragma once
 
 #include <sys/time.h>
+#include <stdint.h>             /* uintmax_t */
+
+/*** typedefs(not structures) and defined constants **********************************************/
+
+/* number of samples kept by a rate window */
+#define MC_RATE_WINDOW_SAMPLES 10
+
+/*** structures declarations (and typedefs of structures)*****************************************/
+
+/**
+ * Sliding window over a growing counter (e.g. bytes copied). Samples are taken not more often
+ * than the window step, so the rate reflects roughly the last
+ * MC_RATE_WINDOW_SAMPLES * step microseconds instead of the whole run.
+ * A zero-filled structure is an empty window.
+ */
+typedef struct
+{
+    uint64_t time[MC_RATE_WINDOW_SAMPLES];
+    uintmax_t value[MC_RATE_WINDOW_SAMPLES];
+    int count;
+    int head;
+} mc_rate_window_t;
+
+/*** declarations of public functions ************************************************************/
+
+void mc_rate_window_reset (mc_rate_window_t * w);
+void mc_rate_window_add (mc_rate_window_t * w, uint64_t now, uintmax_t value, uint64_t step);
+uintmax_t mc_rate_window_rate (const mc_rate_window_t * w, uint64_t now, uintmax_t value);
 
 /**
  * Timer:
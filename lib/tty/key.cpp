@@ -45,6 +45,10 @@
 #include <sys/types.h>
 #include <unistd.h>
 #endif
+#include <poll.h>
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
 
 #include "lib/global.hpp"
 
@@ -224,6 +228,9 @@ const key_code_name_t key_name_conv_tab[] = {
 /* The maximum sequence length (32 + null terminator) */
 #define SEQ_BUFFER_LEN 33
 
+/* how many ready descriptors are handled in one pass of the event loop */
+#define READY_FDS_MAX 64
+
 /*** file scope type declarations ****************************************************************/
 
 /* Linux console keyboard modifiers */
@@ -261,6 +268,13 @@ typedef struct
     void *info;
 } select_t;
 
+/* Descriptors found ready by wait_channels() */
+typedef struct
+{
+    int n;
+    int fd[READY_FDS_MAX];
+} ready_fds_t;
+
 typedef enum KeySortType
 {
     KEY_NOSORT = 0,
@@ -523,7 +537,14 @@ static key_def *keys = NULL;
 static int input_fd;
 static int disabled_channels = 0;       /* Disable channels checking */
 
-static GSList *select_list = NULL;
+static GHashTable *select_channels = NULL;     /* fd -> select_t */
+
+#ifdef HAVE_SYS_EPOLL_H
+/* The terminal and the channels are registered in epoll once, so waiting for
+   them doesn't rebuild and scan descriptor sets on every pass */
+static int epoll_fd = -1;
+static int epoll_input_fd = -1; /* the terminal descriptor registered in epoll_fd */
+#endif
 
 static int seq_buffer[SEQ_BUFFER_LEN];
 static int *seq_append = NULL;
@@ -553,67 +574,169 @@ static const key_code_name_t *key_conv_tab_sorted[G_N_ELEMENTS (key_name_conv_ta
 /*** file scope functions ************************************************************************/
 /* --------------------------------------------------------------------------------------------- */
 
-static int
-select_cmp_by_fd_set (gconstpointer a, gconstpointer b)
+static gboolean
+ready_fds_has (const ready_fds_t * ready, int fd)
 {
-    const select_t *s = (const select_t *) a;
-    const fd_set *f = (const fd_set *) b;
+    int i;
+
+    if (fd < 0)
+        return FALSE;
+
+    for (i = 0; i < ready->n; i++)
+        if (ready->fd[i] == fd)
+            return TRUE;
 
-    return (FD_ISSET (s->fd, f) ? 0 : 1);
+    return FALSE;
 }
 
 /* --------------------------------------------------------------------------------------------- */
 
-static int
-select_cmp_by_fd (gconstpointer a, gconstpointer b)
+#ifdef HAVE_SYS_EPOLL_H
+static void
+epoll_add_fd (int fd)
+{
+    struct epoll_event ev;
+
+    memset (&ev, 0, sizeof (ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+
+    if (epoll_ctl (epoll_fd, EPOLL_CTL_ADD, fd, &ev) != 0 && errno == EEXIST)
+        epoll_ctl (epoll_fd, EPOLL_CTL_MOD, fd, &ev);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Create the epoll instance on the first use and keep the terminal registered in it.
+ *
+ * @return TRUE if epoll can be used
+ */
+
+static gboolean
+epoll_sync (void)
 {
-    const select_t *s = (const select_t *) a;
-    const int fd = GPOINTER_TO_INT (b);
+    if (epoll_fd == -1)
+    {
+        GHashTableIter iter;
+        gpointer key;
+
+        epoll_fd = epoll_create1 (EPOLL_CLOEXEC);
+        if (epoll_fd == -1)
+        {
+            epoll_fd = -2;      /* don't try again */
+            return FALSE;
+        }
+
+        if (select_channels != NULL)
+        {
+            g_hash_table_iter_init (&iter, select_channels);
+            while (g_hash_table_iter_next (&iter, &key, NULL))
+                epoll_add_fd (GPOINTER_TO_INT (key));
+        }
+    }
+    else if (epoll_fd < 0)
+        return FALSE;
+
+    if (epoll_input_fd != input_fd)
+    {
+        if (epoll_input_fd >= 0
+            && (select_channels == NULL
+                || !g_hash_table_contains (select_channels, GINT_TO_POINTER (epoll_input_fd))))
+            epoll_ctl (epoll_fd, EPOLL_CTL_DEL, epoll_input_fd, NULL);
+        epoll_add_fd (input_fd);
+        epoll_input_fd = input_fd;
+    }
 
-    return (s->fd == fd ? 0 : 1);
+    return TRUE;
 }
+#endif /* HAVE_SYS_EPOLL_H */
 
 /* --------------------------------------------------------------------------------------------- */
+/**
+ * Wait for input on the terminal, the mouse and the channels (if they are enabled).
+ *
+ * @param ready descriptors which are ready for reading
+ * @param gpm descriptor of gpm connection or -1
+ * @param timeout timeout, NULL to wait forever
+ *
+ * @return as select(): count of ready descriptors, 0 on timeout, -1 on error
+ */
 
 static int
-add_selects (fd_set * select_set)
+wait_channels (ready_fds_t * ready, int gpm, struct timeval *timeout)
 {
-    int top_fd = 0;
+    fd_set select_set;
+    int nfd, v;
 
-    if (disabled_channels == 0)
+    ready->n = 0;
+
+#ifdef HAVE_SYS_EPOLL_H
+    /* disabled channels stay registered in epoll, so it can't be used then */
+    if (disabled_channels == 0 && gpm < 0 && epoll_sync ())
     {
-        GSList *s;
+        struct epoll_event events[READY_FDS_MAX];
+        int ms = -1;
 
-        for (s = select_list; s != NULL; s = g_slist_next (s))
-        {
-            select_t *p = (select_t *) s->data;
+        if (timeout != NULL)
+            ms = timeout->tv_sec * 1000 + (timeout->tv_usec + 999) / 1000;
+
+        v = epoll_wait (epoll_fd, events, READY_FDS_MAX, ms);
+        for (ready->n = 0; ready->n < v; ready->n++)
+            ready->fd[ready->n] = events[ready->n].data.fd;
+
+        return v;
+    }
+#endif /* HAVE_SYS_EPOLL_H */
+
+    FD_ZERO (&select_set);
+    FD_SET (input_fd, &select_set);
+    nfd = MAX (0, input_fd);
+
+    if (gpm >= 0)
+    {
+        FD_SET (gpm, &select_set);
+        nfd = MAX (nfd, gpm);
+    }
 
-            FD_SET (p->fd, select_set);
-            if (p->fd > top_fd)
-                top_fd = p->fd;
+    if (disabled_channels == 0 && select_channels != NULL)
+    {
+        GHashTableIter iter;
+        gpointer key;
+
+        g_hash_table_iter_init (&iter, select_channels);
+        while (g_hash_table_iter_next (&iter, &key, NULL))
+        {
+            FD_SET (GPOINTER_TO_INT (key), &select_set);
+            nfd = MAX (nfd, GPOINTER_TO_INT (key));
         }
     }
 
-    return top_fd;
+    v = select (nfd + 1, &select_set, NULL, NULL, timeout);
+    if (v <= 0)
+        return v;
+
+    for (; nfd >= 0 && ready->n < READY_FDS_MAX; nfd--)
+        if (FD_ISSET (nfd, &select_set))
+            ready->fd[ready->n++] = nfd;
+
+    return ready->n;
 }
 
 /* --------------------------------------------------------------------------------------------- */
 
 static void
-check_selects (fd_set * select_set)
+check_selects (const ready_fds_t * ready)
 {
-    while (disabled_channels == 0)
+    int i;
+
+    for (i = 0; i < ready->n && disabled_channels == 0 && select_channels != NULL; i++)
     {
-        GSList *s;
         select_t *p;
 
-        s = g_slist_find_custom (select_list, select_set, select_cmp_by_fd_set);
-        if (s == NULL)
-            break;
-
-        p = (select_t *) s->data;
-        FD_CLR (p->fd, select_set);
-        p->callback (p->fd, p->info);
+        /* the callbacks may remove channels */
+        p = (select_t *) g_hash_table_lookup (select_channels, GINT_TO_POINTER (ready->fd[i]));
+        if (p != NULL)
+            p->callback (p->fd, p->info);
     }
 }
 
@@ -624,16 +747,11 @@ static void
 try_channels (gboolean set_timeout)
 {
     struct timeval time_out;
-    static fd_set select_set;
+    ready_fds_t ready;
 
     while (TRUE)
     {
         struct timeval *timeptr = NULL;
-        int maxfdp, v;
-
-        FD_ZERO (&select_set);
-        FD_SET (input_fd, &select_set); /* Add stdin */
-        maxfdp = MAX (add_selects (&select_set), input_fd);
 
         if (set_timeout)
         {
@@ -642,11 +760,10 @@ try_channels (gboolean set_timeout)
             timeptr = &time_out;
         }
 
-        v = select (maxfdp + 1, &select_set, NULL, NULL, timeptr);
-        if (v > 0)
+        if (wait_channels (&ready, -1, timeptr) > 0)
         {
-            check_selects (&select_set);
-            if (FD_ISSET (input_fd, &select_set))
+            check_selects (&ready);
+            if (ready_fds_has (&ready, input_fd))
                 break;
         }
     }
@@ -1381,7 +1498,18 @@ void
 done_key (void)
 {
     k_dispose (keys);
-    g_slist_free_full (select_list, g_free);
+    if (select_channels != NULL)
+    {
+        g_hash_table_destroy (select_channels);
+        select_channels = NULL;
+    }
+
+#ifdef HAVE_SYS_EPOLL_H
+    if (epoll_fd >= 0)
+        close (epoll_fd);
+    epoll_fd = -1;
+    epoll_input_fd = -1;
+#endif
 
 #ifdef HAVE_TEXTMODE_X11_SUPPORT
     if (x11_display)
@@ -1401,7 +1529,14 @@ add_select_channel (int fd, select_fn callback, void *info)
     New->callback = callback;
     New->info = info;
 
-    select_list = g_slist_prepend (select_list, New);
+    if (select_channels == NULL)
+        select_channels = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, g_free);
+    g_hash_table_replace (select_channels, GINT_TO_POINTER (fd), New);
+
+#ifdef HAVE_SYS_EPOLL_H
+    if (epoll_fd >= 0)
+        epoll_add_fd (fd);
+#endif
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -1409,11 +1544,15 @@ add_select_channel (int fd, select_fn callback, void *info)
 void
 delete_select_channel (int fd)
 {
-    GSList *p;
+    if (select_channels == NULL
+        || !g_hash_table_remove (select_channels, GINT_TO_POINTER (fd)))
+        return;
 
-    p = g_slist_find_custom (select_list, GINT_TO_POINTER (fd), select_cmp_by_fd);
-    if (p != NULL)
-        select_list = g_slist_delete_link (select_list, p);
+#ifdef HAVE_SYS_EPOLL_H
+    /* the descriptor may be closed already, then it has gone from epoll itself */
+    if (epoll_fd >= 0 && fd != epoll_input_fd)
+        epoll_ctl (epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+#endif
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -1682,31 +1821,24 @@ define_sequence (int code, const char *seq, int action)
 gboolean
 is_idle (void)
 {
-    int nfd;
-    fd_set select_set;
-    struct timeval time_out;
+    struct pollfd fds[2];
+    nfds_t nfd = 1;
 
-    FD_ZERO (&select_set);
-    FD_SET (input_fd, &select_set);
-    nfd = MAX (0, input_fd) + 1;
-    time_out.tv_sec = 0;
-    time_out.tv_usec = 0;
+    fds[0].fd = input_fd;
+    fds[0].events = POLLIN;
 #ifdef HAVE_LIBGPM
     if (mouse_enabled && use_mouse_p == MOUSE_GPM)
     {
         if (gpm_fd >= 0)
         {
-            FD_SET (gpm_fd, &select_set);
-            nfd = MAX (nfd, gpm_fd + 1);
+            fds[1].fd = gpm_fd;
+            fds[1].events = POLLIN;
+            nfd++;
         }
         else
         {
             if (mouse_fd >= 0)  /* error indicative */
-            {
-                if (FD_ISSET (mouse_fd, &select_set))
-                    FD_CLR (mouse_fd, &select_set);
                 mouse_fd = gpm_fd;
-            }
             /* gpm_fd == -2 means under some X terminal */
             if (gpm_fd == -1)
             {
@@ -1716,7 +1848,7 @@ is_idle (void)
         }
     }
 #endif
-    return (select (nfd, &select_set, 0, 0, &time_out) <= 0);
+    return (poll (fds, nfd, 0) <= 0);
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -1959,29 +2091,18 @@ tty_get_event (struct Gpm_Event *event, gboolean redo_event, gboolean block)
     /* Repeat if using mouse */
     while (pending_keys == NULL)
     {
-        int nfd;
-        fd_set select_set;
-
-        FD_ZERO (&select_set);
-        FD_SET (input_fd, &select_set);
-        nfd = MAX (add_selects (&select_set), MAX (0, input_fd)) + 1;
+        int gpm = -1;
+        ready_fds_t ready;
 
 #ifdef HAVE_LIBGPM
         if (mouse_enabled && (use_mouse_p == MOUSE_GPM))
         {
             if (gpm_fd >= 0)
-            {
-                FD_SET (gpm_fd, &select_set);
-                nfd = MAX (nfd, gpm_fd + 1);
-            }
+                gpm = gpm_fd;
             else
             {
                 if (mouse_fd >= 0)      /* error indicative */
-                {
-                    if (FD_ISSET (mouse_fd, &select_set))
-                        FD_CLR (mouse_fd, &select_set);
                     mouse_fd = gpm_fd;
-                }
                 /* gpm_fd == -2 means under some X terminal */
                 if (gpm_fd == -1)
                 {
@@ -2028,7 +2149,7 @@ tty_get_event (struct Gpm_Event *event, gboolean redo_event, gboolean block)
         }
 
         tty_enable_interrupt_key ();
-        flag = select (nfd, &select_set, NULL, NULL, time_addr);
+        flag = wait_channels (&ready, gpm, time_addr);
         tty_disable_interrupt_key ();
 
         /* select timed out: it could be for any of the following reasons:
@@ -2047,9 +2168,9 @@ tty_get_event (struct Gpm_Event *event, gboolean redo_event, gboolean block)
         if (flag == -1 && errno == EINTR)
             return EV_NONE;
 
-        check_selects (&select_set);
+        check_selects (&ready);
 
-        if (FD_ISSET (input_fd, &select_set))
+        if (ready_fds_has (&ready, input_fd))
             break;
 
 #ifdef HAVE_LIBGPM
@@ -2057,7 +2178,7 @@ tty_get_event (struct Gpm_Event *event, gboolean redo_event, gboolean block)
         {
             if (gpm_fd >= 0)
             {
-                if (FD_ISSET (gpm_fd, &select_set))
+                if (ready_fds_has (&ready, gpm_fd))
                 {
                     int status;
 
@@ -2070,9 +2191,6 @@ tty_get_event (struct Gpm_Event *event, gboolean redo_event, gboolean block)
                     }
                     if (status <= 0)    /* connection closed; -1 == error */
                     {
-                        if (mouse_fd >= 0 && FD_ISSET (mouse_fd, &select_set))
-                            FD_CLR (mouse_fd, &select_set);
-
                         disable_mouse ();
                         return EV_NONE;
                     }
@@ -2081,11 +2199,7 @@ tty_get_event (struct Gpm_Event *event, gboolean redo_event, gboolean block)
             else
             {
                 if (mouse_fd >= 0)      /* error indicative */
-                {
-                    if (FD_ISSET (mouse_fd, &select_set))
-                        FD_CLR (mouse_fd, &select_set);
                     mouse_fd = gpm_fd;
-                }
                 /* gpm_fd == -2 means under some X terminal */
                 if (gpm_fd == -1)
                 {
@@ -116,6 +116,11 @@ typedef struct
         unsigned int stale_link:1;      /* If this is a symlink and points to Charon's land */
         unsigned int dir_size_computed:1;       /* Size of directory was computed with dirsizes_cmd */
     } f;
+
+    /* File highlight color computed by mc_fhl_get_color(), valid while fhl_stamp
+       matches the stamp of the highlighting rules. 0 means "not computed" */
+    int fhl_color;
+    unsigned int fhl_stamp;
 } file_entry_t;
 
 /*** global variables defined in .c file *********************************************************/
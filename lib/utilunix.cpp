@@ -81,8 +81,12 @@ struct sigaction startup_handler;
 
 /*** file scope macro definitions ****************************************************************/
 
-#define UID_CACHE_SIZE 200
-#define GID_CACHE_SIZE 30
+/* the caches of user and group names are flushed when they grow bigger */
+#define ID_CACHE_MAX 65536
+/* how long the names are trusted, microseconds */
+#define ID_CACHE_TTL (300 * G_USEC_PER_SEC)
+/* ... and how long the ids without names */
+#define ID_CACHE_NEGATIVE_TTL (60 * G_USEC_PER_SEC)
 
 /* Pipes are guaranteed to be able to hold at least 4096 bytes */
 /* More than that would be unportable */
@@ -92,9 +96,14 @@ struct sigaction startup_handler;
 
 typedef struct
 {
-    int index;
-    char *string;
-} int_cache;
+    char *name;                 /* user/group name or the number if there is no name */
+    gint64 expires;
+} id_cache_entry_t;
+
+typedef struct
+{
+    GHashTable *ids;            /* id -> id_cache_entry_t */
+} id_cache_t;
 
 typedef enum
 {
@@ -112,8 +121,8 @@ typedef struct
 
 /*** file scope variables ************************************************************************/
 
-static int_cache uid_cache[UID_CACHE_SIZE];
-static int_cache gid_cache[GID_CACHE_SIZE];
+static id_cache_t uid_cache = { NULL };
+static id_cache_t gid_cache = { NULL };
 
 static int error_pipe[2];       /* File descriptors of error pipe */
 static int old_error;           /* File descriptor of old standard error */
@@ -122,26 +131,67 @@ static int old_error;           /* File descriptor of old standard error */
 /*** file scope functions ************************************************************************/
 /* --------------------------------------------------------------------------------------------- */
 
-static char *
-i_cache_match (int id, int_cache * cache, int size)
+static void
+id_cache_entry_free (gpointer data)
 {
-    int i;
+    id_cache_entry_t *entry = (id_cache_entry_t *) data;
 
-    for (i = 0; i < size; i++)
-        if (cache[i].index == id)
-            return cache[i].string;
-    return 0;
+    g_free (entry->name);
+    g_free (entry);
 }
 
 /* --------------------------------------------------------------------------------------------- */
 
-static void
-i_cache_add (int id, int_cache * cache, int size, char *text, int *last)
+static const char *
+id_cache_match (id_cache_t * cache, unsigned long id, gint64 now)
 {
-    g_free (cache[*last].string);
-    cache[*last].string = g_strdup (text);
-    cache[*last].index = id;
-    *last = ((*last) + 1) % size;
+    id_cache_entry_t *entry;
+
+    if (cache->ids == NULL)
+        return NULL;
+
+    entry = (id_cache_entry_t *) g_hash_table_lookup (cache->ids, GSIZE_TO_POINTER (id));
+    if (entry == NULL || entry->expires < now)
+        return NULL;
+
+    return entry->name;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Remember the name of id.
+ *
+ * @param name name of id or NULL if id has no name
+ *
+ * @return the cached name, the number of id if it has no name
+ */
+
+static const char *
+id_cache_add (id_cache_t * cache, unsigned long id, const char *name, gint64 now)
+{
+    id_cache_entry_t *entry;
+
+    if (cache->ids == NULL)
+        cache->ids =
+            g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, id_cache_entry_free);
+    else if (g_hash_table_size (cache->ids) >= ID_CACHE_MAX)
+        g_hash_table_remove_all (cache->ids);
+
+    entry = g_new (id_cache_entry_t, 1);
+    if (name != NULL)
+    {
+        entry->name = g_strdup (name);
+        entry->expires = now + ID_CACHE_TTL;
+    }
+    else
+    {
+        entry->name = g_strdup_printf ("%lu", id);
+        entry->expires = now + ID_CACHE_NEGATIVE_TTL;
+    }
+
+    g_hash_table_replace (cache->ids, GSIZE_TO_POINTER (id), entry);
+
+    return entry->name;
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -283,26 +333,18 @@ const char *
 get_owner (uid_t uid)
 {
     struct passwd *pwd;
-    char *name;
-    static uid_t uid_last;
+    const char *name;
+    gint64 now;
 
-    name = i_cache_match ((int) uid, uid_cache, UID_CACHE_SIZE);
+    now = g_get_monotonic_time ();
+
+    name = id_cache_match (&uid_cache, (unsigned long) uid, now);
     if (name != NULL)
         return name;
 
     pwd = getpwuid (uid);
-    if (pwd != NULL)
-    {
-        i_cache_add ((int) uid, uid_cache, UID_CACHE_SIZE, pwd->pw_name, (int *) &uid_last);
-        return pwd->pw_name;
-    }
-    else
-    {
-        static char ibuf[10];
 
-        g_snprintf (ibuf, sizeof (ibuf), "%d", (int) uid);
-        return ibuf;
-    }
+    return id_cache_add (&uid_cache, (unsigned long) uid, pwd != NULL ? pwd->pw_name : NULL, now);
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -311,26 +353,18 @@ const char *
 get_group (gid_t gid)
 {
     struct group *grp;
-    char *name;
-    static gid_t gid_last;
+    const char *name;
+    gint64 now;
+
+    now = g_get_monotonic_time ();
 
-    name = i_cache_match ((int) gid, gid_cache, GID_CACHE_SIZE);
+    name = id_cache_match (&gid_cache, (unsigned long) gid, now);
     if (name != NULL)
         return name;
 
     grp = getgrgid (gid);
-    if (grp != NULL)
-    {
-        i_cache_add ((int) gid, gid_cache, GID_CACHE_SIZE, grp->gr_name, (int *) &gid_last);
-        return grp->gr_name;
-    }
-    else
-    {
-        static char gbuf[10];
 
-        g_snprintf (gbuf, sizeof (gbuf), "%d", (int) gid);
-        return gbuf;
-    }
+    return id_cache_add (&gid_cache, (unsigned long) gid, grp != NULL ? grp->gr_name : NULL, now);
 }
 
 /* --------------------------------------------------------------------------------------------- */
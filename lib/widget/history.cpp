@@ -200,7 +200,9 @@ history_descriptor_init (history_descriptor_t * hd, int y, int x, GList * histor
 void
 history_show (history_descriptor_t * hd)
 {
-    GList *z, *hi;
+    GList *z;
+    WLEntry *le;
+    int i;
     size_t count;
     WDialog *query_dlg;
     history_dlg_data hist_data;
@@ -242,7 +244,7 @@ history_show (history_descriptor_t * hd)
     {
         /* history is above base widget -- revert order to place recent item at bottom */
         /* revert history direction */
-        g_queue_reverse (hd->listbox->list);
+        listbox_reverse_list (hd->listbox);
         if (hd->current < 0 || (size_t) hd->current >= count)
             listbox_select_last (hd->listbox);
         else
@@ -278,9 +280,9 @@ history_show (history_descriptor_t * hd)
 
     /* get modified history from dialog */
     z = NULL;
-    for (hi = listbox_get_first_link (hd->listbox); hi != NULL; hi = g_list_next (hi))
+    for (i = 0; (le = listbox_get_nth_item (hd->listbox, i)) != NULL; i++)
         /* history is being reverted here again */
-        z = g_list_prepend (z, hd->release (hd, LENTRY (hi->data)));
+        z = g_list_prepend (z, hd->release (hd, le));
 
     /* restore history direction */
     if (WIDGET (query_dlg)->y < hd->y)
@@ -1050,15 +1050,13 @@ query_callback (Widget * w, Widget * sender, widget_msg_t msg, int parm, void *d
             {
                 int new_end;
                 int i;
-                GList *e;
+                WLEntry *le;
 
                 new_end = str_get_prev_char (&input->buffer[end]) - input->buffer;
 
-                for (i = 0, e = listbox_get_first_link (LISTBOX (g->current->data));
-                     e != NULL; i++, e = g_list_next (e))
+                for (i = 0; (le = listbox_get_nth_item (LISTBOX (g->current->data), i)) != NULL;
+                     i++)
                 {
-                    WLEntry *le = LENTRY (e->data);
-
                     if (strncmp (input->buffer + start, le->text, new_end - start) == 0)
                     {
                         listbox_select_entry (LISTBOX (g->current->data), i);
@@ -1088,7 +1086,7 @@ query_callback (Widget * w, Widget * sender, widget_msg_t msg, int parm, void *d
             else
             {
                 static char buff[MB_LEN_MAX] = "";
-                GList *e;
+                WLEntry *le;
                 int i;
                 int need_redraw = 0;
                 int low = 4096;
@@ -1108,11 +1106,9 @@ query_callback (Widget * w, Widget * sender, widget_msg_t msg, int parm, void *d
                     break;
                 }
 
-                for (i = 0, e = listbox_get_first_link (LISTBOX (g->current->data));
-                     e != NULL; i++, e = g_list_next (e))
+                for (i = 0; (le = listbox_get_nth_item (LISTBOX (g->current->data), i)) != NULL;
+                     i++)
                 {
-                    WLEntry *le = LENTRY (e->data);
-
                     if (strncmp (input->buffer + start, le->text, end - start) == 0
                         && strncmp (&le->text[end - start], buff, bl) == 0)
                     {
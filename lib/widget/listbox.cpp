@@ -49,7 +49,9 @@ const global_keymap_t *listbox_map = NULL;
 /*** file scope macro definitions ****************************************************************/
 
 /* Gives the position of the last item. */
-#define LISTBOX_LAST(l) (listbox_is_empty (l) ? 0 : (int) g_queue_get_length ((l)->list) - 1)
+#define LISTBOX_LAST(l) (listbox_is_empty (l) ? 0 : (int) (l)->list->len - 1)
+
+#define LISTBOX_ENTRY(l, i) LENTRY (g_ptr_array_index ((l)->list, (i)))
 
 /*** file scope type declarations ****************************************************************/
 
@@ -58,13 +60,8 @@ const global_keymap_t *listbox_map = NULL;
 /*** file scope functions ************************************************************************/
 
 static int
-listbox_entry_cmp (const void *a, const void *b, void *user_data)
+listbox_entry_cmp (const WLEntry * ea, const WLEntry * eb)
 {
-    const WLEntry *ea = (const WLEntry *) a;
-    const WLEntry *eb = (const WLEntry *) b;
-
-    (void) user_data;
-
     return strcmp (ea->text, eb->text);
 }
 
@@ -83,6 +80,89 @@ listbox_entry_free (void *data)
 
 /* --------------------------------------------------------------------------------------------- */
 
+/* Forget the text index; it is rebuilt by the next lookup. */
+static void
+listbox_index_drop (WListbox * l)
+{
+    if (l->index != NULL)
+    {
+        g_hash_table_destroy (l->index);
+        l->index = NULL;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* Remember the position of the first entry with the given text. */
+static void
+listbox_index_add (WListbox * l, WLEntry * e, guint pos)
+{
+    if (l->index != NULL && g_hash_table_lookup (l->index, e->text) == NULL)
+        g_hash_table_insert (l->index, e->text, GUINT_TO_POINTER (pos + 1));
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+listbox_index_build (WListbox * l)
+{
+    guint i;
+
+    if (l->index != NULL)
+        return;
+
+    l->index = g_hash_table_new (g_str_hash, g_str_equal);
+
+    for (i = 0; i < l->list->len; i++)
+        listbox_index_add (l, LISTBOX_ENTRY (l, i), i);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* Insert entry at given position shifting the tail; g_ptr_array_insert() needs glib 2.40. */
+static void
+listbox_insert_at (WListbox * l, guint pos, WLEntry * e)
+{
+    guint len = l->list->len;
+
+    if (pos >= len)
+    {
+        g_ptr_array_add (l->list, e);
+        listbox_index_add (l, e, len);
+        return;
+    }
+
+    g_ptr_array_add (l->list, NULL);
+    memmove (&l->list->pdata[pos + 1], &l->list->pdata[pos], (len - pos) * sizeof (gpointer));
+    l->list->pdata[pos] = e;
+
+    /* positions after the insertion point are shifted */
+    listbox_index_drop (l);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* Position of the first entry that sorts after e, like g_queue_insert_sorted() does. */
+static guint
+listbox_sorted_pos (const WListbox * l, const WLEntry * e)
+{
+    guint lo = 0, hi = l->list->len;
+
+    while (lo < hi)
+    {
+        guint mid = lo + (hi - lo) / 2;
+
+        if (listbox_entry_cmp (LISTBOX_ENTRY (l, mid), e) <= 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
 static void
 listbox_drawscroll (WListbox * l)
 {
@@ -99,7 +179,7 @@ listbox_drawscroll (WListbox * l)
     else
         tty_print_char ('^');
 
-    length = g_queue_get_length (l->list);
+    length = (int) l->list->len;
 
     /* Are we at the bottom? */
     widget_gotoyx (w, max_line, w->cols);
@@ -109,7 +189,7 @@ listbox_drawscroll (WListbox * l)
         tty_print_char ('v');
 
     /* Now draw the nice relative pointer */
-    if (!g_queue_is_empty (l->list))
+    if (length != 0)
         line = 1 + ((l->pos * (w->lines - 2)) / length);
 
     for (i = 1; i < max_line; i++)
@@ -132,7 +212,6 @@ listbox_draw (WListbox * l, gboolean focused)
     gboolean disabled;
     int normalc, selc;
     int length = 0;
-    GList *le = NULL;
     int pos;
     int i;
     int sel_line = -1;
@@ -144,13 +223,10 @@ listbox_draw (WListbox * l, gboolean focused)
     selc = disabled ? DISABLED_COLOR : colors[focused ? DLG_COLOR_HOT_FOCUS : DLG_COLOR_FOCUS];
 
     if (l->list != NULL)
-    {
-        length = g_queue_get_length (l->list);
-        le = g_queue_peek_nth_link (l->list, (guint) l->top);
-    }
+        length = (int) l->list->len;
 
-    /*    pos = (le == NULL) ? 0 : g_list_position (l->list, le); */
-    pos = (le == NULL) ? 0 : l->top;
+    /* only the visible rows are touched */
+    pos = (l->top < length) ? l->top : 0;
 
     for (i = 0; i < w->lines; i++)
     {
@@ -167,12 +243,9 @@ listbox_draw (WListbox * l, gboolean focused)
 
         widget_gotoyx (l, i, 1);
 
-        if (l->list != NULL && le != NULL && (i == 0 || pos < length))
+        if (pos < length)
         {
-            WLEntry *e = LENTRY (le->data);
-
-            text = e->text;
-            le = g_list_next (le);
+            text = LISTBOX_ENTRY (l, pos)->text;
             pos++;
         }
 
@@ -195,16 +268,11 @@ listbox_check_hotkey (WListbox * l, int key)
 {
     if (!listbox_is_empty (l))
     {
-        int i;
-        GList *le;
-
-        for (i = 0, le = g_queue_peek_head_link (l->list); le != NULL; i++, le = g_list_next (le))
-        {
-            WLEntry *e = LENTRY (le->data);
+        guint i;
 
-            if (e->hotkey == key)
-                return i;
-        }
+        for (i = 0; i < l->list->len; i++)
+            if (LISTBOX_ENTRY (l, i)->hotkey == key)
+                return (int) i;
     }
 
     return (-1);
@@ -226,7 +294,7 @@ listbox_fwd (WListbox * l, gboolean wrap)
 {
     if (!listbox_is_empty (l))
     {
-        if ((guint) l->pos + 1 < g_queue_get_length (l->list))
+        if ((guint) l->pos + 1 < l->list->len)
             listbox_select_entry (l, l->pos + 1);
         else if (wrap)
             listbox_select_first (l);
@@ -271,7 +339,7 @@ listbox_execute_cmd (WListbox * l, long command)
     cb_ret_t ret = MSG_HANDLED;
     Widget *w = WIDGET (l);
 
-    if (l->list == NULL || g_queue_is_empty (l->list))
+    if (listbox_is_empty (l))
         return MSG_NOT_HANDLED;
 
     switch (command)
@@ -300,7 +368,7 @@ listbox_execute_cmd (WListbox * l, long command)
             gboolean is_last, is_more;
             int length;
 
-            length = g_queue_get_length (l->list);
+            length = (int) l->list->len;
 
             is_last = (l->pos + 1 >= length);
             is_more = (l->top + w->lines >= length);
@@ -362,26 +430,26 @@ listbox_append_item (WListbox * l, WLEntry * e, listbox_append_t pos)
 {
     if (l->list == NULL)
     {
-        l->list = g_queue_new ();
+        l->list = g_ptr_array_new ();
         pos = LISTBOX_APPEND_AT_END;
     }
 
     switch (pos)
     {
     case LISTBOX_APPEND_AT_END:
-        g_queue_push_tail (l->list, e);
+        listbox_insert_at (l, l->list->len, e);
         break;
 
     case LISTBOX_APPEND_BEFORE:
-        g_queue_insert_before (l->list, g_queue_peek_nth_link (l->list, (guint) l->pos), e);
+        listbox_insert_at (l, (guint) l->pos, e);
         break;
 
     case LISTBOX_APPEND_AFTER:
-        g_queue_insert_after (l->list, g_queue_peek_nth_link (l->list, (guint) l->pos), e);
+        listbox_insert_at (l, (guint) l->pos + 1, e);
         break;
 
     case LISTBOX_APPEND_SORTED:
-        g_queue_insert_sorted (l->list, e, (GCompareDataFunc) listbox_entry_cmp, NULL);
+        listbox_insert_at (l, listbox_sorted_pos (l, e), e);
         break;
 
     default:
@@ -555,6 +623,7 @@ listbox_new (int y, int x, int height, int width, gboolean deletable, lcback_fn
     w->keymap = listbox_map;
 
     l->list = NULL;
+    l->index = NULL;
     l->top = l->pos = 0;
     l->deletable = deletable;
     l->callback = callback;
@@ -574,16 +643,13 @@ listbox_search_text (WListbox * l, const char *text)
 {
     if (!listbox_is_empty (l))
     {
-        int i;
-        GList *le;
+        gpointer pos;
 
-        for (i = 0, le = g_queue_peek_head_link (l->list); le != NULL; i++, le = g_list_next (le))
-        {
-            WLEntry *e = LENTRY (le->data);
+        listbox_index_build (l);
 
-            if (strcmp (e->text, text) == 0)
-                return i;
-        }
+        pos = g_hash_table_lookup (l->index, text);
+        if (pos != NULL)
+            return (int) GPOINTER_TO_UINT (pos) - 1;
     }
 
     return (-1);
@@ -599,16 +665,11 @@ listbox_search_data (WListbox * l, const void *data)
 {
     if (!listbox_is_empty (l))
     {
-        int i;
-        GList *le;
-
-        for (i = 0, le = g_queue_peek_head_link (l->list); le != NULL; i++, le = g_list_next (le))
-        {
-            WLEntry *e = LENTRY (le->data);
+        guint i;
 
-            if (e->data == data)
-                return i;
-        }
+        for (i = 0; i < l->list->len; i++)
+            if (LISTBOX_ENTRY (l, i)->data == data)
+                return (int) i;
     }
 
     return (-1);
@@ -643,33 +704,22 @@ listbox_select_last (WListbox * l)
 void
 listbox_select_entry (WListbox * l, int dest)
 {
-    GList *le;
-    int pos;
-    gboolean top_seen = FALSE;
-
     if (listbox_is_empty (l) || dest < 0)
         return;
 
-    /* Special case */
-    for (pos = 0, le = g_queue_peek_head_link (l->list); le != NULL; pos++, le = g_list_next (le))
+    if ((guint) dest < l->list->len)
     {
-        if (pos == l->top)
-            top_seen = TRUE;
-
-        if (pos == dest)
+        l->pos = dest;
+        if (l->pos < l->top)
+            l->top = l->pos;
+        else
         {
-            l->pos = dest;
-            if (!top_seen)
-                l->top = l->pos;
-            else
-            {
-                int lines = WIDGET (l)->lines;
-
-                if (l->pos - l->top >= lines)
-                    l->top = l->pos - lines + 1;
-            }
-            return;
+            int lines = WIDGET (l)->lines;
+
+            if (l->pos - l->top >= lines)
+                l->top = l->pos - lines + 1;
         }
+        return;
     }
 
     /* If we are unable to find it, set decent values */
@@ -681,7 +731,7 @@ listbox_select_entry (WListbox * l, int dest)
 int
 listbox_get_length (const WListbox * l)
 {
-    return listbox_is_empty (l) ? 0 : (int) g_queue_get_length (l->list);
+    return listbox_is_empty (l) ? 0 : (int) l->list->len;
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -710,41 +760,25 @@ listbox_get_current (WListbox * l, char **string, void **extra)
 WLEntry *
 listbox_get_nth_item (const WListbox * l, int pos)
 {
-    if (!listbox_is_empty (l) && pos >= 0)
-    {
-        GList *item;
-
-        item = g_queue_peek_nth_link (l->list, (guint) pos);
-        if (item != NULL)
-            return LENTRY (item->data);
-    }
+    if (!listbox_is_empty (l) && pos >= 0 && (guint) pos < l->list->len)
+        return LISTBOX_ENTRY (l, pos);
 
     return NULL;
 }
 
 /* --------------------------------------------------------------------------------------------- */
 
-GList *
-listbox_get_first_link (const WListbox * l)
-{
-    return (l == NULL || l->list == NULL) ? NULL : g_queue_peek_head_link (l->list);
-}
-
-/* --------------------------------------------------------------------------------------------- */
-
 void
 listbox_remove_current (WListbox * l)
 {
     if (!listbox_is_empty (l))
     {
-        GList *current;
         int length;
 
-        current = g_queue_peek_nth_link (l->list, (guint) l->pos);
-        listbox_entry_free (LENTRY (current->data));
-        g_queue_delete_link (l->list, current);
+        listbox_index_drop (l);
+        listbox_entry_free (g_ptr_array_remove_index (l->list, (guint) l->pos));
 
-        length = g_queue_get_length (l->list);
+        length = (int) l->list->len;
 
         if (length == 0)
             l->top = l->pos = 0;
@@ -758,7 +792,29 @@ listbox_remove_current (WListbox * l)
 gboolean
 listbox_is_empty (const WListbox * l)
 {
-    return (l == NULL || l->list == NULL || g_queue_is_empty (l->list));
+    return (l == NULL || l->list == NULL || l->list->len == 0);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* Reverse the order of entries in place. */
+void
+listbox_reverse_list (WListbox * l)
+{
+    if (!listbox_is_empty (l))
+    {
+        guint i, j;
+
+        for (i = 0, j = l->list->len - 1; i < j; i++, j--)
+        {
+            gpointer tmp = l->list->pdata[i];
+
+            l->list->pdata[i] = l->list->pdata[j];
+            l->list->pdata[j] = tmp;
+        }
+
+        listbox_index_drop (l);
+    }
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -767,10 +823,10 @@ listbox_is_empty (const WListbox * l)
  * Set new listbox items list.
  *
  * @param l WListbox object
- * @param list list of WLEntry objects
+ * @param list array of WLEntry objects
  */
 void
-listbox_set_list (WListbox * l, GQueue * list)
+listbox_set_list (WListbox * l, GPtrArray * list)
 {
     listbox_remove_list (l);
 
@@ -785,9 +841,12 @@ listbox_remove_list (WListbox * l)
 {
     if (l != NULL)
     {
+        listbox_index_drop (l);
+
         if (l->list != NULL)
         {
-            g_queue_free_full (l->list, (GDestroyNotify) listbox_entry_free);
+            g_ptr_array_foreach (l->list, (GFunc) listbox_entry_free, NULL);
+            g_ptr_array_free (l->list, TRUE);
             l->list = NULL;
         }
 
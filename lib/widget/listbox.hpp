@@ -43,7 +43,8 @@ typedef struct WLEntry
 typedef struct WListbox
 {
     Widget widget;
-    GQueue *list;               /* Pointer to the list of WLEntry */
+    GPtrArray *list;            /* Pointer to the array of WLEntry */
+    GHashTable *index;          /* Text -> first position, built on demand */
     int pos;                    /* The current element displayed */
     int top;                    /* The first element displayed */
     gboolean allow_duplicates;  /* Do we allow duplicates on the list? */
@@ -68,10 +69,10 @@ void listbox_select_entry (WListbox * l, int dest);
 int listbox_get_length (const WListbox * l);
 void listbox_get_current (WListbox * l, char **string, void **extra);
 WLEntry *listbox_get_nth_item (const WListbox * l, int pos);
-GList *listbox_get_first_link (const WListbox * l);
 void listbox_remove_current (WListbox * l);
 gboolean listbox_is_empty (const WListbox * l);
-void listbox_set_list (WListbox * l, GQueue * list);
+void listbox_reverse_list (WListbox * l);
+void listbox_set_list (WListbox * l, GPtrArray * list);
 void listbox_remove_list (WListbox * l);
 char *listbox_add_item (WListbox * l, listbox_append_t pos, int hotkey, const char *text,
                         void *data, gboolean free_data);
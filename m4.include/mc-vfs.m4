@@ -16,6 +16,7 @@ m4_include([m4.include/vfs/mc-vfs-sftp.m4])
 m4_include([m4.include/vfs/mc-vfs-fish.m4])
 m4_include([m4.include/vfs/mc-vfs-undelfs.m4])
 m4_include([m4.include/vfs/mc-vfs-tarfs.m4])
+m4_include([m4.include/vfs/mc-vfs-zipfs.m4])
 m4_include([m4.include/vfs/mc-vfs-cpiofs.m4])
 m4_include([m4.include/vfs/mc-vfs-samba.m4])
 
@@ -78,6 +79,7 @@ AC_DEFUN([mc_VFS_CHECKS],
     mc_VFS_SMB
     mc_VFS_TARFS
     mc_VFS_UNDELFS
+    mc_VFS_ZIPFS
 
     AM_CONDITIONAL(ENABLE_VFS, [test x"$enable_vfs" = x"yes"])
 
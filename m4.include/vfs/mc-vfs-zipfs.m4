@@ -0,0 +1,29 @@
+dnl ZIP filesystem support
+AC_DEFUN([mc_VFS_ZIPFS],
+[
+    AC_ARG_ENABLE([vfs-zip],
+		    AS_HELP_STRING([--enable-vfs-zip], [Support for zip filesystem @<:@auto@:>@]))
+    dnl without zlib, mc.ext opens zip archives with the uzip extfs helper
+    ZIP_VFS_PREFIX="uzip"
+    if test "$enable_vfs" = "yes" -a x"$enable_vfs_zip" != x"no"; then
+	AC_CHECK_HEADER([zlib.h],
+	    [AC_CHECK_LIB([z], [inflateInit2_], [found_zlib=yes])])
+	if test x"$found_zlib" = x"yes"; then
+	    enable_vfs_zip="yes"
+	    mc_VFS_ADDNAME([zip])
+	    AC_DEFINE([ENABLE_VFS_ZIP], [1], [Support for zip filesystem])
+	    ZIP_VFS_PREFIX="zip"
+	    ZLIB_LIBS="-lz"
+	    MCLIBS="$MCLIBS $ZLIB_LIBS"
+	else
+	    if test x"$enable_vfs_zip" = x"yes"; then
+		dnl user explicitly requested feature
+		AC_MSG_ERROR([zlib library not found])
+	    fi
+	    enable_vfs_zip="no"
+	fi
+    fi
+    AC_SUBST(ZLIB_LIBS)
+    AC_SUBST(ZIP_VFS_PREFIX)
+    AM_CONDITIONAL(ENABLE_VFS_ZIP, [test "$enable_vfs" = "yes" -a x"$enable_vfs_zip" = x"yes"])
+])
@@ -53,6 +53,8 @@
 #define COLUMN_OFF      609
 #define DELCHAR_BR      610
 #define BACKSPACE_BR    611
+#define SPAN_INSERT     612     /* insert a run of bytes kept aside (from backspaces) */
+#define SPAN_INSERT_AHEAD 613   /* insert ahead a run of bytes kept aside (from deletes) */
 #define MARK_1          1000
 #define MARK_2          500000000
 #define MARK_CURS       1000000000
@@ -125,7 +127,7 @@ extern edit_stack_type edit_history_moveto[MAX_HISTORY_MOVETO];
 
 extern int option_line_state_width;
 
-extern int option_max_undo;
+extern long option_max_undo_size;
 extern bool option_auto_syntax;
 
 extern bool search_create_bookmark;
@@ -82,7 +82,7 @@ bool option_backspace_through_tabs = FALSE;
 bool option_fake_half_tabs = TRUE;
 int option_save_mode = EDIT_QUICK_SAVE;
 bool option_save_position = TRUE;
-int option_max_undo = 32768;
+long option_max_undo_size = 256L * 1024 * 1024;
 bool option_persistent_selections = TRUE;
 bool option_cursor_beyond_eol = FALSE;
 bool option_line_state = FALSE;
@@ -374,6 +374,153 @@ static bool check_file_access (WEdit * edit, const vfs_path_t * filename_vpath,
 
 /* --------------------------------------------------------------------------------------------- */
 
+/** Free all byte runs kept aside for an undo or redo stack */
+
+static void
+edit_spans_clear (GQueue * spans, gsize * size)
+{
+    GString *s;
+
+    while ((s = (GString *) g_queue_pop_head (spans)) != NULL)
+        g_string_free (s, TRUE);
+
+    *size = 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Free the byte runs referenced by the stack entry at pos, which falls off the stack bottom */
+
+static void
+edit_spans_drop_entry (const long *stack, unsigned long pos, unsigned long mask, GQueue * spans,
+                       gsize * size)
+{
+    long v = stack[pos];
+    long n = 0;
+
+    if (v == SPAN_INSERT || v == SPAN_INSERT_AHEAD)
+        n = 1;
+    else if (v < 0)
+    {
+        long d = stack[(pos - 1) & mask];
+
+        /* the first of the repeated runs was dropped with the previous entry */
+        if (d == SPAN_INSERT || d == SPAN_INSERT_AHEAD)
+            n = -v - 1;
+    }
+
+    for (; n > 0; n--)
+    {
+        GString *s;
+
+        s = (GString *) g_queue_pop_head (spans);
+        if (s == NULL)
+            break;
+        *size -= s->len;
+        g_string_free (s, TRUE);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Erase the oldest key press worth of actions by moving the stack bottom forward */
+
+static void
+edit_stack_drop_oldest (const long *stack, unsigned long *bottom, unsigned long pointer,
+                        unsigned long mask, GQueue * spans, gsize * size)
+{
+    do
+    {
+        edit_spans_drop_entry (stack, *bottom, mask, spans, size);
+        *bottom = (*bottom + 1) & mask;
+    }
+    while (stack[*bottom] < KEY_PRESS && *bottom != pointer);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Record a removed byte (0-255 from a backspace, 256-511 from a delete) as part of a run kept
+ * aside instead of a stack entry of its own. The second byte in a row of the same kind turns
+ * the top entry into SPAN_INSERT or SPAN_INSERT_AHEAD; further bytes are appended to that run.
+ *
+ * @return TRUE if the byte was recorded, FALSE if it should be pushed as usual
+ */
+
+static gboolean
+edit_spans_push_byte (long *stack, unsigned long sp, unsigned long bottom, unsigned long mask,
+                      GQueue * spans, gsize * size, long c)
+{
+    long code, top;
+    unsigned long spm1;
+    GString *s;
+
+    if (c < 0 || c >= 512 || sp == bottom)
+        return FALSE;
+
+    code = c < 256 ? SPAN_INSERT : SPAN_INSERT_AHEAD;
+    spm1 = (sp - 1) & mask;
+    top = stack[spm1];
+
+    if (top == code || (top < 0 && spm1 != bottom && stack[(sp - 2) & mask] == code))
+    {
+        s = (GString *) g_queue_peek_tail (spans);
+        if (s == NULL)
+            return FALSE;
+        g_string_append_c (s, (char) (c & 0xff));
+        (*size)++;
+        return TRUE;
+    }
+
+    if (top >= 0 && top < 512 && spm1 != bottom && (top & ~0xffL) == (c & ~0xffL))
+    {
+        s = g_string_sized_new (64);
+        g_string_append_c (s, (char) (top & 0xff));
+        g_string_append_c (s, (char) (c & 0xff));
+        g_queue_push_tail (spans, s);
+        *size += 2;
+        stack[spm1] = code;
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Put back a run of bytes popped from the undo or redo stack */
+
+static void
+edit_spans_replay (WEdit * edit, long ac, GQueue * spans, gsize * size)
+{
+    GString *s;
+    gsize i;
+
+    s = (GString *) g_queue_pop_tail (spans);
+    if (s == NULL)
+        return;
+
+    *size -= s->len;
+
+    /* bytes were recorded in the order they were removed */
+    for (i = s->len; i > 0; i--)
+    {
+        if (ac == SPAN_INSERT)
+            edit_insert (edit, (unsigned char) s->str[i - 1]);
+        else
+            edit_insert_ahead (edit, (unsigned char) s->str[i - 1]);
+    }
+
+    g_string_free (s, TRUE);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+edit_redo_stack_clear (WEdit * edit)
+{
+    edit->redo_stack_bottom = edit->redo_stack_pointer = 0;
+    edit_spans_clear (edit->redo_spans, &edit->redo_spans_size);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
 /**
  * Open the file and load it into the buffers, either directly or using
  * a filter.  Return TRUE on success, FALSE on error.
@@ -444,6 +591,8 @@ static bool edit_load_file (WEdit * edit)
                 return FALSE;
             }
             edit->undo_stack_disable = 0;
+            /* loading is not an action to redo */
+            edit_redo_stack_clear (edit);
         }
     }
     edit->lb = LB_ASIS;
@@ -1139,6 +1288,10 @@ edit_do_undo (WEdit * edit)
     long ac;
     long count = 0;
 
+    /* all actions replayed below are redone at once */
+    if (get_prev_undo_action (edit) != STACK_BOTTOM)
+        edit_push_redo_action (edit, KEY_PRESS + edit->start_display);
+
     edit->undo_stack_disable = 1;       /* don't record undo's onto undo stack! */
     edit->over_col = 0;
     while ((ac = edit_pop_undo_action (edit)) < KEY_PRESS)
@@ -1161,6 +1314,10 @@ edit_do_undo (WEdit * edit)
         case DELCHAR_BR:
             edit_delete (edit, TRUE);
             break;
+        case SPAN_INSERT:
+        case SPAN_INSERT_AHEAD:
+            edit_spans_replay (edit, ac, edit->undo_spans, &edit->undo_spans_size);
+            break;
         case COLUMN_ON:
             edit->column_highlight = 1;
             break;
@@ -1246,6 +1403,10 @@ edit_do_redo (WEdit * edit)
         case DELCHAR:
             edit_delete (edit, TRUE);
             break;
+        case SPAN_INSERT:
+        case SPAN_INSERT_AHEAD:
+            edit_spans_replay (edit, ac, edit->redo_spans, &edit->redo_spans_size);
+            break;
         case COLUMN_ON:
             edit->column_highlight = 1;
             break;
@@ -1747,6 +1908,22 @@ edit_insert_column_from_file (WEdit * edit, int file, off_t * start_pos, off_t *
     return blocklen;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/** Return the first '\n' or '\r' in [p, end), or end if there is none. */
+
+static const char *
+edit_find_line_break (const char *p, const char *end)
+{
+    const char *nl, *cr;
+
+    nl = static_cast<const char *> (memchr (p, '\n', end - p));
+    if (nl == NULL)
+        nl = end;
+    cr = static_cast<const char *> (memchr (p, '\r', nl - p));
+
+    return cr != NULL ? cr : nl;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /*** public functions ****************************************************************************/
 /* --------------------------------------------------------------------------------------------- */
@@ -1832,99 +2009,74 @@ edit_get_write_filter (const vfs_path_t * write_name_vpath, const vfs_path_t * f
 off_t
 edit_write_stream (WEdit * edit, FILE * f)
 {
-    long i;
+    const edit_buffer_t *buf = &edit->buffer;
+    const char *eol;
+    size_t eol_len;
+    off_t i = 0;
 
-    if (edit->lb == LB_ASIS)
+    switch (edit->lb)
     {
-        for (i = 0; i < edit->buffer.size; i++)
-            if (fputc (edit_buffer_get_byte (&edit->buffer, i), f) < 0)
-                break;
-        return i;
+    case LB_UNIX:
+        eol = "\n";
+        break;
+    case LB_WIN:
+        eol = "\r\n";
+        break;
+    case LB_MAC:
+        eol = "\r";
+        break;
+    case LB_ASIS:
+    default:
+        eol = NULL;
+        break;
     }
+    eol_len = eol != NULL ? strlen (eol) : 0;
 
-    /* change line breaks */
-    for (i = 0; i < edit->buffer.size; i++)
+    /* write whole parts of the buffer; only line breaks are rewritten */
+    while (i < buf->size)
     {
-        unsigned char c;
+        const char *span, *p, *end;
+        off_t len;
+
+        span = edit_buffer_get_span (buf, i, &len);
+        end = span + len;
 
-        c = edit_buffer_get_byte (&edit->buffer, i);
-        if (!(c == '\n' || c == '\r'))
+        if (eol == NULL)
         {
-            /* not line break */
-            if (fputc (c, f) < 0)
+            if (fwrite (span, 1, len, f) != (size_t) len)
                 return i;
+            i += len;
+            continue;
         }
-        else
-        {                       /* (c == '\n' || c == '\r') */
-            unsigned char c1;
-
-            c1 = edit_buffer_get_byte (&edit->buffer, i + 1);   /* next char */
-
-            switch (edit->lb)
-            {
-            case LB_UNIX:      /* replace "\r\n" or '\r' to '\n' */
-                /* put one line break unconditionally */
-                if (fputc ('\n', f) < 0)
-                    return i;
-
-                i++;            /* 2 chars are processed */
-
-                if (c == '\r' && c1 == '\n')
-                    /* Windows line break; go to the next char */
-                    break;
-
-                if (c == '\r' && c1 == '\r')
-                {
-                    /* two Macintosh line breaks; put second line break */
-                    if (fputc ('\n', f) < 0)
-                        return i;
-                    break;
-                }
 
-                if (fputc (c1, f) < 0)
-                    return i;
-                break;
-
-            case LB_WIN:       /* replace '\n' or '\r' to "\r\n" */
-                /* put one line break unconditionally */
-                if (fputc ('\r', f) < 0 || fputc ('\n', f) < 0)
-                    return i;
+        for (p = span; p < end;)
+        {
+            const char *brk;
+            size_t run;
+            off_t step = 1;
 
-                if (c == '\r' && c1 == '\n')
-                    /* Windows line break; go to the next char */
-                    i++;
+            brk = edit_find_line_break (p, end);
+            run = brk - p;
+            if (run != 0 && fwrite (p, 1, run, f) != run)
+                return i;
+            i += run;
+            if (brk == end)
                 break;
 
-            case LB_MAC:       /* replace "\r\n" or '\n' to '\r' */
-                /* put one line break unconditionally */
-                if (fputc ('\r', f) < 0)
-                    return i;
-
-                i++;            /* 2 chars are processed */
-
-                if (c == '\r' && c1 == '\n')
-                    /* Windows line break; go to the next char */
-                    break;
-
-                if (c == '\n' && c1 == '\n')
-                {
-                    /* two Windows line breaks; put second line break */
-                    if (fputc ('\r', f) < 0)
-                        return i;
-                    break;
-                }
-
-                if (fputc (c1, f) < 0)
-                    return i;
-                break;
-            case LB_ASIS:      /* default without changes */
-            default:
-                break;
-            }
+            /* "\r\n", '\r' and '\n' are one line break each */
+            if (fwrite (eol, 1, eol_len, f) != eol_len)
+                return i;
+            if (*brk == '\r' && i + 1 < buf->size
+                && (brk + 1 < end ? brk[1] : edit_buffer_get_byte (buf, i + 1)) == '\n')
+                step = 2;
+            i += step;
+            if (end - brk <= step)
+                break;          /* "\r\n" may end in the next part of the buffer */
+            p = brk + step;
         }
     }
 
-    return edit->buffer.size;
+    return buf->size;
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -2128,6 +2280,11 @@ edit_init (WEdit * edit, int y, int x, int lines, int cols, const vfs_path_t * f
     edit->redo_stack_size_mask = START_STACK_SIZE - 1;
     edit->redo_stack = static_cast<long*>(g_malloc0 ((edit->redo_stack_size + 10) * sizeof (long)));
 
+    edit->undo_spans = g_queue_new ();
+    edit->undo_spans_size = 0;
+    edit->redo_spans = g_queue_new ();
+    edit->redo_spans_size = 0;
+
 #ifdef HAVE_CHARSET
     edit->utf8 = FALSE;
     edit->converter = str_cnv_from_term;
@@ -2195,6 +2352,16 @@ edit_clean (WEdit * edit)
 
     g_free (edit->undo_stack);
     g_free (edit->redo_stack);
+    if (edit->undo_spans != NULL)
+    {
+        edit_spans_clear (edit->undo_spans, &edit->undo_spans_size);
+        g_queue_free (edit->undo_spans);
+    }
+    if (edit->redo_spans != NULL)
+    {
+        edit_spans_clear (edit->redo_spans, &edit->redo_spans_size);
+        g_queue_free (edit->redo_spans);
+    }
     vfs_path_free (edit->filename_vpath);
     vfs_path_free (edit->dir_vpath);
     mc_search_free (edit->search);
@@ -2301,6 +2468,12 @@ edit_set_codeset (WEdit * edit)
  * set edit->mark1 position. 700'000'000 through 1400'000'000 is to set edit->mark2
  * position.
  *
+ * Consecutive removed bytes of the same kind are not stored one per entry: they are
+ * appended to a byte run kept aside in edit->undo_spans and a single SPAN_INSERT or
+ * SPAN_INSERT_AHEAD entry refers to it, so deleting a large block costs one entry and is
+ * undone in one pass. The stack and the bytes kept aside are limited by option_max_undo_size;
+ * the oldest key presses are dropped to stay under it.
+ *
  * The only way the cursor moves or the buffer is changed is through the routines:
  * insert, backspace, insert_ahead, delete, and cursor_move.
  * These record the reverse undo movements onto the stack each time they are
@@ -2328,9 +2501,9 @@ edit_push_undo_action (WEdit * edit, long c)
     /* first enlarge the stack if necessary */
     if (sp > edit->undo_stack_size - 10)
     {                           /* say */
-        if (option_max_undo < 256)
-            option_max_undo = 256;
-        if (edit->undo_stack_size < (unsigned long) option_max_undo)
+        /* stack entries and bytes kept aside share one memory limit */
+        if ((edit->undo_stack_size * 2 + 10) * sizeof (long) + edit->undo_spans_size
+            <= (gsize) option_max_undo_size)
         {
             t = static_cast<long*>(g_realloc (edit->undo_stack, (edit->undo_stack_size * 2 + 10) * sizeof (long)));
             if (t)
@@ -2344,19 +2517,50 @@ edit_push_undo_action (WEdit * edit, long c)
     spm1 = (edit->undo_stack_pointer - 1) & edit->undo_stack_size_mask;
     if (edit->undo_stack_disable)
     {
-        edit_push_redo_action (edit, KEY_PRESS);
+        /* the key press for the redo group is pushed by edit_do_undo() */
+        if (c == BACKSPACE_BR)
+            c = BACKSPACE;
+        else if (c == DELCHAR_BR)
+            c = DELCHAR;
         edit_push_redo_action (edit, c);
         return;
     }
 
     if (edit->redo_stack_reset)
-        edit->redo_stack_bottom = edit->redo_stack_pointer = 0;
+        edit_redo_stack_clear (edit);
+
+    if (edit_spans_push_byte (edit->undo_stack, sp, edit->undo_stack_bottom,
+                              edit->undo_stack_size_mask, edit->undo_spans,
+                              &edit->undo_spans_size, c))
+    {
+        /* keep the bytes kept aside under the limit, dropping the oldest key presses */
+        while ((long) edit->undo_spans_size > option_max_undo_size
+               && edit->undo_stack_bottom != edit->undo_stack_pointer)
+            edit_stack_drop_oldest (edit->undo_stack, &edit->undo_stack_bottom,
+                                    edit->undo_stack_pointer, edit->undo_stack_size_mask,
+                                    edit->undo_spans, &edit->undo_spans_size);
+        if (edit->undo_stack_bottom == edit->undo_stack_pointer)
+        {
+            edit->undo_stack_bottom = edit->undo_stack_pointer = 0;
+            edit_spans_clear (edit->undo_spans, &edit->undo_spans_size);
+        }
+        return;
+    }
 
     if (edit->undo_stack_bottom != sp
         && spm1 != edit->undo_stack_bottom
         && ((sp - 2) & edit->undo_stack_size_mask) != edit->undo_stack_bottom)
     {
         long d;
+
+        /* a run of inserts or deletes within a key press is one action for group undo */
+        d = edit->undo_stack[spm1] < 0 ? edit->undo_stack[(sp - 2) & edit->undo_stack_size_mask]
+            : edit->undo_stack[spm1];
+        if ((c == BACKSPACE || c == BACKSPACE_BR) && (d == BACKSPACE || d == BACKSPACE_BR))
+            c = d;
+        else if ((c == DELCHAR || c == DELCHAR_BR) && (d == DELCHAR || d == DELCHAR_BR))
+            c = d;
+
         if (edit->undo_stack[spm1] < 0)
         {
             d = edit->undo_stack[(sp - 2) & edit->undo_stack_size_mask];
@@ -2390,18 +2594,16 @@ edit_push_undo_action (WEdit * edit, long c)
     c = (edit->undo_stack_pointer + 2) & edit->undo_stack_size_mask;
     if ((unsigned long) c == edit->undo_stack_bottom ||
         (((unsigned long) c + 1) & edit->undo_stack_size_mask) == edit->undo_stack_bottom)
-        do
-        {
-            edit->undo_stack_bottom = (edit->undo_stack_bottom + 1) & edit->undo_stack_size_mask;
-        }
-        while (edit->undo_stack[edit->undo_stack_bottom] < KEY_PRESS
-               && edit->undo_stack_bottom != edit->undo_stack_pointer);
+        edit_stack_drop_oldest (edit->undo_stack, &edit->undo_stack_bottom,
+                                edit->undo_stack_pointer, edit->undo_stack_size_mask,
+                                edit->undo_spans, &edit->undo_spans_size);
 
     /*If a single key produced enough pushes to wrap all the way round then we would notice that the [undo_stack_bottom] does not contain KEY_PRESS. The stack is then initialised: */
     if (edit->undo_stack_pointer != edit->undo_stack_bottom
         && edit->undo_stack[edit->undo_stack_bottom] < KEY_PRESS)
     {
         edit->undo_stack_bottom = edit->undo_stack_pointer = 0;
+        edit_spans_clear (edit->undo_spans, &edit->undo_spans_size);
     }
 }
 
@@ -2416,9 +2618,9 @@ edit_push_redo_action (WEdit * edit, long c)
     /* first enlarge the stack if necessary */
     if (sp > edit->redo_stack_size - 10)
     {                           /* say */
-        if (option_max_undo < 256)
-            option_max_undo = 256;
-        if (edit->redo_stack_size < (unsigned long) option_max_undo)
+        /* stack entries and bytes kept aside share one memory limit */
+        if ((edit->redo_stack_size * 2 + 10) * sizeof (long) + edit->redo_spans_size
+            <= (gsize) option_max_undo_size)
         {
             t = static_cast<long*>(g_realloc (edit->redo_stack, (edit->redo_stack_size * 2 + 10) * sizeof (long)));
             if (t)
@@ -2431,6 +2633,20 @@ edit_push_redo_action (WEdit * edit, long c)
     }
     spm1 = (edit->redo_stack_pointer - 1) & edit->redo_stack_size_mask;
 
+    if (edit_spans_push_byte (edit->redo_stack, sp, edit->redo_stack_bottom,
+                              edit->redo_stack_size_mask, edit->redo_spans,
+                              &edit->redo_spans_size, c))
+    {
+        while ((long) edit->redo_spans_size > option_max_undo_size
+               && edit->redo_stack_bottom != edit->redo_stack_pointer)
+            edit_stack_drop_oldest (edit->redo_stack, &edit->redo_stack_bottom,
+                                    edit->redo_stack_pointer, edit->redo_stack_size_mask,
+                                    edit->redo_spans, &edit->redo_spans_size);
+        if (edit->redo_stack_bottom == edit->redo_stack_pointer)
+            edit_redo_stack_clear (edit);
+        return;
+    }
+
     if (edit->redo_stack_bottom != sp
         && spm1 != edit->redo_stack_bottom
         && ((sp - 2) & edit->redo_stack_size_mask) != edit->redo_stack_bottom)
@@ -2469,12 +2685,9 @@ edit_push_redo_action (WEdit * edit, long c)
     c = (edit->redo_stack_pointer + 2) & edit->redo_stack_size_mask;
     if ((unsigned long) c == edit->redo_stack_bottom ||
         (((unsigned long) c + 1) & edit->redo_stack_size_mask) == edit->redo_stack_bottom)
-        do
-        {
-            edit->redo_stack_bottom = (edit->redo_stack_bottom + 1) & edit->redo_stack_size_mask;
-        }
-        while (edit->redo_stack[edit->redo_stack_bottom] < KEY_PRESS
-               && edit->redo_stack_bottom != edit->redo_stack_pointer);
+        edit_stack_drop_oldest (edit->redo_stack, &edit->redo_stack_bottom,
+                                edit->redo_stack_pointer, edit->redo_stack_size_mask,
+                                edit->redo_spans, &edit->redo_spans_size);
 
     /*
      * If a single key produced enough pushes to wrap all the way round then
@@ -2484,7 +2697,7 @@ edit_push_redo_action (WEdit * edit, long c)
 
     if (edit->redo_stack_pointer != edit->redo_stack_bottom
         && edit->redo_stack[edit->redo_stack_bottom] < KEY_PRESS)
-        edit->redo_stack_bottom = edit->redo_stack_pointer = 0;
+        edit_redo_stack_clear (edit);
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -194,6 +194,34 @@ edit_buffer_get_byte (const edit_buffer_t * buf, off_t byte_index)
     return (p != NULL) ? *(unsigned char *) p : '\n';
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get pointer to the run of bytes that starts at specified index and is kept contiguously.
+ *
+ * @param buf pointer to editor buffer
+ * @param byte_index byte index
+ * @param len length of the run: the bytes up to the end of the buffer part or of the text
+ *
+ * @return NULL if byte_index is negative or larger than file size; pointer to the run otherwise.
+ */
+
+const char *
+edit_buffer_get_span (const edit_buffer_t * buf, off_t byte_index, off_t * len)
+{
+    const char *p;
+
+    p = edit_buffer_get_byte_ptr (buf, byte_index);
+    if (p == NULL)
+        *len = 0;
+    else if (byte_index >= buf->curs1)
+        /* parts of b2 are filled from the end, but the bytes go forward within a part */
+        *len = ((buf->curs1 + buf->curs2 - byte_index - 1) & M_EDIT_BUF_SIZE) + 1;
+    else
+        *len = MIN (EDIT_BUF_SIZE - (byte_index & M_EDIT_BUF_SIZE), buf->curs1 - byte_index);
+
+    return p;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 #ifdef HAVE_CHARSET
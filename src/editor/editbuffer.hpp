@@ -38,6 +38,7 @@ void edit_buffer_init (edit_buffer_t * buf, off_t size);
 void edit_buffer_clean (edit_buffer_t * buf);
 
 int edit_buffer_get_byte (const edit_buffer_t * buf, off_t byte_index);
+const char *edit_buffer_get_span (const edit_buffer_t * buf, off_t byte_index, off_t * len);
 #ifdef HAVE_CHARSET
 int edit_buffer_get_utf (const edit_buffer_t * buf, off_t byte_index, int *char_length);
 int edit_buffer_get_prev_utf (const edit_buffer_t * buf, off_t byte_index, int *char_length);
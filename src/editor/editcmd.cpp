@@ -76,6 +76,7 @@
 #include "spell_dialogs.hpp"
 #endif
 #include "etags.hpp"
+#include "editsort.hpp"
 
 /*** global variables ****************************************************************************/
 
@@ -570,13 +571,18 @@ edit_block_delete (WEdit * edit)
     off_t start_mark, end_mark;
     off_t curs_pos;
     long curs_line, c1, c2;
+    long undo_limit;
 
     if (!eval_marks (edit, &start_mark, &end_mark))
         return 0;
 
     if (edit->column_highlight && edit->mark2 < 0)
         edit_mark_cmd (edit, FALSE);
-    if ((end_mark - start_mark) > option_max_undo / 2)
+    /* a plain block is recorded as one run of bytes, a column block takes stack entries */
+    undo_limit = option_max_undo_size;
+    if (edit->column_highlight)
+        undo_limit /= 2 * (long) sizeof (long);
+    if ((end_mark - start_mark) > undo_limit)
     {
         /* Warning message with a query to continue or cancel the operation */
         if (edit_query_dialog2
@@ -1519,7 +1525,12 @@ edit_complete_word_insert_recoded_completion (WEdit * edit, char *completion, gs
 void
 edit_refresh_cmd (void)
 {
+#ifdef HAVE_SLANG
+    /* resend every cell once instead of flushing a blank screen first */
+    tty_touch_screen ();
+#else
     clr_scr ();
+#endif /* HAVE_SLANG */
     repaint_screen ();
     tty_keypad (TRUE);
 }
@@ -3120,9 +3131,12 @@ bool edit_insert_file_cmd (WEdit * edit)
 int
 edit_sort_cmd (WEdit * edit)
 {
-    char *exp, *tmp, *tmp_edit_block_name, *tmp_edit_temp_name;
-    off_t start_mark, end_mark;
-    int e;
+    char *exp;
+    unsigned char *block;
+    off_t start_mark, end_mark, len, current, i;
+    edit_sort_options_t opts;
+    GString *sorted;
+    GError *error = NULL;
 
     if (!eval_marks (edit, &start_mark, &end_mark))
     {
@@ -3130,9 +3144,11 @@ edit_sort_cmd (WEdit * edit)
         return 0;
     }
 
-    tmp = mc_config_get_full_path (EDIT_BLOCK_FILE);
-    edit_save_block (edit, tmp, start_mark, end_mark);
-    g_free (tmp);
+    if (edit->column_highlight)
+    {
+        edit_error_dialog (_("Sort block"), _("Column blocks cannot be sorted"));
+        return 0;
+    }
 
     exp = input_dialog (_("Run sort"),
                         _("Enter sort options (see manpage) separated by whitespace:"),
@@ -3141,45 +3157,41 @@ edit_sort_cmd (WEdit * edit)
     if (exp == NULL)
         return 1;
 
-    tmp_edit_block_name = mc_config_get_full_path (EDIT_BLOCK_FILE);
-    tmp_edit_temp_name = mc_config_get_full_path (EDIT_TEMP_FILE);
-    tmp =
-        g_strconcat (" sort ", exp, " ", tmp_edit_block_name,
-                     " > ", tmp_edit_temp_name, (char *) NULL);
-    g_free (tmp_edit_temp_name);
-    g_free (tmp_edit_block_name);
-    g_free (exp);
-
-    e = system (tmp);
-    g_free (tmp);
-    if (e != 0)
+    if (!edit_sort_parse_options (exp, &opts, &error))
     {
-        if (e == -1 || e == 127)
-            edit_error_dialog (_("Sort"), get_sys_error (_("Cannot execute sort command")));
-        else
-        {
-            char q[8];
-
-            sprintf (q, "%d ", e);
-            tmp = g_strdup_printf (_("Sort returned non-zero: %s"), q);
-            edit_error_dialog (_("Sort"), tmp);
-            g_free (tmp);
-        }
+        g_free (exp);
+        edit_error_dialog (_("Sort"), error->message);
+        g_error_free (error);
         return -1;
     }
+    g_free (exp);
+
+    block = edit_get_block (edit, start_mark, end_mark, &len);
+    sorted = edit_sort_lines ((const char *) block, (size_t) len, &opts);
+    g_free (block);
 
     edit->force |= REDRAW_COMPLETELY;
 
+    /* the delete and the insertion share the key press, so one undo restores the block */
     if (edit_block_delete_cmd (edit))
+    {
+        g_string_free (sorted, TRUE);
         return 1;
+    }
 
-    {
-        vfs_path_t *tmp_vpath;
+    current = edit->buffer.curs1;
+    for (i = 0; i < (off_t) sorted->len; i++)
+        edit_insert (edit, (unsigned char) sorted->str[i]);
+    g_string_free (sorted, TRUE);
+
+    /* highlight inserted text then not persistent blocks */
+    if (!option_persistent_selections && edit->modified)
+        edit_set_markers (edit, edit->buffer.curs1, current, 0, 0);
+
+    /* Place cursor at the end of text selection */
+    if (!option_cursor_after_inserted_block)
+        edit_cursor_move (edit, current - edit->buffer.curs1);
 
-        tmp_vpath = mc_config_get_full_vpath (EDIT_TEMP_FILE);
-        edit_insert_file (edit, tmp_vpath);
-        vfs_path_free (tmp_vpath);
-    }
     return 0;
 }
 
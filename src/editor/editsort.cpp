@@ -0,0 +1,483 @@
+/*
+   Editor block sort.
+
+   Copyright (C) 2020
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \file
+ *  \brief Source: sort lines of an editor block in memory
+ *
+ *  The options are a subset of the sort(1) ones, so the history of the
+ *  "Run sort" dialog keeps working.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "lib/global.hpp"
+#include "lib/strutil.hpp"        /* str_create_key() */
+
+#include "editsort.hpp"
+
+/*** global variables ****************************************************************************/
+
+/*** file scope macro definitions ****************************************************************/
+
+#define SORT_IS_BLANK(c) ((c) == ' ' || (c) == '\t')
+
+/*** file scope type declarations ****************************************************************/
+
+typedef struct
+{
+    const char *text;           /* points into the block, not terminated */
+    size_t len;                 /* without the newline */
+    char *key;                  /* collation key of the key field(s), NULL for numeric sort */
+    gboolean key_is_raw;        /* key is a plain copy that str_release_key() doesn't free */
+    double num;
+} sort_line_t;
+
+/*** file scope variables ************************************************************************/
+
+/*** file scope functions ************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+sort_parse_key (const char *value, edit_sort_options_t * opts, GError ** error)
+{
+    char *end;
+    long first, last = 0;
+
+    first = strtol (value, &end, 10);
+    if (end != value && *end == ',')
+    {
+        const char *p = end + 1;
+
+        last = strtol (p, &end, 10);
+        if (end == p)
+            last = -1;
+    }
+
+    if (end == value || *end != '\0' || first < 1 || first > G_MAXINT || last < 0
+        || last > G_MAXINT || (last != 0 && last < first))
+    {
+        g_set_error (error, MC_ERROR, 0, _("Invalid sort key \"%s\", expected N or N,M"), value);
+        return FALSE;
+    }
+
+    opts->key_first = (int) first;
+    opts->key_last = (int) last;
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+sort_parse_separator (const char *value, edit_sort_options_t * opts, GError ** error)
+{
+    if (value[0] == '\0' || value[1] != '\0' || value[0] == '\n')
+    {
+        g_set_error (error, MC_ERROR, 0, _("Field separator must be a single character"));
+        return FALSE;
+    }
+
+    opts->separator = value[0];
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Parse one long option; *i is moved past a separate argument. */
+
+static gboolean
+sort_parse_long_option (char **argv, int argc, int *i, edit_sort_options_t * opts,
+                        GError ** error)
+{
+    const char *arg = argv[*i] + 2;
+    const char *value;
+    size_t name_len;
+
+    value = strchr (arg, '=');
+    name_len = value != NULL ? (size_t) (value - arg) : strlen (arg);
+
+#define SORT_LONG_IS(name) (name_len == sizeof (name) - 1 && strncmp (arg, name, name_len) == 0)
+
+    if (value == NULL)
+    {
+        if (SORT_LONG_IS ("reverse"))
+            opts->reverse = TRUE;
+        else if (SORT_LONG_IS ("numeric-sort"))
+            opts->numeric = TRUE;
+        else if (SORT_LONG_IS ("ignore-case"))
+            opts->ignore_case = TRUE;
+        else if (SORT_LONG_IS ("unique"))
+            opts->unique = TRUE;
+        else if (SORT_LONG_IS ("ignore-leading-blanks"))
+            opts->skip_blanks = TRUE;
+        else if ((SORT_LONG_IS ("key") || SORT_LONG_IS ("field-separator")) && *i + 1 < argc)
+            value = argv[++(*i)];
+        else
+            goto unknown;
+
+        if (value == NULL)
+            return TRUE;
+    }
+    else
+        value++;
+
+    if (SORT_LONG_IS ("key"))
+        return sort_parse_key (value, opts, error);
+    if (SORT_LONG_IS ("field-separator"))
+        return sort_parse_separator (value, opts, error);
+
+#undef SORT_LONG_IS
+
+  unknown:
+    g_set_error (error, MC_ERROR, 0, _("Unsupported sort option \"%s\""), argv[*i]);
+    return FALSE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Parse a cluster of short options like "-rn" or "-k2,3"; *i is moved past a separate argument. */
+
+static gboolean
+sort_parse_short_options (char **argv, int argc, int *i, edit_sort_options_t * opts,
+                          GError ** error)
+{
+    const char *p;
+
+    for (p = argv[*i] + 1; *p != '\0'; p++)
+    {
+        const char *value;
+
+        switch (*p)
+        {
+        case 'r':
+            opts->reverse = TRUE;
+            break;
+        case 'n':
+            opts->numeric = TRUE;
+            break;
+        case 'f':
+            opts->ignore_case = TRUE;
+            break;
+        case 'u':
+            opts->unique = TRUE;
+            break;
+        case 'b':
+            opts->skip_blanks = TRUE;
+            break;
+        case 'k':
+        case 't':
+            if (p[1] != '\0')
+                value = p + 1;
+            else if (*i + 1 < argc)
+                value = argv[++(*i)];
+            else
+            {
+                g_set_error (error, MC_ERROR, 0, _("Sort option \"-%c\" requires an argument"),
+                             *p);
+                return FALSE;
+            }
+
+            return *p == 'k' ? sort_parse_key (value, opts, error)
+                : sort_parse_separator (value, opts, error);
+        default:
+            g_set_error (error, MC_ERROR, 0, _("Unsupported sort option \"-%c\""), *p);
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Skip count fields starting at pos; returns the offset the next field starts at. */
+
+static size_t
+sort_skip_fields (const char *s, size_t len, size_t pos, int count, char separator)
+{
+    for (; count > 0 && pos < len; count--)
+    {
+        if (separator != '\0')
+        {
+            const char *p;
+
+            p = static_cast<const char *> (memchr (s + pos, separator, len - pos));
+            if (p == NULL)
+                return len;
+            pos = p - s + 1;
+        }
+        else
+        {
+            /* like sort(1), a field owns the blanks in front of it */
+            while (pos < len && SORT_IS_BLANK (s[pos]))
+                pos++;
+            while (pos < len && !SORT_IS_BLANK (s[pos]))
+                pos++;
+        }
+    }
+
+    return pos;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+sort_key_bounds (const sort_line_t * line, const edit_sort_options_t * opts, size_t * start,
+                 size_t * end)
+{
+    const char *s = line->text;
+    size_t len = line->len;
+    size_t b, e;
+
+    if (opts->key_first <= 1)
+        b = 0;
+    else
+        b = sort_skip_fields (s, len, 0, opts->key_first - 1, opts->separator);
+
+    if (opts->key_last == 0)
+        e = len;
+    else if (opts->separator == '\0')
+        e = sort_skip_fields (s, len, 0, opts->key_last, '\0');
+    else
+    {
+        const char *p;
+
+        e = sort_skip_fields (s, len, 0, opts->key_last - 1, opts->separator);
+        p = static_cast<const char *> (memchr (s + e, opts->separator, len - e));
+        if (p != NULL)
+            e = p - s;
+    }
+
+    if (opts->skip_blanks || opts->numeric)
+        while (b < e && SORT_IS_BLANK (s[b]))
+            b++;
+
+    *start = b;
+    *end = MAX (b, e);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static double
+sort_parse_number (const char *s, size_t len)
+{
+    char buf[64];
+    size_t i = 0;
+
+    if (len >= sizeof (buf))
+        len = sizeof (buf) - 1;
+    memcpy (buf, s, len);
+    buf[len] = '\0';
+
+    /* only plain decimal numbers; text sorts as zero, as with sort -n */
+    if (buf[i] == '-' || buf[i] == '+')
+        i++;
+    if (!g_ascii_isdigit (buf[i]) && !((buf[i] == '.' || buf[i] == ',')
+                                       && g_ascii_isdigit (buf[i + 1])))
+        return 0.0;
+
+    return strtod (buf, NULL);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+sort_line_make_key (sort_line_t * line, const edit_sort_options_t * opts)
+{
+    size_t start, end;
+
+    sort_key_bounds (line, opts, &start, &end);
+
+    if (opts->numeric)
+        line->num = sort_parse_number (line->text + start, end - start);
+    else
+    {
+        char *raw;
+
+        raw = g_strndup (line->text + start, end - start);
+        line->key = str_create_key (raw, !opts->ignore_case);
+        line->key_is_raw = line->key == raw;
+        if (!line->key_is_raw)
+            g_free (raw);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+sort_line_free_key (sort_line_t * line, const edit_sort_options_t * opts)
+{
+    if (line->key_is_raw)
+        g_free (line->key);
+    else if (line->key != NULL)
+        str_release_key (line->key, !opts->ignore_case);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static int
+sort_compare_keys (const sort_line_t * a, const sort_line_t * b, const edit_sort_options_t * opts)
+{
+    if (opts->numeric)
+        return (a->num > b->num) - (a->num < b->num);
+
+    return str_key_collate (a->key, b->key, !opts->ignore_case);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static int
+sort_compare (gconstpointer a, gconstpointer b, gpointer user_data)
+{
+    const sort_line_t *la = static_cast<const sort_line_t *> (a);
+    const sort_line_t *lb = static_cast<const sort_line_t *> (b);
+    const edit_sort_options_t *opts = static_cast<const edit_sort_options_t *> (user_data);
+    int r;
+
+    r = sort_compare_keys (la, lb, opts);
+    if (r == 0 && !opts->unique)
+    {
+        /* last resort as in sort(1): whole lines byte by byte */
+        r = memcmp (la->text, lb->text, MIN (la->len, lb->len));
+        if (r == 0)
+            r = (la->len > lb->len) - (la->len < lb->len);
+    }
+
+    return opts->reverse ? -r : r;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Parse the text of the "Run sort" dialog.
+ *
+ * @param text options separated by whitespace, quoted as in shell
+ * @param opts filled with the options; fields not mentioned in text are cleared
+ * @param error set on an unknown option or a bad argument
+ *
+ * @return TRUE on success
+ */
+
+gboolean
+edit_sort_parse_options (const char *text, edit_sort_options_t * opts, GError ** error)
+{
+    char **argv = NULL;
+    int argc = 0;
+    int i;
+    gboolean ok = TRUE;
+
+    memset (opts, 0, sizeof (*opts));
+
+    while (SORT_IS_BLANK (*text))
+        text++;
+    if (*text == '\0')
+        return TRUE;
+
+    if (!g_shell_parse_argv (text, &argc, &argv, error))
+        return FALSE;
+
+    for (i = 0; ok && i < argc; i++)
+    {
+        if (strncmp (argv[i], "--", 2) == 0 && argv[i][2] != '\0')
+            ok = sort_parse_long_option (argv, argc, &i, opts, error);
+        else if (argv[i][0] == '-' && argv[i][1] != '\0')
+            ok = sort_parse_short_options (argv, argc, &i, opts, error);
+        else
+        {
+            g_set_error (error, MC_ERROR, 0, _("Unexpected sort argument \"%s\""), argv[i]);
+            ok = FALSE;
+        }
+    }
+
+    g_strfreev (argv);
+    return ok;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Sort lines of text.
+ *
+ * The sort is stable.  A last line without newline gets one if it doesn't stay last;
+ * the result ends with a newline only if text does.
+ *
+ * @param text lines to sort, not necessarily null terminated
+ * @param len length of text
+ * @param opts sort options
+ *
+ * @return newly allocated sorted text
+ */
+
+GString *
+edit_sort_lines (const char *text, size_t len, const edit_sort_options_t * opts)
+{
+    GArray *lines;
+    GString *result;
+    gboolean final_newline;
+    gboolean first = TRUE;
+    const char *p, *end;
+    sort_line_t *v;
+    guint i;
+
+    result = g_string_sized_new (len + 1);
+    if (len == 0)
+        return result;
+
+    final_newline = text[len - 1] == '\n';
+    lines = g_array_sized_new (FALSE, TRUE, sizeof (sort_line_t), len / 32 + 16);
+
+    for (p = text, end = text + len; p < end;)
+    {
+        const char *nl;
+        sort_line_t line;
+
+        nl = static_cast<const char *> (memchr (p, '\n', end - p));
+        memset (&line, 0, sizeof (line));
+        line.text = p;
+        line.len = (nl != NULL ? nl : end) - p;
+        sort_line_make_key (&line, opts);
+        g_array_append_val (lines, line);
+        p += line.len + 1;
+    }
+
+    v = &g_array_index (lines, sort_line_t, 0);
+    g_qsort_with_data (v, lines->len, sizeof (sort_line_t), sort_compare, (gpointer) opts);
+
+    for (i = 0; i < lines->len; i++)
+    {
+        if (opts->unique && i != 0 && sort_compare_keys (&v[i - 1], &v[i], opts) == 0)
+            continue;
+
+        if (!first)
+            g_string_append_c (result, '\n');
+        first = FALSE;
+        g_string_append_len (result, v[i].text, v[i].len);
+    }
+
+    if (final_newline)
+        g_string_append_c (result, '\n');
+
+    for (i = 0; i < lines->len; i++)
+        sort_line_free_key (&v[i], opts);
+    g_array_free (lines, TRUE);
+
+    return result;
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <sys/types.h>          /* size_t */
+#include "lib/global.hpp"         /* include <glib.h> */
+
+/*** typedefs(not structures) and defined constants **********************************************/
+
+/*** enums ***************************************************************************************/
+
+/*** structures declarations (and typedefs of structures)*****************************************/
+
+/* what the options of the "Sort block" dialog ask for; the letters follow sort(1) */
+typedef struct edit_sort_options_struct
+{
+    gboolean reverse;           /* -r */
+    gboolean numeric;           /* -n */
+    gboolean ignore_case;       /* -f */
+    gboolean unique;            /* -u */
+    gboolean skip_blanks;       /* -b */
+    char separator;             /* -t; '\0' splits fields on runs of blanks */
+    int key_first;              /* -k N[,M]: first field of the key, 1-based; 0 is the whole line */
+    int key_last;               /* last field of the key; 0 is the end of line */
+} edit_sort_options_t;
+
+/*** global variables defined in .c file *********************************************************/
+
+/*** declarations of public functions ************************************************************/
+
+gboolean edit_sort_parse_options (const char *text, edit_sort_options_t * opts, GError ** error);
+GString *edit_sort_lines (const char *text, size_t len, const edit_sort_options_t * opts);
+
+/*** inline functions ****************************************************************************/
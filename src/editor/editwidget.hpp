@@ -139,6 +139,8 @@ struct WEdit
     unsigned long undo_stack_size_mask;
     unsigned long undo_stack_bottom;
     unsigned int undo_stack_disable:1;  /* If not 0, don't save events in the undo stack */
+    GQueue *undo_spans;         /* byte runs of SPAN_INSERT* actions, oldest first */
+    gsize undo_spans_size;      /* total bytes kept in undo_spans */
 
     unsigned long redo_stack_pointer;
     long *redo_stack;
@@ -146,6 +148,8 @@ struct WEdit
     unsigned long redo_stack_size_mask;
     unsigned long redo_stack_bottom;
     unsigned int redo_stack_reset:1;    /* If 1, need clear redo stack */
+    GQueue *redo_spans;
+    gsize redo_spans_size;
 
     struct stat stat1;          /* Result of mc_fstat() on the file */
     unsigned int skip_detach_prompt:1;  /* Do not prompt whether to detach a file anymore */
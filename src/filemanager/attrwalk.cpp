@@ -0,0 +1,360 @@
+/*
+   Recursive change of file attributes for the Midnight Commander.
+
+   Copyright (C) 2020
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \file attrwalk.c
+ *  \brief Source: recursive change of file attributes
+ *
+ *  Used by the Chmod and Chown commands to apply the change to all entries below
+ *  the selected directories. Local trees are walked relative to directory
+ *  descriptors (openat, fstatat, fchmodat, fchownat), so no path is resolved
+ *  again for every entry, and the syscalls are skipped for entries which
+ *  already have the requested attributes. Other VFS are walked with mc_* calls.
+ *
+ *  Symbolic links are not followed. Their owner is changed on local file systems,
+ *  their mode never.
+ */
+
+#include <errno.h>
+#include <fcntl.h>              /* openat() */
+#include <dirent.h>             /* fdopendir() */
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "lib/global.hpp"
+#include "lib/fs.hpp"           /* DIR_IS_DOT */
+#include "lib/util.hpp"         /* mc_time_elapsed(), unix_error_string() */
+#include "lib/vfs/vfs.hpp"
+#include "lib/widget.hpp"
+
+#include "attrwalk.hpp"
+
+/*** global variables ****************************************************************************/
+
+/*** file scope macro definitions ****************************************************************/
+
+/* how often the progress is redrawn */
+#define ATTR_WALK_FRAME_INTERVAL (G_USEC_PER_SEC / 20)
+
+/* how many failures are listed in the summary */
+#define ATTR_WALK_ERRORS_MAX 10
+
+#define ATTR_MODE_BITS 07777
+
+/*** file scope type declarations ****************************************************************/
+
+/*** file scope variables ************************************************************************/
+
+/*** file scope functions ************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+static int
+attr_walk_status_update_cb (status_msg_t * sm)
+{
+    simple_status_msg_t *ssm = SIMPLE_STATUS_MSG (sm);
+    attr_walk_t *aw = (attr_walk_t *) sm;
+
+    label_set_textv (ssm->label, _("Processed: %ju, failed: %ju"), aw->count, aw->failed);
+
+    return status_msg_common_update (sm);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+attr_walk_progress (attr_walk_t * aw)
+{
+    aw->count++;
+
+    if (mc_time_elapsed (&aw->frame_last, ATTR_WALK_FRAME_INTERVAL)
+        && STATUS_MSG (aw)->update (STATUS_MSG (aw)) == B_CANCEL)
+        aw->aborted = TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+attr_walk_error (attr_walk_t * aw, const char *path, int error)
+{
+    aw->failed++;
+
+    if (aw->failed <= ATTR_WALK_ERRORS_MAX)
+        g_string_append_printf (aw->errors, "%s: %s\n", path, unix_error_string (error));
+    else if (aw->failed == ATTR_WALK_ERRORS_MAX + 1)
+        g_string_append (aw->errors, "...\n");
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static inline gboolean
+attr_walk_chown_needed (const attr_walk_t * aw, const struct stat *st)
+{
+    return ((aw->uid != (uid_t) (-1) && aw->uid != st->st_uid)
+            || (aw->gid != (gid_t) (-1) && aw->gid != st->st_gid));
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static inline mode_t
+attr_walk_new_mode (const attr_walk_t * aw, const struct stat *st)
+{
+    return ((st->st_mode & aw->and_mask) | aw->or_mask) & ATTR_MODE_BITS;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+attr_walk_path_append (GString * path, gsize len, const char *name)
+{
+    g_string_truncate (path, len);
+    if (len != 0 && !IS_PATH_SEP (path->str[len - 1]))
+        g_string_append_c (path, PATH_SEP);
+    g_string_append (path, name);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Change the entries of the local directory. The directory itself is not changed.
+ *
+ * @param fd descriptor of the directory, it is closed here
+ * @param path path of the directory, for messages
+ */
+
+static void
+attr_walk_local_dir (attr_walk_t * aw, int fd, GString * path)
+{
+    DIR *dir;
+    struct dirent *next;
+    gsize path_len;
+
+    dir = fdopendir (fd);
+    if (dir == NULL)
+    {
+        attr_walk_error (aw, path->str, errno);
+        close (fd);
+        return;
+    }
+
+    path_len = path->len;
+
+    while (!aw->aborted && (next = readdir (dir)) != NULL)
+    {
+        struct stat st;
+        mode_t mode;
+        gboolean mode_done = FALSE;
+
+        if (DIR_IS_DOT (next->d_name) || DIR_IS_DOTDOT (next->d_name))
+            continue;
+
+        attr_walk_path_append (path, path_len, next->d_name);
+
+        if (fstatat (fd, next->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+        {
+            attr_walk_error (aw, path->str, errno);
+            continue;
+        }
+
+        /* chown may clear set-user-ID bits, so the mode is changed after it */
+        if (attr_walk_chown_needed (aw, &st)
+            && fchownat (fd, next->d_name, aw->uid, aw->gid, AT_SYMLINK_NOFOLLOW) != 0)
+            attr_walk_error (aw, path->str, errno);
+
+        mode = attr_walk_new_mode (aw, &st);
+        if (S_ISLNK (st.st_mode) || mode == (st.st_mode & ATTR_MODE_BITS))
+            mode_done = TRUE;
+
+        if (S_ISDIR (st.st_mode))
+        {
+            int sub_fd;
+
+            sub_fd = openat (fd, next->d_name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+            if (sub_fd == -1 && errno == EACCES && !mode_done)
+            {
+                /* maybe the new mode makes it readable */
+                if (fchmodat (fd, next->d_name, mode, 0) != 0)
+                    attr_walk_error (aw, path->str, errno);
+                mode_done = TRUE;
+                sub_fd =
+                    openat (fd, next->d_name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+            }
+
+            if (sub_fd == -1)
+                attr_walk_error (aw, path->str, errno);
+            else
+                attr_walk_local_dir (aw, sub_fd, path);
+        }
+
+        /* the mode of directory is changed after its entries: it may take away the access */
+        if (!mode_done && fchmodat (fd, next->d_name, mode, 0) != 0)
+            attr_walk_error (aw, path->str, errno);
+
+        attr_walk_progress (aw);
+    }
+
+    g_string_truncate (path, path_len);
+    closedir (dir);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Change the entries of the directory on any VFS. The directory itself is not changed. */
+
+static void
+attr_walk_vfs_dir (attr_walk_t * aw, const vfs_path_t * vpath)
+{
+    DIR *dir;
+    struct dirent *next;
+
+    dir = mc_opendir (vpath);
+    if (dir == NULL)
+    {
+        attr_walk_error (aw, vfs_path_as_str (vpath), errno);
+        return;
+    }
+
+    while (!aw->aborted && (next = mc_readdir (dir)) != NULL)
+    {
+        vfs_path_t *tmp_vpath;
+        struct stat st;
+        mode_t mode;
+
+        if (DIR_IS_DOT (next->d_name) || DIR_IS_DOTDOT (next->d_name))
+            continue;
+
+        tmp_vpath = vfs_path_append_new (vpath, next->d_name, (char *) NULL);
+
+        /* there is no lchown in VFS: links are left alone */
+        if (mc_lstat (tmp_vpath, &st) != 0)
+            attr_walk_error (aw, vfs_path_as_str (tmp_vpath), errno);
+        else if (!S_ISLNK (st.st_mode))
+        {
+            if (attr_walk_chown_needed (aw, &st) && mc_chown (tmp_vpath, aw->uid, aw->gid) != 0)
+                attr_walk_error (aw, vfs_path_as_str (tmp_vpath), errno);
+
+            if (S_ISDIR (st.st_mode))
+                attr_walk_vfs_dir (aw, tmp_vpath);
+
+            mode = attr_walk_new_mode (aw, &st);
+            if (mode != (st.st_mode & ATTR_MODE_BITS) && mc_chmod (tmp_vpath, mode) != 0)
+                attr_walk_error (aw, vfs_path_as_str (tmp_vpath), errno);
+
+            attr_walk_progress (aw);
+        }
+
+        vfs_path_free (tmp_vpath);
+    }
+
+    mc_closedir (dir);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/** Initialize the walker which changes nothing */
+
+void
+attr_walk_init (attr_walk_t * aw)
+{
+    aw->and_mask = (mode_t) (-1);
+    aw->or_mask = 0;
+    aw->uid = (uid_t) (-1);
+    aw->gid = (gid_t) (-1);
+    aw->count = 0;
+    aw->failed = 0;
+    aw->errors = g_string_new (NULL);
+    aw->aborted = FALSE;
+    aw->frame_last = 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+void
+attr_walk_set_mode (attr_walk_t * aw, mode_t and_mask, mode_t or_mask)
+{
+    aw->and_mask = and_mask;
+    aw->or_mask = or_mask;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+void
+attr_walk_set_owner (attr_walk_t * aw, uid_t uid, gid_t gid)
+{
+    aw->uid = uid;
+    aw->gid = gid;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Change all entries below the directory. The directory itself is not changed.
+ *
+ * @return FALSE if the user has aborted the walk
+ */
+
+gboolean
+attr_walk_tree (attr_walk_t * aw, const vfs_path_t * root_vpath)
+{
+    if (aw->aborted)
+        return FALSE;
+
+    status_msg_init (STATUS_MSG (aw), _("Processing"), 1.0, simple_status_msg_init_cb,
+                     attr_walk_status_update_cb, NULL);
+
+    if (vfs_path_elements_count (root_vpath) == 1 && vfs_file_is_local (root_vpath))
+    {
+        const char *root = vfs_path_as_str (root_vpath);
+        int fd;
+
+        fd = open (root, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd == -1)
+            attr_walk_error (aw, root, errno);
+        else
+        {
+            GString *path;
+
+            path = g_string_new (root);
+            attr_walk_local_dir (aw, fd, path);
+            g_string_free (path, TRUE);
+        }
+    }
+    else
+        attr_walk_vfs_dir (aw, root_vpath);
+
+    status_msg_deinit (STATUS_MSG (aw));
+
+    return !aw->aborted;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Show the summary of failures if there were some and free the walker */
+
+void
+attr_walk_done (attr_walk_t * aw, const char *title)
+{
+    if (aw->failed != 0)
+        message (D_ERROR, title, _("%ju errors in %ju processed entries:\n%s"), aw->failed,
+                 aw->count, aw->errors->str);
+
+    g_string_free (aw->errors, TRUE);
+    aw->errors = NULL;
+}
+
+/* --------------------------------------------------------------------------------------------- */
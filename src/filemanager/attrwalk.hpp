@@ -0,0 +1,51 @@
+/** \file attrwalk.h
+ *  \brief Header: recursive change of file attributes
+ */
+
+#pragma once
+
+#include <sys/types.h>
+#include <inttypes.h>           /* uintmax_t */
+
+#include "lib/global.hpp"
+#include "lib/vfs/vfs.hpp"
+#include "lib/widget.hpp"       /* simple_status_msg_t */
+
+/*** typedefs(not structures) and defined constants **********************************************/
+
+/*** enums ***************************************************************************************/
+
+/*** structures declarations (and typedefs of structures)*****************************************/
+
+/* Walker over directory trees which changes mode and owner of every entry below the root.
+   Errors don't stop the walk, they are collected and shown in one summary. */
+typedef struct
+{
+    simple_status_msg_t status_msg;     /* base class */
+
+    /* new mode = (old mode & and_mask) | or_mask */
+    mode_t and_mask;
+    mode_t or_mask;
+    /* (uid_t) -1 and (gid_t) -1 keep the owner and the group */
+    uid_t uid;
+    gid_t gid;
+
+    uintmax_t count;            /* entries processed */
+    uintmax_t failed;           /* entries which could not be changed */
+    GString *errors;            /* messages of first failures */
+    gboolean aborted;
+
+    guint64 frame_last;
+} attr_walk_t;
+
+/*** global variables defined in .c file *********************************************************/
+
+/*** declarations of public functions ************************************************************/
+
+void attr_walk_init (attr_walk_t * aw);
+void attr_walk_set_mode (attr_walk_t * aw, mode_t and_mask, mode_t or_mask);
+void attr_walk_set_owner (attr_walk_t * aw, uid_t uid, gid_t gid);
+gboolean attr_walk_tree (attr_walk_t * aw, const vfs_path_t * root_vpath);
+void attr_walk_done (attr_walk_t * aw, const char *title);
+
+/*** inline functions ****************************************************************************/
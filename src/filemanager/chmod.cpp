@@ -39,6 +39,7 @@
 #include "lib/widget.hpp"
 
 #include "midnight.hpp"           /* current_panel */
+#include "attrwalk.hpp"
 
 #include "chmod.hpp"
 
@@ -125,6 +126,11 @@ static mode_t and_mask, or_mask, ch_mode;
 static WLabel *statl;
 static WGroupbox *file_gb;
 
+static const char *recursive_text = N_("Recursi&ve");
+static WCheck *recursive_check;
+static gboolean recursive = FALSE;
+static attr_walk_t walk;
+
 /* --------------------------------------------------------------------------------------------- */
 /*** file scope functions ************************************************************************/
 /* --------------------------------------------------------------------------------------------- */
@@ -149,6 +155,8 @@ chmod_i18n (void)
 
     for (i = 0; i < BUTTONS; i++)
         chmod_but[i].text = _(chmod_but[i].text);
+
+    recursive_text = _(recursive_text);
 #endif /* ENABLE_NLS */
 
     for (i = 0; i < BUTTONS_PERM; i++)
@@ -307,7 +315,7 @@ chmod_init (const char *fname, const struct stat *sf_stat)
     cols = str_term_width1 (fname) + 2 + 1;
     file_gb_len = MAX (file_gb_len, cols);
 
-    lines = single_set ? 20 : 23;
+    lines = single_set ? 21 : 24;
     cols = perm_gb_len + file_gb_len + 1 + 6;
 
     if (cols > COLS)
@@ -350,6 +358,9 @@ chmod_init (const char *fname, const struct stat *sf_stat)
     c_fgrp = str_trunc (get_group (sf_stat->st_gid), file_gb_len - 3);
     group_add_widget (g, label_new (y + 6, cols, c_fgrp));
 
+    recursive_check = check_new (PY + BUTTONS_PERM + 2, PX, recursive, recursive_text);
+    group_add_widget (g, recursive_check);
+
     if (!single_set)
     {
         i = 0;
@@ -452,15 +463,51 @@ try_chmod (const vfs_path_t * p, mode_t m)
 
 /* --------------------------------------------------------------------------------------------- */
 
+static gboolean
+chmod_subtree (const vfs_path_t * p, const struct stat *sf, mode_t and_m, mode_t or_m)
+{
+    if (!recursive || !S_ISDIR (sf->st_mode))
+        return TRUE;
+
+    attr_walk_set_mode (&walk, and_m, or_m);
+    return attr_walk_tree (&walk, p);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * The mode of a directory is changed after its entries, because the new mode may take away
+ * the access to them. A directory which can't be read yet gets the new mode first.
+ */
+
+static inline gboolean
+chmod_dir_last (const struct stat *sf)
+{
+    return ((sf->st_mode & (S_IRUSR | S_IXUSR)) == (S_IRUSR | S_IXUSR));
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+try_chmod_tree (const vfs_path_t * p, const struct stat *sf, mode_t m, mode_t and_m, mode_t or_m)
+{
+    if (chmod_dir_last (sf))
+        return (chmod_subtree (p, sf, and_m, or_m) && try_chmod (p, m));
+
+    return (try_chmod (p, m) && chmod_subtree (p, sf, and_m, or_m));
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
 static gboolean
 do_chmod (const vfs_path_t * p, struct stat *sf)
 {
     gboolean ret;
+    mode_t m;
 
-    sf->st_mode &= and_mask;
-    sf->st_mode |= or_mask;
+    m = (sf->st_mode & and_mask) | or_mask;
 
-    ret = try_chmod (p, sf->st_mode);
+    ret = try_chmod_tree (p, sf, m, and_mask, or_mask);
+    sf->st_mode = m;
 
     do_file_mark (current_panel, current_file, 0);
 
@@ -520,6 +567,7 @@ chmod_cmd (void)
 
     current_file = 0;
     ignore_all = FALSE;
+    attr_walk_init (&walk);
 
     do
     {                           /* do while any files remaining */
@@ -552,6 +600,7 @@ chmod_cmd (void)
         ch_dlg = chmod_init (fname, &sf_stat);
 
         result = dlg_run (ch_dlg);
+        recursive = recursive_check->state;
 
         switch (result)
         {
@@ -562,15 +611,23 @@ chmod_cmd (void)
         case B_ENTER:
             if (mode_change)
             {
+                /* apply the toggled bits only to the entries below */
+                const mode_t cleared = sf_stat.st_mode & ~ch_mode & 07777;
+                const mode_t set = ch_mode & ~sf_stat.st_mode & 07777;
+
                 if (current_panel->marked <= 1)
                 {
                     /* single or last file */
+                    if (chmod_dir_last (&sf_stat))
+                        chmod_subtree (vpath, &sf_stat, ~cleared, set);
                     if (mc_chmod (vpath, ch_mode) == -1 && !ignore_all)
                         message (D_ERROR, MSG_ERROR, _("Cannot chmod \"%s\"\n%s"), fname,
                                  unix_error_string (errno));
+                    if (!chmod_dir_last (&sf_stat))
+                        chmod_subtree (vpath, &sf_stat, ~cleared, set);
                     end_chmod = TRUE;
                 }
-                else if (!try_chmod (vpath, ch_mode))
+                else if (!try_chmod_tree (vpath, &sf_stat, ch_mode, ~cleared, set))
                 {
                     /* stop multiple files processing */
                     result = B_CANCEL;
@@ -642,6 +699,7 @@ chmod_cmd (void)
     }
     while (current_panel->marked != 0 && !end_chmod);
 
+    attr_walk_done (&walk, _("Chmod command"));
     chmod_done (need_update);
 }
 
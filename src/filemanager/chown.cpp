@@ -44,6 +44,7 @@
 
 #include "src/setup.hpp"          /* panels_options */
 #include "midnight.hpp"           /* current_panel */
+#include "attrwalk.hpp"
 
 #include "chown.hpp"
 
@@ -110,6 +111,11 @@ static gboolean ignore_all;
 
 static WListbox *l_user, *l_group;
 
+static const char *recursive_text = N_("&Recursive");
+static WCheck *recursive_check;
+static gboolean recursive = FALSE;
+static attr_walk_t walk;
+
 /* --------------------------------------------------------------------------------------------- */
 /*** file scope functions ************************************************************************/
 /* --------------------------------------------------------------------------------------------- */
@@ -128,6 +134,8 @@ chown_i18n (void)
 #ifdef ENABLE_NLS
     for (i = 0; i < BUTTONS; i++)
         chown_but[i].text = _(chown_but[i].text);
+
+    recursive_text = _(recursive_text);
 #endif /* ENABLE_NLS */
 
     for (i = 0; i < BUTTONS; i++)
@@ -196,7 +204,7 @@ chown_init (void)
     struct group *l_grp;
 
     single_set = (current_panel->marked < 2) ? 3 : 0;
-    lines = GH + 4 + (single_set != 0 ? 2 : 4);
+    lines = GH + 5 + (single_set != 0 ? 2 : 4);
     cols = GW * 3 + 2 + 6;
 
     ch_dlg =
@@ -237,6 +245,9 @@ chown_init (void)
         group_add_widget (g, chown_label[i].l);
     }
 
+    recursive_check = check_new (GH + 2, 3, recursive, recursive_text);
+    group_add_widget (g, recursive_check);
+
     if (single_set == 0)
     {
         int x;
@@ -338,11 +349,23 @@ try_chown (const vfs_path_t * p, uid_t u, gid_t g)
 /* --------------------------------------------------------------------------------------------- */
 
 static gboolean
-do_chown (const vfs_path_t * p, uid_t u, gid_t g)
+chown_subtree (const vfs_path_t * p, const struct stat *sf, uid_t u, gid_t g)
+{
+    if (!recursive || !S_ISDIR (sf->st_mode))
+        return TRUE;
+
+    attr_walk_set_owner (&walk, u, g);
+    return attr_walk_tree (&walk, p);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+do_chown (const vfs_path_t * p, const struct stat *sf, uid_t u, gid_t g)
 {
     gboolean ret;
 
-    ret = try_chown (p, u, g);
+    ret = try_chown (p, u, g) && chown_subtree (p, sf, u, g);
 
     do_file_mark (current_panel, current_file, 0);
 
@@ -352,11 +375,11 @@ do_chown (const vfs_path_t * p, uid_t u, gid_t g)
 /* --------------------------------------------------------------------------------------------- */
 
 static void
-apply_chowns (vfs_path_t * vpath, uid_t u, gid_t g)
+apply_chowns (vfs_path_t * vpath, const struct stat *sf_stat, uid_t u, gid_t g)
 {
     gboolean ok;
 
-    if (!do_chown (vpath, u, g))
+    if (!do_chown (vpath, sf_stat, u, g))
         return;
 
     do
@@ -378,7 +401,7 @@ apply_chowns (vfs_path_t * vpath, uid_t u, gid_t g)
             ok = TRUE;
         }
         else
-            ok = do_chown (vpath, u, g);
+            ok = do_chown (vpath, &sf, u, g);
 
         vfs_path_free (vpath);
     }
@@ -399,6 +422,7 @@ chown_cmd (void)
 
     current_file = 0;
     ignore_all = FALSE;
+    attr_walk_init (&walk);
 
     do
     {                           /* do while any files remaining */
@@ -443,6 +467,7 @@ chown_cmd (void)
         chown_label (4, string_perm (sf_stat.st_mode));
 
         result = dlg_run (ch_dlg);
+        recursive = recursive_check->state;
 
         switch (result)
         {
@@ -473,9 +498,11 @@ chown_cmd (void)
                         if (mc_chown (vpath, new_user, new_group) == -1)
                             message (D_ERROR, MSG_ERROR, _("Cannot chown \"%s\"\n%s"),
                                      fname, unix_error_string (errno));
+                        chown_subtree (vpath, &sf_stat, new_user, new_group);
                         end_chown = TRUE;
                     }
-                    else if (!try_chown (vpath, new_user, new_group))
+                    else if (!try_chown (vpath, new_user, new_group)
+                             || !chown_subtree (vpath, &sf_stat, new_user, new_group))
                     {
                         /* stop multiple files processing */
                         result = B_CANCEL;
@@ -484,7 +511,7 @@ chown_cmd (void)
                 }
                 else
                 {
-                    apply_chowns (vpath, new_user, new_group);
+                    apply_chowns (vpath, &sf_stat, new_user, new_group);
                     end_chown = TRUE;
                 }
 
@@ -502,7 +529,7 @@ chown_cmd (void)
                 if (user != NULL)
                 {
                     new_user = user->pw_uid;
-                    apply_chowns (vpath, new_user, new_group);
+                    apply_chowns (vpath, &sf_stat, new_user, new_group);
                     need_update = TRUE;
                     end_chown = TRUE;
                 }
@@ -519,7 +546,7 @@ chown_cmd (void)
                 if (grp != NULL)
                 {
                     new_group = grp->gr_gid;
-                    apply_chowns (vpath, new_user, new_group);
+                    apply_chowns (vpath, &sf_stat, new_user, new_group);
                     need_update = TRUE;
                     end_chown = TRUE;
                 }
@@ -542,6 +569,7 @@ chown_cmd (void)
     }
     while (current_panel->marked != 0 && !end_chown);
 
+    attr_walk_done (&walk, _("Chown command"));
     chown_done (need_update);
 }
 
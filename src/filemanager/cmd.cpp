@@ -31,14 +31,12 @@
  */
 
 #include <errno.h>
+#include <inttypes.h>           /* uintmax_t */
 #include <stdio.h>
 #include <string.h>
 
 #include <sys/types.h>
 #include <sys/stat.h>
-#ifdef HAVE_MMAP
-#include <sys/mman.h>
-#endif
 #ifdef ENABLE_VFS_NET
 #include <netdb.h>
 #endif
@@ -49,7 +47,7 @@
 
 #include "lib/global.hpp"
 
-#include "lib/tty/tty.hpp"        /* LINES, tty_touch_screen() */
+#include "lib/tty/tty.hpp"
 #include "lib/tty/key.hpp"        /* ALT() macro */
 #include "lib/mcconfig.hpp"
 #include "lib/filehighlight.hpp"  /* MC_FHL_INI_FILE */
@@ -97,11 +95,11 @@
 
 /*** file scope macro definitions ****************************************************************/
 
-#ifdef HAVE_MMAP
-#ifndef MAP_FILE
-#define MAP_FILE 0
-#endif
-#endif /* HAVE_MMAP */
+/* Size of buffers used to compare files in Compare directories */
+#define COMPARE_BUF_SIZE ((size_t) 64 * 1024)
+
+/* Maximal number of file digests remembered between compares */
+#define COMPARE_DIGEST_CACHE_MAX 65536
 
 /*** file scope type declarations ****************************************************************/
 
@@ -109,11 +107,15 @@ enum CompareMode
 {
     compare_quick = 0,
     compare_size_only,
-    compare_thourough
+    compare_thourough,
+    compare_hash
 };
 
 /*** file scope variables ************************************************************************/
 
+/* Digests of already hashed files: "path:size:mtime" -> hex digest */
+static GHashTable *compare_digest_cache = NULL;
+
 #ifdef ENABLE_VFS_NET
 static const char *machine_str = N_("Enter machine name (F1 for details):");
 #endif /* ENABLE_VFS_NET */
@@ -201,82 +203,181 @@ set_panel_filter (WPanel * p)
 
 /* --------------------------------------------------------------------------------------------- */
 
+/** Read up to @size bytes, retrying short reads so that two streams
+ * of equal content always return equal chunks.
+ */
+
+static ssize_t
+compare_read (int fd, char *buf, size_t size)
+{
+    size_t got = 0;
+
+    while (got < size)
+    {
+        ssize_t n;
+
+        n = mc_read (fd, buf + got, size - got);
+        if (n == -1 && errno == EINTR)
+            continue;
+        if (n == -1)
+            return -1;
+        if (n == 0)
+            break;
+        got += (size_t) n;
+    }
+
+    return (ssize_t) got;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Compare files chunk by chunk through the VFS. Stops at the first difference. */
+
 static int
 compare_files (const vfs_path_t * vpath1, const vfs_path_t * vpath2, off_t size)
 {
-    int file1;
+    int file1, file2;
     int result = -1;            /* Different by default */
+    char *buf1, *buf2;
 
     if (size == 0)
         return 0;
 
-    file1 = open (vfs_path_as_str (vpath1), O_RDONLY);
-    if (file1 >= 0)
+    file1 = mc_open (vpath1, O_RDONLY);
+    if (file1 == -1)
+        return result;
+
+    file2 = mc_open (vpath2, O_RDONLY);
+    if (file2 == -1)
     {
-        int file2;
+        mc_close (file1);
+        return result;
+    }
 
-        file2 = open (vfs_path_as_str (vpath2), O_RDONLY);
-        if (file2 >= 0)
-        {
-#ifdef HAVE_MMAP
-            char *data1;
+    buf1 = static_cast<char *>(g_malloc (2 * COMPARE_BUF_SIZE));
+    buf2 = buf1 + COMPARE_BUF_SIZE;
 
-            /* Ugly if jungle */
-            data1 = mmap (0, size, PROT_READ, MAP_FILE | MAP_PRIVATE, file1, 0);
-            if (data1 != (char *) -1)
-            {
-                char *data2;
+    while (TRUE)
+    {
+        ssize_t n1, n2;
 
-                data2 = mmap (0, size, PROT_READ, MAP_FILE | MAP_PRIVATE, file2, 0);
-                if (data2 != (char *) -1)
-                {
-                    rotate_dash (TRUE);
-                    result = memcmp (data1, data2, size);
-                    munmap (data2, size);
-                }
-                munmap (data1, size);
-            }
-#else
-            /* Don't have mmap() :( Even more ugly :) */
-            char buf1[BUFSIZ], buf2[BUFSIZ];
-            int n1, n2;
+        rotate_dash (TRUE);
 
-            rotate_dash (TRUE);
-            do
-            {
-                while ((n1 = read (file1, buf1, sizeof (buf1))) == -1 && errno == EINTR)
-                    ;
-                while ((n2 = read (file2, buf2, sizeof (buf2))) == -1 && errno == EINTR)
-                    ;
-            }
-            while (n1 == n2 && n1 == sizeof (buf1) && memcmp (buf1, buf2, sizeof (buf1)) == 0);
-            result = (n1 != n2) || memcmp (buf1, buf2, n1);
-#endif /* !HAVE_MMAP */
-            close (file2);
+        n1 = compare_read (file1, buf1, COMPARE_BUF_SIZE);
+        n2 = compare_read (file2, buf2, COMPARE_BUF_SIZE);
+
+        if (n1 == -1 || n2 == -1 || n1 != n2 || memcmp (buf1, buf2, (size_t) n1) != 0)
+            break;
+
+        if ((size_t) n1 < COMPARE_BUF_SIZE)
+        {
+            result = 0;
+            break;
         }
-        close (file1);
     }
+
+    g_free (buf1);
+    mc_close (file2);
+    mc_close (file1);
     rotate_dash (FALSE);
 
     return result;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/** Get digest of the file content. Digests are cached by name, size and mtime,
+ * so repeated compares of unchanged files read them only once.
+ *
+ * @return newly allocated digest or NULL on error. The cache may be flushed by the next
+ * call, so the caller gets its own copy.
+ */
+
+static char *
+compare_get_digest (const vfs_path_t * vpath, const struct stat *st)
+{
+    char *key;
+    const char *digest;
+    GChecksum *checksum;
+    char *buf;
+    int fd;
+    ssize_t n;
+
+    if (compare_digest_cache == NULL)
+        compare_digest_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
+    key = g_strdup_printf ("%s:%" PRIuMAX ":%" PRIuMAX, vfs_path_as_str (vpath),
+                           (uintmax_t) st->st_size, (uintmax_t) st->st_mtime);
+
+    digest = static_cast<const char *>(g_hash_table_lookup (compare_digest_cache, key));
+    if (digest != NULL)
+    {
+        g_free (key);
+        return g_strdup (digest);
+    }
+
+    fd = mc_open (vpath, O_RDONLY);
+    if (fd == -1)
+    {
+        g_free (key);
+        return NULL;
+    }
+
+    checksum = g_checksum_new (G_CHECKSUM_SHA256);
+    buf = static_cast<char *>(g_malloc (COMPARE_BUF_SIZE));
+
+    do
+    {
+        rotate_dash (TRUE);
+        n = compare_read (fd, buf, COMPARE_BUF_SIZE);
+        if (n > 0)
+            g_checksum_update (checksum, (const guchar *) buf, n);
+    }
+    while (n == (ssize_t) COMPARE_BUF_SIZE);
+
+    g_free (buf);
+    mc_close (fd);
+    rotate_dash (FALSE);
+
+    if (n == -1)
+    {
+        g_checksum_free (checksum);
+        g_free (key);
+        return NULL;
+    }
+
+    if (g_hash_table_size (compare_digest_cache) >= COMPARE_DIGEST_CACHE_MAX)
+        g_hash_table_remove_all (compare_digest_cache);
+
+    digest = g_strdup (g_checksum_get_string (checksum));
+    g_checksum_free (checksum);
+    g_hash_table_insert (compare_digest_cache, key, (gpointer) digest);
+
+    return g_strdup (digest);
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 static void
 compare_dir (WPanel * panel, WPanel * other, enum CompareMode mode)
 {
-    int i, j;
+    int i;
+    GHashTable *other_files;
 
     /* No marks by default */
     panel->marked = 0;
     panel->total = 0;
     panel->dirs_marked = 0;
 
+    /* Index the other panel by name: one hash lookup per file instead of a scan.
+       Fill backwards so that the first of equal names wins, as the old scan did. */
+    other_files = g_hash_table_new (g_str_hash, g_str_equal);
+    for (i = other->dir.len - 1; i >= 0; i--)
+        g_hash_table_insert (other_files, other->dir.list[i].fname, &other->dir.list[i]);
+
     /* Handle all files in the panel */
     for (i = 0; i < panel->dir.len; i++)
     {
         file_entry_t *source = &panel->dir.list[i];
+        file_entry_t *target;
 
         /* Default: unmarked */
         file_mark (panel, i, 0);
@@ -286,18 +387,14 @@ compare_dir (WPanel * panel, WPanel * other, enum CompareMode mode)
             continue;
 
         /* Search the corresponding entry from the other panel */
-        for (j = 0; j < other->dir.len; j++)
-            if (strcmp (source->fname, other->dir.list[j].fname) == 0)
-                break;
+        target = static_cast<file_entry_t *>(g_hash_table_lookup (other_files, source->fname));
 
-        if (j >= other->dir.len)
+        if (target == NULL)
             /* Not found -> mark */
             do_file_mark (panel, i, 1);
         else
         {
             /* Found */
-            file_entry_t *target = &other->dir.list[j];
-
             if (mode != compare_size_only)
                 /* Older version is not marked */
                 if (source->st.st_mtime < target->st.st_mtime)
@@ -323,19 +420,35 @@ compare_dir (WPanel * panel, WPanel * other, enum CompareMode mode)
                 continue;
             }
 
-            /* Thorough compare on, do byte-by-byte comparison */
+            /* Thorough compare on, do byte-by-byte or digest comparison */
             {
                 vfs_path_t *src_name, *dst_name;
 
                 src_name = vfs_path_append_new (panel->cwd_vpath, source->fname, (char *) NULL);
                 dst_name = vfs_path_append_new (other->cwd_vpath, target->fname, (char *) NULL);
-                if (compare_files (src_name, dst_name, source->st.st_size))
+
+                if (mode == compare_hash)
+                {
+                    char *src_digest, *dst_digest;
+
+                    src_digest = compare_get_digest (src_name, &source->st);
+                    dst_digest = compare_get_digest (dst_name, &target->st);
+                    if (src_digest == NULL || dst_digest == NULL
+                        || strcmp (src_digest, dst_digest) != 0)
+                        do_file_mark (panel, i, 1);
+                    g_free (src_digest);
+                    g_free (dst_digest);
+                }
+                else if (compare_files (src_name, dst_name, source->st.st_size))
                     do_file_mark (panel, i, 1);
+
                 vfs_path_free (src_name);
                 vfs_path_free (dst_name);
             }
         }
     }                           /* for (i ...) */
+
+    g_hash_table_destroy (other_files);
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -1151,10 +1264,10 @@ compare_dirs_cmd (void)
 
     choice =
         query_dialog (_("Compare directories"),
-                      _("Select compare method:"), D_NORMAL, 4,
-                      _("&Quick"), _("&Size only"), _("&Thorough"), _("&Cancel"));
+                      _("Select compare method:"), D_NORMAL, 5,
+                      _("&Quick"), _("&Size only"), _("&Thorough"), _("&Hash"), _("&Cancel"));
 
-    if (choice < 0 || choice > 2)
+    if (choice < 0 || choice > 3)
         return;
 
     thorough_flag = static_cast<CompareMode>(choice);
@@ -1197,7 +1310,7 @@ void
 swap_cmd (void)
 {
     swap_panels ();
-    tty_touch_screen ();
+    /* both panels are redrawn in full; the screen library sends only the cells that differ */
     repaint_screen ();
 }
 
@@ -298,6 +298,7 @@ dir_list_append (dir_list * list, const char *fname, const struct stat * st,
     fentry->f.link_to_dir = link_to_dir ? 1 : 0;
     fentry->f.stale_link = stale_link ? 1 : 0;
     fentry->f.dir_size_computed = 0;
+    fentry->fhl_stamp = 0;
     fentry->st = *st;
     fentry->sort_key = NULL;
     fentry->second_sort_key = NULL;
@@ -730,6 +731,7 @@ dir_list_reload (dir_list * list, const vfs_path_t * vpath, GCompareFunc sort,
         dfentry->f.dir_size_computed = fentry->f.dir_size_computed;
         dfentry->f.link_to_dir = fentry->f.link_to_dir;
         dfentry->f.stale_link = fentry->f.stale_link;
+        dfentry->fhl_stamp = 0;
         dfentry->sort_key = NULL;
         dfentry->second_sort_key = NULL;
         if (fentry->f.marked)
@@ -813,3 +815,135 @@ dir_list_reload (dir_list * list, const vfs_path_t * vpath, GCompareFunc sort,
 }
 
 /* --------------------------------------------------------------------------------------------- */
+/**
+ * Apply a set of changed names to a loaded directory list.
+ *
+ * Every name of @changes is re-examined: entries which disappeared or no longer pass the filter
+ * are dropped, the others are (re)inserted at their sorted place. Marks of the surviving
+ * entries are kept. Unlike dir_list_reload() the directory is not read again, so the cost
+ * depends on the number of changes and not on the size of the directory.
+ *
+ * @param list directory list sorted with @sort and @sort_op
+ * @param vpath directory the list belongs to
+ * @param changes set of file names relative to @vpath
+ *
+ * @return FALSE on failure, TRUE on success
+ */
+
+gboolean
+dir_list_update (dir_list * list, const vfs_path_t * vpath, GHashTable * changes,
+                 GCompareFunc sort, const dir_sort_options_t * sort_op, const char *fltr)
+{
+    GHashTable *marked_files;
+    GHashTableIter iter;
+    gpointer key;
+    int i, j, dot_dot_found;
+    gboolean ret = TRUE;
+
+    marked_files = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+    /* take the changed entries out of the list */
+    for (i = 0, j = 0; i < list->len; i++)
+    {
+        file_entry_t *fentry;
+
+        fentry = &list->list[i];
+        if (!DIR_IS_DOTDOT (fentry->fname) && g_hash_table_contains (changes, fentry->fname))
+        {
+            if (fentry->f.marked)
+                g_hash_table_add (marked_files, fentry->fname);
+            else
+                g_free (fentry->fname);
+            continue;
+        }
+
+        if (j != i)
+            list->list[j] = *fentry;
+        j++;
+    }
+    list->len = j;
+
+    reverse = sort_op->reverse ? -1 : 1;
+    case_sensitive = sort_op->case_sensitive ? 1 : 0;
+    exec_first = sort_op->exec_first;
+    dot_dot_found = list->len > 0 && DIR_IS_DOTDOT (list->list[0].fname) ? 1 : 0;
+
+    g_hash_table_iter_init (&iter, changes);
+    while (ret && g_hash_table_iter_next (&iter, &key, NULL))
+    {
+        const char *fname = (const char *) key;
+        vfs_path_t *tmp_vpath;
+        struct stat st;
+        gboolean link_to_dir, stale_link;
+        file_entry_t fentry;
+        int lo, hi;
+
+        if (DIR_IS_DOT (fname) || DIR_IS_DOTDOT (fname))
+            continue;
+        if (!panels_options.show_dot_files && fname[0] == '.')
+            continue;
+        if (!panels_options.show_backups && fname[strlen (fname) - 1] == '~')
+            continue;
+
+        tmp_vpath = vfs_path_append_new (vpath, fname, (char *) NULL);
+        if (mc_lstat (tmp_vpath, &st) == -1)
+        {
+            /* gone */
+            vfs_path_free (tmp_vpath);
+            continue;
+        }
+
+        link_to_dir = file_is_symlink_to_dir (tmp_vpath, &st, &stale_link);
+        vfs_path_free (tmp_vpath);
+
+        if (!(S_ISDIR (st.st_mode) || link_to_dir || fltr == NULL
+              || mc_search (fltr, NULL, fname, MC_SEARCH_T_GLOB)))
+            continue;
+
+        if (list->len == list->size && !dir_list_grow (list, DIR_LIST_RESIZE_STEP))
+        {
+            ret = FALSE;
+            break;
+        }
+
+        fentry.fnamelen = strlen (fname);
+        fentry.fname = g_strndup (fname, fentry.fnamelen);
+        fentry.f.marked = g_hash_table_contains (marked_files, fname) ? 1 : 0;
+        fentry.f.link_to_dir = link_to_dir ? 1 : 0;
+        fentry.f.stale_link = stale_link ? 1 : 0;
+        fentry.f.dir_size_computed = 0;
+        fentry.fhl_stamp = 0;
+        fentry.st = st;
+        fentry.sort_key = NULL;
+        fentry.second_sort_key = NULL;
+
+        /* the new entry goes after all equal ones, as it would be appended by a reload */
+        lo = dot_dot_found;
+        hi = list->len;
+        if (sort != (GCompareFunc) unsorted)
+            while (lo < hi)
+            {
+                int mid = lo + (hi - lo) / 2;
+
+                if (sort (&list->list[mid], &fentry) <= 0)
+                    lo = mid + 1;
+                else
+                    hi = mid;
+            }
+        else
+            lo = hi;
+
+        if (lo < list->len)
+            memmove (&list->list[lo + 1], &list->list[lo],
+                     (list->len - lo) * sizeof (file_entry_t));
+        list->list[lo] = fentry;
+        list->len++;
+    }
+
+    clean_sort_keys (list, 0, list->len);
+    g_hash_table_destroy (marked_files);
+
+    return ret;
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,362 @@
+/*
+   Watching of panel directories for changes.
+
+   Copyright (C) 2020
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \file dirwatch.c
+ *  \brief Source: watching of panel directories for changes
+ *
+ *  Every local panel directory is watched with inotify. Names reported by the kernel
+ *  are collected per panel, and on the next reload only those entries are re-examined
+ *  instead of reading and sorting the whole directory again. If the kernel queue
+ *  overflows or the directory itself goes away, the panel falls back to a full reload.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+#include "lib/global.hpp"
+#include "lib/tty/key.hpp"        /* add_select_channel() */
+#include "lib/vfs/vfs.hpp"
+#include "lib/widget.hpp"
+
+#include "dirwatch.hpp"
+
+/*** global variables ****************************************************************************/
+
+/*** file scope macro definitions ****************************************************************/
+
+#define DIRWATCH_MASK (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_MODIFY \
+                       | IN_ATTRIB | IN_CLOSE_WRITE | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR)
+
+#define DIRWATCH_LOST_MASK (IN_DELETE_SELF | IN_MOVE_SELF | IN_UNMOUNT | IN_IGNORED)
+
+/* above this number of pending names a full reload is cheaper */
+#define DIRWATCH_CHANGES_MAX 1024
+
+/*** file scope type declarations ****************************************************************/
+
+typedef struct
+{
+    WPanel *panel;
+    int wd;
+    char *path;                 /* directory as it was when the watch was added */
+    GHashTable *changes;        /* names reported since the last sync */
+    gboolean lost;              /* changes are unknown, full reload is required */
+} dirwatch_t;
+
+/*** file scope variables ************************************************************************/
+
+static int dirwatch_fd = -1;
+static gboolean dirwatch_failed = FALSE;
+static GSList *dirwatch_list = NULL;
+
+/*** file scope functions ************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+static dirwatch_t *
+dirwatch_find (const WPanel * panel)
+{
+    GSList *l;
+
+    for (l = dirwatch_list; l != NULL; l = g_slist_next (l))
+    {
+        dirwatch_t *w = (dirwatch_t *) l->data;
+
+        if (w->panel == panel)
+            return w;
+    }
+
+    return NULL;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+dirwatch_set_lost (dirwatch_t * w)
+{
+    w->lost = TRUE;
+    g_hash_table_remove_all (w->changes);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+dirwatch_event (const struct inotify_event *ev)
+{
+    GSList *l;
+
+    for (l = dirwatch_list; l != NULL; l = g_slist_next (l))
+    {
+        dirwatch_t *w = (dirwatch_t *) l->data;
+
+        if ((ev->mask & IN_Q_OVERFLOW) != 0)
+            dirwatch_set_lost (w);
+        else if (w->wd != ev->wd || w->lost)
+            continue;
+        else if ((ev->mask & DIRWATCH_LOST_MASK) != 0)
+            dirwatch_set_lost (w);
+        else if (ev->len != 0 && ev->name[0] != '\0')
+        {
+            if (g_hash_table_size (w->changes) >= DIRWATCH_CHANGES_MAX)
+                dirwatch_set_lost (w);
+            else
+                g_hash_table_add (w->changes, g_strdup (ev->name));
+        }
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Take all queued events from the kernel */
+
+static gboolean
+dirwatch_read (void)
+{
+    gboolean got = FALSE;
+
+    if (dirwatch_fd < 0)
+        return FALSE;
+
+    while (TRUE)
+    {
+        alignas (struct inotify_event) char buf[4096];
+        ssize_t len;
+        char *p;
+
+        len = read (dirwatch_fd, buf, sizeof (buf));
+        if (len <= 0)
+        {
+            if (len < 0 && errno == EINTR)
+                continue;
+            break;
+        }
+
+        for (p = buf; p < buf + len;)
+        {
+            const struct inotify_event *ev = (const struct inotify_event *) p;
+
+            dirwatch_event (ev);
+            p += sizeof (struct inotify_event) + ev->len;
+        }
+
+        got = TRUE;
+    }
+
+    return got;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+dirwatch_is_pending (const dirwatch_t * w)
+{
+    return w->lost || g_hash_table_size (w->changes) != 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Called from the main loop when the kernel has events for us. The panels are refreshed
+ * at once only while no other dialog is on top of the file manager; otherwise the changes
+ * are kept and applied by the next panel update.
+ */
+
+static int
+dirwatch_callback (int fd, void *info)
+{
+    GSList *l, *panels = NULL;
+    gboolean redraw = FALSE;
+
+    (void) fd;
+    (void) info;
+
+    if (!dirwatch_read ())
+        return 0;
+
+    if (top_dlg == NULL || top_dlg->data != midnight_dlg)
+        return 0;
+
+    /* panel_reload() re-adds watches, so don't walk the list while reloading */
+    for (l = dirwatch_list; l != NULL; l = g_slist_next (l))
+    {
+        dirwatch_t *w = (dirwatch_t *) l->data;
+
+        if (dirwatch_is_pending (w) && !w->panel->is_panelized && !w->panel->searching)
+            panels = g_slist_prepend (panels, w->panel);
+    }
+
+    for (l = panels; l != NULL; l = g_slist_next (l))
+    {
+        WPanel *panel = (WPanel *) l->data;
+        char *current_file;
+
+        current_file = g_strdup (panel->dir.list[panel->selected].fname);
+        panel_reload (panel);
+        try_to_select (panel, current_file);
+        g_free (current_file);
+
+        if (panel->dirty)
+        {
+            widget_draw (WIDGET (panel));
+            redraw = TRUE;
+        }
+    }
+
+    g_slist_free (panels);
+
+    if (redraw)
+        mc_refresh ();
+
+    return 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+dirwatch_init (void)
+{
+    if (dirwatch_fd >= 0)
+        return TRUE;
+
+    if (dirwatch_failed)
+        return FALSE;
+
+    dirwatch_fd = inotify_init1 (IN_NONBLOCK | IN_CLOEXEC);
+    if (dirwatch_fd < 0)
+    {
+        dirwatch_failed = TRUE;
+        return FALSE;
+    }
+
+    add_select_channel (dirwatch_fd, dirwatch_callback, NULL);
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Start watching the current directory of the panel. A previous watch of the panel is dropped.
+ * Nothing is watched for non-local directories. Call it before the directory is read:
+ * changes made between the read and the start of the watch would never be reported.
+ */
+
+void
+dirwatch_add (WPanel * panel)
+{
+    dirwatch_t *w;
+    const char *path;
+    int wd;
+
+    dirwatch_remove (panel);
+
+    if (!vfs_file_is_local (panel->cwd_vpath) || !dirwatch_init ())
+        return;
+
+    path = vfs_path_as_str (panel->cwd_vpath);
+    wd = inotify_add_watch (dirwatch_fd, path, DIRWATCH_MASK);
+    if (wd < 0)
+        return;
+
+    w = g_new (dirwatch_t, 1);
+    w->panel = panel;
+    w->wd = wd;
+    w->path = g_strdup (path);
+    w->changes = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    w->lost = FALSE;
+
+    dirwatch_list = g_slist_prepend (dirwatch_list, w);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+void
+dirwatch_remove (WPanel * panel)
+{
+    dirwatch_t *w;
+    GSList *l;
+    gboolean shared = FALSE;
+
+    w = dirwatch_find (panel);
+    if (w == NULL)
+        return;
+
+    dirwatch_list = g_slist_remove (dirwatch_list, w);
+
+    /* both panels in the same directory get the same watch descriptor */
+    for (l = dirwatch_list; l != NULL && !shared; l = g_slist_next (l))
+        shared = ((dirwatch_t *) l->data)->wd == w->wd;
+
+    if (!shared)
+        inotify_rm_watch (dirwatch_fd, w->wd);
+
+    g_hash_table_destroy (w->changes);
+    g_free (w->path);
+    g_free (w);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Forget collected changes: the next reload of the panel reads the whole directory */
+
+void
+dirwatch_reset (WPanel * panel)
+{
+    dirwatch_t *w;
+
+    w = dirwatch_find (panel);
+    if (w != NULL)
+        dirwatch_set_lost (w);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Bring the panel list up to date using the collected changes.
+ *
+ * @return TRUE if the list is current, FALSE if the directory must be read again
+ */
+
+gboolean
+dirwatch_sync (WPanel * panel)
+{
+    dirwatch_t *w;
+    gboolean ret;
+
+    dirwatch_read ();
+
+    w = dirwatch_find (panel);
+    if (w == NULL || w->lost || panel->is_panelized
+        || strcmp (w->path, vfs_path_as_str (panel->cwd_vpath)) != 0)
+        return FALSE;
+
+    if (g_hash_table_size (w->changes) == 0)
+        return TRUE;
+
+    ret = dir_list_update (&panel->dir, panel->cwd_vpath, w->changes,
+                           panel->sort_field->sort_routine, &panel->sort_info, panel->filter);
+    g_hash_table_remove_all (w->changes);
+
+    if (!ret)
+        w->lost = TRUE;
+
+    return ret;
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,55 @@
+/** \file dirwatch.h
+ *  \brief Header: watching of panel directories for changes
+ */
+
+#pragma once
+
+#include "lib/global.hpp"
+
+#include "panel.hpp"
+
+/*** typedefs(not structures) and defined constants **********************************************/
+
+/*** enums ***************************************************************************************/
+
+/*** structures declarations (and typedefs of structures)*****************************************/
+
+/*** global variables defined in .c file *********************************************************/
+
+/*** declarations of public functions ************************************************************/
+
+#ifdef HAVE_SYS_INOTIFY_H
+void dirwatch_add (WPanel * panel);
+void dirwatch_remove (WPanel * panel);
+void dirwatch_reset (WPanel * panel);
+gboolean dirwatch_sync (WPanel * panel);
+#endif /* HAVE_SYS_INOTIFY_H */
+
+/*** inline functions ****************************************************************************/
+
+#ifndef HAVE_SYS_INOTIFY_H
+static inline void
+dirwatch_add (WPanel * panel)
+{
+    (void) panel;
+}
+
+static inline void
+dirwatch_remove (WPanel * panel)
+{
+    (void) panel;
+}
+
+static inline void
+dirwatch_reset (WPanel * panel)
+{
+    (void) panel;
+}
+
+static inline gboolean
+dirwatch_sync (WPanel * panel)
+{
+    (void) panel;
+    return FALSE;
+}
+#endif /* HAVE_SYS_INOTIFY_H */
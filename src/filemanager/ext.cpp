@@ -61,6 +61,7 @@
 #endif
 
 #include "panel.hpp"              /* do_cd */
+#include "filetype.hpp"
 
 #include "ext.hpp"
 
@@ -68,23 +69,70 @@
 
 /*** file scope macro definitions ****************************************************************/
 
-#ifdef FILE_L
-#define FILE_CMD "file -L "
-#else
-#define FILE_CMD "file "
-#endif
+/* Limit of strings enumerated while looking for the suffixes a regex/ rule can match */
+#define EXT_REGEX_EXPAND_MAX 1024
 
 /*** file scope type declarations ****************************************************************/
 
 typedef char *(*quote_func_t) (const char *name, gboolean quote_percent);
 
+typedef enum
+{
+    EXT_RULE_SHELL = 0,
+    EXT_RULE_REGEX,
+    EXT_RULE_TYPE,
+    EXT_RULE_DIRECTORY,
+    EXT_RULE_INCLUDE,
+    EXT_RULE_DEFAULT
+} ext_rule_kind_t;
+
+typedef struct
+{
+    char *key;                  /* Open, View, Edit, Include... */
+    char *command;              /* text after '=' up to the end of line */
+} ext_action_t;
+
+/* One section of mc.ext: the keyword/description line and its list of actions */
+typedef struct
+{
+    ext_rule_kind_t kind;
+    gboolean case_insense;
+    char *pattern;              /* description without keyword/ and i/ */
+    size_t pattern_len;
+    mc_search_t *search;        /* for regex/, type/ and directory/ rules */
+    GArray *actions;            /* ext_action_t */
+} ext_rule_t;
+
+typedef struct
+{
+    gboolean exists;
+    time_t mtime;
+    off_t size;
+    ino_t inode;
+} ext_file_stamp_t;
+
+/* mc.ext compiled into a list of rules.
+ * Rules are kept in file order, indexes store rule numbers in ascending order. */
+typedef struct
+{
+    char *path;                 /* file the rules were read from */
+    ext_file_stamp_t stamp;
+    char *user_path;            /* user's mc.ext, which overrides the stock one when it appears */
+    ext_file_stamp_t user_stamp;
+
+    GPtrArray *rules;           /* ext_rule_t */
+    GHashTable *by_name;        /* lowercased file name -> GArray of rule numbers */
+    GHashTable *by_ext;         /* lowercased text after the last dot -> GArray of rule numbers */
+    GArray *unindexed;          /* rules which are checked for every file */
+    GArray *includes;           /* include/ rules */
+} ext_table_t;
+
 /*** file scope variables ************************************************************************/
 
-/* This variable points to a copy of the mc.ext file in memory
- * With this we avoid loading/parsing the file each time we
- * need it
+/* mc.ext compiled on first use.
+ * With this we avoid loading/parsing the file each time we need it.
  */
-static char *data = NULL;
+static ext_table_t *ext_table = NULL;
 static vfs_path_t *localfilecopy_vpath = NULL;
 static char buffer[BUF_1K];
 
@@ -525,113 +573,20 @@ exec_extension (void *target, const vfs_path_t * filename_vpath, const char *lc_
 
 /* --------------------------------------------------------------------------------------------- */
 /**
- * Run cmd_file with args, put result into buf.
- * If error, put '\0' into buf[0]
- * Return 1 if the data is valid, 0 otherwise, -1 for fatal errors.
- *
- * NOTES: buf is null-terminated string.
- */
-
-static int
-get_popen_information (const char *cmd_file, const char *args, char *buf, int buflen)
-{
-    gboolean read_bytes = FALSE;
-    char *command;
-    FILE *f;
-
-    command = g_strconcat (cmd_file, args, " 2>/dev/null", (char *) NULL);
-    f = popen (command, "r");
-    g_free (command);
-
-    if (f != NULL)
-    {
-#ifdef __QNXNTO__
-        if (setvbuf (f, NULL, _IOFBF, 0) != 0)
-        {
-            (void) pclose (f);
-            return -1;
-        }
-#endif
-        read_bytes = (fgets (buf, buflen, f) != NULL);
-        if (!read_bytes)
-            buf[0] = '\0';      /* Paranoid termination */
-        pclose (f);
-    }
-    else
-    {
-        buf[0] = '\0';          /* Paranoid termination */
-        return -1;
-    }
-
-    buf[buflen - 1] = '\0';
-
-    return read_bytes ? 1 : 0;
-}
-
-/* --------------------------------------------------------------------------------------------- */
-/**
- * Run the "file" command on the local file.
- * Return 1 if the data is valid, 0 otherwise, -1 for fatal errors.
- */
-
-static int
-get_file_type_local (const vfs_path_t * filename_vpath, char *buf, int buflen)
-{
-    char *tmp;
-    int ret;
-
-    tmp = name_quote (vfs_path_get_last_path_str (filename_vpath), FALSE);
-    ret = get_popen_information (FILE_CMD, tmp, buf, buflen);
-    g_free (tmp);
-
-    return ret;
-}
-
-/* --------------------------------------------------------------------------------------------- */
-/**
- * Run the "enca" command on the local file.
- * Return 1 if the data is valid, 0 otherwise, -1 for fatal errors.
- */
-
-#ifdef HAVE_CHARSET
-static int
-get_file_encoding_local (const vfs_path_t * filename_vpath, char *buf, int buflen)
-{
-    char *tmp, *lang, *args;
-    int ret;
-
-    tmp = name_quote (vfs_path_get_last_path_str (filename_vpath), FALSE);
-    lang = name_quote (autodetect_codeset, FALSE);
-    args = g_strconcat (" -L", lang, " -i ", tmp, (char *) NULL);
-
-    ret = get_popen_information ("enca", args, buf, buflen);
-
-    g_free (args);
-    g_free (lang);
-    g_free (tmp);
-
-    return ret;
-}
-#endif /* HAVE_CHARSET */
-
-/* --------------------------------------------------------------------------------------------- */
-/**
- * Invoke the "file" command on the file and match its output against PTR.
+ * Match the description of the file contents against SEARCH.
  * have_type is a flag that is set if we already have tried to determine
  * the type of that file.
  * Return TRUE for match, FALSE otherwise.
  */
 
 static gboolean
-regex_check_type (const vfs_path_t * filename_vpath, const char *ptr, gboolean case_insense,
-                  gboolean * have_type, GError ** mcerror)
+regex_check_type (const vfs_path_t * filename_vpath, mc_search_t * search, gboolean * have_type,
+                  GError ** mcerror)
 {
     gboolean found = FALSE;
 
-    /* Following variables are valid if *have_type is TRUE */
+    /* Following variable is valid if *have_type is TRUE */
     static char content_string[2048];
-    static size_t content_shift = 0;
-    static int got_data = 0;
 
     mc_return_val_if_error (mcerror, FALSE);
 
@@ -640,409 +595,1242 @@ regex_check_type (const vfs_path_t * filename_vpath, const char *ptr, gboolean c
 
     if (!*have_type)
     {
-        vfs_path_t *localfile_vpath;
-        const char *realname;   /* name used with "file" */
-
-#ifdef HAVE_CHARSET
-        static char encoding_id[21];    /* CSISO51INISCYRILLIC -- 20 */
-        int got_encoding_data;
-#endif /* HAVE_CHARSET */
+        const file_type_t *info;
 
         /* Don't repeate even unsuccessful checks */
         *have_type = TRUE;
+        content_string[0] = '\0';
 
-        localfile_vpath = mc_getlocalcopy (filename_vpath);
-        if (localfile_vpath == NULL)
-        {
-            mc_propagate_error (mcerror, 0, _("Cannot fetch a local copy of %s"),
-                                vfs_path_as_str (filename_vpath));
+        info = file_type_get (filename_vpath, NULL, mcerror);
+        if (info == NULL)
             return FALSE;
-        }
 
-        realname = vfs_path_get_last_path_str (localfile_vpath);
+        g_strlcpy (content_string, info->type, sizeof (content_string));
 
 #ifdef HAVE_CHARSET
-        got_encoding_data = is_autodetect_codeset_enabled
-            ? get_file_encoding_local (localfile_vpath, encoding_id, sizeof (encoding_id)) : 0;
-
-        if (got_encoding_data > 0)
+        if (is_autodetect_codeset_enabled)
         {
-            char *pp;
             int cp_id;
 
-            pp = strchr (encoding_id, '\n');
-            if (pp != NULL)
-                *pp = '\0';
-
-            cp_id = CodepageDesc::get_codepage_index (encoding_id);
+            cp_id = info->encoding != NULL
+                ? CodepageDesc::get_codepage_index (info->encoding) : -1;
             if (cp_id == -1)
                 cp_id = default_source_codepage;
 
             SelCodePage::do_set_codepage (cp_id);
         }
 #endif /* HAVE_CHARSET */
+    }
 
-        got_data = get_file_type_local (localfile_vpath, content_string, sizeof (content_string));
-
-        mc_ungetlocalcopy (filename_vpath, localfile_vpath, FALSE);
+    if (content_string[0] != '\0')
+    {
+        if (search != NULL)
+            found = mc_search_run (search, content_string, 0, -1, NULL);
+        else
+            mc_propagate_error (mcerror, 0, "%s", _("Regular expression error"));
+    }
 
-        if (got_data > 0)
-        {
-            char *pp;
-            size_t real_len;
+    return found;
+}
 
-            pp = strchr (content_string, '\n');
-            if (pp != NULL)
-                *pp = '\0';
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Find the end of a bracket expression which starts at RE[POS].
+ * Store the characters it matches to SET, or NULL if the class is negated or not
+ * a plain list of ASCII characters and ranges.
+ * Return the position after the closing bracket, 0 for a malformed class.
+ */
 
-            real_len = strlen (realname);
+static size_t
+ext_regex_class (const char *re, size_t len, size_t pos, GPtrArray ** set)
+{
+    GString *chars;
+    gboolean enumerable = TRUE;
+    size_t i = pos + 1;
 
-            if (strncmp (content_string, realname, real_len) == 0)
-            {
-                /* Skip "realname: " */
-                content_shift = real_len;
-                if (content_string[content_shift] == ':')
-                {
-                    /* Solaris' file prints tab(s) after ':' */
-                    for (content_shift++; whitespace (content_string[content_shift]);
-                         content_shift++)
-                        ;
-                }
-            }
-        }
-        else
-        {
-            /* No data */
-            content_string[0] = '\0';
-        }
-        vfs_path_free (localfile_vpath);
-    }
+    chars = g_string_new ("");
 
-    if (got_data == -1)
+    if (i < len && re[i] == '^')
     {
-        mc_propagate_error (mcerror, 0, "%s", _("Pipe failed"));
-        return FALSE;
+        enumerable = FALSE;
+        i++;
     }
 
-    if (content_string[0] != '\0')
+    for (size_t first = i; i < len && (re[i] != ']' || i == first);)
     {
-        mc_search_t *search;
+        unsigned char lo, hi;
 
-        search = mc_search_new (ptr, DEFAULT_CHARSET);
-        if (search != NULL)
+        if (re[i] == '[' && i + 1 < len && strchr (":.=", re[i + 1]) != NULL)
+        {
+            /* [:alpha:] and friends */
+            const char *end;
+
+            end = g_strstr_len (re + i + 2, len - i - 2, ":]");
+            if (end == NULL)
+                end = g_strstr_len (re + i + 2, len - i - 2, ".]");
+            if (end == NULL)
+                end = g_strstr_len (re + i + 2, len - i - 2, "=]");
+            if (end == NULL)
+                break;
+            enumerable = FALSE;
+            i = (size_t) (end - re) + 2;
+            continue;
+        }
+
+        if (re[i] == '\\')
         {
-            search->search_type = MC_SEARCH_T_REGEX;
-            search->is_case_sensitive = !case_insense;
-            found = mc_search_run (search, content_string + content_shift, 0, -1, NULL);
-            mc_search_free (search);
+            if (i + 1 >= len)
+                break;
+            if (g_ascii_isalnum (re[i + 1]))
+                enumerable = FALSE;
+            lo = (unsigned char) re[i + 1];
+            i += 2;
         }
         else
+            lo = (unsigned char) re[i++];
+
+        hi = lo;
+        if (i + 1 < len && re[i] == '-' && re[i + 1] != ']')
         {
-            mc_propagate_error (mcerror, 0, "%s", _("Regular expression error"));
+            if (re[i + 1] == '\\')
+            {
+                if (i + 2 >= len)
+                    break;
+                if (g_ascii_isalnum (re[i + 2]))
+                    enumerable = FALSE;
+                hi = (unsigned char) re[i + 2];
+                i += 3;
+            }
+            else
+            {
+                hi = (unsigned char) re[i + 1];
+                i += 2;
+            }
         }
+
+        if (lo >= 0x80 || hi >= 0x80 || hi < lo || chars->len + (hi - lo) > 64)
+            enumerable = FALSE;
+        else
+            for (unsigned int c = lo; c <= hi; c++)
+                g_string_append_c (chars, (char) c);
     }
 
-    return found;
-}
+    *set = NULL;
 
-/* --------------------------------------------------------------------------------------------- */
-/*** public functions ****************************************************************************/
-/* --------------------------------------------------------------------------------------------- */
+    if (i >= len || re[i] != ']')
+    {
+        g_string_free (chars, TRUE);
+        return 0;
+    }
 
-void
-flush_extension_file (void)
-{
-    MC_PTR_FREE (data);
+    if (enumerable)
+    {
+        *set = g_ptr_array_new_with_free_func (g_free);
+        for (size_t c = 0; c < chars->len; c++)
+            g_ptr_array_add (*set, g_strndup (chars->str + c, 1));
+    }
+
+    g_string_free (chars, TRUE);
+
+    return i + 1;
 }
 
 /* --------------------------------------------------------------------------------------------- */
 /**
- * The second argument is action, i.e. Open, View or Edit
- * Use target object to open file in.
- *
- * This function returns:
- *
- * -1 for a failure or user interrupt
- * 0 if no command was run
- * 1 if some command was run
- *
- * If action == "View" then a parameter is checked in the form of "View:%d",
- * if the value for %d exists, then the viewer is started up at that line number.
+ * Split RE into the branches of its top level alternation.
+ * Return an array of offsets: start and end of each branch, NULL if RE is malformed.
  */
 
-int
-regex_command_for (void *target, const vfs_path_t * filename_vpath, const char *action,
-                   vfs_path_t ** script_vpath)
+static GArray *
+ext_regex_split (const char *re, size_t len)
 {
-    char *p, *q, *r, c;
-    const char *filename;
-    size_t file_len;
-    gboolean found = FALSE;
-    gboolean error_flag = FALSE;
-    int ret = 0;
-    struct stat mystat;
-    int view_at_line_number = 0;
-    char *include_target = NULL;
-    size_t include_target_len = 0;
-    gboolean have_type = FALSE; /* Flag used by regex_check_type() */
-
-    if (filename_vpath == NULL)
-        return 0;
-
-    if (script_vpath != NULL)
-        *script_vpath = NULL;
+    GArray *bounds;
+    size_t i, start = 0;
+    int depth = 0;
 
-    /* Check for the special View:%d parameter */
-    if (strncmp (action, "View:", 5) == 0)
-    {
-        view_at_line_number = atoi (action + 5);
-        action = "View";
-    }
+    bounds = g_array_new (FALSE, FALSE, sizeof (size_t));
 
-    if (data == NULL)
+    for (i = 0; i < len;)
     {
-        char *extension_file;
-        gboolean mc_user_ext = TRUE;
-        gboolean home_error = FALSE;
+        GPtrArray *set;
 
-        extension_file = mc_config_get_full_path (MC_FILEBIND_FILE);
-        if (!exist_file (extension_file))
+        switch (re[i])
         {
-            g_free (extension_file);
-          check_stock_mc_ext:
-            extension_file = mc_build_filename (mc_global.sysconfig_dir.c_str(), MC_LIB_EXT, (char *) NULL);
-            if (!exist_file (extension_file))
+        case '\\':
+            i += 2;
+            break;
+        case '[':
+            i = ext_regex_class (re, len, i, &set);
+            if (set != NULL)
+                g_ptr_array_free (set, TRUE);
+            if (i == 0)
+            {
+                g_array_free (bounds, TRUE);
+                return NULL;
+            }
+            break;
+        case '(':
+            depth++;
+            i++;
+            break;
+        case ')':
+            depth--;
+            i++;
+            break;
+        case '|':
+            if (depth == 0)
             {
-                g_free (extension_file);
-                extension_file =
-                    mc_build_filename (mc_global.share_data_dir.c_str(), MC_LIB_EXT, (char *) NULL);
+                g_array_append_val (bounds, start);
+                g_array_append_val (bounds, i);
+                start = i + 1;
             }
-            mc_user_ext = FALSE;
+            i++;
+            break;
+        default:
+            i++;
+            break;
         }
 
-        g_file_get_contents (extension_file, &data, NULL, NULL);
-        g_free (extension_file);
-        if (data == NULL)
-            return 0;
+        if (depth < 0)
+            break;
+    }
 
-        if (strstr (data, "default/") == NULL)
-        {
-            if (strstr (data, "regex/") == NULL && strstr (data, "shell/") == NULL &&
-                strstr (data, "type/") == NULL)
-            {
-                MC_PTR_FREE (data);
+    if (depth != 0 || i > len)
+    {
+        g_array_free (bounds, TRUE);
+        return NULL;
+    }
 
-                if (!mc_user_ext)
-                {
-                    char *title;
-
-                    title = g_strdup_printf (_(" %s%s file error"),
-                                             mc_global.sysconfig_dir.c_str(), MC_LIB_EXT);
-                    message (D_ERROR, title, _("The format of the %smc.ext "
-                                               "file has changed with version 3.0. It seems that "
-                                               "the installation failed. Please fetch a fresh "
-                                               "copy from the Midnight Commander package."),
-                             mc_global.sysconfig_dir.c_str());
-                    g_free (title);
-                    return 0;
-                }
+    g_array_append_val (bounds, start);
+    g_array_append_val (bounds, len);
 
-                home_error = TRUE;
-                goto check_stock_mc_ext;
-            }
-        }
+    return bounds;
+}
 
-        if (home_error)
-        {
-            char *filebind_filename;
-            char *title;
-
-            filebind_filename = mc_config_get_full_path (MC_FILEBIND_FILE);
-            title = g_strdup_printf (_("%s file error"), filebind_filename);
-            message (D_ERROR, title,
-                     _("The format of the %s file has "
-                       "changed with version 3.0. You may either want to copy "
-                       "it from %smc.ext or use that file as an example of how to write it."),
-                     filebind_filename, mc_global.sysconfig_dir.c_str());
-            g_free (filebind_filename);
-            g_free (title);
-        }
-    }
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+ext_regex_atoms_free (GPtrArray * atoms)
+{
+    for (guint a = 0; a < atoms->len; a++)
+        if (g_ptr_array_index (atoms, a) != NULL)
+            g_ptr_array_free (static_cast < GPtrArray * >(g_ptr_array_index (atoms, a)), TRUE);
+    g_ptr_array_free (atoms, TRUE);
+}
 
-    mc_stat (filename_vpath, &mystat);
+/* --------------------------------------------------------------------------------------------- */
 
-    filename = vfs_path_get_last_path_str (filename_vpath);
-    filename = x_basename (filename);
-    file_len = strlen (filename);
+static GPtrArray *ext_regex_expand (const char *re, size_t len);
+
+/**
+ * Split a branch without alternation into atoms. Each atom is the set of strings it can match
+ * or NULL if that set is unknown.
+ * Return FALSE if the branch is malformed.
+ */
+
+static gboolean
+ext_regex_parse (const char *re, size_t len, GPtrArray * atoms)
+{
+    size_t i = 0;
 
-    for (p = data; *p != '\0'; p++)
+    while (i < len)
     {
-        for (q = p; whitespace (*q); q++)
-            ;
-        if (*q == '\n' || *q == '\0')
-            p = q;              /* empty line */
-        if (*p == '#')          /* comment */
-            while (*p != '\0' && *p != '\n')
-                p++;
-        if (*p == '\n')
-            continue;
-        if (*p == '\0')
-            break;
-        if (p == q)
+        GPtrArray *set = NULL;
+        unsigned char c = (unsigned char) re[i];
+
+        switch (c)
         {
-            /* i.e. starts in the first column, should be keyword/descNL */
-            gboolean case_insense;
-
-            found = FALSE;
-            q = strchr (p, '\n');
-            if (q == NULL)
-                q = strchr (p, '\0');
-            c = *q;
-            *q = '\0';
-            if (include_target != NULL)
+        case '\\':
+            if (i + 1 >= len)
+                return FALSE;
+            if (!g_ascii_isalnum (re[i + 1]) && (unsigned char) re[i + 1] < 0x80)
             {
-                if ((strncmp (p, "include/", 8) == 0)
-                    && (strncmp (p + 8, include_target, include_target_len) == 0))
-                    found = TRUE;
+                set = g_ptr_array_new_with_free_func (g_free);
+                g_ptr_array_add (set, g_strndup (re + i + 1, 1));
             }
-            else if (strncmp (p, "regex/", 6) == 0)
+            i += 2;
+            break;
+        case '[':
+            i = ext_regex_class (re, len, i, &set);
+            if (i == 0)
+                return FALSE;
+            break;
+        case '(':
             {
-                mc_search_t *search;
+                size_t end;
+                int depth = 0;
 
-                p += 6;
-                case_insense = (strncmp (p, "i/", 2) == 0);
-                if (case_insense)
-                    p += 2;
-
-                search = mc_search_new (p, DEFAULT_CHARSET);
-                if (search != NULL)
+                for (end = i; end < len; end++)
                 {
-                    search->search_type = MC_SEARCH_T_REGEX;
-                    search->is_case_sensitive = !case_insense;
-                    found = mc_search_run (search, filename, 0, file_len, NULL);
-                    mc_search_free (search);
+                    if (re[end] == '\\')
+                        end++;
+                    else if (re[end] == '[')
+                    {
+                        GPtrArray *skip;
+
+                        end = ext_regex_class (re, len, end, &skip);
+                        if (skip != NULL)
+                            g_ptr_array_free (skip, TRUE);
+                        if (end == 0)
+                            return FALSE;
+                        end--;
+                    }
+                    else if (re[end] == '(')
+                        depth++;
+                    else if (re[end] == ')' && --depth == 0)
+                        break;
                 }
+
+                if (end >= len)
+                    return FALSE;
+
+                /* (?:...) is a plain group, other (?...) constructs are not enumerated */
+                if (re[i + 1] != '?')
+                    set = ext_regex_expand (re + i + 1, end - i - 1);
+                else if (end > i + 2 && re[i + 2] == ':')
+                    set = ext_regex_expand (re + i + 3, end - i - 3);
+                i = end + 1;
             }
-            else if (strncmp (p, "directory/", 10) == 0)
+            break;
+        case ')':
+        case '*':
+        case '+':
+        case '?':
+        case '{':
+            return FALSE;
+        case '.':
+        case '^':
+        case '$':
+            i++;
+            break;
+        default:
+            if (c < 0x80)
             {
-                if (S_ISDIR (mystat.st_mode)
-                    && mc_search (p + 10, DEFAULT_CHARSET, vfs_path_as_str (filename_vpath),
-                                  MC_SEARCH_T_REGEX))
-                    found = TRUE;
+                set = g_ptr_array_new_with_free_func (g_free);
+                g_ptr_array_add (set, g_strndup (re + i, 1));
             }
-            else if (strncmp (p, "shell/", 6) == 0)
-            {
-                int (*cmp_func) (const char *s1, const char *s2, size_t n) = strncmp;
-
-                p += 6;
-                case_insense = (strncmp (p, "i/", 2) == 0);
-                if (case_insense)
-                {
-                    p += 2;
-                    cmp_func = strncasecmp;
-                }
+            i++;
+            break;
+        }
 
-                if (*p == '.' && file_len >= (size_t) (q - p))
+        if (i < len && re[i] == '?' && (i + 1 >= len || strchr ("?*+{", re[i + 1]) == NULL))
+        {
+            /* optional atom */
+            if (set != NULL)
+                g_ptr_array_add (set, g_strdup (""));
+            i++;
+        }
+        else
+            while (i < len && strchr ("?*+{", re[i]) != NULL)
+            {
+                if (set != NULL)
                 {
-                    if (cmp_func (p, filename + file_len - (q - p), q - p) == 0)
-                        found = TRUE;
+                    g_ptr_array_free (set, TRUE);
+                    set = NULL;
                 }
-                else
+                if (re[i] == '{')
                 {
-                    if ((size_t) (q - p) == file_len && cmp_func (p, filename, file_len) == 0)
-                        found = TRUE;
+                    const char *end;
+
+                    end = static_cast < const char *>(memchr (re + i, '}', len - i));
+                    if (end == NULL)
+                        return FALSE;
+                    i = (size_t) (end - re);
                 }
+                i++;
             }
-            else if (strncmp (p, "type/", 5) == 0)
-            {
-                GError *mcerror = NULL;
 
-                p += 5;
+        g_ptr_array_add (atoms, set);
+    }
 
-                case_insense = (strncmp (p, "i/", 2) == 0);
-                if (case_insense)
-                    p += 2;
+    return TRUE;
+}
 
-                found = regex_check_type (filename_vpath, p, case_insense, &have_type, &mcerror);
-                if (mc_error_message (&mcerror, NULL))
-                    error_flag = TRUE;  /* leave it if file cannot be opened */
-            }
-            else if (strncmp (p, "default/", 8) == 0)
-                found = TRUE;
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Enumerate all strings matched by RE.
+ * Return NULL if RE can match strings we can't or don't want to enumerate.
+ */
 
-            *q = c;
-        }
-        else
-        {                       /* List of actions */
-            p = q;
-            q = strchr (p, '\n');
-            if (q == NULL)
-                q = strchr (p, '\0');
-            if (found && !error_flag)
-            {
-                r = strchr (p, '=');
-                if (r != NULL)
-                {
-                    c = *r;
-                    *r = '\0';
-                    if (strcmp (p, "Include") == 0)
-                    {
-                        char *t;
+static GPtrArray *
+ext_regex_expand (const char *re, size_t len)
+{
+    GArray *bounds;
+    GPtrArray *result;
 
-                        include_target = p + 8;
-                        t = strchr (include_target, '\n');
+    bounds = ext_regex_split (re, len);
+    if (bounds == NULL)
+        return NULL;
 
-                        if (t != NULL)
-                            include_target_len = (size_t) (t - include_target);
-                        else
-                            include_target_len = strlen (include_target);
+    result = g_ptr_array_new_with_free_func (g_free);
 
-                        *r = c;
-                        p = q;
-                        found = FALSE;
+    for (guint b = 0; b < bounds->len; b += 2)
+    {
+        size_t start = g_array_index (bounds, size_t, b);
+        size_t end = g_array_index (bounds, size_t, b + 1);
+        GPtrArray *atoms, *strings;
+        gboolean ok;
 
-                        if (*p == '\0')
-                            break;
-                        continue;
-                    }
+        atoms = g_ptr_array_new ();
+        strings = g_ptr_array_new_with_free_func (g_free);
+        g_ptr_array_add (strings, g_strdup (""));
 
-                    if (strcmp (action, p) != 0)
-                        *r = c;
-                    else
-                    {
-                        *r = c;
+        ok = ext_regex_parse (re + start, end - start, atoms);
 
-                        for (p = r + 1; whitespace (*p); p++)
-                            ;
+        for (guint a = 0; ok && a < atoms->len; a++)
+        {
+            GPtrArray *set = static_cast < GPtrArray * >(g_ptr_array_index (atoms, a));
+            GPtrArray *next;
 
-                        /* Empty commands just stop searching
-                         * through, they don't do anything
-                         */
-                        if (p < q)
-                        {
-                            vfs_path_t *sv;
+            if (set == NULL || strings->len * set->len > EXT_REGEX_EXPAND_MAX)
+            {
+                ok = FALSE;
+                break;
+            }
 
-                            sv = exec_extension (target, filename_vpath, r + 1,
-                                                 view_at_line_number);
-                            if (script_vpath != NULL)
-                                *script_vpath = sv;
-                            else
-                                exec_cleanup_script (sv);
+            next = g_ptr_array_new_with_free_func (g_free);
+            for (guint s = 0; s < strings->len; s++)
+                for (guint t = 0; t < set->len; t++)
+                {
+                    const char *head = static_cast < const char *>(g_ptr_array_index (strings, s));
+                    const char *tail = static_cast < const char *>(g_ptr_array_index (set, t));
 
-                            ret = 1;
-                        }
-                        break;
-                    }
+                    g_ptr_array_add (next, g_strconcat (head, tail, (char *) NULL));
                 }
-            }
+            g_ptr_array_free (strings, TRUE);
+            strings = next;
         }
 
-        p = q;
-        if (*p == '\0')
+        if (ok && result->len + strings->len > EXT_REGEX_EXPAND_MAX)
+            ok = FALSE;
+
+        for (guint s = 0; ok && s < strings->len; s++)
+            g_ptr_array_add (result,
+                             g_strdup (static_cast < char *>(g_ptr_array_index (strings, s))));
+
+        g_ptr_array_free (strings, TRUE);
+        ext_regex_atoms_free (atoms);
+
+        if (!ok)
+        {
+            g_ptr_array_free (result, TRUE);
+            result = NULL;
             break;
+        }
+    }
+
+    g_array_free (bounds, TRUE);
+
+    return result;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+ext_key_is_foldable (const char *key, gboolean case_insense)
+{
+    if (case_insense)
+        for (; *key != '\0'; key++)
+            if ((unsigned char) *key >= 0x80)
+                return FALSE;
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Find out which file names a regex/ rule can match.
+ * Every branch of the pattern must be anchored at the end of the name. Reading it backwards,
+ * the branch must either reach a literal dot (store the text after the last dot to EXTS)
+ * or the start of the name (store the whole name to NAMES) through atoms matching
+ * a small known set of strings.
+ * Return FALSE if the rule has to be checked for every file name.
+ */
+
+static gboolean
+ext_regex_index_keys (const char *re, gboolean case_insense, GPtrArray * names, GPtrArray * exts)
+{
+    GArray *bounds;
+    gboolean ok;
+
+    bounds = ext_regex_split (re, strlen (re));
+    ok = bounds != NULL;
+
+    for (guint b = 0; ok && b < bounds->len; b += 2)
+    {
+        size_t start = g_array_index (bounds, size_t, b);
+        size_t end = g_array_index (bounds, size_t, b + 1);
+        size_t dollar;
+        gboolean anchored;
+        GPtrArray *atoms, *pending;
+
+        if (end == start || re[end - 1] != '$')
+        {
+            ok = FALSE;
+            break;
+        }
+
+        /* "\\$" is a literal dollar sign */
+        for (dollar = end - 1; dollar > start && re[dollar - 1] == '\\'; dollar--)
+            ;
+        if ((end - 1 - dollar) % 2 != 0)
+        {
+            ok = FALSE;
+            break;
+        }
+        end--;
+
+        anchored = start < end && re[start] == '^';
+        if (anchored)
+            start++;
+
+        atoms = g_ptr_array_new ();
+        ok = ext_regex_parse (re + start, end - start, atoms);
+
+        pending = g_ptr_array_new_with_free_func (g_free);
+        g_ptr_array_add (pending, g_strdup (""));
+
+        for (guint a = atoms->len; ok && a > 0 && pending->len != 0; a--)
+        {
+            GPtrArray *set = static_cast < GPtrArray * >(g_ptr_array_index (atoms, a - 1));
+            GPtrArray *next;
+
+            if (set == NULL || pending->len * set->len > EXT_REGEX_EXPAND_MAX)
+            {
+                ok = FALSE;
+                break;
+            }
+
+            next = g_ptr_array_new_with_free_func (g_free);
+            for (guint p = 0; p < pending->len; p++)
+                for (guint s = 0; s < set->len; s++)
+                {
+                    char *str, *dot;
+
+                    str = g_strconcat (static_cast < char *>(g_ptr_array_index (set, s)),
+                                       static_cast < char *>(g_ptr_array_index (pending, p)),
+                                       (char *) NULL);
+                    dot = strrchr (str, '.');
+                    if (dot == NULL)
+                        g_ptr_array_add (next, str);
+                    else
+                    {
+                        g_ptr_array_add (exts, g_strdup (dot + 1));
+                        g_free (str);
+                    }
+                }
+            g_ptr_array_free (pending, TRUE);
+            pending = next;
+        }
+
+        if (ok && pending->len != 0)
+        {
+            if (!anchored)
+                ok = FALSE;
+            else
+                for (guint p = 0; p < pending->len; p++)
+                    g_ptr_array_add (names, g_strdup (static_cast <
+                                                      char *>(g_ptr_array_index (pending, p))));
+        }
+
+        g_ptr_array_free (pending, TRUE);
+        ext_regex_atoms_free (atoms);
+    }
+
+    if (bounds != NULL)
+        g_array_free (bounds, TRUE);
+
+    for (guint k = 0; ok && k < names->len; k++)
+        ok = ext_key_is_foldable (static_cast < char *>(g_ptr_array_index (names, k)),
+                                  case_insense);
+    for (guint k = 0; ok && k < exts->len; k++)
+        ok = ext_key_is_foldable (static_cast < char *>(g_ptr_array_index (exts, k)), case_insense);
+
+    return ok;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+ext_rule_free (gpointer data)
+{
+    ext_rule_t *rule = static_cast < ext_rule_t * >(data);
+
+    for (guint i = 0; i < rule->actions->len; i++)
+    {
+        ext_action_t *a = &g_array_index (rule->actions, ext_action_t, i);
+
+        g_free (a->key);
+        g_free (a->command);
+    }
+    g_array_free (rule->actions, TRUE);
+    mc_search_free (rule->search);
+    g_free (rule->pattern);
+    g_free (rule);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Create a rule from the keyword/description line.
+ * Return NULL for unknown keywords: sections starting with them never match.
+ */
+
+static ext_rule_t *
+ext_rule_new (const char *line, size_t len)
+{
+    static const struct
+    {
+        const char *keyword;
+        ext_rule_kind_t kind;
+        gboolean has_case;
+    } keywords[] =
+    {
+        /* *INDENT-OFF* */
+        { "shell/", EXT_RULE_SHELL, TRUE },
+        { "regex/", EXT_RULE_REGEX, TRUE },
+        { "type/", EXT_RULE_TYPE, TRUE },
+        { "directory/", EXT_RULE_DIRECTORY, FALSE },
+        { "include/", EXT_RULE_INCLUDE, FALSE },
+        { "default/", EXT_RULE_DEFAULT, FALSE },
+        /* *INDENT-ON* */
+    };
+
+    ext_rule_t *rule;
+    size_t i, klen = 0;
+
+    for (i = 0; i < G_N_ELEMENTS (keywords); i++)
+    {
+        klen = strlen (keywords[i].keyword);
+        if (len >= klen && strncmp (line, keywords[i].keyword, klen) == 0)
+            break;
+    }
+
+    if (i == G_N_ELEMENTS (keywords))
+        return NULL;
+
+    rule = g_new0 (ext_rule_t, 1);
+    rule->kind = keywords[i].kind;
+    rule->actions = g_array_new (FALSE, FALSE, sizeof (ext_action_t));
+
+    line += klen;
+    len -= klen;
+    rule->case_insense = keywords[i].has_case && len >= 2 && strncmp (line, "i/", 2) == 0;
+    if (rule->case_insense)
+    {
+        line += 2;
+        len -= 2;
+    }
+
+    rule->pattern = g_strndup (line, len);
+    rule->pattern_len = len;
+
+    if (rule->kind == EXT_RULE_REGEX || rule->kind == EXT_RULE_TYPE
+        || rule->kind == EXT_RULE_DIRECTORY)
+    {
+        /* compiled on first run and reused after that */
+        rule->search = mc_search_new (rule->pattern, DEFAULT_CHARSET);
+        if (rule->search != NULL)
+        {
+            rule->search->search_type = MC_SEARCH_T_REGEX;
+            rule->search->is_case_sensitive = !rule->case_insense;
+        }
+    }
+
+    return rule;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+ext_index_list_free (gpointer data)
+{
+    g_array_free (static_cast < GArray * >(data), TRUE);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+ext_index_add (GHashTable * index, const char *key, guint num)
+{
+    char *lkey;
+    GArray *list;
+
+    lkey = g_ascii_strdown (key, -1);
+    list = static_cast < GArray * >(g_hash_table_lookup (index, lkey));
+    if (list == NULL)
+    {
+        list = g_array_new (FALSE, FALSE, sizeof (guint));
+        g_hash_table_insert (index, lkey, list);
+    }
+    else
+        g_free (lkey);
+
+    /* rules are added in file order, so only the last one can be a duplicate */
+    if (list->len == 0 || g_array_index (list, guint, list->len - 1) != num)
+        g_array_append_val (list, num);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+ext_table_add_rule (ext_table_t * table, ext_rule_t * rule)
+{
+    guint num = table->rules->len;
+
+    g_ptr_array_add (table->rules, rule);
+
+    switch (rule->kind)
+    {
+    case EXT_RULE_INCLUDE:
+        g_array_append_val (table->includes, num);
+        break;
+
+    case EXT_RULE_SHELL:
+        if (!ext_key_is_foldable (rule->pattern, rule->case_insense))
+            g_array_append_val (table->unindexed, num);
+        else if (rule->pattern[0] == '.')
+            ext_index_add (table->by_ext, strrchr (rule->pattern, '.') + 1, num);
+        else
+            ext_index_add (table->by_name, rule->pattern, num);
+        break;
+
+    case EXT_RULE_REGEX:
+        {
+            GPtrArray *names, *exts;
+
+            names = g_ptr_array_new_with_free_func (g_free);
+            exts = g_ptr_array_new_with_free_func (g_free);
+
+            /* a rule with a broken regex never matches and doesn't need indexing */
+            if (rule->search == NULL)
+                ;
+            else if (!ext_regex_index_keys (rule->pattern, rule->case_insense, names, exts))
+                g_array_append_val (table->unindexed, num);
+            else
+            {
+                for (guint i = 0; i < names->len; i++)
+                    ext_index_add (table->by_name,
+                                   static_cast < char *>(g_ptr_array_index (names, i)), num);
+                for (guint i = 0; i < exts->len; i++)
+                    ext_index_add (table->by_ext,
+                                   static_cast < char *>(g_ptr_array_index (exts, i)), num);
+            }
+
+            g_ptr_array_free (names, TRUE);
+            g_ptr_array_free (exts, TRUE);
+        }
+        break;
+
+    default:
+        g_array_append_val (table->unindexed, num);
+        break;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+ext_table_free (ext_table_t * table)
+{
+    if (table == NULL)
+        return;
+
+    g_free (table->path);
+    g_free (table->user_path);
+    g_ptr_array_free (table->rules, TRUE);
+    g_hash_table_destroy (table->by_name);
+    g_hash_table_destroy (table->by_ext);
+    g_array_free (table->unindexed, TRUE);
+    g_array_free (table->includes, TRUE);
+    g_free (table);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Parse the contents of mc.ext.
+ * A line starting in the first column is keyword/description, an indented line is an action
+ * of the section above, '#' in the first column starts a comment.
+ */
+
+static ext_table_t *
+ext_table_compile (const char *text)
+{
+    ext_table_t *table;
+    ext_rule_t *rule = NULL;
+    const char *p, *eol;
+
+    table = g_new0 (ext_table_t, 1);
+    table->rules = g_ptr_array_new_with_free_func (ext_rule_free);
+    table->by_name = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, ext_index_list_free);
+    table->by_ext = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, ext_index_list_free);
+    table->unindexed = g_array_new (FALSE, FALSE, sizeof (guint));
+    table->includes = g_array_new (FALSE, FALSE, sizeof (guint));
+
+    for (p = text; *p != '\0'; p = *eol == '\0' ? eol : eol + 1)
+    {
+        const char *q;
+
+        eol = strchr (p, '\n');
+        if (eol == NULL)
+            eol = strchr (p, '\0');
+
+        for (q = p; q < eol && whitespace (*q); q++)
+            ;
+
+        if (q == eol || *p == '#')
+            continue;           /* empty line or comment */
+
+        if (q == p)
+        {
+            rule = ext_rule_new (p, (size_t) (eol - p));
+            if (rule != NULL)
+                ext_table_add_rule (table, rule);
+        }
+        else if (rule != NULL)
+        {
+            const char *r;
+
+            r = static_cast < const char *>(memchr (q, '=', (size_t) (eol - q)));
+            if (r != NULL)
+            {
+                ext_action_t a;
+
+                a.key = g_strndup (q, (size_t) (r - q));
+                a.command = g_strndup (r + 1, (size_t) (eol - r - 1));
+                g_array_append_val (rule->actions, a);
+            }
+        }
+    }
+
+    return table;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+ext_file_stamp (const char *path, ext_file_stamp_t * stamp)
+{
+    struct stat st;
+
+    memset (stamp, 0, sizeof (*stamp));
+    if (stat (path, &st) == 0)
+    {
+        stamp->exists = TRUE;
+        stamp->mtime = st.st_mtime;
+        stamp->size = st.st_size;
+        stamp->inode = st.st_ino;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+ext_file_stamp_changed (const char *path, const ext_file_stamp_t * stamp)
+{
+    ext_file_stamp_t now;
+
+    ext_file_stamp (path, &now);
+
+    return (now.exists != stamp->exists || now.mtime != stamp->mtime || now.size != stamp->size
+            || now.inode != stamp->inode);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Check whether the file the table was compiled from has been modified or the user
+ * has created, changed or removed their own mc.ext since then.
+ */
+
+static gboolean
+ext_table_is_stale (const ext_table_t * table)
+{
+    if (ext_file_stamp_changed (table->user_path, &table->user_stamp))
+        return TRUE;
+
+    return (strcmp (table->path, table->user_path) != 0
+            && ext_file_stamp_changed (table->path, &table->stamp));
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Read and compile the user's mc.ext or, if there is no valid one, the stock file.
+ * Return NULL if no usable file is found.
+ */
+
+static ext_table_t *
+ext_table_load (void)
+{
+    char *extension_file;
+    char *text = NULL;
+    ext_file_stamp_t stamp, user_stamp;
+    gboolean mc_user_ext = TRUE;
+    gboolean home_error = FALSE;
+    ext_table_t *table;
+
+    extension_file = mc_config_get_full_path (MC_FILEBIND_FILE);
+    ext_file_stamp (extension_file, &user_stamp);
+    if (!exist_file (extension_file))
+    {
+        g_free (extension_file);
+      check_stock_mc_ext:
+        extension_file = mc_build_filename (mc_global.sysconfig_dir.c_str(), MC_LIB_EXT, (char *) NULL);
+        if (!exist_file (extension_file))
+        {
+            g_free (extension_file);
+            extension_file =
+                mc_build_filename (mc_global.share_data_dir.c_str(), MC_LIB_EXT, (char *) NULL);
+        }
+        mc_user_ext = FALSE;
+    }
+
+    /* take the stamp first: a change while we are reading causes one more reload */
+    ext_file_stamp (extension_file, &stamp);
+    g_file_get_contents (extension_file, &text, NULL, NULL);
+    if (text == NULL)
+    {
+        g_free (extension_file);
+        return NULL;
+    }
+
+    if (strstr (text, "default/") == NULL)
+    {
+        if (strstr (text, "regex/") == NULL && strstr (text, "shell/") == NULL &&
+            strstr (text, "type/") == NULL)
+        {
+            MC_PTR_FREE (text);
+            g_free (extension_file);
+
+            if (!mc_user_ext)
+            {
+                char *title;
+
+                title = g_strdup_printf (_(" %s%s file error"),
+                                         mc_global.sysconfig_dir.c_str(), MC_LIB_EXT);
+                message (D_ERROR, title, _("The format of the %smc.ext "
+                                           "file has changed with version 3.0. It seems that "
+                                           "the installation failed. Please fetch a fresh "
+                                           "copy from the Midnight Commander package."),
+                         mc_global.sysconfig_dir.c_str());
+                g_free (title);
+                return NULL;
+            }
+
+            home_error = TRUE;
+            goto check_stock_mc_ext;
+        }
+    }
+
+    if (home_error)
+    {
+        char *filebind_filename;
+        char *title;
+
+        filebind_filename = mc_config_get_full_path (MC_FILEBIND_FILE);
+        title = g_strdup_printf (_("%s file error"), filebind_filename);
+        message (D_ERROR, title,
+                 _("The format of the %s file has "
+                   "changed with version 3.0. You may either want to copy "
+                   "it from %smc.ext or use that file as an example of how to write it."),
+                 filebind_filename, mc_global.sysconfig_dir.c_str());
+        g_free (filebind_filename);
+        g_free (title);
+    }
+
+    table = ext_table_compile (text);
+    g_free (text);
+
+    table->path = extension_file;
+    table->stamp = stamp;
+    table->user_path = mc_config_get_full_path (MC_FILEBIND_FILE);
+    table->user_stamp = user_stamp;
+
+    return table;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Look for ACTION in the actions of a matched rule.
+ * Return the action, or NULL and set INCLUDE to the target of an Include action met first.
+ */
+
+static const ext_action_t *
+ext_rule_get_action (const ext_rule_t * rule, const char *action, const char **include)
+{
+    *include = NULL;
+
+    for (guint i = 0; i < rule->actions->len; i++)
+    {
+        const ext_action_t *a = &g_array_index (rule->actions, ext_action_t, i);
+
+        if (strcmp (a->key, "Include") == 0)
+        {
+            *include = a->command;
+            return NULL;
+        }
+
+        if (strcmp (a->key, action) == 0)
+            return a;
+    }
+
+    return NULL;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+ext_rule_has_action (const ext_rule_t * rule, const char *action)
+{
+    const char *include;
+
+    return (ext_rule_get_action (rule, action, &include) != NULL || include != NULL);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Find the action for FILENAME_VPATH: the first section in file order which matches the file
+ * and has ACTION or an Include action.
+ * Only the rules indexed by the file name, by its extension and the unindexed ones are checked.
+ * Contents of the file is examined only if a type/ rule is reached.
+ *
+ * Return the action found, NULL if there is none. ERROR is set if the file type can't be
+ * determined.
+ */
+
+static const ext_action_t *
+ext_table_lookup (const ext_table_t * table, const vfs_path_t * filename_vpath,
+                  const char *action, gboolean * error)
+{
+    const char *filename;
+    size_t file_len;
+    char *key, *ext;
+    GArray *lists[3];
+    guint pos[3] = { 0, 0, 0 };
+    guint next_rule = 0;
+    const char *include = NULL;
+    const ext_action_t *found = NULL;
+    gboolean have_type = FALSE; /* Flag used by regex_check_type() */
+    gboolean have_stat = FALSE;
+    struct stat mystat;
+
+    *error = FALSE;
+
+    filename = vfs_path_get_last_path_str (filename_vpath);
+    filename = x_basename (filename);
+    file_len = strlen (filename);
+
+    /* '$' matches before a newline at the end of the name as well */
+    key = g_ascii_strdown (filename, file_len != 0 && filename[file_len - 1] == '\n'
+                           ? (gssize) file_len - 1 : (gssize) file_len);
+    ext = strrchr (key, '.');
+
+    lists[0] = static_cast < GArray * >(g_hash_table_lookup (table->by_name, key));
+    lists[1] = ext == NULL ? NULL
+        : static_cast < GArray * >(g_hash_table_lookup (table->by_ext, ext + 1));
+    lists[2] = table->unindexed;
+
+    g_free (key);
+
+    while (TRUE)
+    {
+        const ext_rule_t *rule;
+        guint num = G_MAXUINT;
+        gboolean match = FALSE;
+
+        /* merge candidate lists keeping the file order */
+        for (int i = 0; i < 3; i++)
+            if (lists[i] != NULL)
+            {
+                while (pos[i] < lists[i]->len
+                       && g_array_index (lists[i], guint, pos[i]) < next_rule)
+                    pos[i]++;
+                if (pos[i] < lists[i]->len)
+                    num = MIN (num, g_array_index (lists[i], guint, pos[i]));
+            }
+
+        if (num == G_MAXUINT)
+            break;
+
+        next_rule = num + 1;
+        rule = static_cast < const ext_rule_t * >(g_ptr_array_index (table->rules, num));
+
+        /* A section without our action can't stop the search, skip its test.
+         * type/ rules are tested anyway: they set the codepage and report unreadable files. */
+        if (rule->kind != EXT_RULE_TYPE && !ext_rule_has_action (rule, action))
+            continue;
+
+        switch (rule->kind)
+        {
+        case EXT_RULE_SHELL:
+            {
+                int (*cmp_func) (const char *s1, const char *s2, size_t n) =
+                    rule->case_insense ? strncasecmp : strncmp;
+
+                if (rule->pattern[0] == '.')
+                    match = file_len >= rule->pattern_len
+                        && cmp_func (rule->pattern, filename + file_len - rule->pattern_len,
+                                     rule->pattern_len) == 0;
+                else
+                    match = rule->pattern_len == file_len
+                        && cmp_func (rule->pattern, filename, file_len) == 0;
+            }
+            break;
+
+        case EXT_RULE_REGEX:
+            match = mc_search_run (rule->search, filename, 0, file_len, NULL);
+            break;
+
+        case EXT_RULE_TYPE:
+            {
+                GError *mcerror = NULL;
+
+                match = regex_check_type (filename_vpath, rule->search, &have_type, &mcerror);
+                if (mc_error_message (&mcerror, NULL))
+                {
+                    /* leave it if file cannot be opened */
+                    *error = TRUE;
+                    return NULL;
+                }
+            }
+            break;
+
+        case EXT_RULE_DIRECTORY:
+            if (!have_stat)
+            {
+                have_stat = TRUE;
+                if (mc_stat (filename_vpath, &mystat) != 0)
+                    mystat.st_mode = 0;
+            }
+            match = S_ISDIR (mystat.st_mode)
+                && mc_search_run (rule->search, vfs_path_as_str (filename_vpath), 0,
+                                  strlen (vfs_path_as_str (filename_vpath)), NULL);
+            break;
+
+        case EXT_RULE_DEFAULT:
+            match = TRUE;
+            break;
+
+        default:
+            break;
+        }
+
+        if (match)
+        {
+            found = ext_rule_get_action (rule, action, &include);
+            if (found != NULL || include != NULL)
+                break;
+        }
+    }
+
+    /* after Include only the include/ sections below are looked at */
+    for (guint i = 0; found == NULL && include != NULL && i < table->includes->len; i++)
+    {
+        guint num = g_array_index (table->includes, guint, i);
+        const ext_rule_t *rule;
+        const char *target;
+
+        if (num < next_rule)
+            continue;
+
+        rule = static_cast < const ext_rule_t * >(g_ptr_array_index (table->rules, num));
+        if (strncmp (rule->pattern, include, strlen (include)) == 0)
+        {
+            found = ext_rule_get_action (rule, action, &target);
+            if (target != NULL)
+                include = target;
+        }
+    }
+
+    return found;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+void
+flush_extension_file (void)
+{
+    ext_table_free (ext_table);
+    ext_table = NULL;
+    file_type_flush ();
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * The second argument is action, i.e. Open, View or Edit
+ * Use target object to open file in.
+ *
+ * This function returns:
+ *
+ * -1 for a failure or user interrupt
+ * 0 if no command was run
+ * 1 if some command was run
+ *
+ * If action == "View" then a parameter is checked in the form of "View:%d",
+ * if the value for %d exists, then the viewer is started up at that line number.
+ */
+
+int
+regex_command_for (void *target, const vfs_path_t * filename_vpath, const char *action,
+                   vfs_path_t ** script_vpath)
+{
+    const ext_action_t *found;
+    const char *p;
+    gboolean error_flag = FALSE;
+    int view_at_line_number = 0;
+
+    if (filename_vpath == NULL)
+        return 0;
+
+    if (script_vpath != NULL)
+        *script_vpath = NULL;
+
+    /* Check for the special View:%d parameter */
+    if (strncmp (action, "View:", 5) == 0)
+    {
+        view_at_line_number = atoi (action + 5);
+        action = "View";
+    }
+
+    if (ext_table != NULL && ext_table_is_stale (ext_table))
+    {
+        ext_table_free (ext_table);
+        ext_table = NULL;
+    }
+
+    if (ext_table == NULL)
+    {
+        ext_table = ext_table_load ();
+        if (ext_table == NULL)
+            return 0;
+    }
+
+    found = ext_table_lookup (ext_table, filename_vpath, action, &error_flag);
+    if (error_flag)
+        return -1;
+    if (found == NULL)
+        return 0;
+
+    for (p = found->command; whitespace (*p); p++)
+        ;
+
+    /* Empty commands just stop searching
+     * through, they don't do anything
+     */
+    if (*p != '\0')
+    {
+        vfs_path_t *sv;
+
+        sv = exec_extension (target, filename_vpath, found->command, view_at_line_number);
+        if (script_vpath != NULL)
+            *script_vpath = sv;
+        else
+            exec_cleanup_script (sv);
+
+        return 1;
     }
 
-    return (error_flag ? -1 : ret);
+    return 0;
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -57,6 +57,8 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#include <fcntl.h>              /* openat() */
+#include <dirent.h>             /* fdopendir() */
 
 #include "lib/global.hpp"
 #include "lib/tty/tty.hpp"
@@ -81,6 +83,7 @@
 #include "midnight.hpp"           /* current_panel */
 #include "layout.hpp"            /* rotate_dash() */
 #include "ioblksize.hpp"          /* io_blksize() */
+#include "fileopjournal.hpp"
 
 #include "file.hpp"
 
@@ -100,6 +103,14 @@ const char *op_names[3] = {
 #define FILEOP_UPDATE_INTERVAL 2
 #define FILEOP_STALLING_INTERVAL 4
 
+/* the progress dialog is redrawn not more often than this (microseconds) */
+#define FILEOP_FRAME_INTERVAL (G_USEC_PER_SEC / 20)
+/* distance between samples of the transfer rate window (microseconds) */
+#define FILEOP_RATE_STEP (G_USEC_PER_SEC / 2)
+
+/* max number of stat results kept from the directory scanning */
+#define FILEOP_SCAN_CACHE_MAX 131072
+
 /*** file scope type declarations ****************************************************************/
 
 /* This is a hard link cache */
@@ -108,7 +119,7 @@ struct link
     const struct vfs_class *vfs;
     dev_t dev;
     ino_t ino;
-    short linkcount;
+    nlink_t linkcount;          /* links not seen yet */
     mode_t st_mode;
     vfs_path_t *src_vpath;
     vfs_path_t *dst_vpath;
@@ -122,6 +133,13 @@ typedef enum
     DEST_FULL = 2               /* Created, fully copied */
 } dest_status_t;
 
+/* Files and bytes found below a directory by the directory scanning */
+typedef struct
+{
+    size_t count;
+    uintmax_t bytes;
+} scan_dir_total_t;
+
 /* Status of hard link creation */
 typedef enum
 {
@@ -174,23 +192,38 @@ static const char *prompt_parts[] = {
 
 /*** file scope variables ************************************************************************/
 
-/* the hard link cache */
-static GSList *linklist = NULL;
+/* the hard link cache: struct link keyed on (vfs, dev, ino) */
+static GHashTable *linklist = NULL;
 
-/* the files-to-be-erased list */
-static GSList *erase_list = NULL;
+/* the files-to-be-erased queue */
+static GQueue erase_list = G_QUEUE_INIT;
 
 /*
- * In copy_dir_dir we use two additional single linked lists: The first -
+ * In copy_dir_dir we use two additional link sets: The first -
  * variable name 'parent_dirs' - holds information about already copied
- * directories and is used to detect cyclic symbolic links.
+ * directories and is used to detect cyclic symbolic links. It is as short
+ * as the directory nesting, so it is a plain list.
  * The second ('dest_dirs' below) holds information about just created
  * target directories and is used to detect when an directory is copied
- * into itself (we don't want to copy infinitly).
- * Both lists don't use the linkcount and name structure members of struct
+ * into itself (we don't want to copy infinitly). It grows with the number
+ * of copied directories, so it is hashed like the hard link cache.
+ * Both don't use the linkcount and name structure members of struct
  * link.
  */
-static GSList *dest_dirs = NULL;
+static GHashTable *dest_dirs = NULL;
+
+/*
+ * lstat() results gathered by the "Directory scanning" before a copy or move:
+ * path -> struct stat. copy_dir_dir() and copy_file_file() take them from here
+ * instead of asking the (maybe remote) file system again for every entry.
+ */
+static GHashTable *scan_stat_cache = NULL;
+
+/*
+ * Totals of every directory walked by the same scanning: path -> scan_dir_total_t.
+ * A directory which is moved by a rename advances the progress by them at once.
+ */
+static GHashTable *scan_dir_totals = NULL;
 
 /* --------------------------------------------------------------------------------------------- */
 /*** file scope functions ************************************************************************/
@@ -303,16 +336,157 @@ free_link (void *data)
 
 /* --------------------------------------------------------------------------------------------- */
 
-static inline void *
-free_linklist (GSList * lp)
+static guint
+link_hash (gconstpointer key)
+{
+    const struct link *lnk = (const struct link *) key;
+    guint64 ino = (guint64) lnk->ino;
+
+    return (guint) (ino ^ (ino >> 32)) ^ ((guint) lnk->dev * 16777619U) ^ g_direct_hash (lnk->vfs);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+link_equal (gconstpointer a, gconstpointer b)
 {
-    g_slist_free_full (lp, free_link);
+    const struct link *la = (const struct link *) a;
+    const struct link *lb = (const struct link *) b;
+
+    return (la->vfs == lb->vfs && la->ino == lb->ino && la->dev == lb->dev);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Add @lnk to the link set @table, which is created if needed. The set owns @lnk then. */
+
+static GHashTable *
+add_to_linktable (GHashTable * table, struct link *lnk)
+{
+    if (table == NULL)
+        table = g_hash_table_new_full (link_hash, link_equal, free_link, NULL);
+
+    g_hash_table_add (table, lnk);
+
+    return table;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static inline GHashTable *
+free_linktable (GHashTable * table)
+{
+    if (table != NULL)
+        g_hash_table_destroy (table);
 
     return NULL;
 }
 
 /* --------------------------------------------------------------------------------------------- */
 
+static void
+free_erase_list (void)
+{
+    struct link *lp;
+
+    while ((lp = (struct link *) g_queue_pop_head (&erase_list)) != NULL)
+        free_link (lp);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+scan_stat_cache_add (const vfs_path_t * vpath, const struct stat *sb)
+{
+    if (scan_stat_cache != NULL && g_hash_table_size (scan_stat_cache) < FILEOP_SCAN_CACHE_MAX)
+        g_hash_table_insert (scan_stat_cache, g_strdup (vfs_path_as_str (vpath)),
+                             g_memdup (sb, sizeof (*sb)));
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+scan_dir_totals_add (const vfs_path_t * vpath, size_t count, uintmax_t bytes)
+{
+    if (scan_dir_totals != NULL && g_hash_table_size (scan_dir_totals) < FILEOP_SCAN_CACHE_MAX)
+    {
+        scan_dir_total_t *t;
+
+        t = g_new (scan_dir_total_t, 1);
+        t->count = count;
+        t->bytes = bytes;
+        g_hash_table_insert (scan_dir_totals, g_strdup (vfs_path_as_str (vpath)), t);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Forget all that the directory scanning has gathered */
+
+static void
+scan_stat_cache_free (void)
+{
+    if (scan_stat_cache != NULL)
+    {
+        g_hash_table_destroy (scan_stat_cache);
+        scan_stat_cache = NULL;
+    }
+
+    if (scan_dir_totals != NULL)
+    {
+        g_hash_table_destroy (scan_dir_totals);
+        scan_dir_totals = NULL;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Stat the source entry of a copy. The result of the directory scanning is used if there is one.
+ *
+ * @param keep if FALSE, the cached result is dropped: the caller is its last user, and a retry
+ *             after an error must see the real file system.
+ */
+
+static int
+file_op_stat (const file_op_context_t * ctx, const vfs_path_t * vpath, struct stat *buf,
+              gboolean keep)
+{
+    if (scan_stat_cache != NULL && ctx->stat_func == mc_lstat)
+    {
+        const char *path;
+        struct stat *sb;
+
+        path = vfs_path_as_str (vpath);
+        sb = (struct stat *) g_hash_table_lookup (scan_stat_cache, path);
+        if (sb != NULL)
+        {
+            *buf = *sb;
+            if (!keep)
+                g_hash_table_remove (scan_stat_cache, path);
+            return 0;
+        }
+    }
+
+    return (*ctx->stat_func) (vpath, buf);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static const struct link *
+is_in_linktable (GHashTable * table, const vfs_path_t * vpath, const struct stat *sb)
+{
+    struct link key;
+
+    if (table == NULL)
+        return NULL;
+
+    key.vfs = vfs_path_get_last_path_vfs (vpath);
+    key.ino = sb->st_ino;
+    key.dev = sb->st_dev;
+
+    return (const struct link *) g_hash_table_lookup (table, &key);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
 static const struct link *
 is_in_linklist (const GSList * lp, const vfs_path_t * vpath, const struct stat *sb)
 {
@@ -354,7 +528,7 @@ check_hardlinks (const vfs_path_t * src_vpath, const struct stat *src_stat,
     if ((vfs_file_class_flags (src_vpath) & VFSF_NOLINKS) != 0)
         return HARDLINK_UNSUPPORTED;
 
-    lnk = (struct link *) is_in_linklist (linklist, src_vpath, src_stat);
+    lnk = (struct link *) is_in_linktable (linklist, src_vpath, src_stat);
     if (lnk != NULL)
     {
         int stat_result;
@@ -417,8 +591,14 @@ check_hardlinks (const vfs_path_t * src_vpath, const struct stat *src_stat,
                         break;
                     }
 
-                    /* Success? */
-                    return (ok ? HARDLINK_OK : HARDLINK_ERROR);
+                    if (!ok)
+                        return HARDLINK_ERROR;
+
+                    /* all links of the inode are made: forget it */
+                    if (--lnk->linkcount == 0)
+                        g_hash_table_remove (linklist, lnk);
+
+                    return HARDLINK_OK;
                 }
             }
         }
@@ -461,12 +641,12 @@ check_hardlinks (const vfs_path_t * src_vpath, const struct stat *src_stat,
         lnk->vfs = vfs_path_get_last_path_vfs (src_vpath);
         lnk->ino = ino;
         lnk->dev = dev;
-        lnk->linkcount = 0;
+        lnk->linkcount = src_stat->st_nlink - 1;
         lnk->st_mode = 0;
         lnk->src_vpath = vfs_path_clone (src_vpath);
         lnk->dst_vpath = vfs_path_clone (dst_vpath);
 
-        linklist = g_slist_prepend (linklist, lnk);
+        linklist = add_to_linktable (linklist, lnk);
     }
 
     return HARDLINK_CACHED;
@@ -624,6 +804,8 @@ do_compute_dir_size (const vfs_path_t * dirname_vpath, dirsize_status_msg_t * ds
     DIR *dir;
     struct dirent *dirent;
     FileProgressStatus ret = FILE_CONT;
+    size_t marked_before;
+    uintmax_t total_before;
 
     if (!compute_symlinks)
     {
@@ -631,6 +813,8 @@ do_compute_dir_size (const vfs_path_t * dirname_vpath, dirsize_status_msg_t * ds
         if (res != 0)
             return ret;
 
+        scan_stat_cache_add (dirname_vpath, &s);
+
         /* don't scan symlink to directory */
         if (S_ISLNK (s.st_mode))
         {
@@ -646,6 +830,9 @@ do_compute_dir_size (const vfs_path_t * dirname_vpath, dirsize_status_msg_t * ds
     if (dir == NULL)
         return ret;
 
+    marked_before = *ret_marked;
+    total_before = *ret_total;
+
     while (ret == FILE_CONT && (dirent = mc_readdir (dir)) != NULL)
     {
         vfs_path_t *tmp_vpath;
@@ -658,6 +845,9 @@ do_compute_dir_size (const vfs_path_t * dirname_vpath, dirsize_status_msg_t * ds
         res = mc_lstat (tmp_vpath, &s);
         if (res == 0)
         {
+            if (!compute_symlinks)
+                scan_stat_cache_add (tmp_vpath, &s);
+
             if (S_ISDIR (s.st_mode))
                 ret =
                     do_compute_dir_size (tmp_vpath, dsm, dir_count, ret_marked, ret_total,
@@ -683,6 +873,11 @@ do_compute_dir_size (const vfs_path_t * dirname_vpath, dirsize_status_msg_t * ds
     }
 
     mc_closedir (dir);
+
+    if (ret == FILE_CONT)
+        scan_dir_totals_add (dirname_vpath, *ret_marked - marked_before,
+                             *ret_total - total_before);
+
     return ret;
 }
 
@@ -761,6 +956,14 @@ panel_operate_init_totals (const WPanel * panel, const vfs_path_t * source,
         ctx->progress_count = 0;
         ctx->progress_bytes = 0;
 
+        /* the copy itself will walk the same tree: remember what we've seen */
+        scan_stat_cache_free ();
+        if (ctx->operation != OP_DELETE && !ctx->follow_links)
+        {
+            scan_stat_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+            scan_dir_totals = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+        }
+
         if (source == NULL)
             status = panel_compute_totals (panel, &dsm, &ctx->progress_count, &ctx->progress_bytes,
                                            ctx->follow_links);
@@ -803,28 +1006,35 @@ panel_operate_init_totals (const WPanel * panel, const vfs_path_t * source,
 
 /* --------------------------------------------------------------------------------------------- */
 
+/**
+ * Tell whether the progress dialog should be redrawn and polled for buttons now.
+ * Copying only updates the counters in between, so the terminal output does not
+ * depend on the number of files and buffers.
+ */
+
+static inline gboolean
+progress_frame_due (file_op_total_context_t * tctx)
+{
+    return mc_time_elapsed (&tctx->frame_last, FILEOP_FRAME_INTERVAL);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
 static FileProgressStatus
-progress_update_one (file_op_total_context_t * tctx, file_op_context_t * ctx, off_t add)
+progress_update (file_op_total_context_t * tctx, file_op_context_t * ctx, size_t count,
+                 uintmax_t add)
 {
-    struct timeval tv_current;
-    static struct timeval tv_start = { 0, 0 };
+    tctx->progress_count += count;
+    tctx->progress_bytes += add;
 
-    tctx->progress_count++;
-    tctx->progress_bytes += (uintmax_t) add;
+    if (!progress_frame_due (tctx))
+        return FILE_CONT;
 
-    if (tv_start.tv_sec == 0)
+    if (verbose && ctx->dialog_type == FILEGUI_DIALOG_MULTI_ITEM)
     {
-        gettimeofday (&tv_start, (struct timezone *) NULL);
-    }
-    gettimeofday (&tv_current, (struct timezone *) NULL);
-    if ((tv_current.tv_sec - tv_start.tv_sec) > FILEOP_UPDATE_INTERVAL)
-    {
-        if (verbose && ctx->dialog_type == FILEGUI_DIALOG_MULTI_ITEM)
-        {
-            file_progress_show_count (ctx, tctx->progress_count, ctx->progress_count);
-            file_progress_show_total (tctx, ctx, tctx->progress_bytes, TRUE);
-        }
-        tv_start.tv_sec = tv_current.tv_sec;
+        file_progress_show_count (ctx, tctx->progress_count, ctx->progress_count);
+        file_progress_show_total (tctx, ctx, tctx->progress_bytes, TRUE);
+        mc_refresh ();
     }
 
     return check_progress_buttons (ctx);
@@ -832,6 +1042,14 @@ progress_update_one (file_op_total_context_t * tctx, file_op_context_t * ctx, of
 
 /* --------------------------------------------------------------------------------------------- */
 
+static inline FileProgressStatus
+progress_update_one (file_op_total_context_t * tctx, file_op_context_t * ctx, off_t add)
+{
+    return progress_update (tctx, ctx, 1, (uintmax_t) add);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
 static FileProgressStatus
 real_warn_same_file (enum OperationMode mode, const char *fmt, const char *a, const char *b)
 {
@@ -1108,55 +1326,41 @@ files_error (const char *format, const char *file1, const char *file2)
 
 /* --------------------------------------------------------------------------------------------- */
 
+/**
+ * Compute ETA and BPS of the current file and of the whole operation.
+ * The rates are taken over the last few seconds (see FILEOP_RATE_STEP), so they follow
+ * changes of the transfer speed instead of averaging the whole run.
+ */
+
 static void
 copy_file_file_display_progress (file_op_total_context_t * tctx, file_op_context_t * ctx,
-                                 struct timeval tv_current, struct timeval tv_transfer_start,
+                                 uint64_t now, uint64_t transfer_start,
                                  off_t file_size, off_t n_read_total)
 {
-    long dt;
-
     /* 1. Update rotating dash after some time */
     rotate_dash (TRUE);
 
-    /* 3. Compute ETA */
-    dt = (tv_current.tv_sec - tv_transfer_start.tv_sec);
+    /* 2. Compute BPS rate and ETA */
+    mc_rate_window_add (&ctx->rate_window, now, (uintmax_t) n_read_total, FILEOP_RATE_STEP);
+    ctx->bps = (long) mc_rate_window_rate (&ctx->rate_window, now, (uintmax_t) n_read_total);
+    ctx->bps_time = (long) ((now - transfer_start) / G_USEC_PER_SEC);
+    if (ctx->bps_time < 1)
+        ctx->bps_time = 1;
 
-    if (n_read_total == 0)
+    if (n_read_total == 0 || ctx->bps == 0)
         ctx->eta_secs = 0.0;
     else
-    {
-        ctx->eta_secs = ((dt / (double) n_read_total) * file_size) - dt;
-        ctx->bps = n_read_total / ((dt < 1) ? 1 : dt);
-    }
-
-    /* 4. Compute BPS rate */
-    ctx->bps_time = (tv_current.tv_sec - tv_transfer_start.tv_sec);
-    if (ctx->bps_time < 1)
-        ctx->bps_time = 1;
-    ctx->bps = n_read_total / ctx->bps_time;
+        ctx->eta_secs = (double) (file_size - n_read_total) / ctx->bps;
 
-    /* 5. Compute total ETA and BPS */
+    /* 3. Compute total ETA and BPS */
     if (ctx->progress_bytes != 0)
     {
         uintmax_t remain_bytes;
 
         remain_bytes = ctx->progress_bytes - tctx->copied_bytes;
-#if 1
-        {
-            int total_secs = tv_current.tv_sec - tctx->transfer_start.tv_sec;
-
-            if (total_secs < 1)
-                total_secs = 1;
-
-            tctx->bps = tctx->copied_bytes / total_secs;
-            tctx->eta_secs = (tctx->bps != 0) ? remain_bytes / tctx->bps : 0;
-        }
-#else
-        /* broken on lot of little files */
-        tctx->bps_count++;
-        tctx->bps = (tctx->bps * (tctx->bps_count - 1) + ctx->bps) / tctx->bps_count;
+        mc_rate_window_add (&tctx->rate_window, now, tctx->copied_bytes, FILEOP_RATE_STEP);
+        tctx->bps = mc_rate_window_rate (&tctx->rate_window, now, tctx->copied_bytes);
         tctx->eta_secs = (tctx->bps != 0) ? remain_bytes / tctx->bps : 0;
-#endif
     }
 }
 
@@ -1356,7 +1560,6 @@ move_file_file (const WPanel * panel, file_op_total_context_t * tctx, file_op_co
 static FileProgressStatus
 erase_file (file_op_total_context_t * tctx, file_op_context_t * ctx, const vfs_path_t * vpath)
 {
-    struct stat buf;
     FileProgressStatus return_status;
 
     /* check buttons if deleting info was changed */
@@ -1369,16 +1572,10 @@ erase_file (file_op_total_context_t * tctx, file_op_context_t * ctx, const vfs_p
         mc_refresh ();
     }
 
-    if (tctx->progress_count != 0 && mc_lstat (vpath, &buf) != 0)
-    {
-        /* ignore, most likely the mc_unlink fails, too */
-        buf.st_size = 0;
-    }
-
     if (!try_remove_file (ctx, vpath, &return_status) && return_status == FILE_ABORT)
         return FILE_ABORT;
 
-    if (tctx->progress_count == 0)
+    if (tctx->progress_count == 0 || !progress_frame_due (tctx))
         return FILE_CONT;
 
     return check_progress_buttons (ctx);
@@ -1405,6 +1602,138 @@ try_erase_dir (file_op_context_t * ctx, const char *dir)
 
 /* --------------------------------------------------------------------------------------------- */
 
+/**
+ * Show progress of the local erase engine. Nothing but counters is touched between frames.
+ */
+
+static FileProgressStatus
+erase_local_progress (file_op_total_context_t * tctx, file_op_context_t * ctx, const char *path,
+                      gboolean is_file)
+{
+    gboolean shown;
+
+    shown = file_progress_show_deleting (ctx, path, is_file ? &tctx->progress_count : NULL);
+    if (!shown && !progress_frame_due (tctx))
+        return FILE_CONT;
+
+    file_progress_show_count (ctx, tctx->progress_count, ctx->progress_count);
+    if (check_progress_buttons (ctx) == FILE_ABORT)
+        return FILE_ABORT;
+
+    mc_refresh ();
+    return FILE_CONT;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Remove the directory @name relative to the directory descriptor @parent_fd with all its
+ * contents. Entries are opened and removed relative to directory descriptors, so no full path
+ * is built or resolved per file. @path holds the full name of the directory for messages;
+ * it is extended for the entries and restored on return.
+ *
+ * Errors are reported with the same dialogs as in recursive_erase().
+ */
+
+static FileProgressStatus
+erase_local_dir (file_op_total_context_t * tctx, file_op_context_t * ctx, int parent_fd,
+                 const char *name, GString * path)
+{
+    int fd;
+    DIR *reading;
+    struct dirent *next;
+    gsize path_len;
+    FileProgressStatus return_status = FILE_CONT;
+
+    fd = openat (parent_fd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd == -1)
+        return FILE_RETRY;
+
+    reading = fdopendir (fd);
+    if (reading == NULL)
+    {
+        close (fd);
+        return FILE_RETRY;
+    }
+
+    path_len = path->len;
+
+    while ((next = readdir (reading)) != NULL && return_status != FILE_ABORT)
+    {
+        gboolean is_dir;
+
+        if (DIR_IS_DOT (next->d_name) || DIR_IS_DOTDOT (next->d_name))
+            continue;
+
+        g_string_truncate (path, path_len);
+        if (!IS_PATH_SEP (path->str[path_len - 1]))
+            g_string_append_c (path, PATH_SEP);
+        g_string_append (path, next->d_name);
+
+#ifdef _DIRENT_HAVE_D_TYPE
+        if (next->d_type != DT_UNKNOWN)
+            is_dir = next->d_type == DT_DIR;
+        else
+#endif
+        {
+            struct stat buf;
+
+            if (fstatat (fd, next->d_name, &buf, AT_SYMLINK_NOFOLLOW) != 0)
+            {
+                closedir (reading);
+                g_string_truncate (path, path_len);
+                return FILE_RETRY;
+            }
+            is_dir = S_ISDIR (buf.st_mode);
+        }
+
+        if (is_dir)
+        {
+            return_status = erase_local_dir (tctx, ctx, fd, next->d_name, path);
+            continue;
+        }
+
+        return_status = erase_local_progress (tctx, ctx, path->str, TRUE);
+        if (return_status == FILE_ABORT)
+            break;
+
+        while (unlinkat (fd, next->d_name, 0) != 0 && !ctx->skip_all)
+        {
+            return_status = file_error (TRUE, _("Cannot remove file \"%s\"\n%s"), path->str);
+            if (return_status == FILE_RETRY)
+                continue;
+            if (return_status == FILE_SKIPALL)
+                ctx->skip_all = TRUE;
+            break;
+        }
+
+        if (return_status != FILE_ABORT)
+            return_status = FILE_CONT;
+    }
+
+    closedir (reading);
+    g_string_truncate (path, path_len);
+
+    if (return_status == FILE_ABORT)
+        return FILE_ABORT;
+
+    return_status = erase_local_progress (tctx, ctx, path->str, FALSE);
+    if (return_status == FILE_ABORT)
+        return FILE_ABORT;
+
+    while (unlinkat (parent_fd, name, AT_REMOVEDIR) != 0 && !ctx->skip_all)
+    {
+        return_status = file_error (TRUE, _("Cannot remove directory \"%s\"\n%s"), path->str);
+        if (return_status == FILE_SKIPALL)
+            ctx->skip_all = TRUE;
+        if (return_status != FILE_RETRY)
+            break;
+    }
+
+    return return_status;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
 /**
   Recursive remove of files
   abort->cancel stack
@@ -1419,6 +1748,19 @@ recursive_erase (file_op_total_context_t * tctx, file_op_context_t * ctx, const
     const char *s;
     FileProgressStatus return_status = FILE_CONT;
 
+    /* local file system: work relative to directory descriptors */
+    if (vfs_path_elements_count (vpath) == 1 && vfs_file_is_local (vpath))
+    {
+        GString *path;
+
+        /* the name must not live in the buffer which is modified during the walk */
+        path = g_string_new (vfs_path_as_str (vpath));
+        return_status = erase_local_dir (tctx, ctx, AT_FDCWD, vfs_path_as_str (vpath), path);
+        g_string_free (path, TRUE);
+
+        return return_status;
+    }
+
     reading = mc_opendir (vpath);
     if (reading == NULL)
         return FILE_RETRY;
@@ -1511,6 +1853,57 @@ erase_dir_iff_empty (file_op_context_t * ctx, const vfs_path_t * vpath, size_t c
 }
 
 
+/* --------------------------------------------------------------------------------------------- */
+
+/**
+ * Remove the source of a moved file. Unlike erase_file() the file is not counted again:
+ * it was counted when it was copied.
+ */
+
+static FileProgressStatus
+erase_copied_file (file_op_total_context_t * tctx, file_op_context_t * ctx,
+                   const vfs_path_t * vpath)
+{
+    FileProgressStatus return_status = FILE_CONT;
+
+    if (file_progress_show_deleting (ctx, vfs_path_as_str (vpath), NULL)
+        || progress_frame_due (tctx))
+    {
+        if (check_progress_buttons (ctx) == FILE_ABORT)
+            return FILE_ABORT;
+
+        mc_refresh ();
+    }
+
+    if (!try_remove_file (ctx, vpath, &return_status) && return_status == FILE_ABORT)
+        return FILE_ABORT;
+
+    return FILE_CONT;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/**
+ * Count a directory which was renamed into place as a whole like the files in it would
+ * have been counted one by one when copied, so that the progress meets the totals.
+ * The numbers are those the directory scanning found below the source path.
+ */
+
+static FileProgressStatus
+progress_update_moved_dir (file_op_total_context_t * tctx, file_op_context_t * ctx,
+                           const char *src)
+{
+    const scan_dir_total_t *t = NULL;
+
+    if (ctx->progress_totals_computed && scan_dir_totals != NULL)
+        t = (const scan_dir_total_t *) g_hash_table_lookup (scan_dir_totals, src);
+
+    if (t == NULL)
+        return progress_update_one (tctx, ctx, 0);
+
+    return progress_update (tctx, ctx, t->count, t->bytes);
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 static void
@@ -1519,24 +1912,17 @@ erase_dir_after_copy (file_op_total_context_t * tctx, file_op_context_t * ctx,
 {
     if (ctx->erase_at_end)
     {
-        /* Reset progress count before delete to avoid counting files twice */
-        tctx->progress_count = tctx->prev_progress_count;
-
-        while (erase_list != NULL && *status != FILE_ABORT)
+        while (!g_queue_is_empty (&erase_list) && *status != FILE_ABORT)
         {
-            struct link *lp = (struct link *) erase_list->data;
+            struct link *lp = (struct link *) g_queue_pop_head (&erase_list);
 
             if (S_ISDIR (lp->st_mode))
                 *status = erase_dir_iff_empty (ctx, lp->src_vpath, tctx->progress_count);
             else
-                *status = erase_file (tctx, ctx, lp->src_vpath);
+                *status = erase_copied_file (tctx, ctx, lp->src_vpath);
 
-            erase_list = g_slist_remove (erase_list, lp);
             free_link (lp);
         }
-
-        /* Save progress counter before move next directory */
-        tctx->prev_progress_count = tctx->progress_count;
     }
 
     erase_dir_iff_empty (ctx, vpath, tctx->progress_count);
@@ -1703,7 +2089,7 @@ do_move_dir_dir (const WPanel * panel, file_op_total_context_t * tctx, file_op_c
     erase_dir_after_copy (tctx, ctx, src_vpath, &return_status);
 
   ret:
-    erase_list = static_cast<GSList *>(free_linklist(erase_list));
+    free_erase_list ();
   ret_fast:
     vfs_path_free (src_vpath);
     vfs_path_free (dst_vpath);
@@ -2118,7 +2504,7 @@ operate_one_file (const WPanel * panel, FileOperation operation, file_op_total_c
                     value = copy_file_file (tctx, ctx, src, dest);
                 else
                     value = copy_dir_dir (tctx, ctx, src, dest, TRUE, FALSE, FALSE, NULL);
-                dest_dirs = static_cast<GSList *>(free_linklist(dest_dirs));
+                dest_dirs = free_linktable (dest_dirs);
                 break;
 
             case OP_MOVE:
@@ -2217,10 +2603,10 @@ copy_file_file (file_op_total_context_t * tctx, file_op_context_t * ctx,
     mode_t src_mode = 0;        /* The mode of the source file */
     struct stat src_stat, dst_stat;
     mc_timesbuf_t times;
-    gboolean dst_exists = FALSE, appending = FALSE;
+    gboolean dst_exists = FALSE, appending = FALSE, resuming = FALSE;
     off_t file_size = -1;
     FileProgressStatus return_status, temp_status;
-    struct timeval tv_transfer_start;
+    uint64_t transfer_start;
     dest_status_t dst_status = DEST_NONE;
     int open_flags;
     vfs_path_t *src_vpath = NULL, *dst_vpath = NULL;
@@ -2236,13 +2622,16 @@ copy_file_file (file_op_total_context_t * tctx, file_op_context_t * ctx,
     file_progress_show_source (ctx, src_vpath);
     file_progress_show_target (ctx, dst_vpath);
 
-    if (check_progress_buttons (ctx) == FILE_ABORT)
+    if (progress_frame_due (tctx))
     {
-        return_status = FILE_ABORT;
-        goto ret_fast;
-    }
+        if (check_progress_buttons (ctx) == FILE_ABORT)
+        {
+            return_status = FILE_ABORT;
+            goto ret_fast;
+        }
 
-    mc_refresh ();
+        mc_refresh ();
+    }
 
     while (mc_stat (dst_vpath, &dst_stat) == 0)
     {
@@ -2266,7 +2655,7 @@ copy_file_file (file_op_total_context_t * tctx, file_op_context_t * ctx,
         break;
     }
 
-    while ((*ctx->stat_func) (src_vpath, &src_stat) != 0)
+    while (file_op_stat (ctx, src_vpath, &src_stat, FALSE) != 0)
     {
         if (ctx->skip_all)
             return_status = FILE_SKIPALL;
@@ -2281,7 +2670,35 @@ copy_file_file (file_op_total_context_t * tctx, file_op_context_t * ctx,
             goto ret_fast;
     }
 
-    if (dst_exists)
+    switch (fileop_journal_get_state (ctx->journal, src_path))
+    {
+    case JOURNAL_FILE_DONE:
+        /* copied by the interrupted run, unless the target was lost or changed since then */
+        if (dst_exists && dst_stat.st_size == src_stat.st_size
+            && (!ctx->preserve || dst_stat.st_mtime == src_stat.st_mtime))
+        {
+            return_status = progress_update_one (tctx, ctx, src_stat.st_size);
+            goto ret_fast;
+        }
+
+        fileop_journal_forget_file (ctx->journal, src_path);
+        break;
+
+    case JOURNAL_FILE_STARTED:
+        /* continue the file the interrupted run was copying */
+        if (dst_exists && S_ISREG (dst_stat.st_mode) && dst_stat.st_size <= src_stat.st_size)
+        {
+            ctx->do_reget = dst_stat.st_size;
+            ctx->do_append = ctx->do_reget != 0;
+            resuming = ctx->do_append;
+        }
+        break;
+
+    default:
+        break;
+    }
+
+    if (dst_exists && !ctx->do_append)
     {
         /* Destination already exists */
         if (check_same_file (src_path, &src_stat, dst_path, &dst_stat, &return_status))
@@ -2381,7 +2798,8 @@ copy_file_file (file_op_total_context_t * tctx, file_op_context_t * ctx,
         }
     }
 
-    gettimeofday (&tv_transfer_start, (struct timezone *) NULL);
+    transfer_start = mc_global.timer->mc_timer_elapsed ();
+    mc_rate_window_reset (&ctx->rate_window);
 
     while ((src_desc = mc_open (src_vpath, O_RDONLY | O_LINEAR)) < 0 && !ctx->skip_all)
     {
@@ -2461,6 +2879,7 @@ copy_file_file (file_op_total_context_t * tctx, file_op_context_t * ctx,
         goto ret;
     }
     dst_status = DEST_SHORT;    /* file opened, but not fully copied */
+    fileop_journal_begin_file (ctx->journal, src_path);
 
     appending = ctx->do_append;
     ctx->do_append = FALSE;
@@ -2532,19 +2951,22 @@ copy_file_file (file_op_total_context_t * tctx, file_op_context_t * ctx,
         file_progress_show (ctx, 0, file_size, "", TRUE);
     else
         file_progress_show (ctx, 1, 1, "", TRUE);
-    return_status = check_progress_buttons (ctx);
-    mc_refresh ();
+
+    return_status = FILE_CONT;
+    if (progress_frame_due (tctx))
+    {
+        return_status = check_progress_buttons (ctx);
+        mc_refresh ();
+    }
 
     if (return_status == FILE_CONT)
     {
         size_t bufsize;
         off_t n_read_total = 0;
-        struct timeval tv_current, tv_last_update, tv_last_input;
-        int secs, update_secs;
+        uint64_t now, last_input;
         const char *stalled_msg = "";
-        gboolean is_first_time = TRUE;
 
-        tv_last_update = tv_transfer_start;
+        last_input = transfer_start;
 
         bufsize = io_blksize (dst_stat);
         buf = static_cast<char *>(g_malloc(bufsize));
@@ -2569,7 +2991,7 @@ copy_file_file (file_op_total_context_t * tctx, file_op_context_t * ctx,
             if (n_read == 0)
                 break;
 
-            gettimeofday (&tv_current, NULL);
+            now = mc_global.timer->mc_timer_elapsed ();
 
             if (n_read > 0)
             {
@@ -2583,7 +3005,7 @@ copy_file_file (file_op_total_context_t * tctx, file_op_context_t * ctx,
                  */
                 if ((src_mode & (S_IRWXU | S_IRWXG | S_IRWXO)) == 0)
                     src_mode = S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH;
-                gettimeofday (&tv_last_input, NULL);
+                last_input = now;
 
                 /* dst_write */
                 while ((n_written = mc_write (dest_desc, t, (size_t) n_read)) < n_read)
@@ -2624,26 +3046,23 @@ copy_file_file (file_op_total_context_t * tctx, file_op_context_t * ctx,
 
             tctx->copied_bytes = tctx->progress_bytes + n_read_total + ctx->do_reget;
 
-            secs = (tv_current.tv_sec - tv_last_update.tv_sec);
-            update_secs = (tv_current.tv_sec - tv_last_input.tv_sec);
+            /* the rest is drawing: skip it until the next frame */
+            if (!progress_frame_due (tctx))
+                continue;
 
-            if (is_first_time || secs > FILEOP_UPDATE_INTERVAL)
-            {
-                copy_file_file_display_progress (tctx, ctx,
-                                                 tv_current,
-                                                 tv_transfer_start, file_size, n_read_total);
-                tv_last_update = tv_current;
-            }
-            is_first_time = FALSE;
+            copy_file_file_display_progress (tctx, ctx, now, transfer_start, file_size,
+                                             n_read_total);
 
-            if (update_secs > FILEOP_STALLING_INTERVAL)
+            if (now - last_input > FILEOP_STALLING_INTERVAL * G_USEC_PER_SEC)
             {
                 stalled_msg = _("(stalled)");
             }
 
             {
+                struct timeval tv_current;
                 gboolean force_update;
 
+                gettimeofday (&tv_current, NULL);
                 force_update =
                     (tv_current.tv_sec - tctx->transfer_start.tv_sec) > FILEOP_UPDATE_INTERVAL;
 
@@ -2706,8 +3125,8 @@ copy_file_file (file_op_total_context_t * tctx, file_op_context_t * ctx,
     }
     else if (dst_status == DEST_FULL)
     {
-        /* Copy has succeeded */
-        if (!appending && ctx->preserve_uidgid)
+        /* Copy has succeeded. The target of a resumed copy is new: set its attributes too */
+        if ((!appending || resuming) && ctx->preserve_uidgid)
         {
             while (mc_chown (dst_vpath, src_uid, src_gid) != 0 && !ctx->skip_all)
             {
@@ -2725,7 +3144,7 @@ copy_file_file (file_op_total_context_t * tctx, file_op_context_t * ctx,
             }
         }
 
-        if (!appending)
+        if (!appending || resuming)
         {
             if (ctx->preserve)
             {
@@ -2757,7 +3176,11 @@ copy_file_file (file_op_total_context_t * tctx, file_op_context_t * ctx,
     }
 
     if (return_status == FILE_CONT)
+    {
+        if (dst_status == DEST_FULL)
+            fileop_journal_end_file (ctx->journal, src_path);
         return_status = progress_update_one (tctx, ctx, file_size);
+    }
 
   ret_fast:
     vfs_path_free (src_vpath);
@@ -2784,6 +3207,8 @@ copy_dir_dir (file_op_total_context_t * tctx, file_op_context_t * ctx, const cha
     struct link *lp;
     vfs_path_t *src_vpath, *dst_vpath;
     gboolean do_mkdir = TRUE;
+    gboolean rename_entries;
+    dev_t dest_dev;
 
     src_vpath = vfs_path_from_str (s);
     dst_vpath = vfs_path_from_str (d);
@@ -2791,7 +3216,7 @@ copy_dir_dir (file_op_total_context_t * tctx, file_op_context_t * ctx, const cha
     /* First get the mode of the source dir */
 
   retry_src_stat:
-    if ((*ctx->stat_func) (src_vpath, &src_stat) != 0)
+    if (file_op_stat (ctx, src_vpath, &src_stat, FALSE) != 0)
     {
         if (ctx->skip_all)
             return_status = FILE_SKIPALL;
@@ -2806,7 +3231,7 @@ copy_dir_dir (file_op_total_context_t * tctx, file_op_context_t * ctx, const cha
         goto ret_fast;
     }
 
-    if (is_in_linklist (dest_dirs, src_vpath, &src_stat) != NULL)
+    if (is_in_linktable (dest_dirs, src_vpath, &src_stat) != NULL)
     {
         /* Don't copy a directory we created before (we don't want to copy 
            infinitely if a directory is copied into itself) */
@@ -2938,7 +3363,7 @@ copy_dir_dir (file_op_total_context_t * tctx, file_op_context_t * ctx, const cha
         lp->vfs = vfs_path_get_by_index (dst_vpath, -1)->Class;
         lp->ino = dst_stat.st_ino;
         lp->dev = dst_stat.st_dev;
-        dest_dirs = g_slist_prepend (dest_dirs, lp);
+        dest_dirs = add_to_linktable (dest_dirs, lp);
     }
 
     if (ctx->preserve_uidgid)
@@ -2958,6 +3383,15 @@ copy_dir_dir (file_op_total_context_t * tctx, file_op_context_t * ctx, const cha
         }
     }
 
+    /*
+     * Plan the move: entries which live on the file system of the target directory
+     * (e.g. when moving into an existing directory, or a mount point inside the source)
+     * are renamed into place instead of being copied and erased.
+     */
+    rename_entries = do_delete && vfs_file_is_local (src_vpath) && vfs_file_is_local (dst_vpath)
+        && mc_stat (dst_vpath, &dst_stat) == 0;
+    dest_dev = rename_entries ? dst_stat.st_dev : 0;
+
     /* open the source dir for reading */
     reading = mc_opendir (src_vpath);
     if (reading == NULL)
@@ -2978,7 +3412,31 @@ copy_dir_dir (file_op_total_context_t * tctx, file_op_context_t * ctx, const cha
         path = mc_build_filename (s, next->d_name, (char *) NULL);
         tmp_vpath = vfs_path_from_str (path);
 
-        (*ctx->stat_func) (tmp_vpath, &dst_stat);
+        file_op_stat (ctx, tmp_vpath, &dst_stat, TRUE);
+
+        if (rename_entries && dst_stat.st_dev == dest_dev)
+        {
+            vfs_path_t *dest_vpath;
+            struct stat buf;
+            gboolean renamed;
+
+            dest_vpath = vfs_path_build_filename (d, next->d_name, (char *) NULL);
+            renamed = mc_lstat (dest_vpath, &buf) != 0 && errno == ENOENT
+                && mc_rename (tmp_vpath, dest_vpath) == 0;
+            vfs_path_free (dest_vpath);
+
+            if (renamed)
+            {
+                if (S_ISDIR (dst_stat.st_mode))
+                    return_status = progress_update_moved_dir (tctx, ctx, path);
+                else
+                    return_status = progress_update_one (tctx, ctx, dst_stat.st_size);
+                g_free (path);
+                vfs_path_free (tmp_vpath);
+                continue;
+            }
+        }
+
         if (S_ISDIR (dst_stat.st_mode))
         {
             char *mdpath;
@@ -3007,18 +3465,22 @@ copy_dir_dir (file_op_total_context_t * tctx, file_op_context_t * ctx, const cha
 
         if (do_delete && return_status == FILE_CONT)
         {
-            if (ctx->erase_at_end)
+            /* the copy of a file is complete: remove the source right now, unless
+               further hard links still need it as the link origin */
+            if (!S_ISDIR (dst_stat.st_mode) && dst_stat.st_nlink < 2)
+                return_status = erase_copied_file (tctx, ctx, tmp_vpath);
+            else if (ctx->erase_at_end)
             {
                 lp = g_new0 (struct link, 1);
                 lp->src_vpath = tmp_vpath;
                 lp->st_mode = dst_stat.st_mode;
-                erase_list = g_slist_append (erase_list, lp);
+                g_queue_push_tail (&erase_list, lp);
                 tmp_vpath = NULL;
             }
             else if (S_ISDIR (dst_stat.st_mode))
                 return_status = erase_dir_iff_empty (ctx, tmp_vpath, tctx->progress_count);
             else
-                return_status = erase_file (tctx, ctx, tmp_vpath);
+                return_status = erase_copied_file (tctx, ctx, tmp_vpath);
         }
         vfs_path_free (tmp_vpath);
     }
@@ -3204,6 +3666,43 @@ compute_dir_size (const vfs_path_t * dirname_vpath, dirsize_status_msg_t * sm,
                                 compute_symlinks);
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Open the journal of copy/move operation. If the same operation was interrupted before,
+ * ask whether to continue it or to start from scratch.
+ */
+
+static fileop_journal_t *
+panel_operate_open_journal (const WPanel * panel, FileOperation operation, const char *source,
+                            const char *dest)
+{
+    fileop_journal_t *journal;
+    GSList *names = NULL;
+
+    if (source != NULL)
+        names = g_slist_prepend (names, (gpointer) source);
+    else
+    {
+        int i;
+
+        for (i = panel->dir.len - 1; i >= 0; i--)
+            if (panel->dir.list[i].f.marked)
+                names = g_slist_prepend (names, panel->dir.list[i].fname);
+    }
+
+    journal = fileop_journal_open (operation, vfs_path_as_str (panel->cwd_vpath), dest, names);
+    g_slist_free (names);
+
+    if (fileop_journal_is_resumable (journal)
+        && query_dialog (op_names[operation],
+                         _("This operation was interrupted.\n"
+                           "Resume it skipping the files which are already done?"),
+                         D_NORMAL, 2, _("&Resume"), _("Re&start")) != 0)
+        fileop_journal_restart (journal);
+
+    return journal;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /**
  * panel_operate:
@@ -3239,6 +3738,7 @@ panel_operate (void *source_panel, FileOperation operation, gboolean force_singl
     filegui_dialog_type_t dialog_type = FILEGUI_DIALOG_ONE_ITEM;
 
     gboolean do_bg = FALSE;     /* do background operation? */
+    gboolean op_done = FALSE;   /* was not aborted */
 
     static gboolean i18n_flag = FALSE;
     if (!i18n_flag)
@@ -3248,8 +3748,8 @@ panel_operate (void *source_panel, FileOperation operation, gboolean force_singl
         i18n_flag = TRUE;
     }
 
-    linklist = static_cast<GSList *>(free_linklist(linklist));
-    dest_dirs = static_cast<GSList *>(free_linklist(dest_dirs));
+    linklist = free_linktable (linklist);
+    dest_dirs = free_linktable (dest_dirs);
 
     if (single_entry)
     {
@@ -3284,6 +3784,9 @@ panel_operate (void *source_panel, FileOperation operation, gboolean force_singl
     tctx = file_op_total_context_new ();
     gettimeofday (&tctx->transfer_start, (struct timezone *) NULL);
 
+    if (operation == OP_COPY || operation == OP_MOVE)
+        ctx->journal = panel_operate_open_journal (panel, operation, source, dest);
+
 #ifdef ENABLE_BACKGROUND
     /* Did the user select to do a background operation? */
     if (do_bg)
@@ -3304,6 +3807,8 @@ panel_operate (void *source_panel, FileOperation operation, gboolean force_singl
             mc_setctl (dest_vpath, VFS_SETCTL_FORGET, NULL);
             vfs_path_free (dest_vpath);
             g_free (dest);
+            /* the child goes on writing the journal */
+            fileop_journal_close (ctx->journal, FALSE);
             /*          file_op_context_destroy (ctx); */
             return FALSE;
         }
@@ -3358,6 +3863,7 @@ panel_operate (void *source_panel, FileOperation operation, gboolean force_singl
 
         value =
             operate_single_file (panel, operation, tctx, ctx, source, &src_stat, dest, dialog_type);
+        op_done = value != FILE_ABORT;
 
         if ((value == FILE_CONT) && !force_single)
             unmark_files (panel);
@@ -3424,6 +3930,8 @@ panel_operate (void *source_panel, FileOperation operation, gboolean force_singl
 
                 mc_refresh ();
             }                   /* Loop for every file */
+
+            op_done = i == panel->dir.len;
         }
     }                           /* Many entries */
 
@@ -3445,11 +3953,15 @@ panel_operate (void *source_panel, FileOperation operation, gboolean force_singl
         g_free (save_dest);
     }
 
-    linklist = static_cast<GSList *>(free_linklist(linklist));
-    dest_dirs = static_cast<GSList *>(free_linklist(dest_dirs));
+    linklist = free_linktable (linklist);
+    dest_dirs = free_linktable (dest_dirs);
+    scan_stat_cache_free ();
     g_free (dest);
     vfs_path_free (dest_vpath);
     MC_PTR_FREE (ctx->dest_mask);
+    /* keep the journal of the interrupted operation to resume it later */
+    fileop_journal_close (ctx->journal, op_done);
+    ctx->journal = NULL;
 
 #ifdef ENABLE_BACKGROUND
     /* Let our parent know we are saying bye bye */
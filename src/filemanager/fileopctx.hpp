@@ -66,6 +66,7 @@ enum OperationMode
 /*** structures declarations (and typedefs of structures)*****************************************/
 
 struct mc_search_struct;
+struct fileop_journal_t;
 
 /* This structure describes a context for file operations.  It is used to update
  * the progress windows and pass around options.
@@ -84,6 +85,9 @@ typedef struct
     /* Transferred seconds */
     long bps_time;
 
+    /* Recent transfer rate of the current file */
+    mc_rate_window_t rate_window;
+
     /* Whether the panel total has been computed */
     gboolean progress_totals_computed;
     filegui_dialog_type_t dialog_type;
@@ -139,13 +143,13 @@ typedef struct
     /* Whether to dive into subdirectories for recursive operations */
     bool dive_into_subdirs;
 
-    /* When moving directories cross filesystem boundaries delete the
-     * successfully copied files when all files below the directory and its
-     * subdirectories were processed.
+    /* When moving directories cross filesystem boundaries the source of a
+     * file is deleted right after its successful copy. Directories and files
+     * with several hard links (still needed as link origins) are deleted when
+     * all files below the directory and its subdirectories were processed.
      *
-     * If erase_at_end is FALSE files will be deleted immediately after their
-     * successful copy (Note: this behavior is not tested and at the moment
-     * it can't be changed at runtime).
+     * If erase_at_end is FALSE those are deleted immediately as well
+     * (Note: at the moment it can't be changed at runtime).
      */
     gboolean erase_at_end;
 
@@ -158,6 +162,9 @@ typedef struct
     /* Whether the file operation is in pause */
     gboolean suspended;
 
+    /* Journal of copied files to resume the interrupted operation, or NULL */
+    fileop_journal_t *journal;
+
     /* User interface data goes here */
     void *ui;
 } file_op_context_t;
@@ -165,13 +172,14 @@ typedef struct
 typedef struct
 {
     size_t progress_count;
-    size_t prev_progress_count; /* Used in OP_MOVE between copy and remove directories */
     uintmax_t progress_bytes;
     uintmax_t copied_bytes;
     size_t bps;
     size_t bps_count;
     struct timeval transfer_start;
     double eta_secs;
+    mc_rate_window_t rate_window;     /* recent transfer rate of the whole operation */
+    guint64 frame_last;         /* time of the last progress redraw */
 
     gboolean ask_overwrite;
 } file_op_total_context_t;
@@ -0,0 +1,274 @@
+/*
+   Journal of copy/move operations for the Midnight Commander.
+
+   Copyright (C) 2020
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \file fileopjournal.c
+ *  \brief Source: journal of copy/move operations for resuming them
+ *
+ *  While a copy or move runs, every source file is logged twice: when its target
+ *  is created ("S") and when the copy is complete ("D"). The journal lives in the
+ *  cache directory and is named after a digest of the operation (kind, source
+ *  directory, destination and the selected names), so starting the same operation
+ *  again finds it. Then completed files are skipped and the one being copied when
+ *  the run was interrupted is continued by appending to its target (reget).
+ *  The journal is removed when the operation finishes.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "lib/global.hpp"
+#include "lib/mcconfig.hpp"       /* mc_config_get_cache_path() */
+#include "lib/util.hpp"
+
+#include "fileopjournal.hpp"
+
+/*** global variables ****************************************************************************/
+
+/*** file scope macro definitions ****************************************************************/
+
+#define JOURNAL_DIR "fileops"
+
+/*** file scope type declarations ****************************************************************/
+
+struct fileop_journal_t
+{
+    char *path;
+    FILE *f;
+    GHashTable *files;          /* source path -> journal_file_state_t */
+};
+
+/*** file scope variables ************************************************************************/
+
+/*** file scope functions ************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+static char *
+fileop_journal_name (int operation, const char *source_dir, const char *dest,
+                     const GSList * names)
+{
+    GChecksum *sum;
+    char *op, *name;
+
+    sum = g_checksum_new (G_CHECKSUM_SHA1);
+
+    op = g_strdup_printf ("%d", operation);
+    g_checksum_update (sum, (const guchar *) op, strlen (op) + 1);
+    g_free (op);
+    g_checksum_update (sum, (const guchar *) source_dir, strlen (source_dir) + 1);
+    g_checksum_update (sum, (const guchar *) dest, strlen (dest) + 1);
+    for (; names != NULL; names = g_slist_next (names))
+        g_checksum_update (sum, (const guchar *) names->data,
+                           strlen ((const char *) names->data) + 1);
+
+    name = g_strconcat (g_checksum_get_string (sum), ".journal", (char *) NULL);
+    g_checksum_free (sum);
+
+    return name;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+fileop_journal_load (fileop_journal_t * journal)
+{
+    FILE *f;
+    char *line = NULL;
+    size_t len = 0;
+
+    f = fopen (journal->path, "r");
+    if (f == NULL)
+        return;
+
+    while (getline (&line, &len, f) > 0)
+    {
+        journal_file_state_t state;
+        char *src;
+
+        if (line[0] == 'S')
+            state = JOURNAL_FILE_STARTED;
+        else if (line[0] == 'D')
+            state = JOURNAL_FILE_DONE;
+        else
+            continue;
+
+        /* a line cut by a crash has no newline and is ignored */
+        if (line[1] != '\t' || strchr (line, '\n') == NULL)
+            continue;
+
+        *strchr (line, '\n') = '\0';
+        src = g_strcompress (line + 2);
+        g_hash_table_insert (journal->files, src, GINT_TO_POINTER (state));
+    }
+
+    free (line);
+    fclose (f);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+fileop_journal_write (fileop_journal_t * journal, char kind, const char *src)
+{
+    char *escaped;
+
+    if (journal == NULL || journal->f == NULL)
+        return;
+
+    escaped = g_strescape (src, NULL);
+    fprintf (journal->f, "%c\t%s\n", kind, escaped);
+    g_free (escaped);
+
+    /* survive a crash of mc; we don't fsync, a crash of the system may lose the tail */
+    fflush (journal->f);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Open the journal of an operation. The journal left by an interrupted run of the same
+ * operation is loaded, see fileop_journal_is_resumable().
+ *
+ * @return journal or NULL if it cannot be written
+ */
+
+fileop_journal_t *
+fileop_journal_open (int operation, const char *source_dir, const char *dest,
+                     const GSList * names)
+{
+    fileop_journal_t *journal;
+    char *dir, *name;
+
+    dir = g_build_filename (mc_config_get_cache_path (), JOURNAL_DIR, (char *) NULL);
+    if (g_mkdir_with_parents (dir, 0700) != 0)
+    {
+        g_free (dir);
+        return NULL;
+    }
+
+    name = fileop_journal_name (operation, source_dir, dest, names);
+
+    journal = g_new (fileop_journal_t, 1);
+    journal->path = g_build_filename (dir, name, (char *) NULL);
+    journal->files = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    g_free (name);
+    g_free (dir);
+
+    fileop_journal_load (journal);
+
+    journal->f = fopen (journal->path, "a");
+    if (journal->f == NULL)
+    {
+        fileop_journal_close (journal, FALSE);
+        return NULL;
+    }
+
+    return journal;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+gboolean
+fileop_journal_is_resumable (const fileop_journal_t * journal)
+{
+    return (journal != NULL && g_hash_table_size (journal->files) != 0);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Forget the interrupted run: the operation starts from scratch */
+
+void
+fileop_journal_restart (fileop_journal_t * journal)
+{
+    if (journal == NULL)
+        return;
+
+    g_hash_table_remove_all (journal->files);
+
+    if (journal->f != NULL)
+        fclose (journal->f);
+    journal->f = fopen (journal->path, "w");
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Close the journal.
+ *
+ * @param completed if TRUE, the operation is finished and the journal is removed,
+ *                  otherwise it is kept for resuming
+ */
+
+void
+fileop_journal_close (fileop_journal_t * journal, gboolean completed)
+{
+    if (journal == NULL)
+        return;
+
+    if (journal->f != NULL)
+        fclose (journal->f);
+    if (completed)
+        unlink (journal->path);
+
+    g_hash_table_destroy (journal->files);
+    g_free (journal->path);
+    g_free (journal);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+journal_file_state_t
+fileop_journal_get_state (const fileop_journal_t * journal, const char *src)
+{
+    if (journal == NULL)
+        return JOURNAL_FILE_NONE;
+
+    return (journal_file_state_t) GPOINTER_TO_INT (g_hash_table_lookup (journal->files, src));
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+void
+fileop_journal_begin_file (fileop_journal_t * journal, const char *src)
+{
+    fileop_journal_write (journal, 'S', src);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+void
+fileop_journal_end_file (fileop_journal_t * journal, const char *src)
+{
+    fileop_journal_write (journal, 'D', src);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Drop the state of a file left by the interrupted run: it is copied again */
+
+void
+fileop_journal_forget_file (fileop_journal_t * journal, const char *src)
+{
+    if (journal != NULL)
+        g_hash_table_remove (journal->files, src);
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,39 @@
+/** \file fileopjournal.h
+ *  \brief Header: journal of copy/move operations for resuming them
+ */
+
+#pragma once
+
+#include "lib/global.hpp"
+
+/*** typedefs(not structures) and defined constants **********************************************/
+
+/*** enums ***************************************************************************************/
+
+typedef enum
+{
+    JOURNAL_FILE_NONE = 0,      /* not touched by the interrupted run */
+    JOURNAL_FILE_STARTED,       /* target was created, but the copy didn't finish */
+    JOURNAL_FILE_DONE           /* file was copied completely */
+} journal_file_state_t;
+
+/*** structures declarations (and typedefs of structures)*****************************************/
+
+typedef struct fileop_journal_t fileop_journal_t;
+
+/*** global variables defined in .c file *********************************************************/
+
+/*** declarations of public functions ************************************************************/
+
+fileop_journal_t *fileop_journal_open (int operation, const char *source_dir, const char *dest,
+                                       const GSList * names);
+gboolean fileop_journal_is_resumable (const fileop_journal_t * journal);
+void fileop_journal_restart (fileop_journal_t * journal);
+void fileop_journal_close (fileop_journal_t * journal, gboolean completed);
+
+journal_file_state_t fileop_journal_get_state (const fileop_journal_t * journal, const char *src);
+void fileop_journal_begin_file (fileop_journal_t * journal, const char *src);
+void fileop_journal_end_file (fileop_journal_t * journal, const char *src);
+void fileop_journal_forget_file (fileop_journal_t * journal, const char *src);
+
+/*** inline functions ****************************************************************************/
@@ -0,0 +1,719 @@
+/*
+   In-process detection of file types and encodings.
+
+   Copyright (C) 2020
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \file filetype.c
+ *  \brief Source: in-process detection of file types and encodings
+ *
+ *  The type/ rules of mc.ext are matched against a description of the file contents in
+ *  the style of file(1). It is made from the head of the file, read through the VFS, by
+ *  libmagic when it is compiled in and by a small built-in table of the formats mc.ext
+ *  knows about otherwise. The encoding of text files, which used to come from enca(1),
+ *  is guessed from the same bytes. Results are cached by device, inode, size and mtime,
+ *  so panels on local disks can fill the cache for the visible rows while the user is
+ *  idle. The cache is emptied when the language of the encoding detection changes.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+
+#ifdef HAVE_LIBMAGIC
+#include <magic.h>
+#endif
+
+#include "lib/global.hpp"
+#include "lib/util.hpp"
+#include "lib/vfs/vfs.hpp"
+
+#include "src/setup.hpp"          /* autodetect_codeset */
+
+#include "filetype.hpp"
+
+/*** global variables ****************************************************************************/
+
+/*** file scope macro definitions ****************************************************************/
+
+/* bytes of the file the detection looks at */
+#define FILE_TYPE_HEAD_SIZE (64 * 1024)
+
+/* the cache is emptied when it grows beyond this number of files */
+#define FILE_TYPE_CACHE_MAX 4096
+
+#define FILE_TYPE_IS_MAGIC(buf, len, offset, magic) \
+    ((len) >= (offset) + sizeof (magic) - 1 \
+     && memcmp ((buf) + (offset), (magic), sizeof (magic) - 1) == 0)
+
+/*** file scope type declarations ****************************************************************/
+
+typedef struct
+{
+    dev_t dev;
+    ino_t ino;
+    off_t size;
+    time_t mtime;
+} file_type_key_t;
+
+typedef struct
+{
+    file_type_key_t key;
+    file_type_t info;
+} file_type_entry_t;
+
+/* formats recognized by a fixed string at a fixed offset */
+typedef struct
+{
+    size_t offset;
+    const char *magic;
+    size_t len;
+    const char *type;
+} file_type_magic_t;
+
+/*** file scope variables ************************************************************************/
+
+/* *INDENT-OFF* */
+static const file_type_magic_t file_type_magics[] =
+{
+    { 0, "GIF87a", 6, "GIF image data, version 87a" },
+    { 0, "GIF89a", 6, "GIF image data, version 89a" },
+    { 0, "\377\330\377", 3, "JPEG image data" },
+    { 0, "\211PNG\r\n\032\n", 8, "PNG image data" },
+    { 0, "\213JNG\r\n\032\n", 8, "JNG video data" },
+    { 0, "\212MNG\r\n\032\n", 8, "MNG video data" },
+    { 0, "II*\0", 4, "TIFF image data, little-endian" },
+    { 0, "MM\0*", 4, "TIFF image data, big-endian" },
+    { 0, "%!PS", 4, "PostScript document text" },
+    { 0, "\004%!", 3, "PostScript document text" },
+    { 0, "%PDF-", 5, "PDF document" },
+    { 0, "<MakerFile", 10, "FrameMaker document" },
+    { 0, "SQLite format 3", 16, "SQLite 3.x database" },
+    { 0, "\037\213", 2, "gzip compressed data" },
+    { 0, "BZh", 3, "bzip2 compressed data" },
+    { 0, "\037\235", 2, "compress'd data" },
+    { 0, "LZIP", 4, "LZIP compressed data" },
+    { 0, "\3757zXZ", 6, "XZ compressed data" },
+    { 0, "(\265/\375", 4, "Zstandard compressed data" },
+    { 0, "7z\274\257\047\034", 6, "7-zip archive data" },
+    { 0, "Rar!\032\007", 6, "RAR archive data" },
+    { 0, "PAR2\0PKT", 8, "Parity Archive Volume Set" },
+    { 0, "!<arch>\ndebian-binary", 21, "Debian binary package" },
+    { 0, "!<arch>\n", 8, "current ar archive" },
+    { 0, "\355\253\356\333", 4, "RPM" },
+    { 0, "OggS", 4, "Ogg data" },
+    { 0, "fLaC", 4, "FLAC audio bitstream data" },
+    { 0, "ID3", 3, "Audio file with ID3 version 2" },
+    { 0, "RIFF", 4, "RIFF (little-endian) data" },
+    { 4, "ftyp", 4, "ISO Media" },
+    { 0, "\367\002", 2, "TeX DVI file" },
+    { 0, "MZ", 2, "MS-DOS executable" },
+    { 257, "ustar", 5, "POSIX tar archive" },
+};
+/* *INDENT-ON* */
+
+static GHashTable *file_type_cache = NULL;
+
+#ifdef HAVE_CHARSET
+/* language of the encodings in the cache, NULL if they were not guessed */
+static char *file_type_cache_codeset = NULL;
+#endif
+
+#ifdef HAVE_LIBMAGIC
+static magic_t file_type_magic_cookie = NULL;
+static gboolean file_type_magic_failed = FALSE;
+#endif
+
+/* --------------------------------------------------------------------------------------------- */
+/*** file scope functions ************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+static guint
+file_type_key_hash (gconstpointer k)
+{
+    const file_type_key_t *key = (const file_type_key_t *) k;
+
+    return (guint) key->ino ^ ((guint) key->dev << 16) ^ (guint) key->size ^ (guint) key->mtime;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+file_type_key_equal (gconstpointer a, gconstpointer b)
+{
+    const file_type_key_t *ka = (const file_type_key_t *) a;
+    const file_type_key_t *kb = (const file_type_key_t *) b;
+
+    return ka->ino == kb->ino && ka->dev == kb->dev && ka->size == kb->size
+        && ka->mtime == kb->mtime;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+file_type_entry_free (gpointer data)
+{
+    file_type_entry_t *entry = (file_type_entry_t *) data;
+
+    g_free (entry->info.type);
+    g_free (entry->info.encoding);
+    g_free (entry);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static inline guint16
+file_type_get16 (const unsigned char *p)
+{
+    return (guint16) (p[0] | (p[1] << 8));
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static inline guint32
+file_type_get32 (const unsigned char *p)
+{
+    return (guint32) p[0] | ((guint32) p[1] << 8) | ((guint32) p[2] << 16)
+        | ((guint32) p[3] << 24);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+file_type_contains (const char *buf, size_t len, const char *s, size_t s_len)
+{
+    size_t i;
+
+    if (len < s_len)
+        return FALSE;
+
+    for (i = 0; i <= len - s_len; i++)
+        if (buf[i] == s[0] && memcmp (buf + i, s, s_len) == 0)
+            return TRUE;
+
+    return FALSE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Classify the bytes as text the way file(1) does.
+ * Return the name of the character set, or NULL if this is not text.
+ */
+
+static const char *
+file_type_text_kind (const char *buf, size_t len, gboolean truncated)
+{
+    const unsigned char *p = (const unsigned char *) buf;
+    gboolean high = FALSE, c1 = FALSE;
+    const char *end;
+    size_t i;
+
+    for (i = 0; i < len; i++)
+    {
+        if (p[i] == '\0' || p[i] == 0x7f
+            || (p[i] < 0x20 && strchr ("\a\b\t\n\v\f\r\033", p[i]) == NULL))
+            return NULL;
+        if (p[i] >= 0x80)
+        {
+            high = TRUE;
+            if (p[i] < 0xa0)
+                c1 = TRUE;
+        }
+    }
+
+    if (!high)
+        return "ASCII";
+
+    /* a multibyte character may be cut at the end of the head */
+    if (g_utf8_validate (buf, len, &end)
+        || (truncated && end != NULL && (size_t) (buf + len - end) < 4
+            && g_utf8_get_char_validated (end, buf + len - end) == (gunichar) (-2)))
+        return "UTF-8 Unicode";
+
+    return c1 ? "Non-ISO extended-ASCII" : "ISO-8859";
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static char *
+file_type_guess_text (const char *buf, size_t len, gboolean truncated)
+{
+    const char *kind;
+    const char *crlf;
+    const char *nl;
+
+    kind = file_type_text_kind (buf, len, truncated);
+    if (kind == NULL)
+        return NULL;
+
+    crlf = file_type_contains (buf, len, "\r\n", 2) ? ", with CRLF line terminators" : "";
+    nl = (const char *) memchr (buf, '\n', len);
+
+    if (FILE_TYPE_IS_MAGIC (buf, len, 0, "#!"))
+    {
+        const char *eol = nl != NULL ? nl : buf + len;
+        char *interp, *type;
+
+        interp = g_strstrip (g_strndup (buf + 2, eol - buf - 2));
+        if (strcmp (interp, "/bin/sh") == 0)
+            type = g_strdup_printf ("POSIX shell script, %s text executable%s", kind, crlf);
+        else if (g_str_has_suffix (interp, "/bash"))
+            type = g_strdup_printf ("Bourne-Again shell script, %s text executable%s", kind, crlf);
+        else
+            type = g_strdup_printf ("a %s script, %s text executable%s", interp, kind, crlf);
+        g_free (interp);
+        return type;
+    }
+
+    if (FILE_TYPE_IS_MAGIC (buf, len, 0, "From ")
+        || FILE_TYPE_IS_MAGIC (buf, len, 0, "Return-Path:")
+        || FILE_TYPE_IS_MAGIC (buf, len, 0, "Received:"))
+        return g_strdup_printf ("%s mail text%s", kind, crlf);
+
+    if (FILE_TYPE_IS_MAGIC (buf, len, 0, "This is ") && nl != NULL
+        && file_type_contains (buf, nl - buf, "produced by makeinfo", 20))
+        return g_strdup ("Info text");
+
+    if (FILE_TYPE_IS_MAGIC (buf, len, 0, "<?xml"))
+        return g_strdup_printf ("XML 1.0 document, %s text%s", kind, crlf);
+
+    if ((len >= 14 && g_ascii_strncasecmp (buf, "<!DOCTYPE html", 14) == 0)
+        || (len >= 5 && g_ascii_strncasecmp (buf, "<html", 5) == 0))
+        return g_strdup_printf ("HTML document, %s text%s", kind, crlf);
+
+    return g_strdup_printf ("%s text%s", kind, crlf);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static char *
+file_type_guess_elf (const unsigned char *p, size_t len)
+{
+    static const char *const types[] =
+        { "no file type", "relocatable", "executable", "shared object", "core file" };
+    guint16 e_type;
+
+    if (len < 18)
+        return g_strdup ("ELF");
+
+    e_type = p[5] == 2 ? (guint16) ((p[16] << 8) | p[17]) : file_type_get16 (p + 16);
+
+    return g_strdup_printf ("ELF %s %s %s", p[4] == 2 ? "64-bit" : "32-bit",
+                            p[5] == 2 ? "MSB" : "LSB",
+                            e_type < G_N_ELEMENTS (types) ? types[e_type] : "processor-specific");
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Zip archives also hold office documents and Java and Android packages. */
+
+static char *
+file_type_guess_zip (const char *buf, size_t len)
+{
+    const unsigned char *p = (const unsigned char *) buf;
+    const char *name;
+    size_t name_len, data;
+
+    if (len < 30)
+        return g_strdup ("Zip archive data");
+
+    name = buf + 30;
+    name_len = file_type_get16 (p + 26);
+    data = 30 + name_len + file_type_get16 (p + 28);
+    if (30 + name_len > len)
+        name_len = 0;
+
+    if ((name_len == 19 && strncmp (name, "[Content_Types].xml", 19) == 0)
+        || (name_len == 11 && strncmp (name, "_rels/.rels", 11) == 0))
+    {
+        if (file_type_contains (buf, len, "word/", 5))
+            return g_strdup ("Microsoft Word 2007+");
+        if (file_type_contains (buf, len, "xl/", 3))
+            return g_strdup ("Microsoft Excel 2007+");
+        if (file_type_contains (buf, len, "ppt/", 4))
+            return g_strdup ("Microsoft PowerPoint 2007+");
+        return g_strdup ("Microsoft OOXML");
+    }
+
+    if (name_len == 8 && strncmp (name, "mimetype", 8) == 0
+        && FILE_TYPE_IS_MAGIC (buf, len, data, "application/vnd.oasis.opendocument."))
+        return g_strdup ("OpenDocument document");
+
+    if (name_len >= 9 && strncmp (name, "META-INF/", 9) == 0)
+        return g_strdup ("Java archive data (JAR)");
+
+    if (name_len == 19 && strncmp (name, "AndroidManifest.xml", 19) == 0)
+        return g_strdup ("Android package (APK)");
+
+    return g_strdup_printf ("Zip archive data, at least v%d.%d to extract",
+                            file_type_get16 (p + 4) / 10, file_type_get16 (p + 4) % 10);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static char *
+file_type_guess_ole (const char *buf, size_t len)
+{
+    /* names of the streams are stored in UTF-16LE */
+    if (file_type_contains (buf, len, "W\0o\0r\0d\0D\0o\0c\0u\0m\0e\0n\0t\0", 24))
+        return g_strdup ("Microsoft Word document");
+    if (file_type_contains (buf, len, "W\0o\0r\0k\0b\0o\0o\0k\0", 16)
+        || file_type_contains (buf, len, "B\0o\0o\0k\0", 8))
+        return g_strdup ("Microsoft Excel worksheet");
+    return g_strdup ("Microsoft Office Document");
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static char *
+file_type_guess_netpbm (const char *buf, size_t len)
+{
+    static const char *const kinds[] = { "bitmap", "greymap", "pixmap" };
+    int n;
+
+    if (len < 3 || buf[0] != 'P' || buf[1] < '1' || buf[1] > '6'
+        || strchr (" \t\r\n#", buf[2]) == NULL)
+        return NULL;
+
+    n = buf[1] - '1';
+    return g_strdup_printf ("Netpbm image data, %s, %s", n < 3 ? "ASCII text" : "rawbits",
+                            kinds[n % 3]);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Describe the contents with the built-in table.
+ * @param truncated the file is longer than @buf
+ */
+
+static char *
+file_type_guess (const char *buf, size_t len, gboolean truncated)
+{
+    const unsigned char *p = (const unsigned char *) buf;
+    char *type;
+    size_t i;
+
+    if (len == 0)
+        return g_strdup ("empty");
+
+    if (FILE_TYPE_IS_MAGIC (buf, len, 0, "\177ELF"))
+        return file_type_guess_elf (p, len);
+
+    if (FILE_TYPE_IS_MAGIC (buf, len, 0, "PK\003\004"))
+        return file_type_guess_zip (buf, len);
+    if (FILE_TYPE_IS_MAGIC (buf, len, 0, "PK\005\006"))
+        return g_strdup ("Zip archive data (empty)");
+
+    if (FILE_TYPE_IS_MAGIC (buf, len, 0, "\320\317\021\340\241\261\032\341"))
+        return file_type_guess_ole (buf, len);
+
+    if (FILE_TYPE_IS_MAGIC (buf, len, 0, "\032\105\337\243"))
+        return g_strdup (file_type_contains (buf, MIN (len, 64), "webm", 4) ? "WebM"
+                         : "Matroska data");
+
+    if (FILE_TYPE_IS_MAGIC (buf, len, 0, "BM") && len >= 18)
+    {
+        guint32 header = file_type_get32 (p + 14);
+
+        if (header == 12 || header == 40 || header == 52 || header == 56 || header == 64
+            || header == 108 || header == 124)
+            return g_strdup ("PC bitmap");
+    }
+
+    if (len >= 7 && memcmp (buf + 2, "-l", 2) == 0 && buf[6] == '-'
+        && (buf[4] == 'h' || buf[4] == 'z'))
+        return g_strdup ("LHa (2.x) archive data");
+
+    for (i = 0; i < G_N_ELEMENTS (file_type_magics); i++)
+    {
+        const file_type_magic_t *m = &file_type_magics[i];
+
+        if (len >= m->offset + m->len && memcmp (buf + m->offset, m->magic, m->len) == 0)
+            return g_strdup (m->type);
+    }
+
+    type = file_type_guess_netpbm (buf, len);
+    if (type == NULL)
+        type = file_type_guess_text (buf, len, truncated);
+    if (type == NULL)
+        type = g_strdup ("data");
+
+    return type;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+#ifdef HAVE_CHARSET
+/**
+ * Guess the charset of a text for the language set in the "autodetect_codeset" option.
+ * Only what tells apart the charsets of a language is looked at; enca(1) does better,
+ * but needs a process per file.
+ */
+
+static char *
+file_type_guess_encoding (const char *buf, size_t len, gboolean truncated, const char *lang)
+{
+    static const char *const cyrillic[] = {
+        "russian", "ru", "ukrainian", "uk", "belarusian", "be", "bulgarian", "bg", NULL
+    };
+    static const char *const central[] = {
+        "czech", "cs", "slovak", "sk", "polish", "pl", "hungarian", "hu", "slovene", "sl",
+        "croatian", "hr", NULL
+    };
+    const unsigned char *p = (const unsigned char *) buf;
+    const char *kind;
+    gboolean c1 = FALSE;
+    size_t i;
+
+    kind = file_type_text_kind (buf, len, truncated);
+    if (kind == NULL)
+        return NULL;
+    if (strcmp (kind, "ASCII") == 0)
+        return g_strdup ("ASCII");
+    if (strcmp (kind, "UTF-8 Unicode") == 0)
+        return g_strdup ("UTF-8");
+
+    for (i = 0; i < len; i++)
+        if (p[i] >= 0x80 && p[i] < 0xa0)
+            c1 = TRUE;
+
+    for (i = 0; cyrillic[i] != NULL; i++)
+        if (g_ascii_strcasecmp (lang, cyrillic[i]) == 0)
+        {
+            /* text is mostly lowercase: count the bytes that are small letters in each charset */
+            size_t cp1251 = 0, koi8 = 0, cp866 = 0, j;
+
+            for (j = 0; j < len; j++)
+            {
+                if (p[j] >= 0xe0)
+                    cp1251++;
+                if (p[j] >= 0xc0 && p[j] < 0xe0)
+                    koi8++;
+                if ((p[j] >= 0xa0 && p[j] < 0xb0) || (p[j] >= 0xe0 && p[j] < 0xf0))
+                    cp866++;
+            }
+
+            if (cp866 > cp1251 && cp866 > koi8)
+                return g_strdup ("IBM866");
+            if (koi8 > cp1251)
+                return g_strdup (i >= 2 && i < 6 ? "KOI8-U" : "KOI8-R");
+            return g_strdup ("CP1251");
+        }
+
+    for (i = 0; central[i] != NULL; i++)
+        if (g_ascii_strcasecmp (lang, central[i]) == 0)
+            return g_strdup (c1 ? "CP1250" : "ISO-8859-2");
+
+    return NULL;
+}
+#endif /* HAVE_CHARSET */
+
+/* --------------------------------------------------------------------------------------------- */
+
+#ifdef HAVE_LIBMAGIC
+static const char *
+file_type_magic (const char *buf, size_t len)
+{
+    if (file_type_magic_cookie == NULL && !file_type_magic_failed)
+    {
+        file_type_magic_cookie = magic_open (MAGIC_NONE);
+        if (file_type_magic_cookie != NULL && magic_load (file_type_magic_cookie, NULL) != 0)
+        {
+            magic_close (file_type_magic_cookie);
+            file_type_magic_cookie = NULL;
+        }
+        /* fall back to the built-in table for the rest of the session */
+        file_type_magic_failed = file_type_magic_cookie == NULL;
+    }
+
+    return file_type_magic_cookie == NULL ? NULL : magic_buffer (file_type_magic_cookie, buf, len);
+}
+#endif /* HAVE_LIBMAGIC */
+
+/* --------------------------------------------------------------------------------------------- */
+/** Read up to FILE_TYPE_HEAD_SIZE bytes from the beginning of the file. */
+
+static char *
+file_type_read_head (const vfs_path_t * vpath, size_t * len, GError ** mcerror)
+{
+    char *buf;
+    int fd;
+    ssize_t n = 0;
+
+    fd = mc_open (vpath, O_RDONLY);
+    if (fd == -1)
+    {
+        mc_propagate_error (mcerror, 0, _("Cannot open %s\n%s"), vfs_path_as_str (vpath),
+                            unix_error_string (errno));
+        return NULL;
+    }
+
+    buf = static_cast<char *> (g_malloc (FILE_TYPE_HEAD_SIZE));
+    *len = 0;
+    while (*len < FILE_TYPE_HEAD_SIZE
+           && (n = mc_read (fd, buf + *len, FILE_TYPE_HEAD_SIZE - *len)) > 0)
+        *len += n;
+    mc_close (fd);
+
+    if (n == -1)
+    {
+        mc_propagate_error (mcerror, 0, _("Cannot read %s\n%s"), vfs_path_as_str (vpath),
+                            unix_error_string (errno));
+        MC_PTR_FREE (buf);
+    }
+
+    return buf;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Cached encodings were guessed for another language: forget them */
+
+#ifdef HAVE_CHARSET
+static void
+file_type_check_codeset (void)
+{
+    const char *codeset;
+
+    codeset = is_autodetect_codeset_enabled ? autodetect_codeset : NULL;
+    if (g_strcmp0 (codeset, file_type_cache_codeset) == 0)
+        return;
+
+    if (file_type_cache != NULL)
+        g_hash_table_remove_all (file_type_cache);
+    g_free (file_type_cache_codeset);
+    file_type_cache_codeset = g_strdup (codeset);
+}
+#endif
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Describe the contents of a file.
+ *
+ * @param vpath file, on any VFS
+ * @param st its stat, or NULL to stat it here
+ * @param mcerror error return location
+ * @return cached result valid until the next call, or NULL if the file cannot be read
+ */
+
+const file_type_t *
+file_type_get (const vfs_path_t * vpath, const struct stat *st, GError ** mcerror)
+{
+    struct stat st_buf;
+    file_type_key_t key;
+    file_type_entry_t *entry;
+    char *buf;
+    size_t len;
+    gboolean truncated;
+
+    mc_return_val_if_error (mcerror, NULL);
+
+    if (st == NULL)
+    {
+        if (mc_stat (vpath, &st_buf) != 0)
+        {
+            mc_propagate_error (mcerror, 0, _("Cannot stat %s\n%s"), vfs_path_as_str (vpath),
+                                unix_error_string (errno));
+            return NULL;
+        }
+        st = &st_buf;
+    }
+
+    memset (&key, 0, sizeof (key));
+    key.dev = st->st_dev;
+    key.ino = st->st_ino;
+    key.size = st->st_size;
+    key.mtime = st->st_mtime;
+
+#ifdef HAVE_CHARSET
+    file_type_check_codeset ();
+#endif
+
+    if (file_type_cache == NULL)
+        file_type_cache =
+            g_hash_table_new_full (file_type_key_hash, file_type_key_equal, NULL,
+                                   file_type_entry_free);
+    else
+    {
+        entry = (file_type_entry_t *) g_hash_table_lookup (file_type_cache, &key);
+        if (entry != NULL)
+            return &entry->info;
+    }
+
+    buf = file_type_read_head (vpath, &len, mcerror);
+    if (buf == NULL)
+        return NULL;
+
+    truncated = st->st_size > (off_t) len;
+
+    entry = g_new0 (file_type_entry_t, 1);
+    entry->key = key;
+
+#ifdef HAVE_LIBMAGIC
+    {
+        const char *type;
+
+        type = file_type_magic (buf, len);
+        if (type != NULL)
+            entry->info.type = g_strdup (type);
+    }
+#endif
+    if (entry->info.type == NULL)
+        entry->info.type = file_type_guess (buf, len, truncated);
+
+#ifdef HAVE_CHARSET
+    if (is_autodetect_codeset_enabled)
+        entry->info.encoding = file_type_guess_encoding (buf, len, truncated, autodetect_codeset);
+#endif
+
+    g_free (buf);
+
+    if (g_hash_table_size (file_type_cache) >= FILE_TYPE_CACHE_MAX)
+        g_hash_table_remove_all (file_type_cache);
+    g_hash_table_insert (file_type_cache, &entry->key, entry);
+
+    return &entry->info;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+void
+file_type_flush (void)
+{
+    if (file_type_cache != NULL)
+    {
+        g_hash_table_destroy (file_type_cache);
+        file_type_cache = NULL;
+    }
+
+#ifdef HAVE_CHARSET
+    MC_PTR_FREE (file_type_cache_codeset);
+#endif
+
+#ifdef HAVE_LIBMAGIC
+    if (file_type_magic_cookie != NULL)
+    {
+        magic_close (file_type_magic_cookie);
+        file_type_magic_cookie = NULL;
+    }
+    file_type_magic_failed = FALSE;
+#endif
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,32 @@
+/** \file filetype.h
+ *  \brief Header: in-process detection of file types and encodings
+ */
+
+#pragma once
+
+#include <sys/stat.h>
+
+#include "lib/global.hpp"
+#include "lib/vfs/vfs.hpp"
+
+/*** typedefs(not structures) and defined constants **********************************************/
+
+/*** enums ***************************************************************************************/
+
+/*** structures declarations (and typedefs of structures)*****************************************/
+
+typedef struct
+{
+    char *type;                 /* description in the style of file(1) */
+    char *encoding;             /* charset name in the style of enca(1), NULL if not known */
+} file_type_t;
+
+/*** global variables defined in .c file *********************************************************/
+
+/*** declarations of public functions ************************************************************/
+
+const file_type_t *file_type_get (const vfs_path_t * vpath, const struct stat *st,
+                                  GError ** mcerror);
+void file_type_flush (void);
+
+/*** inline functions ****************************************************************************/
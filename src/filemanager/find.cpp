@@ -1795,18 +1795,16 @@ do_find (const char *start_dir, ssize_t start_dir_len, const char *ignore_dirs,
     {
         int i;
         struct stat st;
-        GList *entry;
+        WLEntry *le;
         dir_list *list = &current_panel->dir;
         char *name = NULL;
 
         panel_clean_dir (current_panel);
         dir_list_init (list);
 
-        for (i = 0, entry = listbox_get_first_link (find_list); entry != NULL;
-             i++, entry = g_list_next (entry))
+        for (i = 0; (le = listbox_get_nth_item (find_list, i)) != NULL; i++)
         {
             const char *lc_filename = NULL;
-            WLEntry *le = LENTRY (entry->data);
             find_match_location_t *location = static_cast<find_match_location_t *>(le->data);
             char *p;
             gboolean link_to_dir, stale_link;
@@ -1856,6 +1854,7 @@ do_find (const char *start_dir, ssize_t start_dir_len, const char *ignore_dirs,
             list->list[list->len].f.link_to_dir = link_to_dir ? 1 : 0;
             list->list[list->len].f.stale_link = stale_link ? 1 : 0;
             list->list[list->len].f.dir_size_computed = 0;
+            list->list[list->len].fhl_stamp = 0;
             list->list[list->len].st = st;
             list->list[list->len].sort_key = NULL;
             list->list[list->len].second_sort_key = NULL;
@@ -1456,6 +1456,36 @@ get_fs_usage (char const *file, char const *disk, struct fs_usage *fsp)
 }
 #endif /* HAVE_INFOMOUNT */
 
+#ifdef HAVE_INFOMOUNT_LIST
+/* --------------------------------------------------------------------------------------------- */
+/** Find the mount entry of the file system holding the path */
+
+static struct mount_entry *
+my_statfs_find_entry (const char *path)
+{
+    size_t len = 0;
+    struct mount_entry *entry = NULL;
+    GSList *temp;
+
+    for (temp = mc_mount_list; temp != NULL; temp = g_slist_next (temp))
+    {
+        struct mount_entry *me;
+        size_t i;
+
+        me = (struct mount_entry *) temp->data;
+        i = strlen (me->me_mountdir);
+        if (i > len && (strncmp (path, me->me_mountdir, i) == 0) &&
+            (entry == NULL || IS_PATH_SEP (path[i]) || path[i] == '\0'))
+        {
+            len = i;
+            entry = me;
+        }
+    }
+
+    return entry;
+}
+#endif /* HAVE_INFOMOUNT_LIST */
+
 /* --------------------------------------------------------------------------------------------- */
 /*** public functions ****************************************************************************/
 /* --------------------------------------------------------------------------------------------- */
@@ -1485,26 +1515,10 @@ void
 my_statfs (struct my_statfs *myfs_stats, const char *path)
 {
 #ifdef HAVE_INFOMOUNT_LIST
-    size_t len = 0;
-    struct mount_entry *entry = NULL;
-    GSList *temp;
+    struct mount_entry *entry;
     struct fs_usage fs_use;
 
-    for (temp = mc_mount_list; temp != NULL; temp = g_slist_next (temp))
-    {
-        struct mount_entry *me;
-        size_t i;
-
-        me = (struct mount_entry *) temp->data;
-        i = strlen (me->me_mountdir);
-        if (i > len && (strncmp (path, me->me_mountdir, i) == 0) &&
-            (entry == NULL || IS_PATH_SEP (path[i]) || path[i] == '\0'))
-        {
-            len = i;
-            entry = me;
-        }
-    }
-
+    entry = my_statfs_find_entry (path);
     if (entry != NULL)
     {
         memset (&fs_use, 0, sizeof (fs_use));
@@ -1564,3 +1578,27 @@ my_statfs (struct my_statfs *myfs_stats, const char *path)
 }
 
 /* --------------------------------------------------------------------------------------------- */
+/**
+ * Tell whether the path is on a disk of this machine. Network and FUSE file systems,
+ * and any file system when the mount list is not available, are not.
+ * The file system itself is not queried, so a hung server doesn't block the caller.
+ * init_my_statfs() must be called before.
+ */
+
+gboolean
+my_statfs_is_local (const char *path)
+{
+#ifdef HAVE_INFOMOUNT_LIST
+    const struct mount_entry *entry;
+
+    entry = my_statfs_find_entry (path);
+    return (entry != NULL && !entry->me_remote && !entry->me_dummy
+            && strncmp (entry->me_type, "fuse.", 5) != 0);
+#else
+    (void) path;
+
+    return FALSE;
+#endif /* HAVE_INFOMOUNT_LIST */
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -37,6 +37,7 @@ struct my_statfs
 void init_my_statfs (void);
 void my_statfs (struct my_statfs *myfs_stats, const char *path);
 void free_my_statfs (void);
+gboolean my_statfs_is_local (const char *path);
 
 /*** inline functions ****************************************************************************/
 
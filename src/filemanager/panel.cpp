@@ -66,14 +66,16 @@
 #include "src/usermenu.hpp"
 
 #include "dir.hpp"
+#include "dirwatch.hpp"
 #include "boxes.hpp"
 #include "tree.hpp"
 #include "ext.hpp"                /* regexp_command */
+#include "filetype.hpp"           /* file_type_get() */
 #include "layout.hpp"             /* Most layout variables are here */
 #include "cmd.hpp"
 #include "command.hpp"            /* cmdline */
 #include "midnight.hpp"
-#include "mountlist.hpp"          /* my_statfs */
+#include "mountlist.hpp"          /* my_statfs(), my_statfs_is_local() */
 
 #include "panel.hpp"
 
@@ -115,6 +117,9 @@ mc_fhl_t *mc_filehighlight = NULL;
 #define MARKED_SELECTED 3
 #define STATUS          5
 
+/* the cache of formatted lines is flushed when it grows bigger */
+#define PANEL_ROW_CACHE_MAX 1024
+
 /*** file scope type declarations ****************************************************************/
 
 typedef enum
@@ -148,6 +153,47 @@ typedef enum
     FILENAME_SCROLL_RIGHT = 4
 } filename_scroll_flag_t;
 
+typedef enum
+{
+    PANEL_CELL_TEXT = 0,
+    PANEL_CELL_PERM,            /* permission string with highlighted access bits */
+    PANEL_CELL_MODE,            /* octal mode with highlighted access bits */
+    PANEL_CELL_VLINE            /* column separator */
+} panel_cell_kind_t;
+
+/* One field of the formatted line */
+typedef struct
+{
+    panel_cell_kind_t kind;
+    int field_len;
+    char *text;                 /* already fitted to the field */
+} panel_cell_t;
+
+/*
+ * Formatted line of the file list. Colors are not a part of it: they are applied when
+ * the line is drawn, so moving the selection doesn't make the line stale. Marking does,
+ * because of the "mark" field.
+ * The line is valid while the file entry and the width don't change, the cache is
+ * flushed when the format or the options change.
+ */
+typedef struct
+{
+    /* what the line was made from */
+    char *fname;
+    struct stat st;
+    gboolean link_to_dir;
+    gboolean stale_link;
+    gboolean marked;            /* shown by the "mark" field */
+    int width;
+    int content_shift;
+
+    GArray *cells;              /* panel_cell_t */
+    int length;                 /* width of all cells */
+    int field_length;
+    int shift;                  /* part of file name out of the field or -1 */
+    filename_scroll_flag_t scroll;
+} panel_row_t;
+
 /*** file scope variables ************************************************************************/
 
 /* *INDENT-OFF* */
@@ -781,36 +827,68 @@ panel_items (const WPanel * p)
 }
 
 /* --------------------------------------------------------------------------------------------- */
-/** Formats the file number file_index of panel in the buffer dest */
 
-static filename_scroll_flag_t
-format_file (WPanel * panel, int file_index, int width, int attr, gboolean isstatus,
-             int *field_length)
+static void
+panel_row_free (gpointer data)
 {
-    int color = NORMAL_COLOR;
-    int length = 0;
-    GSList *format, *home;
-    file_entry_t *fe = NULL;
-    filename_scroll_flag_t res = FILENAME_NOSCROLL;
+    panel_row_t *row = (panel_row_t *) data;
+    guint i;
 
-    *field_length = 0;
+    for (i = 0; i < row->cells->len; i++)
+        g_free (g_array_index (row->cells, panel_cell_t, i).text);
+    g_array_free (row->cells, TRUE);
+    g_free (row->fname);
+    g_free (row);
+}
 
-    if (file_index < panel->dir.len)
-    {
-        fe = &panel->dir.list[file_index];
-        color = file_compute_color (attr, fe);
-    }
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+panel_row_cache_flush (WPanel * panel)
+{
+    if (panel->row_cache != NULL)
+        g_hash_table_remove_all (panel->row_cache);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+panel_row_is_valid (const WPanel * panel, const panel_row_t * row, const file_entry_t * fe,
+                    int width)
+{
+    return (row->width == width && row->content_shift == panel->content_shift
+            && row->link_to_dir == (gboolean) fe->f.link_to_dir
+            && row->stale_link == (gboolean) fe->f.stale_link
+            && row->marked == (gboolean) fe->f.marked
+            && memcmp (&row->st, &fe->st, sizeof (row->st)) == 0
+            && strcmp (row->fname, fe->fname) == 0);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Format the fields of the file entry fe (NULL for an empty line) into the row */
+
+static void
+panel_row_format (WPanel * panel, panel_row_t * row, file_entry_t * fe, int width,
+                  gboolean isstatus)
+{
+    GSList *format, *home;
+    int length = 0;
+
+    row->field_length = 0;
+    row->shift = -1;
+    row->scroll = FILENAME_NOSCROLL;
 
     home = isstatus ? panel->status_format : panel->format;
 
     for (format = home; format != NULL && length != width; format = g_slist_next (format))
     {
         format_item_t *fi = (format_item_t *) format->data;
+        panel_cell_t cell;
 
         if (fi->string_fn != NULL)
         {
             const char *txt = " ";
-            int len, perm = 0;
+            int len;
             const char *prepared_text;
             int name_offset = 0;
 
@@ -828,11 +906,11 @@ format_file (WPanel * panel, int file_index, int width, int attr, gboolean issta
                 int str_len;
                 int i;
 
-                *field_length = len + 1;
+                row->field_length = len + 1;
 
                 str_len = str_length (txt);
                 i = MAX (0, str_len - len);
-                panel->max_shift = MAX (panel->max_shift, i);
+                row->shift = MAX (row->shift, i);
                 i = MIN (panel->content_shift, i);
 
                 if (i > -1)
@@ -840,56 +918,163 @@ format_file (WPanel * panel, int file_index, int width, int attr, gboolean issta
                     name_offset = str_offset_to_pos (txt, i);
                     if (str_len > len)
                     {
-                        res = FILENAME_SCROLL_LEFT;
+                        row->scroll = FILENAME_SCROLL_LEFT;
                         if (str_length (txt + name_offset) > len)
-                            res = static_cast<filename_scroll_flag_t>(res | FILENAME_SCROLL_RIGHT);
+                            row->scroll =
+                                static_cast<filename_scroll_flag_t>(row->scroll | FILENAME_SCROLL_RIGHT);
                     }
                 }
             }
 
-            if (panels_options.permission_mode)
+            cell.kind = PANEL_CELL_TEXT;
+            if (panels_options.permission_mode && fe != NULL)
             {
                 if (strcmp (fi->id, "perm") == 0)
-                    perm = 1;
+                    cell.kind = PANEL_CELL_PERM;
                 else if (strcmp (fi->id, "mode") == 0)
-                    perm = 2;
+                    cell.kind = PANEL_CELL_MODE;
             }
 
-            if (color >= 0)
-                tty_setcolor (color);
-            else
-                tty_lowlevel_setcolor (-color);
-
             if (!isstatus && panel->content_shift > -1)
                 prepared_text = str_fit_to_term (txt + name_offset, len,
                         static_cast<align_crt_t>(HIDE_FIT (fi->just_mode)));
             else
                 prepared_text = str_fit_to_term (txt, len, fi->just_mode);
 
-            if (perm != 0 && fe != NULL)
-                add_permission_string (prepared_text, fi->field_len, fe, attr, color, perm != 1);
-            else
-                tty_print_string (prepared_text);
-
+            cell.field_len = fi->field_len;
+            cell.text = g_strdup (prepared_text);
             length += len;
         }
         else
         {
+            cell.kind = PANEL_CELL_VLINE;
+            cell.field_len = 1;
+            cell.text = NULL;
+            length++;
+        }
+
+        g_array_append_val (row->cells, cell);
+    }
+
+    row->length = length;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+panel_row_draw (const panel_row_t * row, file_entry_t * fe, int width, int attr, int color)
+{
+    guint i;
+
+    for (i = 0; i < row->cells->len; i++)
+    {
+        const panel_cell_t *cell = &g_array_index (row->cells, panel_cell_t, i);
+
+        switch (cell->kind)
+        {
+        case PANEL_CELL_VLINE:
             if (attr == SELECTED || attr == MARKED_SELECTED)
                 tty_setcolor (SELECTED_COLOR);
             else
                 tty_setcolor (NORMAL_COLOR);
             tty_print_one_vline (TRUE);
-            length++;
+            break;
+
+        case PANEL_CELL_PERM:
+        case PANEL_CELL_MODE:
+            add_permission_string (cell->text, cell->field_len, fe, attr, color,
+                                   cell->kind == PANEL_CELL_MODE);
+            break;
+
+        default:
+            if (color >= 0)
+                tty_setcolor (color);
+            else
+                tty_lowlevel_setcolor (-color);
+            tty_print_string (cell->text);
+            break;
         }
     }
 
-    if (length < width)
+    if (row->length < width)
     {
         int y, x;
 
         tty_getyx (&y, &x);
-        tty_draw_hline (y, x, ' ', width - length);
+        tty_draw_hline (y, x, ' ', width - row->length);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Formats the file number file_index of panel and draws it at the current position.
+ * Lines of the file list are cached: redrawing the panel after a move of the selection or
+ * a scroll only formats the files which were not shown before.
+ */
+
+static filename_scroll_flag_t
+format_file (WPanel * panel, int file_index, int width, int attr, gboolean isstatus,
+             int *field_length)
+{
+    int color = NORMAL_COLOR;
+    file_entry_t *fe = NULL;
+    panel_row_t *row = NULL;
+    filename_scroll_flag_t res;
+
+    if (file_index < panel->dir.len)
+    {
+        fe = &panel->dir.list[file_index];
+        color = file_compute_color (attr, fe);
+    }
+
+    if (!isstatus && fe != NULL)
+    {
+        if (panel->row_cache == NULL)
+            panel->row_cache =
+                g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, panel_row_free);
+
+        row = (panel_row_t *) g_hash_table_lookup (panel->row_cache,
+                                                   GINT_TO_POINTER (file_index));
+        if (row != NULL && !panel_row_is_valid (panel, row, fe, width))
+        {
+            g_hash_table_remove (panel->row_cache, GINT_TO_POINTER (file_index));
+            row = NULL;
+        }
+    }
+
+    if (row != NULL)
+    {
+        panel_row_draw (row, fe, width, attr, color);
+        panel->max_shift = MAX (panel->max_shift, row->shift);
+        *field_length = row->field_length;
+        return row->scroll;
+    }
+
+    row = g_new (panel_row_t, 1);
+    row->cells = g_array_new (FALSE, FALSE, sizeof (panel_cell_t));
+    row->fname = NULL;
+    panel_row_format (panel, row, fe, width, isstatus);
+
+    panel_row_draw (row, fe, width, attr, color);
+    panel->max_shift = MAX (panel->max_shift, row->shift);
+    *field_length = row->field_length;
+    res = row->scroll;
+
+    if (isstatus || fe == NULL)
+        panel_row_free (row);
+    else
+    {
+        row->fname = g_strdup (fe->fname);
+        row->st = fe->st;
+        row->link_to_dir = fe->f.link_to_dir;
+        row->stale_link = fe->f.stale_link;
+        row->marked = fe->f.marked;
+        row->width = width;
+        row->content_shift = panel->content_shift;
+
+        if (g_hash_table_size (panel->row_cache) >= PANEL_ROW_CACHE_MAX)
+            g_hash_table_remove_all (panel->row_cache);
+        g_hash_table_insert (panel->row_cache, GINT_TO_POINTER (file_index), row);
     }
 
     return res;
@@ -1033,6 +1218,86 @@ display_mini_info (WPanel * panel)
         repaint_file (panel, panel->selected, FALSE, STATUS, TRUE);
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Tell whether the directory of the panel is on a disk of this machine. Reading file
+ * heads from NFS, FUSE and other network mounts in the background could block the UI.
+ * The path is matched against the mount list as it is: resolving it would ask the
+ * file system, which may be the hung mount itself. The mount list is consulted again
+ * only when the directory changes.
+ */
+
+static gboolean
+panel_is_on_local_disk (int idx, const WPanel * panel)
+{
+    static char *checked_dir[2] = { NULL, NULL };
+    static gboolean local[2] = { FALSE, FALSE };
+    const char *dir;
+
+    dir = vfs_path_as_str (panel->cwd_vpath);
+
+    if (checked_dir[idx] == NULL || strcmp (checked_dir[idx], dir) != 0)
+    {
+        g_free (checked_dir[idx]);
+        checked_dir[idx] = g_strdup (dir);
+
+        init_my_statfs ();
+        local[idx] = my_statfs_is_local (dir);
+    }
+
+    return local[idx];
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Fill the file type cache for the visible rows of panels on local disks while the user
+ * is idle, so that Enter, F3 and F4 find the type/ rules of mc.ext already answered.
+ */
+
+static void
+panel_prefetch_types (void *data)
+{
+    int i;
+
+    (void) data;
+
+    delete_hook (&idle_hook, panel_prefetch_types);
+
+    for (i = 0; i < 2; i++)
+    {
+        WPanel *panel;
+        int n, last;
+
+        if (get_panel_type (i) != view_listing)
+            continue;
+
+        panel = PANEL (get_panel_widget (i));
+        if (!vfs_file_is_local (panel->cwd_vpath) || !panel_is_on_local_disk (i, panel))
+            continue;
+
+        last = MIN (panel->dir.len, panel->top_file + panel_items (panel));
+        for (n = panel->top_file; n < last; n++)
+        {
+            file_entry_t *fe = &panel->dir.list[n];
+            vfs_path_t *vpath;
+
+            if (!is_idle ())
+            {
+                /* go on when the user is idle again; rows done so far are cached */
+                add_hook (&idle_hook, panel_prefetch_types, NULL);
+                return;
+            }
+
+            if (!S_ISREG (fe->st.st_mode))
+                continue;
+
+            vpath = vfs_path_append_new (panel->cwd_vpath, fe->fname, (char *) NULL);
+            (void) file_type_get (vpath, &fe->st, NULL);
+            vfs_path_free (vpath);
+        }
+    }
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 static void
@@ -1059,6 +1324,9 @@ paint_dir (WPanel * panel)
     }
 
     tty_set_normal_attrs ();
+
+    if (use_file_to_check_type && !hook_present (idle_hook, panel_prefetch_types))
+        add_hook (&idle_hook, panel_prefetch_types, NULL);
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -1477,6 +1745,7 @@ panel_destroy (WPanel * p)
         g_free (name);
     }
 
+    dirwatch_remove (p);
     panel_clean_dir (p);
 
     /* clean history */
@@ -1490,6 +1759,8 @@ panel_destroy (WPanel * p)
 
     g_slist_free_full (p->format, (GDestroyNotify) format_item_free);
     g_slist_free_full (p->status_format, (GDestroyNotify) format_item_free);
+    if (p->row_cache != NULL)
+        g_hash_table_destroy (p->row_cache);
 
     g_free (p->user_format);
     for (i = 0; i < LIST_FORMATS; i++)
@@ -3281,6 +3552,8 @@ _do_panel_cd (WPanel * panel, const vfs_path_t * new_dir_vpath, enum cd_enum cd_
     /* Reload current panel */
     panel_clean_dir (panel);
 
+    /* watch first: a change made while the directory is being read is not lost */
+    dirwatch_add (panel);
     if (!dir_list_load (&panel->dir, panel->cwd_vpath, panel->sort_field->sort_routine,
                         &panel->sort_info, panel->filter))
         message (D_ERROR, MSG_ERROR, _("Cannot read directory contents"));
@@ -3997,6 +4270,7 @@ update_one_panel_widget (WPanel * panel, panel_update_flags_t flags, const char
         panel->is_panelized = FALSE;
         mc_setctl (panel->cwd_vpath, VFS_SETCTL_FLUSH, NULL);
         memset (&(panel->dir_stat), 0, sizeof (panel->dir_stat));
+        dirwatch_reset (panel);
     }
 
     /* If current_file == -1 (an invalid pointer) then preserve selection */
@@ -4014,6 +4288,8 @@ update_one_panel_widget (WPanel * panel, panel_update_flags_t flags, const char
         panel_reload (panel);
 
     try_to_select (panel, current_file);
+    /* options might be changed */
+    panel_row_cache_flush (panel);
     panel->dirty = 1;
 
     if (free_pointer)
@@ -4401,6 +4677,7 @@ panel_sized_with_dir_new (const char *panel_name, int y, int x, int lines, int c
     }
 
     /* Load the default format */
+    dirwatch_add (panel);
     if (!dir_list_load (&panel->dir, panel->cwd_vpath, panel->sort_field->sort_routine,
                         &panel->sort_info, panel->filter))
         message (D_ERROR, MSG_ERROR, _("Cannot read directory contents"));
@@ -4434,6 +4711,17 @@ panel_reload (WPanel * panel)
         && current_stat.st_mtime == panel->dir_stat.st_mtime)
         return;
 
+    /* only the entries reported by the kernel need to be looked at */
+    if (dirwatch_sync (panel))
+    {
+        panel->dirty = 1;
+        if (panel->selected >= panel->dir.len)
+            do_select (panel, panel->dir.len - 1);
+
+        recalculate_panel_summary (panel);
+        return;
+    }
+
     cwd_vpath = panel_recursive_cd_to_parent (panel->cwd_vpath);
     vfs_path_free (panel->cwd_vpath);
 
@@ -4449,6 +4737,7 @@ panel_reload (WPanel * panel)
     memset (&(panel->dir_stat), 0, sizeof (panel->dir_stat));
     show_dir (panel);
 
+    dirwatch_add (panel);
     if (!dir_list_reload (&panel->dir, panel->cwd_vpath, panel->sort_field->sort_routine,
                           &panel->sort_info, panel->filter))
         message (D_ERROR, MSG_ERROR, _("Cannot read directory contents"));
@@ -4502,6 +4791,7 @@ set_panel_formats (WPanel * p)
     }
 
     panel_update_cols (WIDGET (p), p->frame_size);
+    panel_row_cache_flush (p);
 
     if (retcode)
         message (D_ERROR, _("Warning"),
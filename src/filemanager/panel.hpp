@@ -137,6 +137,8 @@ typedef struct
     int search_chpoint;         /*point after last characters in search_char */
     int content_shift;          /* Number of characters of filename need to skip from left side. */
     int max_shift;              /* Max shift for visible part of current panel */
+
+    GHashTable *row_cache;      /* file index -> formatted line of the file list */
 } WPanel;
 
 /*** global variables defined in .c file *********************************************************/
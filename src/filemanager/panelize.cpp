@@ -419,6 +419,7 @@ do_panelize_cd (WPanel * panel)
         list->list[i].f.stale_link = panelized_panel.list.list[i].f.stale_link;
         list->list[i].f.dir_size_computed = panelized_panel.list.list[i].f.dir_size_computed;
         list->list[i].f.marked = panelized_panel.list.list[i].f.marked;
+        list->list[i].fhl_stamp = 0;
         list->list[i].st = panelized_panel.list.list[i].st;
         list->list[i].sort_key = panelized_panel.list.list[i].sort_key;
         list->list[i].second_sort_key = panelized_panel.list.list[i].second_sort_key;
@@ -473,6 +474,7 @@ panelize_save_panel (WPanel * panel)
         panelized_panel.list.list[i].f.stale_link = list->list[i].f.stale_link;
         panelized_panel.list.list[i].f.dir_size_computed = list->list[i].f.dir_size_computed;
         panelized_panel.list.list[i].f.marked = list->list[i].f.marked;
+        panelized_panel.list.list[i].fhl_stamp = 0;
         panelized_panel.list.list[i].st = list->list[i].st;
         panelized_panel.list.list[i].sort_key = list->list[i].sort_key;
         panelized_panel.list.list[i].second_sort_key = list->list[i].second_sort_key;
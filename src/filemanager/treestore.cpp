@@ -161,6 +161,35 @@ pathcmp (const vfs_path_t * p1_vpath, const vfs_path_t * p2_vpath)
 
 /* --------------------------------------------------------------------------------------------- */
 
+static int
+tree_entry_cmp (gconstpointer a, gconstpointer b, gpointer user_data)
+{
+    (void) user_data;
+
+    return pathcmp (static_cast<const tree_entry *>(a)->name,
+                    static_cast<const tree_entry *>(b)->name);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Find the index position of the entry with the given name.
+  *
+  * @return iterator of the entry or NULL if there is no such entry
+  */
+
+static GSequenceIter *
+tree_store_lookup (const vfs_path_t * name)
+{
+    tree_entry key;
+
+    if (ts.index == NULL)
+        return NULL;
+
+    key.name = const_cast<vfs_path_t *>(name);
+    return g_sequence_lookup (ts.index, &key, tree_entry_cmp, NULL);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
 static char *
 decode (char *buffer)
 {
@@ -381,64 +410,50 @@ tree_store_save_to (char *name)
 static tree_entry *
 tree_store_add_entry (const vfs_path_t * name)
 {
-    int flag = -1;
-    tree_entry *current;
+    GSequenceIter *iter;
     tree_entry *old = NULL;
     tree_entry *New;
+    tree_entry *current;
     int submask = 0;
 
     if (ts.tree_last != NULL && ts.tree_last->next != NULL)
         abort ();
 
-    /* Search for the correct place */
-    for (current = ts.tree_first;
-         current != NULL && (flag = pathcmp (current->name, name)) < 0; current = current->next)
-        old = current;
+    iter = tree_store_lookup (name);
+    if (iter != NULL)
+        return static_cast<tree_entry *>(g_sequence_get (iter));       /* Already in the list */
 
-    if (flag == 0)
-        return current;         /* Already in the list */
+    if (ts.index == NULL)
+        ts.index = g_sequence_new (NULL);
 
     /* Not in the list -> add it */
     New = g_new0 (tree_entry, 1);
-    if (current == NULL)
+    New->name = vfs_path_clone (name);
+
+    /* Find the correct place: the index gives the neighbour in O(log n) */
+    iter = g_sequence_insert_sorted (ts.index, New, tree_entry_cmp, NULL);
+    if (!g_sequence_iter_is_begin (iter))
+        old = static_cast<tree_entry *>(g_sequence_get (g_sequence_iter_prev (iter)));
+
+    New->prev = old;
+    if (old != NULL)
     {
-        /* Append to the end of the list */
-        if (ts.tree_first == NULL)
-        {
-            /* Empty list */
-            ts.tree_first = New;
-            New->prev = NULL;
-        }
-        else
-        {
-            if (old != NULL)
-                old->next = New;
-            New->prev = old;
-        }
-        New->next = NULL;
-        ts.tree_last = New;
+        New->next = old->next;
+        old->next = New;
     }
     else
     {
-        /* Insert in to the middle of the list */
-        New->prev = old;
-        if (old != NULL)
-        {
-            /* Yes, in the middle */
-            New->next = old->next;
-            old->next = New;
-        }
-        else
-        {
-            /* Nope, in the beginning of the list */
-            New->next = ts.tree_first;
-            ts.tree_first = New;
-        }
-        New->next->prev = New;
+        /* In the beginning of the list */
+        New->next = ts.tree_first;
+        ts.tree_first = New;
     }
 
+    if (New->next != NULL)
+        New->next->prev = New;
+    else
+        ts.tree_last = New;
+
     /* Calculate attributes */
-    New->name = vfs_path_clone (name);
     New->sublevel = vfs_path_tokens_count (New->name);
 
     {
@@ -493,9 +508,14 @@ remove_entry (tree_entry * entry)
     tree_entry *current = entry->prev;
     long submask = 0;
     tree_entry *ret = NULL;
+    GSequenceIter *iter;
 
     tree_store_notify_remove (entry);
 
+    iter = tree_store_lookup (entry->name);
+    if (iter != NULL)
+        g_sequence_remove (iter);
+
     /* Correct the submasks of the previous entries */
     if (entry->next != NULL)
         submask = entry->next->submask;
@@ -595,14 +615,11 @@ should_skip_directory (const vfs_path_t * vpath)
 tree_entry *
 tree_store_whereis (const vfs_path_t * name)
 {
-    tree_entry *current;
-    int flag = -1;
+    GSequenceIter *iter;
 
-    for (current = ts.tree_first;
-         current != NULL && (flag = pathcmp (current->name, name)) < 0; current = current->next)
-        ;
+    iter = tree_store_lookup (name);
 
-    return flag == 0 ? current : NULL;
+    return iter == NULL ? NULL : static_cast<tree_entry *>(g_sequence_get (iter));
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -730,7 +747,6 @@ tree_store_mark_checked (const char *subname)
 {
     vfs_path_t *name;
     tree_entry *current, *base;
-    int flag = 1;
     const char *cname;
 
     if (!ts.loaded)
@@ -750,11 +766,9 @@ tree_store_mark_checked (const char *subname)
         name = vfs_path_append_new (ts.check_name, subname, (char *) NULL);
 
     /* Search for the subdirectory */
-    for (current = ts.check_start;
-         current != NULL && (flag = pathcmp (current->name, name)) < 0; current = current->next)
-        ;
+    current = tree_store_whereis (name);
 
-    if (flag != 0)
+    if (current == NULL)
     {
         /* Doesn't exist -> add it */
         current = tree_store_add_entry (name);
@@ -34,6 +34,7 @@ struct TreeStore
 {
     tree_entry *tree_first;     /* First entry in the list */
     tree_entry *tree_last;      /* Last entry in the list */
+    GSequence *index;           /* The same entries in a balanced tree ordered by pathcmp() */
     tree_entry *check_start;    /* Start of checked subdirectories */
     vfs_path_t *check_name;
     GList *add_queue_vpath;     /* List of vfs_path_t objects of added directories */
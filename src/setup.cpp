@@ -374,6 +374,7 @@ static const struct
     { "double_click_speed", &double_click_speed },
     { "old_esc_mode_timeout", &old_esc_mode_timeout },
     { "max_dirt_limit", &mcview_max_dirt_limit },
+    { "viewer_growbuf_mem_limit", &mcview_growbuf_mem_limit },
     { "num_history_items_recorded", &num_history_items_recorded },
 #ifdef ENABLE_VFS
     { "vfs_timeout", &vfs_timeout },
@@ -181,6 +181,10 @@ gboolean ftpfs_ignore_chattr_errors = TRUE;
 #define TYPE_UNKNOWN -1
 
 #define ABORT_TIMEOUT 5
+
+/* control connections to one server: the current one, idle ones and those
+   lent to open file handles while their transfers run */
+#define FTPFS_MAX_CONNECTIONS 4
 /*** file scope type declarations ****************************************************************/
 
 #ifndef HAVE_SOCKLEN_T
@@ -201,6 +205,14 @@ typedef enum
     NETRC_UNKNOWN
 } keyword_t;
 
+/* a logged in control connection that is not the current one of its super */
+typedef struct
+{
+    int sock;
+    int isbinary;
+    char *current_dir;
+} ftp_conn_t;
+
 typedef struct
 {
     struct vfs_s_super base;    /* base class */
@@ -220,6 +232,9 @@ typedef struct
                                  */
     gboolean ctl_connection_busy;
     char *current_dir;
+    gboolean use_mlst;          /* FEAT advertises MLST, and so MLSD */
+    GSList *idle;               /* ftp_conn_t: logged in connections ready for reuse */
+    int connections;            /* all connections, including the ones of file handles */
 } ftp_super_t;
 
 typedef struct
@@ -228,6 +243,7 @@ typedef struct
 
     int sock;
     gboolean append;
+    ftp_conn_t ctl;             /* control connection of the running transfer */
 } ftp_file_handler_t;
 
 /*** file scope variables ************************************************************************/
@@ -437,6 +453,65 @@ ftpfs_get_reply (struct vfs_class *me, int sock, char *string_buf, int string_le
     }
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/* Like ftpfs_get_reply(), but keeps the inner lines of a multi-line reply:
+   they carry the payload of FEAT and MLST */
+
+static int
+ftpfs_get_reply_lines (struct vfs_class *me, int sock, GSList ** lines)
+{
+    char answer[BUF_1K];
+    int n;
+
+    *lines = NULL;
+
+    do
+    {
+        if (vfs_s_get_line (me, sock, answer, sizeof (answer), '\n') == 0)
+        {
+            code = 421;
+            return 4;
+        }
+
+        /* cppcheck-suppress invalidscanf */
+        n = sscanf (answer, "%d", &code);
+    }
+    while (n != 0 && n != 1);
+
+    if (n == 0)
+    {
+        code = 500;
+        return 5;
+    }
+
+    if (strlen (answer) > 3 && answer[3] == '-')
+        while (TRUE)
+        {
+            size_t len;
+            int i;
+
+            if (vfs_s_get_line (me, sock, answer, sizeof (answer), '\n') == 0)
+            {
+                g_slist_free_full (*lines, g_free);
+                *lines = NULL;
+                code = 421;
+                return 4;
+            }
+
+            /* cppcheck-suppress invalidscanf */
+            if ((sscanf (answer, "%d", &i) > 0) && (code == i) && (answer[3] == ' '))
+                break;
+
+            len = strlen (answer);
+            if (len != 0 && answer[len - 1] == '\r')
+                answer[len - 1] = '\0';
+            *lines = g_slist_prepend (*lines, g_strdup (answer));
+        }
+
+    *lines = g_slist_reverse (*lines);
+    return code / 100;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 static gboolean
@@ -470,6 +545,143 @@ ftpfs_reconnect (struct vfs_class *me, struct vfs_s_super *super)
     return FALSE;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/* Take the current control connection away from the super */
+
+static void
+ftpfs_conn_detach (ftp_super_t * ftp_super, ftp_conn_t * conn)
+{
+    conn->sock = ftp_super->sock;
+    conn->isbinary = ftp_super->isbinary;
+    conn->current_dir = ftp_super->current_dir;
+
+    ftp_super->sock = -1;
+    ftp_super->isbinary = TYPE_UNKNOWN;
+    ftp_super->current_dir = NULL;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/* Make conn the current control connection of the super, which must have none */
+
+static void
+ftpfs_conn_attach (ftp_super_t * ftp_super, ftp_conn_t * conn)
+{
+    ftp_super->sock = conn->sock;
+    ftp_super->isbinary = conn->isbinary;
+    ftp_super->current_dir = conn->current_dir;
+
+    conn->sock = -1;
+    conn->isbinary = TYPE_UNKNOWN;
+    conn->current_dir = NULL;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+ftpfs_conn_close (ftp_super_t * ftp_super, ftp_conn_t * conn)
+{
+    static const char quit[] = "QUIT\r\n";
+    ssize_t ret;
+
+    ret = write (conn->sock, quit, sizeof (quit) - 1);
+    (void) ret;
+    close (conn->sock);
+    conn->sock = -1;
+    MC_PTR_FREE (conn->current_dir);
+    ftp_super->connections--;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/* An idle control connection has nothing to say: EOF or an unsolicited reply
+   (usually "421 Timeout") means that the server has dropped it */
+
+static gboolean
+ftpfs_conn_is_alive (int sock)
+{
+    fd_set mask;
+    struct timeval tv = { 0, 0 };
+
+    FD_ZERO (&mask);
+    FD_SET (sock, &mask);
+
+    return (select (sock + 1, &mask, NULL, NULL, &tv) == 0);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/* Give the super a current control connection: an idle one if there is any,
+   a new one otherwise */
+
+static gboolean
+ftpfs_conn_acquire (struct vfs_class *me, struct vfs_s_super *super)
+{
+    ftp_super_t *ftp_super = FTP_SUPER (super);
+
+    while (ftp_super->idle != NULL)
+    {
+        ftp_conn_t *conn = (ftp_conn_t *) ftp_super->idle->data;
+
+        ftp_super->idle = g_slist_delete_link (ftp_super->idle, ftp_super->idle);
+        ftpfs_conn_attach (ftp_super, conn);
+        g_free (conn);
+
+        /* a dropped connection is replaced by a new one in the same directory */
+        if (ftpfs_conn_is_alive (ftp_super->sock) || ftpfs_reconnect (me, super))
+            return TRUE;
+
+        close (ftp_super->sock);
+        ftp_super->sock = -1;
+        MC_PTR_FREE (ftp_super->current_dir);
+        ftp_super->connections--;
+    }
+
+    if (ftp_super->connections >= FTPFS_MAX_CONNECTIONS)
+    {
+        vfs_print_message (_("ftpfs: too many connections to %s"), super->path_element->host);
+        ERRNOR (EAGAIN, FALSE);
+    }
+
+    ftp_super->sock = ftpfs_open_socket (me, super);
+    if (ftp_super->sock == -1)
+        return FALSE;
+
+    ftp_super->connections++;
+
+    if (ftpfs_login_server (me, super, super->path_element->password))
+        return TRUE;
+
+    close (ftp_super->sock);
+    ftp_super->sock = -1;
+    ftp_super->connections--;
+    return FALSE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/* Return the control connection of a finished transfer to the super */
+
+static void
+ftpfs_conn_release (struct vfs_s_super *super, ftp_conn_t * conn, gboolean reusable)
+{
+    ftp_super_t *ftp_super = FTP_SUPER (super);
+
+    if (conn->sock == -1)
+        return;
+
+    if (!reusable)
+        ftpfs_conn_close (ftp_super, conn);
+    else if (ftp_super->sock == -1)
+        ftpfs_conn_attach (ftp_super, conn);
+    else
+    {
+        ftp_conn_t *idle;
+
+        idle = g_new (ftp_conn_t, 1);
+        *idle = *conn;
+        conn->sock = -1;
+        conn->current_dir = NULL;
+        ftp_super->idle = g_slist_prepend (ftp_super->idle, idle);
+    }
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 static int
@@ -484,6 +696,13 @@ ftpfs_command (struct vfs_class *me, struct vfs_s_super *super, int wait_reply,
     static gboolean retry = FALSE;
     static int level = 0;       /* ftpfs_login_server() use ftpfs_command() */
 
+    /* the current connection is lent to a running transfer */
+    if (ftp_super->sock == -1 && !ftpfs_conn_acquire (me, super))
+    {
+        code = 421;
+        return TRANSIENT;
+    }
+
     cmdstr = g_string_sized_new (32);
     va_start (ap, fmt);
     g_string_vprintf (cmdstr, fmt, ap);
@@ -591,6 +810,15 @@ ftpfs_free_archive (struct vfs_class *me, struct vfs_s_super *super)
         close (ftp_super->sock);
     }
     g_free (ftp_super->current_dir);
+
+    while (ftp_super->idle != NULL)
+    {
+        ftp_conn_t *conn = (ftp_conn_t *) ftp_super->idle->data;
+
+        ftpfs_conn_close (ftp_super, conn);
+        g_free (conn);
+        ftp_super->idle = g_slist_delete_link (ftp_super->idle, ftp_super->idle);
+    }
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -949,6 +1177,43 @@ ftpfs_open_socket (struct vfs_class *me, struct vfs_s_super *super)
     return my_socket;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/* Ask the server for its extensions (RFC 2389) and remember the ones we use */
+
+static void
+ftpfs_get_features (struct vfs_class *me, struct vfs_s_super *super)
+{
+    ftp_super_t *ftp_super = FTP_SUPER (super);
+    GSList *lines = NULL;
+    GSList *l;
+
+    ftp_super->use_mlst = FALSE;
+
+    if (ftpfs_command (me, super, NONE, "%s", "FEAT") != COMPLETE
+        || ftpfs_get_reply_lines (me, ftp_super->sock, &lines) != COMPLETE)
+        return;
+
+    for (l = lines; l != NULL; l = g_slist_next (l))
+    {
+        const char *feat = (const char *) l->data;
+
+        while (*feat == ' ')
+            feat++;
+
+        /* MLST implies MLSD */
+        if (g_ascii_strncasecmp (feat, "MLST", 4) == 0 && (feat[4] == '\0' || feat[4] == ' '))
+            ftp_super->use_mlst = TRUE;
+    }
+
+    g_slist_free_full (lines, g_free);
+
+    if (me->logfile != NULL)
+    {
+        fprintf (me->logfile, "MC -- use_mlst = %s\n", ftp_super->use_mlst ? "yes" : "no");
+        fflush (me->logfile);
+    }
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 static int
@@ -969,6 +1234,8 @@ ftpfs_open_archive_int (struct vfs_class *me, struct vfs_s_super *super)
         if (ftp_super->sock == -1)
             return (-1);
 
+        ftp_super->connections = 1;
+
         if (ftpfs_login_server (me, super, NULL))
         {
             /* Logged in, no need to retry the connection */
@@ -1003,6 +1270,8 @@ ftpfs_open_archive_int (struct vfs_class *me, struct vfs_s_super *super)
     }
     while (retry_seconds != 0);
 
+    ftpfs_get_features (me, super);
+
     ftp_super->current_dir = ftpfs_get_current_directory (me, super);
     if (ftp_super->current_dir == NULL)
         ftp_super->current_dir = g_strdup (PATH_SEP_STR);
@@ -1390,6 +1659,10 @@ ftpfs_open_data_connection (struct vfs_class *me, struct vfs_s_super *super, con
     if (ftp_super->ctl_connection_busy)
         return (-1);
 
+    /* the data connection is set up from the address of the control one */
+    if (ftp_super->sock == -1 && !ftpfs_conn_acquire (me, super))
+        return (-1);
+
     s = ftpfs_initconn (me, super);
     if (s == -1)
         return (-1);
@@ -1457,13 +1730,25 @@ ftpfs_linear_abort (struct vfs_class *me, vfs_file_handler_t * fh)
 {
     struct vfs_s_super *super = VFS_FILE_HANDLER_SUPER (fh);
     ftp_super_t *ftp_super = FTP_SUPER (super);
+    ftp_conn_t *ctl = &FTP_FILE_HANDLER (fh)->ctl;
+    ftp_conn_t current;
     static unsigned char const ipbuf[3] = { IAC, IP, IAC };
     fd_set mask;
     int dsock = FH_SOCK;
+    gboolean lent;
 
     FH_SOCK = -1;
     ftp_super->ctl_connection_busy = FALSE;
 
+    /* the transfer runs on the control connection lent to the file handle:
+       make it the current one until the server has acknowledged ABOR */
+    lent = ctl->sock != -1;
+    if (lent)
+    {
+        ftpfs_conn_detach (ftp_super, &current);
+        ftpfs_conn_attach (ftp_super, ctl);
+    }
+
     vfs_print_message ("%s", _("ftpfs: aborting transfer."));
 
     if (send (ftp_super->sock, ipbuf, sizeof (ipbuf), MSG_OOB) != sizeof (ipbuf))
@@ -1471,7 +1756,7 @@ ftpfs_linear_abort (struct vfs_class *me, vfs_file_handler_t * fh)
         vfs_print_message (_("ftpfs: abort error: %s"), unix_error_string (errno));
         if (dsock != -1)
             close (dsock);
-        return;
+        goto done;
     }
 
     if (ftpfs_command (me, super, NONE, "%cABOR", DM) != COMPLETE)
@@ -1479,7 +1764,7 @@ ftpfs_linear_abort (struct vfs_class *me, vfs_file_handler_t * fh)
         vfs_print_message ("%s", _("ftpfs: abort failed"));
         if (dsock != -1)
             close (dsock);
-        return;
+        goto done;
     }
 
     if (dsock != -1)
@@ -1503,8 +1788,9 @@ ftpfs_linear_abort (struct vfs_class *me, vfs_file_handler_t * fh)
                 {
                     /* server keeps sending, drop the connection and ftpfs_reconnect */
                     close (dsock);
-                    ftpfs_reconnect (me, super);
-                    return;
+                    if (!lent)
+                        ftpfs_reconnect (me, super);
+                    goto done;
                 }
             }
         }
@@ -1513,6 +1799,16 @@ ftpfs_linear_abort (struct vfs_class *me, vfs_file_handler_t * fh)
 
     if ((ftpfs_get_reply (me, ftp_super->sock, NULL, 0) == TRANSIENT) && (code == 426))
         ftpfs_get_reply (me, ftp_super->sock, NULL, 0);
+
+  done:
+    if (lent)
+    {
+        /* The server may or may not have sent the reply to the transfer
+           besides the one to ABOR: don't trust the connection any more */
+        ftpfs_conn_detach (ftp_super, ctl);
+        ftpfs_conn_attach (ftp_super, &current);
+        ftpfs_conn_release (super, ctl, FALSE);
+    }
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -1717,6 +2013,256 @@ resolve_symlink (struct vfs_class *me, struct vfs_s_super *super, struct vfs_s_i
 }
 #endif
 
+/* --------------------------------------------------------------------------------------------- */
+/* MLSx times are UTC: YYYYMMDDHHMMSS[.sss] */
+
+static gboolean
+ftpfs_parse_mlsx_time (const char *value, time_t * t)
+{
+    int year, mon, day, hour, min, sec;
+    GDateTime *dt;
+
+    /* cppcheck-suppress invalidscanf */
+    if (sscanf (value, "%4d%2d%2d%2d%2d%2d", &year, &mon, &day, &hour, &min, &sec) != 6)
+        return FALSE;
+
+    dt = g_date_time_new_utc (year, mon, day, hour, min, sec);
+    if (dt == NULL)
+        return FALSE;
+
+    *t = (time_t) g_date_time_to_unix (dt);
+    g_date_time_unref (dt);
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/* Parse a line of a MLSD listing or the fact line of a MLST reply (RFC 3659):
+   "fact=value;fact=value; name". Returns FALSE for lines that don't describe
+   an entry, including the "." and ".." ones. */
+
+static gboolean
+ftpfs_parse_mlsx_line (const char *line, struct stat *s, char **filename, char **linkname)
+{
+    const char *name;
+    char *facts, *fact, *next;
+    mode_t type = S_IFREG;
+    mode_t perms = 0;
+    gboolean have_perms = FALSE;
+    char *target = NULL;
+    size_t len;
+
+    name = strchr (line, ' ');
+    if (name == NULL || name == line || name[1] == '\0')
+        return FALSE;
+
+    facts = g_strndup (line, name - line);
+    name++;
+
+    for (fact = facts; fact != NULL && *fact != '\0'; fact = next)
+    {
+        char *value;
+
+        next = strchr (fact, ';');
+        if (next != NULL)
+            *next++ = '\0';
+
+        value = strchr (fact, '=');
+        if (value == NULL)
+            continue;
+        *value++ = '\0';
+
+        if (g_ascii_strcasecmp (fact, "type") == 0)
+        {
+            if (g_ascii_strcasecmp (value, "dir") == 0)
+                type = S_IFDIR;
+            else if (g_ascii_strcasecmp (value, "cdir") == 0
+                     || g_ascii_strcasecmp (value, "pdir") == 0)
+            {
+                g_free (target);
+                g_free (facts);
+                return FALSE;
+            }
+            else if (g_ascii_strncasecmp (value, "OS.unix=slink:", 14) == 0 && value[14] != '\0')
+            {
+                type = S_IFLNK;
+                g_free (target);
+                target = g_strdup (value + 14);
+            }
+            else
+                /* "file", and also devices and links without target we can't handle */
+                type = S_IFREG;
+        }
+        else if (g_ascii_strcasecmp (fact, "size") == 0)
+            s->st_size = (off_t) g_ascii_strtoll (value, NULL, 10);
+        else if (g_ascii_strcasecmp (fact, "modify") == 0)
+            ftpfs_parse_mlsx_time (value, &s->st_mtime);
+        else if (g_ascii_strcasecmp (fact, "UNIX.mode") == 0)
+        {
+            perms = (mode_t) strtoul (value, NULL, 8) & 07777;
+            have_perms = TRUE;
+        }
+        else if (g_ascii_strcasecmp (fact, "UNIX.uid") == 0
+                 || g_ascii_strcasecmp (fact, "UNIX.owner") == 0)
+            s->st_uid = isdigit ((unsigned char) *value) ? (uid_t) atol (value) : vfs_finduid (value);
+        else if (g_ascii_strcasecmp (fact, "UNIX.gid") == 0
+                 || g_ascii_strcasecmp (fact, "UNIX.group") == 0)
+            s->st_gid = isdigit ((unsigned char) *value) ? (gid_t) atol (value) : vfs_findgid (value);
+    }
+
+    g_free (facts);
+
+    if (!have_perms)
+        switch (type)
+        {
+        case S_IFDIR:
+            perms = 0755;
+            break;
+        case S_IFLNK:
+            perms = 0777;
+            break;
+        default:
+            perms = 0644;
+            break;
+        }
+
+    s->st_mode = type | perms;
+    s->st_nlink = 1;
+    if (type != S_IFREG)
+        s->st_size = 0;
+#ifdef HAVE_STRUCT_STAT_ST_RDEV
+    s->st_rdev = 0;
+#endif
+    s->st_atime = s->st_ctime = s->st_mtime;
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+    s->st_atim.tv_nsec = s->st_mtim.tv_nsec = s->st_ctim.tv_nsec = 0;
+#endif
+#ifdef HAVE_STRUCT_STAT_ST_BLKSIZE
+    s->st_blksize = 512;
+#endif
+    vfs_adjust_stat (s);
+
+    len = strlen (name);
+    if (len != 0 && name[len - 1] == '\r')
+        len--;
+
+    if (filename != NULL)
+        *filename = g_strndup (name, len);
+    if (linkname != NULL)
+        *linkname = target;
+    else
+        g_free (target);
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/* Read a directory with MLSD.
+   Returns 0 on success, -1 on error and 1 if the server doesn't know MLSD after all. */
+
+static int
+ftpfs_dir_load_mlsd (struct vfs_class *me, struct vfs_s_inode *dir, const char *remote_path)
+{
+    struct vfs_s_super *super = dir->super;
+    ftp_super_t *ftp_super = FTP_SUPER (super);
+    int sock;
+
+    vfs_print_message (_("ftpfs: Reading FTP directory %s... %s%s"), remote_path, "", "");
+
+    gettimeofday (&dir->timestamp, NULL);
+    dir->timestamp.tv_sec += ftpfs_directory_timeout;
+
+    sock = ftpfs_open_data_connection (me, super, "MLSD", remote_path, TYPE_ASCII, 0);
+    if (sock == -1)
+    {
+        char *p;
+        GSList *lines = NULL;
+        int r;
+
+        /* syntax error, not implemented */
+        if (code == 500 || code == 502 || code == 504)
+            return 1;
+
+        if (code / 100 != 5)
+        {
+            vfs_print_message (_("%s: failure"), me->name);
+            ERRNOR (EIO, -1);
+        }
+
+        /* The path is not a readable directory: ask MLST what it is */
+        p = ftpfs_translate_path (me, super, remote_path);
+        r = ftpfs_command (me, super, NONE, "MLST /%s", IS_PATH_SEP (*p) ? p + 1 : p);
+        g_free (p);
+        if (r == COMPLETE)
+            r = ftpfs_get_reply_lines (me, ftp_super->sock, &lines);
+
+        me->verrno = ENOENT;
+        if (r == COMPLETE && lines != NULL)
+        {
+            const char *facts = (const char *) lines->data;
+            struct stat st;
+
+            while (*facts == ' ')
+                facts++;
+
+            memset (&st, 0, sizeof (st));
+            if (ftpfs_parse_mlsx_line (facts, &st, NULL, NULL))
+                me->verrno = S_ISDIR (st.st_mode) ? EACCES : ENOTDIR;
+        }
+        g_slist_free_full (lines, g_free);
+
+        vfs_print_message (_("%s: failure"), me->name);
+        return (-1);
+    }
+
+    while (TRUE)
+    {
+        int res;
+        char lc_buffer[BUF_8K] = "\0";
+        struct vfs_s_entry *ent;
+        int i;
+
+        res = vfs_s_get_line_interruptible (me, lc_buffer, sizeof (lc_buffer), sock);
+        if (res == 0)
+            break;
+
+        if (res == EINTR)
+        {
+            me->verrno = ECONNRESET;
+            close (sock);
+            ftp_super->ctl_connection_busy = FALSE;
+            ftpfs_get_reply (me, ftp_super->sock, NULL, 0);
+            vfs_print_message (_("%s: failure"), me->name);
+            return (-1);
+        }
+
+        if (me->logfile != NULL)
+        {
+            fputs (lc_buffer, me->logfile);
+            fputs ("\n", me->logfile);
+            fflush (me->logfile);
+        }
+
+        ent = vfs_s_generate_entry (me, NULL, dir, 0);
+        i = ent->ino->st.st_nlink;
+
+        if (!ftpfs_parse_mlsx_line (lc_buffer, &ent->ino->st, &ent->name, &ent->ino->linkname))
+            vfs_s_free_entry (me, ent);
+        else
+        {
+            ent->ino->st.st_nlink = i;  /* Ouch, we need to preserve our counts :-( */
+            vfs_s_insert_entry (me, dir, ent);
+        }
+    }
+
+    close (sock);
+    ftp_super->ctl_connection_busy = FALSE;
+    if (ftpfs_get_reply (me, ftp_super->sock, NULL, 0) != COMPLETE)
+        ERRNOR (E_REMOTE, -1);
+
+    vfs_print_message (_("%s: done."), me->name);
+    return 0;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 static int
@@ -1728,6 +2274,18 @@ ftpfs_dir_load (struct vfs_class *me, struct vfs_s_inode *dir, char *remote_path
     int sock, num_entries = 0;
     gboolean cd_first;
 
+    if (ftp_super->use_mlst)
+    {
+        int res;
+
+        res = ftpfs_dir_load_mlsd (me, dir, remote_path);
+        if (res <= 0)
+            return res;
+
+        /* FEAT promised too much */
+        ftp_super->use_mlst = FALSE;
+    }
+
     cd_first = ftpfs_first_cd_then_ls || (ftp_super->strict == RFC_STRICT)
         || (strchr (remote_path, ' ') != NULL);
 
@@ -1964,6 +2522,19 @@ ftpfs_file_store (struct vfs_class *me, vfs_file_handler_t * fh, char *name, cha
     return (-1);
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/* Lend the control connection that carries a just started transfer to the file handle,
+   so that other requests to the server don't have to wait for the transfer to end */
+
+static void
+ftpfs_fh_take_connection (vfs_file_handler_t * fh)
+{
+    ftp_super_t *ftp_super = FTP_SUPER (VFS_FILE_HANDLER_SUPER (fh));
+
+    ftpfs_conn_detach (ftp_super, &FTP_FILE_HANDLER (fh)->ctl);
+    ftp_super->ctl_connection_busy = FALSE;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 static int
@@ -1982,6 +2553,7 @@ ftpfs_linear_start (struct vfs_class *me, vfs_file_handler_t * fh, off_t offset)
     if (FH_SOCK == -1)
         ERRNOR (EACCES, 0);
 
+    ftpfs_fh_take_connection (fh);
     fh->linear = LS_LINEAR_OPEN;
     FTP_FILE_HANDLER (fh)->append = FALSE;
     return 1;
@@ -1994,6 +2566,7 @@ ftpfs_linear_read (struct vfs_class *me, vfs_file_handler_t * fh, void *buf, siz
 {
     ssize_t n;
     struct vfs_s_super *super = VFS_FILE_HANDLER_SUPER (fh);
+    ftp_conn_t *ctl = &FTP_FILE_HANDLER (fh)->ctl;
 
     while ((n = read (FH_SOCK, buf, len)) < 0)
     {
@@ -2006,10 +2579,13 @@ ftpfs_linear_read (struct vfs_class *me, vfs_file_handler_t * fh, void *buf, siz
         ftpfs_linear_abort (me, fh);
     else if (n == 0)
     {
-        FTP_SUPER (super)->ctl_connection_busy = FALSE;
+        int reply;
+
         close (FH_SOCK);
         FH_SOCK = -1;
-        if ((ftpfs_get_reply (me, FTP_SUPER (super)->sock, NULL, 0) != COMPLETE))
+        reply = ftpfs_get_reply (me, ctl->sock, NULL, 0);
+        ftpfs_conn_release (super, ctl, code != 421);
+        if (reply != COMPLETE)
             ERRNOR (E_REMOTE, -1);
         return 0;
     }
@@ -2242,6 +2818,8 @@ ftpfs_fh_new (struct vfs_s_inode *ino, gboolean changed)
     fh = g_new0 (ftp_file_handler_t, 1);
     vfs_s_init_fh (VFS_FILE_HANDLER (fh), ino, changed);
     fh->sock = -1;
+    fh->ctl.sock = -1;
+    fh->ctl.isbinary = TYPE_UNKNOWN;
 
     return VFS_FILE_HANDLER (fh);
 }
@@ -2302,6 +2880,8 @@ ftpfs_fh_open (struct vfs_class *me, vfs_file_handler_t * fh, int flags, mode_t
         if (fh->handle < 0)
             return (-1);
 
+        ftpfs_fh_take_connection (fh);
+
 #ifdef HAVE_STRUCT_LINGER_L_LINGER
         li.l_onoff = 1;
         li.l_linger = 120;
@@ -2329,22 +2909,28 @@ ftpfs_fh_open (struct vfs_class *me, vfs_file_handler_t * fh, int flags, mode_t
 static int
 ftpfs_fh_close (struct vfs_class *me, vfs_file_handler_t * fh)
 {
+    ftp_conn_t *ctl = &FTP_FILE_HANDLER (fh)->ctl;
+
     if (fh->handle != -1 && fh->ino->localname == NULL)
     {
-        ftp_super_t *ftp = FTP_SUPER (VFS_FILE_HANDLER_SUPER (fh));
+        int reply;
 
         close (fh->handle);
         fh->handle = -1;
-        ftp->ctl_connection_busy = FALSE;
         /* File is stored to destination already, so
          * we prevent VFS_SUBCLASS (me)->ftpfs_file_store() call from vfs_s_close ()
          */
         fh->changed = FALSE;
-        if (ftpfs_get_reply (me, ftp->sock, NULL, 0) != COMPLETE)
+        reply = ftpfs_get_reply (me, ctl->sock, NULL, 0);
+        ftpfs_conn_release (VFS_FILE_HANDLER_SUPER (fh), ctl, code != 421);
+        if (reply != COMPLETE)
             ERRNOR (EIO, -1);
         vfs_s_invalidate (me, VFS_FILE_HANDLER_SUPER (fh));
     }
 
+    /* a transfer left in an unknown state */
+    ftpfs_conn_release (VFS_FILE_HANDLER_SUPER (fh), ctl, FALSE);
+
     return 0;
 }
 
@@ -72,6 +72,10 @@
 #include "undelfs/undelfs.hpp"
 #endif
 
+#ifdef ENABLE_VFS_ZIP
+#include "zip/zip.hpp"
+#endif
+
 #include "plugins_init.hpp"
 
 /*** global variables ****************************************************************************/
@@ -100,6 +104,9 @@ void Plugins::VFSPluginsInit()
 #ifdef ENABLE_VFS_TAR
     vfs_init_tarfs ();
 #endif /* ENABLE_VFS_TAR */
+#ifdef ENABLE_VFS_ZIP
+    vfs_init_zipfs ();
+#endif /* ENABLE_VFS_ZIP */
 #ifdef ENABLE_VFS_SFS
     vfs_init_sfs ();
 #endif /* ENABLE_VFS_SFS */
@@ -0,0 +1,891 @@
+/*
+   Virtual File System: ZIP file system.
+
+   Copyright (C) 2020
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * \brief Source: Virtual File System: ZIP file system
+ *
+ * The directory tree is built from the central directory at the end of the
+ * archive, so no member data is read while browsing.  Members are read in
+ * place: stored ones directly, deflated ones through zlib.  Zip64 archives
+ * are supported; encrypted members and other compression methods are not.
+ *
+ * Namespace: init_zipfs
+ */
+
+#include <sys/types.h>
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+
+#include <zlib.h>
+
+#include "lib/global.hpp"
+#include "lib/util.hpp"           /* canonicalize_pathname() */
+#include "lib/widget.hpp"         /* message() */
+
+#include "lib/vfs/vfs.hpp"
+#include "lib/vfs/utilvfs.hpp"
+#include "lib/vfs/xdirentry.hpp"
+#include "lib/vfs/gc.hpp"         /* vfs_rmstamp */
+
+#include "zip.hpp"
+
+/*** global variables ****************************************************************************/
+
+/*** file scope macro definitions ****************************************************************/
+
+#define ZIP_SUPER(super) ((zip_super_t *) (super))
+#define ZIP_FILE_HANDLER(fh) ((zip_fh_t *) (fh))
+
+/* record signatures */
+#define ZIP_LOCAL_SIG      0x04034b50
+#define ZIP_CENTRAL_SIG    0x02014b50
+#define ZIP_EOCD_SIG       0x06054b50
+#define ZIP64_EOCD_SIG     0x06064b50
+#define ZIP64_LOCATOR_SIG  0x07064b50
+
+/* fixed parts of the records */
+#define ZIP_LOCAL_SIZE     30
+#define ZIP_CENTRAL_SIZE   46
+#define ZIP_EOCD_SIZE      22
+#define ZIP64_EOCD_SIZE    56
+#define ZIP64_LOCATOR_SIZE 20
+
+#define ZIP_MAX_COMMENT 0xffff
+
+#define ZIP_EXTRA_ZIP64     0x0001
+#define ZIP_EXTRA_TIMESTAMP 0x5455
+
+#define ZIP_FLAG_ENCRYPTED 0x0001
+
+#define ZIP_METHOD_STORED   0
+#define ZIP_METHOD_DEFLATED 8
+
+#define ZIP_HOST_UNIX 3
+#define ZIP_ATTR_DIRECTORY 0x10
+
+/* compressed data is read in chunks of this size */
+#define ZIP_IN_BUF_SIZE (64 * 1024)
+
+/*** file scope type declarations ****************************************************************/
+
+/* what is needed to read a member; inode->data_offset is the index in zip_super_t::members */
+typedef struct
+{
+    off_t header_offset;        /* local header */
+    off_t data_offset;          /* compressed data, -1 until the local header is read */
+    off_t csize;
+    guint32 crc;
+    guint16 method;
+    guint16 flags;
+} zip_member_t;
+
+typedef struct
+{
+    struct vfs_s_super base;    /* base class */
+
+    int fd;
+    struct stat st;
+    GArray *members;            /* zip_member_t */
+} zip_super_t;
+
+typedef struct
+{
+    vfs_file_handler_t base;    /* base class */
+
+    z_stream zs;
+    gboolean zs_ready;          /* zs is initialized */
+    gboolean zs_end;            /* the whole member is inflated */
+    off_t in_pos;               /* compressed bytes read */
+    off_t out_pos;              /* uncompressed bytes produced */
+    guint32 crc;                /* of the out_pos bytes */
+    unsigned char *in_buf;
+} zip_fh_t;
+
+/*** file scope variables ************************************************************************/
+
+static struct vfs_s_subclass zipfs_subclass;
+static struct vfs_class *vfs_zipfs_ops = VFS_CLASS (&zipfs_subclass);
+
+/* --------------------------------------------------------------------------------------------- */
+/*** file scope functions ************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+static inline guint16
+zip_get16 (const unsigned char *p)
+{
+    return (guint16) (p[0] | (p[1] << 8));
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static inline guint32
+zip_get32 (const unsigned char *p)
+{
+    return (guint32) zip_get16 (p) | ((guint32) zip_get16 (p + 2) << 16);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static inline guint64
+zip_get64 (const unsigned char *p)
+{
+    return (guint64) zip_get32 (p) | ((guint64) zip_get32 (p + 4) << 32);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+zip_read_at (int fd, off_t offset, void *buf, size_t len)
+{
+    char *p = static_cast<char *> (buf);
+
+    if (mc_lseek (fd, offset, SEEK_SET) != offset)
+        return FALSE;
+
+    while (len != 0)
+    {
+        ssize_t n;
+
+        n = mc_read (fd, p, len);
+        if (n <= 0)
+            return FALSE;
+        p += n;
+        len -= n;
+    }
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static time_t
+zip_dos_time (guint16 dos_time, guint16 dos_date)
+{
+    struct tm tm;
+
+    memset (&tm, 0, sizeof (tm));
+    tm.tm_sec = (dos_time & 0x1f) * 2;
+    tm.tm_min = (dos_time >> 5) & 0x3f;
+    tm.tm_hour = dos_time >> 11;
+    tm.tm_mday = dos_date & 0x1f;
+    tm.tm_mon = ((dos_date >> 5) & 0x0f) - 1;
+    tm.tm_year = (dos_date >> 9) + 80;
+    tm.tm_isdst = -1;
+
+    return mktime (&tm);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static struct vfs_s_super *
+zip_new_archive (struct vfs_class *me)
+{
+    zip_super_t *arch;
+
+    arch = g_new0 (zip_super_t, 1);
+    arch->base.me = me;
+    arch->fd = -1;
+    arch->members = g_array_new (FALSE, FALSE, sizeof (zip_member_t));
+
+    return VFS_SUPER (arch);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+zip_free_archive (struct vfs_class *me, struct vfs_s_super *archive)
+{
+    zip_super_t *arch = ZIP_SUPER (archive);
+
+    (void) me;
+
+    if (arch->fd != -1)
+    {
+        mc_close (arch->fd);
+        arch->fd = -1;
+    }
+
+    g_array_free (arch->members, TRUE);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+zip_fh_cleanup (zip_fh_t * zfh)
+{
+    if (zfh->zs_ready)
+    {
+        inflateEnd (&zfh->zs);
+        zfh->zs_ready = FALSE;
+    }
+    MC_PTR_FREE (zfh->in_buf);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Check that the member can be read and find its data. */
+
+static int
+zip_member_start (struct vfs_class *me, zip_super_t * arch, zip_member_t * m)
+{
+    unsigned char hdr[ZIP_LOCAL_SIZE];
+
+    if ((m->flags & ZIP_FLAG_ENCRYPTED) != 0)
+        ERRNOR (EACCES, -1);
+    if (m->method != ZIP_METHOD_STORED && m->method != ZIP_METHOD_DEFLATED)
+        ERRNOR (EOPNOTSUPP, -1);
+
+    if (m->data_offset != -1)
+        return 0;
+
+    /* name and extra field of the local header may differ from the central ones */
+    if (!zip_read_at (arch->fd, m->header_offset, hdr, sizeof (hdr))
+        || zip_get32 (hdr) != ZIP_LOCAL_SIG)
+        ERRNOR (EIO, -1);
+
+    m->data_offset =
+        m->header_offset + ZIP_LOCAL_SIZE + zip_get16 (hdr + 26) + zip_get16 (hdr + 28);
+    if (m->data_offset + m->csize > arch->st.st_size)
+    {
+        m->data_offset = -1;
+        ERRNOR (EIO, -1);
+    }
+
+    return 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Inflate up to len next bytes of the member. */
+
+static ssize_t
+zip_inflate (struct vfs_class *me, zip_super_t * arch, const zip_member_t * m, zip_fh_t * zfh,
+             char *out, size_t len)
+{
+    size_t produced;
+
+    zfh->zs.next_out = (Bytef *) out;
+    zfh->zs.avail_out = (uInt) len;
+
+    while (zfh->zs.avail_out != 0 && !zfh->zs_end)
+    {
+        int ret;
+
+        if (zfh->zs.avail_in == 0)
+        {
+            size_t chunk;
+
+            chunk = (size_t) MIN ((off_t) ZIP_IN_BUF_SIZE, m->csize - zfh->in_pos);
+            if (chunk == 0
+                || !zip_read_at (arch->fd, m->data_offset + zfh->in_pos, zfh->in_buf, chunk))
+                ERRNOR (EIO, -1);
+            zfh->in_pos += chunk;
+            zfh->zs.next_in = zfh->in_buf;
+            zfh->zs.avail_in = (uInt) chunk;
+        }
+
+        ret = inflate (&zfh->zs, Z_NO_FLUSH);
+        if (ret == Z_STREAM_END)
+            zfh->zs_end = TRUE;
+        else if (ret != Z_OK)
+            ERRNOR (EIO, -1);
+    }
+
+    produced = len - zfh->zs.avail_out;
+    zfh->crc = crc32 (zfh->crc, (const Bytef *) out, (uInt) produced);
+    zfh->out_pos += produced;
+
+    if (zfh->zs_end && zfh->crc != m->crc)
+        ERRNOR (EIO, -1);
+
+    return (ssize_t) produced;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Read count bytes of the member of size bytes from pos on. */
+
+static ssize_t
+zip_member_read (struct vfs_class *me, zip_super_t * arch, const zip_member_t * m, off_t size,
+                 zip_fh_t * zfh, off_t pos, char *buffer, size_t count)
+{
+    ssize_t res;
+
+    count = (size_t) MIN ((off_t) count, size - pos);
+    if (count == 0)
+        return 0;
+
+    if (m->method == ZIP_METHOD_STORED)
+    {
+        if (mc_lseek (arch->fd, m->data_offset + pos, SEEK_SET) != m->data_offset + pos)
+            ERRNOR (EIO, -1);
+        res = mc_read (arch->fd, buffer, count);
+        if (res == -1)
+            ERRNOR (errno, -1);
+        return res;
+    }
+
+    /* a deflate stream can't go back; start it over */
+    if (!zfh->zs_ready || pos < zfh->out_pos)
+    {
+        if (zfh->zs_ready)
+            inflateReset (&zfh->zs);
+        else
+        {
+            memset (&zfh->zs, 0, sizeof (zfh->zs));
+            if (inflateInit2 (&zfh->zs, -MAX_WBITS) != Z_OK)
+                ERRNOR (ENOMEM, -1);
+            zfh->zs_ready = TRUE;
+            zfh->in_buf = static_cast<unsigned char *> (g_malloc (ZIP_IN_BUF_SIZE));
+        }
+
+        zfh->zs.avail_in = 0;
+        zfh->zs_end = FALSE;
+        zfh->in_pos = 0;
+        zfh->out_pos = 0;
+        zfh->crc = crc32 (0L, Z_NULL, 0);
+    }
+
+    /* ... and can't skip forward without inflating either */
+    while (zfh->out_pos < pos)
+    {
+        char skip[BUF_8K];
+
+        res = zip_inflate (me, arch, m, zfh, skip, (size_t) MIN ((off_t) sizeof (skip),
+                                                                 pos - zfh->out_pos));
+        if (res <= 0)
+            ERRNOR (EIO, -1);
+    }
+
+    res = zip_inflate (me, arch, m, zfh, buffer, count);
+    if (res >= 0 && (size_t) res != count)
+        ERRNOR (EIO, -1);           /* member is shorter than the central directory says */
+
+    return res;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Symbolic links keep their target as the member data. */
+
+static void
+zip_read_link (struct vfs_class *me, zip_super_t * arch, struct vfs_s_inode *ino)
+{
+    zip_member_t *m;
+    zip_fh_t zfh;
+    off_t size = ino->st.st_size;
+    char *target = NULL;
+
+    m = &g_array_index (arch->members, zip_member_t, ino->data_offset);
+    memset (&zfh, 0, sizeof (zfh));
+
+    if (size > 0 && size < MC_MAXPATHLEN && zip_member_start (me, arch, m) == 0)
+    {
+        off_t done = 0;
+        ssize_t n = 0;
+
+        target = static_cast<char *> (g_malloc (size + 1));
+        while (done < size
+               && (n = zip_member_read (me, arch, m, size, &zfh, done, target + done,
+                                        size - done)) > 0)
+            done += n;
+
+        if (done == size)
+            target[size] = '\0';
+        else
+            MC_PTR_FREE (target);
+    }
+
+    zip_fh_cleanup (&zfh);
+
+    if (target != NULL)
+        ino->linkname = target;
+    else
+        ino->st.st_mode = (ino->st.st_mode & ~S_IFMT) | S_IFREG;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Find or make the directory inode of path; directories missing from the archive are made up. */
+
+static struct vfs_s_inode *
+zip_get_dir (struct vfs_class *me, struct vfs_s_super *archive, GHashTable * dirs,
+             const char *path)
+{
+    struct vfs_s_inode *ino, *parent;
+    struct vfs_s_entry *entry;
+    const char *name;
+    char *parent_path;
+
+    ino = static_cast<struct vfs_s_inode *> (g_hash_table_lookup (dirs, path));
+    if (ino != NULL)
+        return ino;
+
+    name = strrchr (path, PATH_SEP);
+    if (name == NULL)
+    {
+        parent_path = g_strdup ("");
+        name = path;
+    }
+    else
+    {
+        parent_path = g_strndup (path, name - path);
+        name++;
+    }
+
+    parent = zip_get_dir (me, archive, dirs, parent_path);
+    g_free (parent_path);
+
+    ino = vfs_s_new_inode (me, archive, &archive->root->st);
+    ino->data_offset = -1;
+    entry = vfs_s_new_entry (me, name, ino);
+    vfs_s_insert_entry (me, parent, entry);
+    g_hash_table_insert (dirs, g_strdup (path), ino);
+
+    return ino;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Add a central directory record to the tree; returns the length of the record or 0 on error. */
+
+static size_t
+zip_add_member (struct vfs_class *me, struct vfs_s_super *archive, GHashTable * dirs,
+                const unsigned char *rec, size_t avail)
+{
+    zip_super_t *arch = ZIP_SUPER (archive);
+    const unsigned char *extra, *extra_end;
+    guint16 made_by, name_len, extra_len, comment_len;
+    guint32 attr;
+    guint64 csize, usize, offset;
+    size_t rec_len;
+    zip_member_t m;
+    struct stat st;
+    mode_t mode = 0;
+    gboolean is_dir;
+    char *path, *name;
+    struct vfs_s_inode *ino, *parent;
+
+    if (avail < ZIP_CENTRAL_SIZE || zip_get32 (rec) != ZIP_CENTRAL_SIG)
+        return 0;
+
+    name_len = zip_get16 (rec + 28);
+    extra_len = zip_get16 (rec + 30);
+    comment_len = zip_get16 (rec + 32);
+    rec_len = ZIP_CENTRAL_SIZE + name_len + extra_len + comment_len;
+    if (rec_len > avail)
+        return 0;
+
+    made_by = zip_get16 (rec + 4);
+    m.flags = zip_get16 (rec + 8);
+    m.method = zip_get16 (rec + 10);
+    m.crc = zip_get32 (rec + 16);
+    csize = zip_get32 (rec + 20);
+    usize = zip_get32 (rec + 24);
+    attr = zip_get32 (rec + 38);
+    offset = zip_get32 (rec + 42);
+
+    st = arch->st;
+    st.st_mtime = zip_dos_time (zip_get16 (rec + 12), zip_get16 (rec + 14));
+
+    /* zip64 sizes and offset are there only for the fields that overflowed */
+    extra = rec + ZIP_CENTRAL_SIZE + name_len;
+    extra_end = extra + extra_len;
+    while (extra + 4 <= extra_end)
+    {
+        guint16 id, len;
+        const unsigned char *data;
+
+        id = zip_get16 (extra);
+        len = zip_get16 (extra + 2);
+        data = extra + 4;
+        if (data + len > extra_end)
+            break;
+
+        if (id == ZIP_EXTRA_ZIP64)
+        {
+            const unsigned char *q = data;
+
+            if (usize == 0xffffffff && q + 8 <= data + len)
+            {
+                usize = zip_get64 (q);
+                q += 8;
+            }
+            if (csize == 0xffffffff && q + 8 <= data + len)
+            {
+                csize = zip_get64 (q);
+                q += 8;
+            }
+            if (offset == 0xffffffff && q + 8 <= data + len)
+                offset = zip_get64 (q);
+        }
+        else if (id == ZIP_EXTRA_TIMESTAMP && len >= 5 && (data[0] & 1) != 0)
+            st.st_mtime = (time_t) (gint32) zip_get32 (data + 1);
+
+        extra = data + len;
+    }
+
+    path = g_strndup ((const char *) rec + ZIP_CENTRAL_SIZE, name_len);
+    is_dir = name_len != 0 && IS_PATH_SEP (path[name_len - 1]);
+    canonicalize_pathname (path);
+    for (name = path; IS_PATH_SEP (*name); name++)
+        ;
+    if (*name == '\0' || strcmp (name, ".") == 0)
+    {
+        g_free (path);
+        return rec_len;
+    }
+
+    if ((made_by >> 8) == ZIP_HOST_UNIX)
+        mode = attr >> 16;
+    if (is_dir || (attr & ZIP_ATTR_DIRECTORY) != 0)
+        mode = S_IFDIR | ((mode & 07777) != 0 ? (mode & 07777) : 0755);
+    else if ((mode & S_IFMT) == 0)
+        mode = S_IFREG | ((mode & 07777) != 0 ? (mode & 07777) : 0644);
+
+    st.st_mode = mode;
+    st.st_size = S_ISDIR (mode) ? 0 : (off_t) usize;
+    st.st_atime = st.st_ctime = st.st_mtime;
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+    st.st_atim.tv_nsec = st.st_mtim.tv_nsec = st.st_ctim.tv_nsec = 0;
+#endif
+#ifdef HAVE_STRUCT_STAT_ST_RDEV
+    st.st_rdev = 0;
+#endif
+    vfs_adjust_stat (&st);
+
+    if (S_ISDIR (mode))
+    {
+        ino = zip_get_dir (me, archive, dirs, name);
+        ino->st.st_mode = st.st_mode;
+        ino->st.st_mtime = ino->st.st_atime = ino->st.st_ctime = st.st_mtime;
+        g_free (path);
+        return rec_len;
+    }
+
+    {
+        char *base;
+
+        base = strrchr (name, PATH_SEP);
+        if (base == NULL)
+        {
+            parent = archive->root;
+            base = name;
+        }
+        else
+        {
+            *base++ = '\0';
+            parent = zip_get_dir (me, archive, dirs, name);
+        }
+
+        m.header_offset = (off_t) offset;
+        m.data_offset = -1;
+        m.csize = (off_t) csize;
+        g_array_append_val (arch->members, m);
+
+        ino = vfs_s_new_inode (me, archive, &st);
+        ino->data_offset = arch->members->len - 1;
+        if (S_ISLNK (mode))
+            zip_read_link (me, arch, ino);
+
+        vfs_s_insert_entry (me, parent, vfs_s_new_entry (me, base, ino));
+    }
+
+    g_free (path);
+    return rec_len;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Find the central directory through the end of central directory record. */
+
+static gboolean
+zip_find_central_directory (zip_super_t * arch, off_t * cd_offset, off_t * cd_size,
+                            guint64 * entries)
+{
+    off_t size = arch->st.st_size;
+    off_t tail_offset, eocd_offset;
+    size_t tail_len;
+    unsigned char *tail;
+    const unsigned char *eocd = NULL;
+    ssize_t i;
+    gboolean ok = FALSE;
+
+    if (size < ZIP_EOCD_SIZE)
+        return FALSE;
+
+    /* the record is the last one, followed only by an archive comment */
+    tail_len = (size_t) MIN (size, (off_t) (ZIP_EOCD_SIZE + ZIP_MAX_COMMENT));
+    tail_offset = size - tail_len;
+    tail = static_cast<unsigned char *> (g_malloc (tail_len));
+    if (!zip_read_at (arch->fd, tail_offset, tail, tail_len))
+        goto out;
+
+    for (i = (ssize_t) (tail_len - ZIP_EOCD_SIZE); i >= 0 && eocd == NULL; i--)
+        if (zip_get32 (tail + i) == ZIP_EOCD_SIG
+            && (size_t) i + ZIP_EOCD_SIZE + zip_get16 (tail + i + 20) <= tail_len)
+            eocd = tail + i;
+
+    if (eocd == NULL)
+        goto out;
+
+    eocd_offset = tail_offset + (eocd - tail);
+    *entries = zip_get16 (eocd + 10);
+    *cd_size = zip_get32 (eocd + 12);
+    *cd_offset = zip_get32 (eocd + 16);
+
+    if (*entries == 0xffff || *cd_size == 0xffffffff || *cd_offset == 0xffffffff)
+    {
+        unsigned char loc[ZIP64_LOCATOR_SIZE], rec[ZIP64_EOCD_SIZE];
+        off_t rec_offset;
+
+        if (eocd_offset < ZIP64_LOCATOR_SIZE
+            || !zip_read_at (arch->fd, eocd_offset - ZIP64_LOCATOR_SIZE, loc, sizeof (loc))
+            || zip_get32 (loc) != ZIP64_LOCATOR_SIG)
+            goto out;
+
+        rec_offset = (off_t) zip_get64 (loc + 8);
+        if (rec_offset < 0 || rec_offset > eocd_offset - ZIP64_LOCATOR_SIZE - ZIP64_EOCD_SIZE
+            || !zip_read_at (arch->fd, rec_offset, rec, sizeof (rec))
+            || zip_get32 (rec) != ZIP64_EOCD_SIG)
+            goto out;
+
+        *entries = zip_get64 (rec + 32);
+        *cd_size = (off_t) zip_get64 (rec + 40);
+        *cd_offset = (off_t) zip_get64 (rec + 48);
+        eocd_offset = rec_offset;
+    }
+
+    ok = *cd_offset >= 0 && *cd_size >= 0 && *cd_offset <= eocd_offset
+        && *cd_size <= eocd_offset - *cd_offset;
+
+  out:
+    g_free (tail);
+    return ok;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static int
+zip_read_central_directory (struct vfs_class *me, struct vfs_s_super *archive)
+{
+    zip_super_t *arch = ZIP_SUPER (archive);
+    off_t cd_offset, cd_size;
+    guint64 entries, n;
+    unsigned char *cd;
+    size_t pos = 0;
+    GHashTable *dirs;
+
+    if (!zip_find_central_directory (arch, &cd_offset, &cd_size, &entries))
+        return -1;
+
+    /* all records are read at once; they are small and come one after another */
+    cd = static_cast<unsigned char *> (g_try_malloc (cd_size + 1));
+    if (cd == NULL || !zip_read_at (arch->fd, cd_offset, cd, (size_t) cd_size))
+    {
+        g_free (cd);
+        return -1;
+    }
+
+    dirs = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    g_hash_table_insert (dirs, g_strdup (""), archive->root);
+
+    for (n = 0; pos < (size_t) cd_size; n++)
+    {
+        size_t len;
+
+        len = zip_add_member (me, archive, dirs, cd + pos, (size_t) cd_size - pos);
+        if (len == 0)
+            break;
+        pos += len;
+    }
+
+    g_hash_table_destroy (dirs);
+    g_free (cd);
+
+    /* writers that overflow the 16-bit count without zip64 still fill the whole directory */
+    return (pos == (size_t) cd_size || n == entries) ? 0 : -1;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static int
+zip_open_archive (struct vfs_s_super *archive, const vfs_path_t * vpath,
+                  const vfs_path_element_t * vpath_element)
+{
+    struct vfs_class *me = vpath_element->Class;
+    zip_super_t *arch = ZIP_SUPER (archive);
+    struct vfs_s_inode *root;
+    mode_t mode;
+
+    arch->fd = mc_open (vpath, O_RDONLY);
+    if (arch->fd == -1)
+    {
+        message (D_ERROR, MSG_ERROR, _("Cannot open zip archive\n%s"), vfs_path_as_str (vpath));
+        ERRNOR (ENOENT, -1);
+    }
+
+    archive->name = g_strdup (vfs_path_as_str (vpath));
+    mc_stat (vpath, &arch->st);
+
+    mode = arch->st.st_mode & 07777;
+    if (mode & 0400)
+        mode |= 0100;
+    if (mode & 0040)
+        mode |= 0010;
+    if (mode & 0004)
+        mode |= 0001;
+    mode |= S_IFDIR;
+
+    root = vfs_s_new_inode (me, archive, &arch->st);
+    root->st.st_mode = mode;
+    root->st.st_size = 0;
+    root->data_offset = -1;
+    root->st.st_nlink++;
+    root->st.st_dev = VFS_SUBCLASS (me)->rdev++;
+
+    archive->root = root;
+
+    if (zip_read_central_directory (me, archive) != 0)
+    {
+        message (D_ERROR, MSG_ERROR, _("%s\ndoesn't look like a zip archive."),
+                 vfs_path_as_str (vpath));
+        return -1;
+    }
+
+    return 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void *
+zip_super_check (const vfs_path_t * vpath)
+{
+    static struct stat stat_buf;
+    int stat_result;
+
+    stat_result = mc_stat (vpath, &stat_buf);
+
+    return (stat_result != 0) ? NULL : &stat_buf;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static int
+zip_super_same (const vfs_path_element_t * vpath_element, struct vfs_s_super *parc,
+                const vfs_path_t * vpath, void *cookie)
+{
+    struct stat *archive_stat = static_cast<struct stat *> (cookie);  /* stat of main archive */
+
+    (void) vpath_element;
+
+    if (strcmp (parc->name, vfs_path_as_str (vpath)) != 0)
+        return 0;
+
+    /* Has the cached archive been changed on the disk? */
+    if (ZIP_SUPER (parc)->st.st_mtime < archive_stat->st_mtime
+        || ZIP_SUPER (parc)->st.st_size != archive_stat->st_size)
+    {
+        /* Yes, reload! */
+        vfs_zipfs_ops->free ((vfsid) parc);
+        vfs_rmstamp (vfs_zipfs_ops, (vfsid) parc);
+        return 2;
+    }
+    /* Hasn't been modified, give it a new timeout */
+    vfs_stamp (vfs_zipfs_ops, (vfsid) parc);
+    return 1;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static ssize_t
+zip_read (void *fh, char *buffer, size_t count)
+{
+    struct vfs_class *me = VFS_FILE_HANDLER_SUPER (fh)->me;
+    vfs_file_handler_t *file = VFS_FILE_HANDLER (fh);
+    zip_super_t *arch = ZIP_SUPER (VFS_FILE_HANDLER_SUPER (fh));
+    const zip_member_t *m;
+    ssize_t res;
+
+    m = &g_array_index (arch->members, zip_member_t, file->ino->data_offset);
+    res = zip_member_read (me, arch, m, file->ino->st.st_size, ZIP_FILE_HANDLER (fh), file->pos,
+                           buffer, count);
+    if (res > 0)
+        file->pos += res;
+
+    return res;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static vfs_file_handler_t *
+zip_fh_new (struct vfs_s_inode *ino, gboolean changed)
+{
+    zip_fh_t *fh;
+
+    fh = g_new0 (zip_fh_t, 1);
+    vfs_s_init_fh (VFS_FILE_HANDLER (fh), ino, changed);
+
+    return VFS_FILE_HANDLER (fh);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static int
+zip_fh_open (struct vfs_class *me, vfs_file_handler_t * fh, int flags, mode_t mode)
+{
+    zip_super_t *arch = ZIP_SUPER (VFS_FILE_HANDLER_SUPER (fh));
+
+    (void) mode;
+
+    if ((flags & O_ACCMODE) != O_RDONLY)
+        ERRNOR (EROFS, -1);
+
+    return zip_member_start (me, arch,
+                             &g_array_index (arch->members, zip_member_t, fh->ino->data_offset));
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+zip_fh_free (vfs_file_handler_t * fh)
+{
+    zip_fh_cleanup (ZIP_FILE_HANDLER (fh));
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+void
+vfs_init_zipfs (void)
+{
+    vfs_init_subclass (&zipfs_subclass, "zipfs", VFSF_READONLY, "zip");
+    vfs_zipfs_ops->read = zip_read;
+    vfs_zipfs_ops->setctl = NULL;
+    zipfs_subclass.archive_check = zip_super_check;
+    zipfs_subclass.archive_same = zip_super_same;
+    zipfs_subclass.new_archive = zip_new_archive;
+    zipfs_subclass.open_archive = zip_open_archive;
+    zipfs_subclass.free_archive = zip_free_archive;
+    zipfs_subclass.fh_new = zip_fh_new;
+    zipfs_subclass.fh_open = zip_fh_open;
+    zipfs_subclass.fh_free = zip_fh_free;
+    vfs_register_class (vfs_zipfs_ops);
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -797,6 +797,13 @@ mcview_dialog_callback (Widget * w, Widget * sender, widget_msg_t msg, int parm,
             mcview_update (view);
         return MSG_HANDLED;
 
+    case MSG_IDLE:
+        /* build the line index of the file piece by piece */
+        view = (WView *) widget_find_by_type (w, mcview_callback);
+        if (!mcview_line_index_step (view))
+            widget_idle (w, FALSE);
+        return MSG_HANDLED;
+
     default:
         return dlg_default_callback (w, sender, msg, parm, data);
     }
@@ -45,6 +45,13 @@
    neighbor entries. The algorithm used for determining the line/column
    for a specific offset needs to be kept synchronized with the one used
    in display().
+
+   For DS_FILE sources a sparse line index complements the cache: it holds
+   the start offset of every VIEW_LINE_INDEX_STEP-th line and is filled
+   from the idle handler of the viewer dialog. A lookup inserts the nearest
+   preceding line checkpoint into the cache, along with the checkpoints
+   between it and the cache entry before it, so that only the distance
+   from that checkpoint has to be walked.
  */
 
 #include <string.h>             /* memmove() */
@@ -54,6 +61,7 @@
 
 #include "lib/global.hpp"
 #include "lib/tty/tty.hpp"
+#include "lib/vfs/vfs.hpp"
 #include "internal.hpp"
 
 /*** global variables ****************************************************************************/
@@ -63,6 +71,11 @@
 #define VIEW_COORD_CACHE_GRANUL 1024
 #define CACHE_CAPACITY_DELTA 64
 
+/* Number of lines between two entries of the line index */
+#define VIEW_LINE_INDEX_STEP 256
+/* Number of bytes scanned by the line indexer at once */
+#define VIEW_LINE_INDEX_CHUNK ((size_t) 256 * 1024)
+
 /*** file scope type declarations ****************************************************************/
 
 typedef gboolean (*cmp_func_t) (const coord_cache_entry_t * a, const coord_cache_entry_t * b);
@@ -91,7 +104,7 @@ mcview_ccache_add_entry (coord_cache_t * cache, size_t pos, const coord_cache_en
 
     /* insert new entry */
     if (pos != cache->size)
-        memmove (cache->cache[pos + 1], cache->cache[pos],
+        memmove (&cache->cache[pos + 1], &cache->cache[pos],
                  (cache->size - pos) * sizeof (*cache->cache));
     cache->cache[pos] = static_cast<coord_cache_entry_t *>(g_memdup(entry, sizeof(*entry)));
     cache->size++;
@@ -166,6 +179,189 @@ mcview_ccache_find (WView * view, const coord_cache_entry_t * coord, cmp_func_t
     return base;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/** Count line breaks in the next chunk of the file and record line checkpoints.
+ * Line breaks are detected exactly like in mcview_ccache_lookup(): '\n' and
+ * '\r' not followed by '\r' or '\n'.
+ *
+ * @return TRUE if the whole file is indexed
+ */
+
+static gboolean
+mcview_line_index_scan (WView * view, coord_cache_t * cache)
+{
+    char *buf;
+    size_t want, got = 0, limit;
+    const char *p, *end, *cr;
+    gboolean eof;
+
+    if (cache->line_index_offset >= view->ds_file_filesize)
+        return TRUE;
+
+    want = (size_t) MIN ((off_t) VIEW_LINE_INDEX_CHUNK,
+                         view->ds_file_filesize - cache->line_index_offset);
+
+    /* mcview_file_load_data() always seeks before reading, so the descriptor can be shared */
+    if (mc_lseek (view->ds_file_fd, cache->line_index_offset, SEEK_SET) == -1)
+        return TRUE;
+
+    buf = static_cast<char *>(g_malloc (want));
+
+    while (got < want)
+    {
+        ssize_t res;
+
+        res = mc_read (view->ds_file_fd, buf + got, want - got);
+        if (res <= 0)
+            break;
+        got += (size_t) res;
+    }
+
+    /* the file may have shrunk in the meantime */
+    eof = (got < want || cache->line_index_offset + (off_t) got >= view->ds_file_filesize);
+
+    /* keep the last byte as look-ahead for a possible '\r' unless it is the end of file */
+    limit = eof ? got : got - 1;
+    end = buf + limit;
+
+    p = buf;
+    cr = static_cast<const char *>(memchr (p, '\r', limit));
+
+    while (p < end)
+    {
+        const char *brk;
+
+        if (cr != NULL && cr < p)
+            cr = static_cast<const char *>(memchr (p, '\r', end - p));
+
+        brk = static_cast<const char *>(memchr (p, '\n', end - p));
+        if (cr != NULL && (brk == NULL || cr < brk))
+            brk = cr;
+
+        if (brk == NULL)
+            break;
+
+        p = brk + 1;
+
+        /* "\r\r" and "\r\n" don't produce a line break at the first '\r' */
+        if (*brk == '\r' && p < buf + got && (*p == '\r' || *p == '\n'))
+            continue;
+
+        cache->line_index_lines++;
+        if (cache->line_index_lines % VIEW_LINE_INDEX_STEP == 0)
+        {
+            off_t line_start;
+
+            line_start = cache->line_index_offset + (p - buf);
+            g_array_append_val (cache->line_index, line_start);
+        }
+    }
+
+    cache->line_index_offset += (off_t) limit;
+    if (eof)
+        cache->line_index_offset = view->ds_file_filesize;
+
+    g_free (buf);
+
+    return (cache->line_index_offset >= view->ds_file_filesize);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Extend the line index until it covers the given offset or line.
+ * Can be interrupted by the user.
+ */
+
+static void
+mcview_line_index_extend (WView * view, off_t offset, off_t line)
+{
+    coord_cache_t *cache = view->coord_cache;
+
+    while (cache->line_index_offset <= offset || cache->line_index_lines < line)
+        if (mcview_line_index_scan (view, cache) || tty_got_interrupt ())
+            break;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Find and return the index of the last line checkpoint not greater than ''offset''. */
+
+static size_t
+mcview_line_index_find (const coord_cache_t * cache, off_t offset)
+{
+    size_t base = 0;
+    size_t limit = cache->line_index->len;
+
+    while (limit > 1)
+    {
+        size_t i;
+
+        i = base + limit / 2;
+        if (g_array_index (cache->line_index, off_t, i) <= offset)
+            base = i;
+        limit = (limit + 1) / 2;
+    }
+    return base;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Insert the line checkpoint nearest before ''coord'' into the cache, together with
+ * all checkpoints between it and the preceding cache entry, so that no lookup in
+ * that range has to walk more than VIEW_LINE_INDEX_STEP lines.
+ */
+
+static void
+mcview_ccache_seed (WView * view, const coord_cache_entry_t * coord, enum ccache_type lookup_what)
+{
+    coord_cache_t *cache = view->coord_cache;
+    const coord_cache_entry_t *last = cache->cache[cache->size - 1];
+    coord_cache_entry_t entry;
+    size_t n, i, first, count, k;
+
+    if (lookup_what == CCACHE_OFFSET)
+    {
+        if (coord->cc_line > last->cc_line)
+            mcview_line_index_extend (view, -1, coord->cc_line);
+        n = MIN ((size_t) (coord->cc_line / VIEW_LINE_INDEX_STEP), cache->line_index->len - 1);
+    }
+    else
+    {
+        if (coord->cc_offset > last->cc_offset)
+            mcview_line_index_extend (view, coord->cc_offset, -1);
+        n = mcview_line_index_find (cache, coord->cc_offset);
+    }
+
+    entry.cc_offset = g_array_index (cache->line_index, off_t, n);
+    entry.cc_column = 0;
+    entry.cc_nroff_column = 0;
+
+    /* the cache entry preceding the checkpoint */
+    i = mcview_ccache_find (view, &entry, mcview_coord_cache_entry_less_offset);
+    if (cache->cache[i]->cc_offset == entry.cc_offset)
+        return;
+
+    /* checkpoints first..n lie between the entries i and i + 1 */
+    first = mcview_line_index_find (cache, cache->cache[i]->cc_offset) + 1;
+    count = n + 1 - first;
+
+    if (cache->size + count > cache->capacity)
+    {
+        cache->capacity = cache->size + count + CACHE_CAPACITY_DELTA;
+        cache->cache = static_cast<coord_cache_entry_t **>(g_realloc(cache->cache,
+                                                                     cache->capacity * sizeof(*cache->cache)));
+    }
+
+    memmove (&cache->cache[i + 1 + count], &cache->cache[i + 1],
+             (cache->size - i - 1) * sizeof (*cache->cache));
+
+    for (k = 0; k < count; k++)
+    {
+        entry.cc_offset = g_array_index (cache->line_index, off_t, first + k);
+        entry.cc_line = (off_t) (first + k) * VIEW_LINE_INDEX_STEP;
+        cache->cache[i + 1 + k] = static_cast<coord_cache_entry_t *>(g_memdup(&entry, sizeof(entry)));
+    }
+
+    cache->size += count;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /*** public functions ****************************************************************************/
 /* --------------------------------------------------------------------------------------------- */
@@ -180,6 +376,12 @@ coord_cache_new (void)
     cache->capacity = CACHE_CAPACITY_DELTA;
     cache->cache = static_cast<coord_cache_entry_t **>(g_malloc0(cache->capacity * sizeof(*cache->cache)));
 
+    cache->line_index = g_array_new (FALSE, FALSE, sizeof (off_t));
+    cache->line_index_offset = 0;
+    cache->line_index_lines = 0;
+    /* line 0 always starts at offset 0 */
+    g_array_append_val (cache->line_index, cache->line_index_offset);
+
     return cache;
 }
 
@@ -196,6 +398,7 @@ coord_cache_free (coord_cache_t * cache)
             g_free (cache->cache[i]);
 
         g_free (cache->cache);
+        g_array_free (cache->line_index, TRUE);
         g_free (cache);
     }
 }
@@ -319,6 +522,9 @@ mcview_ccache_lookup (WView * view, coord_cache_entry_t * coord, enum ccache_typ
 
     tty_enable_interrupt_key ();
 
+    if (view->datasource == DS_FILE)
+        mcview_ccache_seed (view, coord, lookup_what);
+
   retry:
     /* find the two neighbor entries in the cache */
     i = mcview_ccache_find (view, coord, cmp_func);
@@ -450,3 +656,23 @@ mcview_ccache_lookup (WView * view, coord_cache_entry_t * coord, enum ccache_typ
 }
 
 /* --------------------------------------------------------------------------------------------- */
+
+/* --------------------------------------------------------------------------------------------- */
+/** Index the next part of the file. Called when the viewer is idle.
+ *
+ * @return TRUE if there is more work to do
+ */
+
+gboolean
+mcview_line_index_step (WView * view)
+{
+    if (view == NULL || view->datasource != DS_FILE)
+        return FALSE;
+
+    if (view->coord_cache == NULL)
+        view->coord_cache = coord_cache_new ();
+
+    return !mcview_line_index_scan (view, view->coord_cache);
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -34,6 +34,7 @@
  */
 
 #include <errno.h>
+#include <unistd.h>
 
 #include "lib/global.hpp"
 #include "lib/vfs/vfs.hpp"
@@ -43,7 +44,7 @@
 #include "internal.hpp"
 
 /* Block size for reading files in parts */
-#define VIEW_PAGE_SIZE ((size_t) 8192)
+#define VIEW_PAGE_SIZE ((size_t) 65536)
 
 /*** global variables ****************************************************************************/
 
@@ -56,6 +57,105 @@
 /*** file scope functions ************************************************************************/
 /* --------------------------------------------------------------------------------------------- */
 
+static size_t
+mcview_growbuf_mem_blocks (void)
+{
+    if (mcview_growbuf_mem_limit <= 0)
+        return 0;
+
+    /* keep at least two blocks: the one being filled and the one before it */
+    return MAX ((size_t) mcview_growbuf_mem_limit * 1024 * 1024 / VIEW_PAGE_SIZE, 2);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Move the oldest in-memory block to the spill file.
+ * Blocks are full and spilled in order, so block N is always stored at offset
+ * N * VIEW_PAGE_SIZE of the spill file and no separate index is needed.
+ *
+ * @return TRUE if a block was spilled, FALSE if spilling is not possible
+ */
+
+static gboolean
+mcview_growbuf_spill_block (WView * view)
+{
+    byte *block;
+    off_t offset;
+    size_t written = 0;
+
+    if (view->growbuf_spill_fd == -1)
+    {
+        vfs_path_t *tmp_vpath;
+
+        view->growbuf_spill_fd = mc_mkstemps (&tmp_vpath, "mcview", NULL);
+        if (view->growbuf_spill_fd == -1)
+            return FALSE;
+
+        /* nobody else needs the file: it will go away on close */
+        unlink (vfs_path_as_str (tmp_vpath));
+        vfs_path_free (tmp_vpath);
+    }
+
+    block = (byte *) g_ptr_array_index (view->growbuf_blockptr, view->growbuf_spilled);
+    offset = (off_t) view->growbuf_spilled * VIEW_PAGE_SIZE;
+
+    while (written < VIEW_PAGE_SIZE)
+    {
+        ssize_t n;
+
+        n = pwrite (view->growbuf_spill_fd, block + written, VIEW_PAGE_SIZE - written,
+                    offset + written);
+        if (n == -1 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return FALSE;
+        written += n;
+    }
+
+    g_free (block);
+    g_ptr_array_index (view->growbuf_blockptr, view->growbuf_spilled) = NULL;
+    view->growbuf_spilled++;
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Return a pointer to the data of block @pageno, reading it back from the spill
+ * file if required. The pointer is valid until the next call.
+ */
+
+static byte *
+mcview_growbuf_get_block (WView * view, off_t pageno)
+{
+    size_t done = 0;
+
+    if (pageno >= (off_t) view->growbuf_spilled)
+        return (byte *) g_ptr_array_index (view->growbuf_blockptr, pageno);
+
+    if (view->growbuf_spill_cache_page == pageno)
+        return view->growbuf_spill_cache;
+
+    if (view->growbuf_spill_cache == NULL)
+        view->growbuf_spill_cache = static_cast<byte*>(g_malloc (VIEW_PAGE_SIZE));
+
+    view->growbuf_spill_cache_page = -1;
+
+    while (done < VIEW_PAGE_SIZE)
+    {
+        ssize_t n;
+
+        n = pread (view->growbuf_spill_fd, view->growbuf_spill_cache + done,
+                   VIEW_PAGE_SIZE - done, pageno * VIEW_PAGE_SIZE + done);
+        if (n == -1 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return NULL;
+        done += n;
+    }
+
+    view->growbuf_spill_cache_page = pageno;
+    return view->growbuf_spill_cache;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /*** public functions ****************************************************************************/
 /* --------------------------------------------------------------------------------------------- */
@@ -67,6 +167,10 @@ mcview_growbuf_init (WView * view)
     view->growbuf_blockptr = g_ptr_array_new ();
     view->growbuf_lastindex = VIEW_PAGE_SIZE;
     view->growbuf_finished = FALSE;
+    view->growbuf_spill_fd = -1;
+    view->growbuf_spilled = 0;
+    view->growbuf_spill_cache = NULL;
+    view->growbuf_spill_cache_page = -1;
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -99,6 +203,16 @@ mcview_growbuf_free (WView * view)
 
     (void) g_ptr_array_free (view->growbuf_blockptr, TRUE);
 
+    if (view->growbuf_spill_fd != -1)
+    {
+        close (view->growbuf_spill_fd);
+        view->growbuf_spill_fd = -1;
+    }
+
+    MC_PTR_FREE (view->growbuf_spill_cache);
+    view->growbuf_spill_cache_page = -1;
+    view->growbuf_spilled = 0;
+
     view->growbuf_blockptr = NULL;
     view->growbuf_in_use = FALSE;
 }
@@ -126,12 +240,15 @@ void
 mcview_growbuf_read_until (WView * view, off_t ofs)
 {
     gboolean short_read = FALSE;
+    size_t mem_blocks;
 
     g_assert (view->growbuf_in_use);
 
     if (view->growbuf_finished)
         return;
 
+    mem_blocks = mcview_growbuf_mem_blocks ();
+
     while (mcview_growbuf_filesize (view) < ofs || short_read)
     {
         ssize_t nread = 0;
@@ -140,8 +257,16 @@ mcview_growbuf_read_until (WView * view, off_t ofs)
 
         if (view->growbuf_lastindex == VIEW_PAGE_SIZE)
         {
+            byte *newblock;
+
+            /* Keep the in-memory window bounded: move the oldest block to disk.
+             * If that fails, keep growing in memory as before. */
+            if (mem_blocks != 0
+                && view->growbuf_blockptr->len - view->growbuf_spilled >= mem_blocks)
+                (void) mcview_growbuf_spill_block (view);
+
             /* Append a new block to the growing buffer */
-            byte *newblock = static_cast<byte*>(g_try_malloc (VIEW_PAGE_SIZE));
+            newblock = static_cast<byte*>(g_try_malloc (VIEW_PAGE_SIZE));
             if (newblock == NULL)
                 return;
 
@@ -268,6 +393,7 @@ char *
 mcview_get_ptr_growing_buffer (WView * view, off_t byte_index)
 {
     off_t pageno, pageindex;
+    byte *block;
 
     g_assert (view->growbuf_in_use);
 
@@ -280,12 +406,14 @@ mcview_get_ptr_growing_buffer (WView * view, off_t byte_index)
     mcview_growbuf_read_until (view, byte_index + 1);
     if (view->growbuf_blockptr->len == 0)
         return NULL;
-    if (pageno < (off_t) view->growbuf_blockptr->len - 1)
-        return ((char *) g_ptr_array_index (view->growbuf_blockptr, pageno) + pageindex);
+    if (pageno > (off_t) view->growbuf_blockptr->len - 1)
+        return NULL;
     if (pageno == (off_t) view->growbuf_blockptr->len - 1
-        && pageindex < (off_t) view->growbuf_lastindex)
-        return ((char *) g_ptr_array_index (view->growbuf_blockptr, pageno) + pageindex);
-    return NULL;
+        && pageindex >= (off_t) view->growbuf_lastindex)
+        return NULL;
+
+    block = mcview_growbuf_get_block (view, pageno);
+    return block == NULL ? NULL : (char *) block + pageindex;
 }
 
 /* --------------------------------------------------------------------------------------------- */
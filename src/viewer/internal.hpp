@@ -81,6 +81,11 @@ typedef struct
     size_t size;
     size_t capacity;
     coord_cache_entry_t **cache;
+
+    /* Sparse line index of DS_FILE sources, built in background */
+    GArray *line_index;         /* Start offsets of every VIEW_LINE_INDEX_STEP-th line */
+    off_t line_index_offset;    /* Offset up to which line breaks are counted */
+    off_t line_index_lines;     /* Number of line breaks before line_index_offset */
 } coord_cache_t;
 
 /* TODO: find a better name. This is not actually a "state machine",
@@ -132,6 +137,10 @@ struct WView
     size_t growbuf_lastindex;   /* Number of bytes in the last page of the
                                    growing buffer */
     gboolean growbuf_finished;  /* TRUE when all data has been read. */
+    int growbuf_spill_fd;       /* Unlinked temp file holding blocks evicted from memory, or -1 */
+    size_t growbuf_spilled;     /* Number of leading blocks that live in the spill file only */
+    byte *growbuf_spill_cache;  /* One spilled block reloaded for reading */
+    off_t growbuf_spill_cache_page;     /* Block number held in growbuf_spill_cache, or -1 */
 
     mcview_mode_flags_t mode_flags;
 
@@ -247,6 +256,7 @@ void mcview_ccache_dump (WView * view);
 #endif
 
 void mcview_ccache_lookup (WView * view, coord_cache_entry_t * coord, enum ccache_type lookup_what);
+gboolean mcview_line_index_step (WView * view);
 
 /* datasource.c: */
 void mcview_set_datasource_none (WView *);
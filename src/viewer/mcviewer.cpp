@@ -68,6 +68,10 @@ bool mcview_remember_file_position = FALSE;
 /* Maxlimit for skipping updates */
 int mcview_max_dirt_limit = 10;
 
+/* Memory (in MiB) kept by the growing buffer of piped data before older blocks
+   are moved to a temporary file. 0 keeps everything in memory */
+int mcview_growbuf_mem_limit = 64;
+
 /* Scrolling is done in pages or line increments */
 bool mcview_mouse_move_pages = TRUE;
 
@@ -410,6 +414,10 @@ mcview_load (WView * view, const char *command, const char *file, int start_line
             }
 
             mcview_set_datasource_file (view, fd, &st);
+
+            /* let the viewer dialog index lines while waiting for keys */
+            if (!mcview_is_in_panel (view) && WIDGET (view)->owner != NULL)
+                widget_idle (WIDGET (WIDGET (view)->owner), TRUE);
         }
         retval = TRUE;
     }
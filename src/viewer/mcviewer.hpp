@@ -30,6 +30,7 @@ extern mcview_mode_flags_t mcview_altered_flags;
 
 extern bool mcview_remember_file_position;
 extern int mcview_max_dirt_limit;
+extern int mcview_growbuf_mem_limit;
 
 extern bool mcview_mouse_move_pages;
 extern char *mcview_show_eof;
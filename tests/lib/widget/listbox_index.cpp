@@ -0,0 +1,156 @@
+/*
+   lib/widget - tests for WListbox indexing
+
+   Copyright (C) 2020
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_SUITE_NAME "lib/widget/listbox"
+
+#include "tests/mctest.h"
+
+#include "lib/widget.h"
+
+#define TEST_ENTRIES 1000
+
+/* --------------------------------------------------------------------------------------------- */
+
+static WListbox *
+make_listbox (void)
+{
+    return listbox_new (0, 0, 20, 40, TRUE, NULL);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* *INDENT-OFF* */
+START_TEST (test_listbox_append_navigate)
+/* *INDENT-ON* */
+{
+    WListbox *l;
+    char text[32];
+    char *current;
+    int i;
+
+    l = make_listbox ();
+
+    for (i = 0; i < TEST_ENTRIES; i++)
+    {
+        g_snprintf (text, sizeof (text), "entry-%07d", i);
+        listbox_add_item (l, LISTBOX_APPEND_AT_END, 0, text, NULL, FALSE);
+    }
+
+    fail_unless (listbox_get_length (l) == TEST_ENTRIES, "length (%d) != %d",
+                 listbox_get_length (l), TEST_ENTRIES);
+
+    /* step through the whole list from both ends */
+    for (i = 0; i < TEST_ENTRIES; i += 7)
+    {
+        listbox_select_entry (l, i);
+        fail_unless (l->pos == i, "pos (%d) != %d", l->pos, i);
+        fail_unless (l->pos - l->top < WIDGET (l)->lines, "pos %d not visible from top %d", l->pos,
+                     l->top);
+        listbox_select_entry (l, TEST_ENTRIES - 1 - i);
+    }
+
+    listbox_select_last (l);
+    listbox_get_current (l, &current, NULL);
+    g_snprintf (text, sizeof (text), "entry-%07d", TEST_ENTRIES - 1);
+    mctest_assert_str_eq (current, text);
+
+    fail_unless (listbox_search_text (l, "entry-0000765") == 765, "search by text failed");
+    fail_unless (listbox_search_text (l, "no such entry") == -1, "search of absent text failed");
+
+    widget_destroy (WIDGET (l));
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* *INDENT-OFF* */
+START_TEST (test_listbox_insert_positions)
+/* *INDENT-ON* */
+{
+    WListbox *l;
+    WLEntry *e;
+
+    l = make_listbox ();
+
+    listbox_add_item (l, LISTBOX_APPEND_AT_END, 0, "b", NULL, FALSE);
+    listbox_add_item (l, LISTBOX_APPEND_AT_END, 0, "d", NULL, FALSE);
+    fail_unless (listbox_search_text (l, "d") == 1, "search before insertion failed");
+
+    /* inserting in the middle shifts positions the text index knows about */
+    listbox_select_entry (l, 1);
+    listbox_add_item (l, LISTBOX_APPEND_BEFORE, 0, "c", NULL, FALSE);
+    fail_unless (listbox_search_text (l, "d") == 2, "stale text index after insertion");
+
+    listbox_select_first (l);
+    listbox_add_item (l, LISTBOX_APPEND_AFTER, 0, "bb", NULL, FALSE);
+    listbox_add_item (l, LISTBOX_APPEND_SORTED, 0, "a", NULL, FALSE);
+    listbox_add_item (l, LISTBOX_APPEND_SORTED, 0, "e", NULL, FALSE);
+
+    e = listbox_get_nth_item (l, 0);
+    mctest_assert_str_eq (e->text, "a");
+    e = listbox_get_nth_item (l, 2);
+    mctest_assert_str_eq (e->text, "bb");
+    e = listbox_get_nth_item (l, 5);
+    mctest_assert_str_eq (e->text, "e");
+    fail_unless (listbox_get_nth_item (l, 6) == NULL, "item past the end");
+
+    listbox_select_entry (l, 0);
+    listbox_remove_current (l);
+    fail_unless (listbox_search_text (l, "e") == 4, "stale text index after removal");
+
+    listbox_reverse_list (l);
+    fail_unless (listbox_search_text (l, "e") == 0, "stale text index after reverse");
+
+    widget_destroy (WIDGET (l));
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    int number_failed;
+
+    Suite *s = suite_create (TEST_SUITE_NAME);
+    TCase *tc_core = tcase_create ("Core");
+    SRunner *sr;
+
+    /* Add new tests here: *************** */
+    tcase_add_test (tc_core, test_listbox_append_navigate);
+    tcase_add_test (tc_core, test_listbox_insert_positions);
+    /* *********************************** */
+
+    suite_add_tcase (s, tc_core);
+    sr = srunner_create (s);
+    srunner_set_log (sr, "listbox_index.log");
+    srunner_run_all (sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed (sr);
+    srunner_free (sr);
+    return (number_failed == 0) ? 0 : 1;
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,98 @@
+/*
+   lib/widget - benchmark of WListbox indexing on large lists
+
+   Copyright (C) 2020
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Not a part of "make check": build and run it with "make listbox_index_bench".
+ * An optional argument is the number of entries to append.
+ */
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "lib/global.h"
+#include "lib/widget.h"
+
+/* A linear walk per cursor move would make this run for hours. */
+#define BENCH_ENTRIES 1000000
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (int argc, char *argv[])
+{
+    WListbox *l;
+    gint64 t0, t1, t2;
+    char text[32];
+    int entries = BENCH_ENTRIES;
+    int found;
+    int i;
+
+    if (argc > 1)
+        entries = atoi (argv[1]);
+    if (entries <= 0)
+    {
+        fprintf (stderr, "usage: %s [entries]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    l = listbox_new (0, 0, 20, 40, TRUE, NULL);
+
+    t0 = g_get_monotonic_time ();
+
+    for (i = 0; i < entries; i++)
+    {
+        g_snprintf (text, sizeof (text), "entry-%07d", i);
+        listbox_add_item (l, LISTBOX_APPEND_AT_END, 0, text, NULL, FALSE);
+    }
+
+    t1 = g_get_monotonic_time ();
+
+    /* step through the whole list from both ends */
+    for (i = 0; i < entries; i += 7)
+    {
+        listbox_select_entry (l, i);
+        listbox_select_entry (l, entries - 1 - i);
+    }
+    listbox_select_last (l);
+
+    g_snprintf (text, sizeof (text), "entry-%07d", entries * 3 / 4);
+    found = listbox_search_text (l, text);
+
+    t2 = g_get_monotonic_time ();
+
+    widget_destroy (WIDGET (l));
+
+    if (found != entries * 3 / 4)
+    {
+        fprintf (stderr, "%s: search for %s returned %d\n", argv[0], text, found);
+        return EXIT_FAILURE;
+    }
+
+    printf ("%d entries: append %" G_GINT64_FORMAT " ms, navigate %" G_GINT64_FORMAT " ms\n",
+            entries, (t1 - t0) / 1000, (t2 - t1) / 1000);
+
+    return EXIT_SUCCESS;
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,302 @@
+/*
+   src/editor - tests for the undo and redo stacks
+
+   Copyright (C) 2020
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_SUITE_NAME "/src/editor"
+
+#include "tests/mctest.h"
+
+#include "lib/timer.h"
+#include "lib/strutil.h"
+#include "lib/keybind.h"
+
+#include "src/vfs/local/local.c"
+#include "src/editor/editwidget.h"
+#include "src/editor/edit-impl.h"
+
+#define RANDOM_GROUPS 300
+#define BIG_BLOCK (1024 * 1024)
+
+static WEdit *test_edit;
+
+/* --------------------------------------------------------------------------------------------- */
+/* @Mock */
+void
+mc_refresh (void)
+{
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/* @Mock */
+void
+edit_load_syntax (WEdit * _edit, GPtrArray * _pnames, const char *_type)
+{
+    (void) _edit;
+    (void) _pnames;
+    (void) _type;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Mock */
+int
+edit_get_syntax_color (WEdit * _edit, off_t _byte_index)
+{
+    (void) _edit;
+    (void) _byte_index;
+
+    return 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Mock */
+gboolean
+edit_load_macro_cmd (WEdit * _edit)
+{
+    (void) _edit;
+
+    return FALSE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static GString *
+buffer_contents (const WEdit * edit)
+{
+    GString *s;
+    off_t i;
+
+    s = g_string_sized_new (edit->buffer.size);
+    for (i = 0; i < edit->buffer.size; i++)
+        g_string_append_c (s, (char) edit_buffer_get_byte (&edit->buffer, i));
+
+    return s;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+assert_contents (const WEdit * edit, const GString * expected, int step)
+{
+    GString *actual;
+
+    actual = buffer_contents (edit);
+    fail_unless (actual->len == expected->len && memcmp (actual->str, expected->str,
+                                                         actual->len) == 0,
+                 "buffer differs after step %d (%zu bytes, expected %zu)", step, actual->len,
+                 expected->len);
+    g_string_free (actual, TRUE);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* One key press worth of random primitive edits; always changes the buffer. */
+static void
+random_group (WEdit * edit, GRand * r)
+{
+    int n, i;
+
+    edit_push_key_press (edit);
+
+    switch (g_rand_int_range (r, 0, 5))
+    {
+    case 0:
+        n = g_rand_int_range (r, 1, 200);
+        for (i = 0; i < n; i++)
+        {
+            int c;
+
+            c = g_rand_int_range (r, 0, 4) == 0 ? '\n' : g_rand_int_range (r, 32, 127);
+            edit_insert (edit, c);
+        }
+        break;
+    case 1:
+        n = g_rand_int_range (r, 1, 300);
+        for (i = 0; i < n; i++)
+            edit_delete (edit, TRUE);
+        break;
+    case 2:
+        n = g_rand_int_range (r, 1, 300);
+        for (i = 0; i < n; i++)
+            edit_backspace (edit, TRUE);
+        break;
+    case 3:
+        /* mixed deletes and moves in one key press */
+        n = g_rand_int_range (r, 1, 50);
+        for (i = 0; i < n; i++)
+        {
+            edit_delete (edit, TRUE);
+            edit_cursor_move (edit, g_rand_int_range (r, -3, 4));
+            edit_backspace (edit, TRUE);
+        }
+        break;
+    default:
+        edit_cursor_move (edit, g_rand_int_range (r, -500, 500));
+        break;
+    }
+
+    edit_insert (edit, g_rand_int_range (r, 'a', 'z' + 1));
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Before */
+static void
+my_setup (void)
+{
+    mc_global.timer = mc_timer_new ();
+    str_init_strings (NULL);
+
+    vfs_init ();
+    vfs_init_localfs ();
+    vfs_setup_work_dir ();
+
+    option_filesize_threshold = (char *) "64M";
+    option_group_undo = FALSE;
+
+    test_edit = edit_init (NULL, 0, 0, 24, 80, vfs_path_from_str ("test-data.txt"), 1);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @After */
+static void
+my_teardown (void)
+{
+    edit_clean (test_edit);
+    g_free (test_edit);
+
+    vfs_shut ();
+
+    str_uninit_strings ();
+    mc_timer_destroy (mc_global.timer);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* Each undo must restore the buffer as it was before the key press, each redo as after it. */
+/* *INDENT-OFF* */
+START_TEST (test_undo_redo_random)
+/* *INDENT-ON* */
+{
+    GPtrArray *snapshots;
+    GRand *r;
+    int i;
+
+    r = g_rand_new_with_seed (20200601);
+    snapshots = g_ptr_array_new ();
+    g_ptr_array_add (snapshots, buffer_contents (test_edit));
+
+    for (i = 1; i <= RANDOM_GROUPS; i++)
+    {
+        random_group (test_edit, r);
+        g_ptr_array_add (snapshots, buffer_contents (test_edit));
+    }
+
+    for (i = RANDOM_GROUPS; i > 0; i--)
+    {
+        edit_execute_cmd (test_edit, CK_Undo, -1);
+        assert_contents (test_edit, (GString *) g_ptr_array_index (snapshots, i - 1), i);
+    }
+
+    for (i = 1; i <= RANDOM_GROUPS; i++)
+    {
+        edit_execute_cmd (test_edit, CK_Redo, -1);
+        assert_contents (test_edit, (GString *) g_ptr_array_index (snapshots, i), i);
+    }
+
+    for (i = 0; i <= RANDOM_GROUPS; i++)
+        g_string_free ((GString *) g_ptr_array_index (snapshots, i), TRUE);
+    g_ptr_array_free (snapshots, TRUE);
+    g_rand_free (r);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* Deleting a large block takes a few stack entries and is undone by a single undo. */
+/* *INDENT-OFF* */
+START_TEST (test_undo_big_block)
+/* *INDENT-ON* */
+{
+    GString *before;
+    unsigned long sp;
+    int i;
+
+    edit_push_key_press (test_edit);
+    for (i = 0; i < BIG_BLOCK; i++)
+        edit_insert (test_edit, (i % 61) == 60 ? '\n' : 'A' + i % 26);
+
+    before = buffer_contents (test_edit);
+    sp = test_edit->undo_stack_pointer;
+
+    edit_push_key_press (test_edit);
+    edit_cursor_move (test_edit, -BIG_BLOCK);
+    for (i = 0; i < BIG_BLOCK; i++)
+        edit_delete (test_edit, TRUE);
+
+    fail_unless (((test_edit->undo_stack_pointer - sp) & test_edit->undo_stack_size_mask) < 16,
+                 "block delete took %lu stack entries",
+                 (test_edit->undo_stack_pointer - sp) & test_edit->undo_stack_size_mask);
+    fail_unless (test_edit->undo_spans_size == BIG_BLOCK, "%zu bytes kept aside",
+                 test_edit->undo_spans_size);
+
+    edit_execute_cmd (test_edit, CK_Undo, -1);
+    assert_contents (test_edit, before, 1);
+    fail_unless (test_edit->undo_spans_size == 0, "undone bytes are still kept aside");
+
+    g_string_free (before, TRUE);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    int number_failed;
+
+    Suite *s = suite_create (TEST_SUITE_NAME);
+    TCase *tc_core = tcase_create ("Core");
+    SRunner *sr;
+
+    tcase_add_checked_fixture (tc_core, my_setup, my_teardown);
+
+    /* Add new tests here: *************** */
+    tcase_add_test (tc_core, test_undo_redo_random);
+    tcase_add_test (tc_core, test_undo_big_block);
+    /* *********************************** */
+
+    suite_add_tcase (s, tc_core);
+    sr = srunner_create (s);
+    srunner_set_log (sr, "edit__undo_redo.log");
+    srunner_run_all (sr, CK_ENV);
+    number_failed = srunner_ntests_failed (sr);
+    srunner_free (sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
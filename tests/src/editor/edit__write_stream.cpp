@@ -0,0 +1,303 @@
+/*
+   src/editor - tests for edit_write_stream() function
+
+   Copyright (C) 2020
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_SUITE_NAME "/src/editor"
+
+#include "tests/mctest.h"
+
+#include <stdint.h>             /* intmax_t */
+#include <stdio.h>
+
+#include "lib/timer.h"
+#include "lib/strutil.h"
+
+#include "src/vfs/local/local.c"
+#include "src/editor/editwidget.h"
+#include "src/editor/edit-impl.h"
+
+/* several parts of the buffer on both sides of the cursor */
+#define TEXT_SIZE (300 * 1024)
+
+static WEdit *test_edit;
+
+/* --------------------------------------------------------------------------------------------- */
+/* @Mock */
+void
+mc_refresh (void)
+{
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/* @Mock */
+void
+edit_load_syntax (WEdit * _edit, GPtrArray * _pnames, const char *_type)
+{
+    (void) _edit;
+    (void) _pnames;
+    (void) _type;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Mock */
+int
+edit_get_syntax_color (WEdit * _edit, off_t _byte_index)
+{
+    (void) _edit;
+    (void) _byte_index;
+
+    return 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Mock */
+gboolean
+edit_load_macro_cmd (WEdit * _edit)
+{
+    (void) _edit;
+
+    return FALSE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* What saving with line break conversion must produce: "\r\n", '\r' and '\n' are one break each. */
+static GString *
+convert_line_breaks (const GString * text, const char *eol)
+{
+    GString *s;
+    gsize i;
+
+    s = g_string_sized_new (text->len * 2);
+    for (i = 0; i < text->len; i++)
+    {
+        char c = text->str[i];
+
+        if (c == '\r' && i + 1 < text->len && text->str[i + 1] == '\n')
+        {
+            g_string_append (s, eol);
+            i++;
+        }
+        else if (c == '\r' || c == '\n')
+            g_string_append (s, eol);
+        else
+            g_string_append_c (s, c);
+    }
+
+    return s;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static GString *
+write_stream (WEdit * edit, LineBreaks lb)
+{
+    FILE *f;
+    GString *s;
+    char chunk[4096];
+    size_t n;
+    off_t written;
+
+    edit->lb = lb;
+    f = tmpfile ();
+    fail_unless (f != NULL, "cannot create temporary file");
+
+    written = edit_write_stream (edit, f);
+    fail_unless (written == edit->buffer.size, "written %jd of %jd bytes", (intmax_t) written,
+                 (intmax_t) edit->buffer.size);
+
+    s = g_string_new ("");
+    rewind (f);
+    while ((n = fread (chunk, 1, sizeof (chunk), f)) != 0)
+        g_string_append_len (s, chunk, n);
+    fclose (f);
+
+    return s;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+assert_equal (const GString * actual, const GString * expected, const char *what)
+{
+    gsize i;
+
+    for (i = 0; i < actual->len && i < expected->len && actual->str[i] == expected->str[i]; i++)
+        ;
+    fail_unless (actual->len == expected->len && i == actual->len,
+                 "%s: %zu bytes, expected %zu, first difference at %zu", what, actual->len,
+                 expected->len, i);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Before */
+static void
+my_setup (void)
+{
+    mc_global.timer = mc_timer_new ();
+    str_init_strings (NULL);
+
+    vfs_init ();
+    vfs_init_localfs ();
+    vfs_setup_work_dir ();
+
+    option_filesize_threshold = (char *) "64M";
+
+    test_edit = edit_init (NULL, 0, 0, 24, 80, vfs_path_from_str ("test-data.txt"), 1);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @After */
+static void
+my_teardown (void)
+{
+    edit_clean (test_edit);
+    g_free (test_edit);
+
+    vfs_shut ();
+
+    str_uninit_strings ();
+    mc_timer_destroy (mc_global.timer);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* *INDENT-OFF* */
+START_TEST (test_write_stream_line_breaks)
+/* *INDENT-ON* */
+{
+    static const struct
+    {
+        LineBreaks lb;
+        const char *eol;
+    } modes[] =
+    {
+        { LB_UNIX, "\n" },
+        { LB_WIN, "\r\n" },
+        { LB_MAC, "\r" },
+    };
+
+    GString *text, *actual, *expected;
+    GRand *r;
+    size_t i;
+
+    /* runs of text with all kinds of line breaks, some of them across parts of the buffer */
+    r = g_rand_new_with_seed (20200801);
+    text = g_string_sized_new (TEXT_SIZE);
+    while (text->len < TEXT_SIZE)
+    {
+        switch (g_rand_int_range (r, 0, 8))
+        {
+        case 0:
+            g_string_append_c (text, '\r');
+            break;
+        case 1:
+            g_string_append_c (text, '\n');
+            break;
+        case 2:
+            g_string_append (text, "\r\n");
+            break;
+        default:
+            g_string_append_c (text, g_rand_int_range (r, 0, 256));
+            break;
+        }
+    }
+
+    for (i = 0; i < text->len; i++)
+        edit_insert (test_edit, (unsigned char) text->str[i]);
+    edit_cursor_move (test_edit, -(off_t) (text->len / 3));
+
+    actual = write_stream (test_edit, LB_ASIS);
+    assert_equal (actual, text, "LB_ASIS");
+    g_string_free (actual, TRUE);
+
+    for (i = 0; i < G_N_ELEMENTS (modes); i++)
+    {
+        expected = convert_line_breaks (text, modes[i].eol);
+        actual = write_stream (test_edit, modes[i].lb);
+        assert_equal (actual, expected, modes[i].eol);
+        g_string_free (actual, TRUE);
+        g_string_free (expected, TRUE);
+    }
+
+    g_string_free (text, TRUE);
+    g_rand_free (r);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* A break at the very end of the text is not followed by another one. */
+/* *INDENT-OFF* */
+START_TEST (test_write_stream_last_break)
+/* *INDENT-ON* */
+{
+    GString *actual;
+
+    edit_insert (test_edit, 'a');
+    edit_insert (test_edit, '\r');
+
+    actual = write_stream (test_edit, LB_UNIX);
+    mctest_assert_str_eq (actual->str, "a\n");
+    g_string_free (actual, TRUE);
+
+    actual = write_stream (test_edit, LB_WIN);
+    mctest_assert_str_eq (actual->str, "a\r\n");
+    g_string_free (actual, TRUE);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    int number_failed;
+
+    Suite *s = suite_create (TEST_SUITE_NAME);
+    TCase *tc_core = tcase_create ("Core");
+    SRunner *sr;
+
+    tcase_add_checked_fixture (tc_core, my_setup, my_teardown);
+
+    /* Add new tests here: *************** */
+    tcase_add_test (tc_core, test_write_stream_line_breaks);
+    tcase_add_test (tc_core, test_write_stream_last_break);
+    /* *********************************** */
+
+    suite_add_tcase (s, tc_core);
+    sr = srunner_create (s);
+    srunner_set_log (sr, "edit__write_stream.log");
+    srunner_run_all (sr, CK_ENV);
+    number_failed = srunner_ntests_failed (sr);
+    srunner_free (sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,195 @@
+/*
+   src/editor - tests for the in-memory block sort
+
+   Copyright (C) 2020
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_SUITE_NAME "/src/editor"
+
+#include "tests/mctest.h"
+
+#include "lib/strutil.h"
+
+#include "src/editor/editsort.h"
+
+#define TEST_LINES 5000
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Before */
+static void
+setup (void)
+{
+    str_init_strings ("UTF-8");
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @After */
+static void
+teardown (void)
+{
+    str_uninit_strings ();
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+check_sort (const char *options, const char *input, const char *expected)
+{
+    edit_sort_options_t opts;
+    GError *error = NULL;
+    GString *sorted;
+
+    fail_unless (edit_sort_parse_options (options, &opts, &error), "options \"%s\": %s", options,
+                 error != NULL ? error->message : "");
+
+    sorted = edit_sort_lines (input, strlen (input), &opts);
+    mctest_assert_str_eq (sorted->str, expected);
+    g_string_free (sorted, TRUE);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* *INDENT-OFF* */
+static const struct test_sort_ds
+{
+    const char *options;
+    const char *input;
+    const char *expected;
+} test_sort_ds[] =
+{
+    { "", "b\nc\na\n", "a\nb\nc\n" },
+    { "", "b\nc\na", "a\nb\nc" },               /* no newline is added at the end */
+    { "-r", "b\nc\na\n", "c\nb\na\n" },
+    { "-n", "10\n9\n-1\n1.5\n", "-1\n1.5\n9\n10\n" },
+    { "-rn", "10\n9\n100\n", "100\n10\n9\n" },
+    { "-f", "b\nA\na\nB\n", "A\na\nB\nb\n" },   /* ties are ordered by bytes */
+    { "-u", "b\na\nb\na\n", "a\nb\n" },
+    { "-f -u", "b\nA\na\nB\n", "A\nb\n" },      /* the first of equal lines stays */
+    { "-k2", "x b\ny a\nz c\n", "y a\nx b\nz c\n" },
+    { "-k 2,2 -n", "a 10 z\nb 9 y\n", "b 9 y\na 10 z\n" },
+    { "-t, -k3", "a,b,2\nc,d,1\n", "c,d,1\na,b,2\n" },
+    { "--field-separator=: --key=2 --reverse", "x:1\ny:3\nz:2\n", "y:3\nz:2\nx:1\n" },
+    { "-b -k2", "a   b\nc a\n", "c a\na   b\n" },
+};
+/* *INDENT-ON* */
+
+/* *INDENT-OFF* */
+START_PARAMETRIZED_TEST (test_sort, test_sort_ds)
+/* *INDENT-ON* */
+{
+    check_sort (data->options, data->input, data->expected);
+}
+/* *INDENT-OFF* */
+END_PARAMETRIZED_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* *INDENT-OFF* */
+START_TEST (test_sort_bad_options)
+/* *INDENT-ON* */
+{
+    static const char *bad[] = { "-x", "-k", "-k0", "-k3,2", "-t ab", "--what", "file.txt" };
+    edit_sort_options_t opts;
+    size_t i;
+
+    for (i = 0; i < G_N_ELEMENTS (bad); i++)
+    {
+        GError *error = NULL;
+
+        fail_if (edit_sort_parse_options (bad[i], &opts, &error), "\"%s\" accepted", bad[i]);
+        fail_unless (error != NULL, "no error for \"%s\"", bad[i]);
+        g_error_free (error);
+    }
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* *INDENT-OFF* */
+START_TEST (test_sort_big_block)
+/* *INDENT-ON* */
+{
+    edit_sort_options_t opts;
+    GString *block, *sorted;
+    GRand *r;
+    const char *p;
+    long prev = -1;
+    int i;
+
+    r = g_rand_new_with_seed (20200715);
+    block = g_string_sized_new (TEST_LINES * 16);
+    for (i = 0; i < TEST_LINES; i++)
+        g_string_append_printf (block, "line %d\n", g_rand_int_range (r, 0, TEST_LINES));
+
+    edit_sort_parse_options ("-k2 -n", &opts, NULL);
+    sorted = edit_sort_lines (block->str, block->len, &opts);
+
+    fail_unless (sorted->len == block->len, "%zu bytes sorted, expected %zu", sorted->len,
+                 block->len);
+    for (p = sorted->str; *p != '\0'; p = strchr (p, '\n') + 1)
+    {
+        long n;
+
+        n = strtol (p + 5, NULL, 10);
+        fail_unless (n >= prev, "%ld after %ld", n, prev);
+        prev = n;
+    }
+    g_string_free (sorted, TRUE);
+
+    g_string_free (block, TRUE);
+    g_rand_free (r);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    int number_failed;
+
+    Suite *s = suite_create (TEST_SUITE_NAME);
+    TCase *tc_core = tcase_create ("Core");
+    SRunner *sr;
+
+    tcase_add_checked_fixture (tc_core, setup, teardown);
+
+    /* Add new tests here: *************** */
+    mctest_add_parameterized_test (tc_core, test_sort, test_sort_ds);
+    tcase_add_test (tc_core, test_sort_bad_options);
+    tcase_add_test (tc_core, test_sort_big_block);
+    /* *********************************** */
+
+    suite_add_tcase (s, tc_core);
+    sr = srunner_create (s);
+    srunner_set_log (sr, "editsort__edit_sort_lines.log");
+    srunner_run_all (sr, CK_ENV);
+    number_failed = srunner_ntests_failed (sr);
+    srunner_free (sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,93 @@
+/*
+   src/editor - benchmark of the in-memory block sort
+
+   Copyright (C) 2020
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Not a part of "make check": build and run it with "make editsort__edit_sort_lines_bench".
+ * An optional argument is the number of lines to sort.
+ */
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "lib/global.h"
+#include "lib/strutil.h"
+
+#include "src/editor/editsort.h"
+
+#define BENCH_LINES 1000000
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gint64
+bench_sort (const GString * block, const char *options)
+{
+    edit_sort_options_t opts;
+    GString *sorted;
+    gint64 t;
+
+    edit_sort_parse_options (options, &opts, NULL);
+    t = g_get_monotonic_time ();
+    sorted = edit_sort_lines (block->str, block->len, &opts);
+    t = g_get_monotonic_time () - t;
+    g_string_free (sorted, TRUE);
+
+    return t;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (int argc, char *argv[])
+{
+    GString *block;
+    GRand *r;
+    int lines = BENCH_LINES;
+    int i;
+
+    if (argc > 1)
+        lines = atoi (argv[1]);
+    if (lines <= 0)
+    {
+        fprintf (stderr, "usage: %s [lines]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    str_init_strings ("UTF-8");
+
+    r = g_rand_new_with_seed (20200715);
+    block = g_string_sized_new (lines * 16);
+    for (i = 0; i < lines; i++)
+        g_string_append_printf (block, "line %d\n", g_rand_int_range (r, 0, lines));
+
+    printf ("%d lines: numeric key %" G_GINT64_FORMAT " ms, collated %" G_GINT64_FORMAT " ms\n",
+            lines, bench_sort (block, "-k2 -n") / 1000, bench_sort (block, "") / 1000);
+
+    g_string_free (block, TRUE);
+    g_rand_free (r);
+    str_uninit_strings ();
+
+    return EXIT_SUCCESS;
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,378 @@
+/*
+   src/filemanager - tests for the compiled mc.ext rule table
+
+   Copyright (C) 2020
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_SUITE_NAME "/src/filemanager"
+
+#include "tests/mctest.h"
+
+#include <unistd.h>
+#include <utime.h>
+
+#include "lib/strutil.h"
+
+#include "src/vfs/local/local.c"
+
+#include "src/filemanager/midnight.c"
+
+#include "src/filemanager/ext.c"
+
+/* each name pattern of test_stock is tried with TEST_ROUNDS numbers */
+#define TEST_ROUNDS 3
+
+static const char *test_rules = "\
+# comment\n\
+shell/.tar.gz\n\
+\tView=tgz-view\n\
+\tInclude=arch\n\
+\n\
+regex/i/\\.a(rj|[0-9][0-9])$\n\
+\tOpen=\n\
+\tView=arj-view\n\
+\n\
+bogus/thing\n\
+\tOpen=never\n\
+\n\
+shell/i/makefile\n\
+\tEdit=make-edit\n\
+\n\
+regex/^[Mm]akefile\\.(PL|pl)$\n\
+\tOpen=perl-make\n\
+\tInclude=editor\n\
+\n\
+regex/\\.(c|h)p?p?$|^README$\n\
+    Edit=c-edit\n\
+  # indented, so not a comment\n\
+\tView=c-view\n\
+\n\
+shell/.zip\n\
+\tInclude=ar\n\
+\n\
+include/arch\n\
+\tEdit=arch-edit\n\
+include/archive\n\
+\tOpen=archive-open\n\
+\tInclude=editor\n\
+include/editor\n\
+\tEdit=include-editor\n\
+\tView=include-view\n\
+include/ar\n\
+\tOpen=ar-open\n\
+regex/\\.z[^a]p$\n\
+\tEdit=zip-edit\n\
+default/*\n\
+\tOpen=default-open\n\
+\tView=%view default\n";
+
+static char *test_dir = NULL;
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Before */
+static void
+setup (void)
+{
+    str_init_strings (NULL);
+
+    vfs_init ();
+    vfs_init_localfs ();
+    vfs_setup_work_dir ();
+
+    /* files in these tests don't exist */
+    use_file_to_check_type = FALSE;
+
+    test_dir = g_dir_make_tmp ("mc-ext-XXXXXX", NULL);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @After */
+static void
+teardown (void)
+{
+    rmdir (test_dir);
+    g_free (test_dir);
+
+    vfs_shut ();
+    str_uninit_strings ();
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static const char *
+lookup (const ext_table_t * table, const char *name, const char *action)
+{
+    vfs_path_t *vpath;
+    const ext_action_t *found;
+    gboolean error;
+
+    vpath = vfs_path_build_filename ("/tmp", name, (char *) NULL);
+    found = ext_table_lookup (table, vpath, action, &error);
+    fail_if (error, "error for %s", name);
+    vfs_path_free (vpath);
+
+    return found != NULL ? found->command : NULL;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* The same table with all rules but include/ ones checked for every file. */
+static ext_table_t *
+unindexed_copy (const char *text)
+{
+    ext_table_t *table;
+
+    table = ext_table_compile (text);
+    g_hash_table_remove_all (table->by_name);
+    g_hash_table_remove_all (table->by_ext);
+    g_array_set_size (table->unindexed, 0);
+
+    for (guint i = 0; i < table->rules->len; i++)
+        if (static_cast < ext_rule_t * >(g_ptr_array_index (table->rules, i))->kind !=
+            EXT_RULE_INCLUDE)
+            g_array_append_val (table->unindexed, i);
+
+    return table;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* *INDENT-OFF* */
+START_TEST (test_index)
+/* *INDENT-ON* */
+{
+    ext_table_t *table;
+    GArray *list;
+
+    table = ext_table_compile (test_rules);
+
+    /* bogus/ is dropped */
+    ck_assert_int_eq (table->rules->len, 12);
+    ck_assert_int_eq (table->includes->len, 4);
+
+    list = static_cast < GArray * >(g_hash_table_lookup (table->by_ext, "gz"));
+    fail_unless (list != NULL && list->len == 1, "no .tar.gz rule");
+    list = static_cast < GArray * >(g_hash_table_lookup (table->by_ext, "a07"));
+    fail_unless (list != NULL && list->len == 1, "no .a07 rule");
+    list = static_cast < GArray * >(g_hash_table_lookup (table->by_ext, "hpp"));
+    fail_unless (list != NULL && list->len == 1, "no .hpp rule");
+    list = static_cast < GArray * >(g_hash_table_lookup (table->by_name, "readme"));
+    fail_unless (list != NULL && list->len == 1, "no README rule");
+    list = static_cast < GArray * >(g_hash_table_lookup (table->by_name, "makefile"));
+    fail_unless (list != NULL && list->len == 1, "no makefile rule");
+
+    /* the negated class and default/ */
+    ck_assert_int_eq (table->unindexed->len, 2);
+
+    ext_table_free (table);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* *INDENT-OFF* */
+static const struct test_lookup_ds
+{
+    const char *name;
+    const char *action;
+    const char *expected;
+} test_lookup_ds[] =
+{
+    { "a.tar.gz", "View", "tgz-view" },
+    { "a.tar.gz", "Edit", "arch-edit" },
+    /* include/archive starts with "arch" too */
+    { "a.tar.gz", "Open", "archive-open" },
+    { "a.TAR.GZ", "Open", "default-open" },
+    /* an empty command stops the search */
+    { "x.ARJ", "Open", "" },
+    { "x.a12", "View", "arj-view" },
+    { "x.a1", "View", "%view default" },
+    { "MAKEFILE", "Edit", "make-edit" },
+    { "Makefile.PL", "Edit", "include-editor" },
+    { "makefile.pl", "Open", "perl-make" },
+    { "Makefile.Pl", "Open", "default-open" },
+    { "main.cpp", "Edit", "c-edit" },
+    { "main.cpp", "View", "c-view" },
+    { "main.cxx", "Edit", NULL },
+    { "README", "Edit", "c-edit" },
+    { "READMEs", "Edit", NULL },
+    /* include/ descriptions are matched by prefix: "arch" comes before "ar" */
+    { "pack.zip", "Open", "archive-open" },
+    { "pack.zip", "Edit", "arch-edit" },
+    { "pack.zop", "Edit", "zip-edit" },
+    { "pack.zap", "Edit", NULL },
+    { "noext", "Open", "default-open" },
+};
+/* *INDENT-ON* */
+
+/* *INDENT-OFF* */
+START_PARAMETRIZED_TEST (test_lookup, test_lookup_ds)
+/* *INDENT-ON* */
+{
+    ext_table_t *table;
+    const char *command;
+
+    table = ext_table_compile (test_rules);
+    command = lookup (table, data->name, data->action);
+
+    if (data->expected == NULL)
+        fail_unless (command == NULL, "%s %s: \"%s\"", data->name, data->action, command);
+    else
+        mctest_assert_str_eq (command, data->expected);
+
+    ext_table_free (table);
+}
+/* *INDENT-OFF* */
+END_PARAMETRIZED_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* *INDENT-OFF* */
+START_TEST (test_stale)
+/* *INDENT-ON* */
+{
+    ext_table_t *table;
+    char *path;
+    struct utimbuf times;
+
+    path = g_build_filename (test_dir, "mc.ext", (char *) NULL);
+    g_file_set_contents (path, test_rules, -1, NULL);
+    times.actime = times.modtime = 1594771200;
+    utime (path, &times);
+
+    table = ext_table_compile (test_rules);
+    table->path = g_strdup (path);
+    ext_file_stamp (path, &table->stamp);
+    table->user_path = g_build_filename (test_dir, "user.ext", (char *) NULL);
+    ext_file_stamp (table->user_path, &table->user_stamp);
+
+    fail_if (ext_table_is_stale (table), "fresh table is stale");
+
+    /* same size, new mtime */
+    times.modtime += 10;
+    utime (path, &times);
+    fail_unless (ext_table_is_stale (table), "modified file isn't noticed");
+    ext_file_stamp (path, &table->stamp);
+
+    /* the user's file appears */
+    g_file_set_contents (table->user_path, "default/*\n", -1, NULL);
+    fail_unless (ext_table_is_stale (table), "new user file isn't noticed");
+
+    unlink (table->user_path);
+    unlink (path);
+    g_free (path);
+    ext_table_free (table);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* Resolve Open for many file names with the stock mc.ext, compare with checking every rule. */
+/* *INDENT-OFF* */
+START_TEST (test_stock)
+/* *INDENT-ON* */
+{
+    static const char *const names[] = {
+        "%d.tar.gz", "%d.tgz", "%d.tar.xz", "%d.ZIP", "%d.jar", "%d.rar", "%d.a07", "%d.deb",
+        "%d.rpm", "%d.c", "%d.CPP", "%d.h", "%d.so.1.2", "page%d.1", "page%d.3pm.gz", "%d.man",
+        "%d.mp3", "%d.ogg", "%d.avi", "%d.MKV", "%d.html", "%d.pdf", "%d.ps.gz", "%d.djvu",
+        "%d.jpg", "%d.PNG", "%d.doc", "%d.odt", "%d.xlsx", "%d.diff", "%d.patch.bz2", "%d.torrent",
+        "%d.iso", "%d.txt", "%d.md", "%d.py", "README%d", "Makefile", "file%d", "x.%d.unknown"
+    };
+    const size_t count = G_N_ELEMENTS (names) * TEST_ROUNDS;
+    char *text = NULL;
+    ext_table_t *table, *plain;
+    const ext_action_t **found;
+    gboolean error;
+    size_t i;
+
+    fail_unless (g_file_get_contents (TEST_MC_EXT_FILE, &text, NULL, NULL), "no stock mc.ext");
+
+    table = ext_table_compile (text);
+    plain = unindexed_copy (text);
+    found = g_new (const ext_action_t *, count);
+
+    for (i = 0; i < count; i++)
+    {
+        char name[64];
+        vfs_path_t *vpath;
+        const ext_action_t *expected;
+
+        g_snprintf (name, sizeof (name), names[i % G_N_ELEMENTS (names)], (int) i);
+        vpath = vfs_path_build_filename ("/tmp", name, (char *) NULL);
+        found[i] = ext_table_lookup (table, vpath, "Open", &error);
+        expected = ext_table_lookup (plain, vpath, "Open", &error);
+        fail_unless (expected == NULL ? found[i] == NULL : found[i] != NULL
+                     && strcmp (found[i]->command, expected->command) == 0,
+                     "%s: \"%s\", expected \"%s\"", name,
+                     found[i] != NULL ? found[i]->command : "",
+                     expected != NULL ? expected->command : "");
+        vfs_path_free (vpath);
+    }
+
+    mctest_assert_str_eq (found[3]->command, "%cd %p/@ZIP_VFS_PREFIX@://");
+    mctest_assert_str_eq (found[10]->command, "%var{EDITOR:vi} %f");
+    mctest_assert_str_eq (found[37]->command, "make -f %f %{Enter parameters}");
+
+    g_free (found);
+    ext_table_free (plain);
+    ext_table_free (table);
+    g_free (text);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    int number_failed;
+
+    Suite *s = suite_create (TEST_SUITE_NAME);
+    TCase *tc_core = tcase_create ("Core");
+    SRunner *sr;
+
+    tcase_add_checked_fixture (tc_core, setup, teardown);
+
+    /* Add new tests here: *************** */
+    tcase_add_test (tc_core, test_index);
+    mctest_add_parameterized_test (tc_core, test_lookup, test_lookup_ds);
+    tcase_add_test (tc_core, test_stale);
+    tcase_add_test (tc_core, test_stock);
+    /* *********************************** */
+
+    suite_add_tcase (s, tc_core);
+    sr = srunner_create (s);
+    srunner_set_log (sr, "ext_rules.log");
+    srunner_run_all (sr, CK_ENV);
+    number_failed = srunner_ntests_failed (sr);
+    srunner_free (sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
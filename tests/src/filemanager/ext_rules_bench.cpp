@@ -0,0 +1,152 @@
+/*
+   src/filemanager - benchmark of the compiled mc.ext rule table
+
+   Copyright (C) 2020
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Not a part of "make check": build and run it with "make ext_rules_bench".
+ * An optional argument is the number of file names to resolve.
+ */
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "lib/global.h"
+#include "lib/strutil.h"
+
+#include "src/vfs/local/local.c"
+
+#include "src/filemanager/midnight.c"
+
+#include "src/filemanager/ext.c"
+
+#define BENCH_FILES 100000
+
+/* every BENCH_CHECK_STEP-th name is resolved by checking every rule too */
+#define BENCH_CHECK_STEP 10
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* The same table with all rules but include/ ones checked for every file. */
+static ext_table_t *
+unindexed_copy (const char *text)
+{
+    ext_table_t *table;
+
+    table = ext_table_compile (text);
+    g_hash_table_remove_all (table->by_name);
+    g_hash_table_remove_all (table->by_ext);
+    g_array_set_size (table->unindexed, 0);
+
+    for (guint i = 0; i < table->rules->len; i++)
+        if (static_cast < ext_rule_t * >(g_ptr_array_index (table->rules, i))->kind !=
+            EXT_RULE_INCLUDE)
+            g_array_append_val (table->unindexed, i);
+
+    return table;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (int argc, char *argv[])
+{
+    static const char *const names[] = {
+        "%d.tar.gz", "%d.tgz", "%d.tar.xz", "%d.ZIP", "%d.jar", "%d.rar", "%d.a07", "%d.deb",
+        "%d.rpm", "%d.c", "%d.CPP", "%d.h", "%d.so.1.2", "page%d.1", "page%d.3pm.gz", "%d.man",
+        "%d.mp3", "%d.ogg", "%d.avi", "%d.MKV", "%d.html", "%d.pdf", "%d.ps.gz", "%d.djvu",
+        "%d.jpg", "%d.PNG", "%d.doc", "%d.odt", "%d.xlsx", "%d.diff", "%d.patch.bz2", "%d.torrent",
+        "%d.iso", "%d.txt", "%d.md", "%d.py", "README%d", "Makefile", "file%d", "x.%d.unknown"
+    };
+    char *text = NULL;
+    ext_table_t *table, *plain;
+    vfs_path_t **vpaths;
+    gint64 t0, t1, t2;
+    gboolean error;
+    int files = BENCH_FILES;
+    int i;
+
+    if (argc > 1)
+        files = atoi (argv[1]);
+    if (files <= 0)
+    {
+        fprintf (stderr, "usage: %s [files]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (!g_file_get_contents (TEST_MC_EXT_FILE, &text, NULL, NULL))
+    {
+        fprintf (stderr, "%s: cannot read %s\n", argv[0], TEST_MC_EXT_FILE);
+        return EXIT_FAILURE;
+    }
+
+    str_init_strings (NULL);
+    vfs_init ();
+    vfs_init_localfs ();
+    vfs_setup_work_dir ();
+
+    /* the files don't exist */
+    use_file_to_check_type = FALSE;
+
+    t0 = g_get_monotonic_time ();
+    table = ext_table_compile (text);
+    t1 = g_get_monotonic_time ();
+    printf ("%u rules compiled in %" G_GINT64_FORMAT " us, %u checked for every file\n",
+            table->rules->len, t1 - t0, table->unindexed->len);
+
+    vpaths = g_new (vfs_path_t *, files);
+    for (i = 0; i < files; i++)
+    {
+        char name[64];
+
+        g_snprintf (name, sizeof (name), names[i % G_N_ELEMENTS (names)], i);
+        vpaths[i] = vfs_path_build_filename ("/tmp", name, (char *) NULL);
+    }
+
+    plain = unindexed_copy (text);
+
+    t0 = g_get_monotonic_time ();
+    for (i = 0; i < files; i++)
+        ext_table_lookup (table, vpaths[i], "Open", &error);
+    t1 = g_get_monotonic_time ();
+    for (i = 0; i < files; i += BENCH_CHECK_STEP)
+        ext_table_lookup (plain, vpaths[i], "Open", &error);
+    t2 = g_get_monotonic_time ();
+
+    printf ("%d names: %" G_GINT64_FORMAT " ms, every rule checked: %" G_GINT64_FORMAT
+            " ms for %d names\n", files, (t1 - t0) / 1000, (t2 - t1) / 1000,
+            (files + BENCH_CHECK_STEP - 1) / BENCH_CHECK_STEP);
+
+    for (i = 0; i < files; i++)
+        vfs_path_free (vpaths[i]);
+    g_free (vpaths);
+    ext_table_free (plain);
+    ext_table_free (table);
+    g_free (text);
+
+    vfs_shut ();
+    str_uninit_strings ();
+
+    return EXIT_SUCCESS;
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,339 @@
+/*
+   src/filemanager - tests for the in-process file type detection
+
+   Copyright (C) 2020
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_SUITE_NAME "/src/filemanager"
+
+#include "tests/mctest.h"
+
+#include <unistd.h>
+#include <utime.h>
+
+#include "lib/strutil.h"
+
+#include "src/vfs/local/local.c"
+
+#include "src/filemanager/filetype.c"
+
+#define TEST_FILES 50
+
+static char *test_dir = NULL;
+
+/* --------------------------------------------------------------------------------------------- */
+
+static char *
+write_test_file (const char *name, const char *data, size_t len)
+{
+    char *path;
+
+    path = g_build_filename (test_dir, name, (char *) NULL);
+    fail_unless (g_file_set_contents (path, data, len, NULL), "cannot write %s", path);
+
+    return path;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Before */
+static void
+setup (void)
+{
+    str_init_strings (NULL);
+
+    vfs_init ();
+    vfs_init_localfs ();
+    vfs_setup_work_dir ();
+
+    test_dir = g_dir_make_tmp ("mc-filetype-XXXXXX", NULL);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @After */
+static void
+teardown (void)
+{
+    file_type_flush ();
+
+    rmdir (test_dir);
+    g_free (test_dir);
+
+    vfs_shut ();
+    str_uninit_strings ();
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* *INDENT-OFF* */
+static const struct test_guess_ds
+{
+    const char *data;
+    size_t len;
+    const char *expected;       /* prefix of the description */
+} test_guess_ds[] =
+{
+    { "", 0, "empty" },
+    { "hello\nworld\n", 12, "ASCII text" },
+    { "a\r\nb\r\n", 6, "ASCII text, with CRLF line terminators" },
+    { "h\303\251llo\n", 7, "UTF-8 Unicode text" },
+    { "h\351llo\n", 6, "ISO-8859 text" },
+    { "a\0b", 3, "data" },
+    { "#!/bin/sh\necho\n", 15, "POSIX shell script, ASCII text executable" },
+    { "From someone Tue Jul 14\n", 24, "ASCII mail text" },
+    { "This is mc.info, produced by makeinfo version 6.7\n", 50, "Info text" },
+    { "\177ELF\002\001\001\0\0\0\0\0\0\0\0\0\003\0", 18, "ELF 64-bit LSB shared object" },
+    { "\177ELF\001\002\001\0\0\0\0\0\0\0\0\0\0\002", 18, "ELF 32-bit MSB executable" },
+    { "GIF89a\001\0\001\0", 10, "GIF image data" },
+    { "\377\330\377\340", 4, "JPEG image data" },
+    { "\211PNG\r\n\032\n\0\0\0\rIHDR", 16, "PNG image data" },
+    { "MM\0*\0\0\0\010", 8, "TIFF image data, big-endian" },
+    { "BM\0\0\0\0\0\0\0\0\066\0\0\0\050\0\0\0", 18, "PC bitmap" },
+    { "P5\n1 1\n255\n", 11, "Netpbm image data, rawbits, greymap" },
+    { "%PDF-1.4\n", 9, "PDF document" },
+    { "%!PS-Adobe-3.0\n", 15, "PostScript document text" },
+    { "SQLite format 3\0\020\0", 18, "SQLite 3.x database" },
+    { "\037\213\010\0", 4, "gzip compressed data" },
+    { "BZh91AY&SY", 10, "bzip2 compressed data" },
+    { "LZIP\001", 5, "LZIP compressed data" },
+    { "\0\0-lh5-\0\0", 9, "LHa (2.x) archive data" },
+    { "\032\105\337\243\001\0\0\0\0\0\0\037\102\202\204webm", 20, "WebM" },
+    { "\320\317\021\340\241\261\032\341W\0o\0r\0d\0D\0o\0c\0u\0m\0e\0n\0t\0", 32,
+      "Microsoft Word" },
+    { "PK\003\004\024\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\023\0\0\0[Content_Types].xml", 49,
+      "Microsoft OOXML" },
+    { "PK\003\004\024\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\011\0\0\0META-INF/", 39,
+      "Java archive data (JAR)" },
+    { "PK\003\004\024\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\005\0\0\0a.txt", 35,
+      "Zip archive data, at least v2.0 to extract" },
+};
+/* *INDENT-ON* */
+
+/* *INDENT-OFF* */
+START_PARAMETRIZED_TEST (test_guess, test_guess_ds)
+/* *INDENT-ON* */
+{
+    char *type;
+
+    type = file_type_guess (data->data, data->len, FALSE);
+    fail_unless (g_str_has_prefix (type, data->expected), "\"%s\", expected \"%s\"", type,
+                 data->expected);
+    g_free (type);
+}
+/* *INDENT-OFF* */
+END_PARAMETRIZED_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* *INDENT-OFF* */
+START_TEST (test_guess_tar)
+/* *INDENT-ON* */
+{
+    char block[512];
+    char *type;
+
+    memset (block, 0, sizeof (block));
+    strcpy (block, "README");
+    memcpy (block + 257, "ustar", 5);
+
+    type = file_type_guess (block, sizeof (block), FALSE);
+    mctest_assert_str_eq (type, "POSIX tar archive");
+    g_free (type);
+
+    /* a UTF-8 character cut at the end of the head is still UTF-8 */
+    type = file_type_guess ("abc\320\277\321", 6, TRUE);
+    mctest_assert_str_eq (type, "UTF-8 Unicode text");
+    g_free (type);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+#ifdef HAVE_CHARSET
+/* *INDENT-OFF* */
+START_TEST (test_guess_encoding)
+/* *INDENT-ON* */
+{
+    /* "privet mir kak dela" */
+    static const char cp1251[] =
+        "\357\360\350\342\345\362 \354\350\360 \312\340\352 \344\345\353\340";
+    static const char koi8[] =
+        "\320\322\311\327\305\324 \315\311\322 \353\301\313 \304\305\314\301";
+    static const char cp866[] =
+        "\257\340\250\242\245\342 \254\250\340 \212\240\252 \244\245\253\240";
+    char *enc;
+
+#define CHECK_ENCODING(text, lang, expected) \
+    enc = file_type_guess_encoding (text, strlen (text), FALSE, lang); \
+    mctest_assert_str_eq (enc, expected); \
+    g_free (enc)
+
+    CHECK_ENCODING (cp1251, "russian", "CP1251");
+    CHECK_ENCODING (koi8, "ru", "KOI8-R");
+    CHECK_ENCODING (koi8, "ukrainian", "KOI8-U");
+    CHECK_ENCODING (cp866, "russian", "IBM866");
+    CHECK_ENCODING ("za\277\363\263\346", "polish", "ISO-8859-2");
+    CHECK_ENCODING ("\234\237", "pl", "CP1250");
+    CHECK_ENCODING ("plain", "russian", "ASCII");
+    CHECK_ENCODING ("\320\277\321\200\320\270", "russian", "UTF-8");
+
+#undef CHECK_ENCODING
+
+    enc = file_type_guess_encoding ("\351\350", 2, FALSE, "klingon");
+    fail_unless (enc == NULL, "guessed %s for an unknown language", enc);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+#endif /* HAVE_CHARSET */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* The description is cached until the size or the mtime of the file changes. */
+/* *INDENT-OFF* */
+START_TEST (test_cache)
+/* *INDENT-ON* */
+{
+    char *path;
+    vfs_path_t *vpath;
+    const file_type_t *info, *again;
+    struct utimbuf times;
+    GError *error = NULL;
+
+    path = write_test_file ("text", "plain text\n", 11);
+    vpath = vfs_path_from_str (path);
+
+    times.actime = times.modtime = 1594771200;
+    utime (path, &times);
+
+    info = file_type_get (vpath, NULL, &error);
+    fail_unless (info != NULL && error == NULL, "no type");
+    fail_unless (strstr (info->type, "text") != NULL, "\"%s\" for a text file", info->type);
+
+    again = file_type_get (vpath, NULL, &error);
+    fail_unless (again == info, "the file was examined again");
+
+    /* same size, new contents and mtime */
+    g_file_set_contents (path, "%PDF-1.4\n\n\n", 11, NULL);
+    times.modtime += 10;
+    utime (path, &times);
+
+    info = file_type_get (vpath, NULL, &error);
+    fail_unless (info != NULL && g_str_has_prefix (info->type, "PDF"), "stale type \"%s\"",
+                 info != NULL ? info->type : "");
+
+    vfs_path_free (vpath);
+    unlink (path);
+    g_free (path);
+
+    vpath = vfs_path_build_filename (test_dir, "missing", (char *) NULL);
+    info = file_type_get (vpath, NULL, &error);
+    fail_unless (info == NULL && error != NULL, "a missing file has a type");
+    g_error_free (error);
+    vfs_path_free (vpath);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* A directory of mixed files: each is read once, then answered from the cache. */
+/* *INDENT-OFF* */
+START_TEST (test_many_files)
+/* *INDENT-ON* */
+{
+    static const char *const contents[] = {
+        "plain text\n", "\211PNG\r\n\032\n", "%PDF-1.4\n", "\037\213\010\0", "#!/bin/sh\n"
+    };
+    vfs_path_t **vpaths;
+    const file_type_t **infos;
+    int i;
+
+    vpaths = g_new (vfs_path_t *, TEST_FILES);
+    for (i = 0; i < TEST_FILES; i++)
+    {
+        const char *data = contents[i % G_N_ELEMENTS (contents)];
+        char name[32], *path;
+
+        g_snprintf (name, sizeof (name), "file%d", i);
+        path = write_test_file (name, data, strlen (data));
+        vpaths[i] = vfs_path_from_str (path);
+        g_free (path);
+    }
+
+    infos = g_new (const file_type_t *, TEST_FILES);
+    for (i = 0; i < TEST_FILES; i++)
+    {
+        infos[i] = file_type_get (vpaths[i], NULL, NULL);
+        fail_unless (infos[i] != NULL, "no type for file%d", i);
+    }
+    for (i = 0; i < TEST_FILES; i++)
+        fail_unless (file_type_get (vpaths[i], NULL, NULL) == infos[i],
+                     "file%d was examined again", i);
+    g_free (infos);
+
+    for (i = 0; i < TEST_FILES; i++)
+    {
+        mc_unlink (vpaths[i]);
+        vfs_path_free (vpaths[i]);
+    }
+    g_free (vpaths);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    int number_failed;
+
+    Suite *s = suite_create (TEST_SUITE_NAME);
+    TCase *tc_core = tcase_create ("Core");
+    SRunner *sr;
+
+    tcase_add_checked_fixture (tc_core, setup, teardown);
+
+    /* Add new tests here: *************** */
+    mctest_add_parameterized_test (tc_core, test_guess, test_guess_ds);
+    tcase_add_test (tc_core, test_guess_tar);
+#ifdef HAVE_CHARSET
+    tcase_add_test (tc_core, test_guess_encoding);
+#endif
+    tcase_add_test (tc_core, test_cache);
+    tcase_add_test (tc_core, test_many_files);
+    /* *********************************** */
+
+    suite_add_tcase (s, tc_core);
+    sr = srunner_create (s);
+    srunner_set_log (sr, "filetype.log");
+    srunner_run_all (sr, CK_ENV);
+    number_failed = srunner_ntests_failed (sr);
+    srunner_free (sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,1037 @@
+/*
+   src/vfs/ftpfs - tests for the FTP file system
+
+   Copyright (C) 2020
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_SUITE_NAME "/src/vfs/ftpfs"
+
+#include "tests/mctest.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "lib/strutil.h"
+#include "lib/vfs/vfs.h"
+
+#include "src/vfs/local/local.c"
+#include "src/vfs/ftpfs/ftpfs.c"
+
+#define BIG_SIZE (1024 * 1024 + 17)
+
+/* a file of the test server */
+typedef struct
+{
+    const char *path;           /* without leading slash */
+    mode_t type;
+    const char *data;           /* link target for symlinks */
+    size_t size;
+} test_node_t;
+
+/* *INDENT-OFF* */
+static test_node_t test_nodes[] =
+{
+    { "", S_IFDIR, NULL, 0 },
+    { "pub", S_IFDIR, NULL, 0 },
+    { "pub/readme", S_IFREG, "hello, world\n", 13 },
+    { "pub/big.bin", S_IFREG, NULL, BIG_SIZE },
+    { "pub/link", S_IFLNK, "readme", 6 },
+    { "pub/dir with space", S_IFDIR, NULL, 0 },
+    { "pub/dir with space/inner", S_IFREG, "inner\n", 6 },
+    { "pub/empty", S_IFDIR, NULL, 0 },
+    { "incoming", S_IFDIR, NULL, 0 },
+};
+/* *INDENT-ON* */
+
+/* the in-process FTP server: one thread accepts, one thread per session */
+static struct
+{
+    int sock;
+    char *url;
+    gboolean mlst;              /* advertise MLST in FEAT */
+    pthread_t thread;
+
+    pthread_mutex_t lock;
+    GSList *sessions;           /* control sockets of the open sessions */
+    int logins;
+    int mlsd;
+    int list;
+    char *stored_name;
+    GString *stored;
+} server;
+
+static char *big_data = NULL;
+
+/* --------------------------------------------------------------------------------------------- */
+/* @Mock */
+void
+message (int flags, const char *title, const char *text, ...)
+{
+    (void) flags;
+    (void) title;
+    (void) text;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+server_send (int sock, const char *fmt, ...)
+{
+    va_list ap;
+    char *s;
+    ssize_t ret;
+
+    va_start (ap, fmt);
+    s = g_strdup_vprintf (fmt, ap);
+    va_end (ap);
+
+    ret = write (sock, s, strlen (s));
+    (void) ret;
+    g_free (s);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+server_get_line (int sock, char *buf, size_t size)
+{
+    size_t i = 0;
+
+    while (TRUE)
+    {
+        char c;
+
+        if (read (sock, &c, 1) != 1)
+            return FALSE;
+        if (c == '\n')
+            break;
+        if (c != '\r' && i < size - 1)
+            buf[i++] = c;
+    }
+
+    buf[i] = '\0';
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/* Find the node at a path relative to cwd; "//x/./y/" is "x/y" */
+
+static test_node_t *
+server_lookup (const char *cwd, const char *arg)
+{
+    char *full;
+    char **parts;
+    GString *path;
+    size_t i;
+    test_node_t *node = NULL;
+
+    full = IS_PATH_SEP (*arg) ? g_strdup (arg) : g_strconcat (cwd, PATH_SEP_STR, arg, (char *) NULL);
+    parts = g_strsplit (full, PATH_SEP_STR, -1);
+    path = g_string_new ("");
+    for (i = 0; parts[i] != NULL; i++)
+        if (*parts[i] != '\0' && strcmp (parts[i], ".") != 0)
+        {
+            if (path->len != 0)
+                g_string_append_c (path, PATH_SEP);
+            g_string_append (path, parts[i]);
+        }
+
+    for (i = 0; i < G_N_ELEMENTS (test_nodes); i++)
+        if (strcmp (test_nodes[i].path, path->str) == 0)
+            node = &test_nodes[i];
+
+    g_string_free (path, TRUE);
+    g_strfreev (parts);
+    g_free (full);
+    return node;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+server_is_child (const test_node_t * dir, const test_node_t * node)
+{
+    size_t len = strlen (dir->path);
+    const char *name;
+
+    if (node == dir || strncmp (node->path, dir->path, len) != 0)
+        return FALSE;
+
+    name = node->path + len;
+    if (len != 0)
+    {
+        if (*name != PATH_SEP)
+            return FALSE;
+        name++;
+    }
+
+    return strchr (name, PATH_SEP) == NULL;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static const char *
+server_basename (const test_node_t * node)
+{
+    const char *name;
+
+    name = strrchr (node->path, PATH_SEP);
+    return name == NULL ? node->path : name + 1;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+server_append_facts (GString * out, const test_node_t * node)
+{
+    switch (node->type)
+    {
+    case S_IFDIR:
+        g_string_append (out, "type=dir;UNIX.mode=0755;");
+        break;
+    case S_IFLNK:
+        g_string_append_printf (out, "type=OS.unix=slink:%s;UNIX.mode=0777;", node->data);
+        break;
+    default:
+        g_string_append_printf (out, "type=file;size=%zu;UNIX.mode=0644;", node->size);
+        break;
+    }
+    g_string_append (out, "modify=20200715120000;UNIX.uid=0;UNIX.gid=0;");
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static GString *
+server_listing (const test_node_t * dir, gboolean mlsd)
+{
+    GString *out;
+    size_t i;
+
+    out = g_string_new ("");
+    if (mlsd)
+        g_string_append_printf (out, "type=cdir;modify=20200715120000; /%s\r\n"
+                                "type=pdir;modify=20200715120000; /\r\n", dir->path);
+    else
+        g_string_append (out, "total 1\r\n");
+
+    for (i = 0; i < G_N_ELEMENTS (test_nodes); i++)
+    {
+        const test_node_t *node = &test_nodes[i];
+
+        if (!server_is_child (dir, node))
+            continue;
+
+        if (mlsd)
+        {
+            server_append_facts (out, node);
+            g_string_append_printf (out, " %s\r\n", server_basename (node));
+        }
+        else
+            g_string_append_printf (out, "%s 1 0 0 %8zu Jul 15  2020 %s%s%s\r\n",
+                                    node->type == S_IFDIR ? "drwxr-xr-x" : node->type ==
+                                    S_IFLNK ? "lrwxrwxrwx" : "-rw-r--r--",
+                                    node->type == S_IFDIR ? 4096 : node->size,
+                                    server_basename (node), node->type == S_IFLNK ? " -> " : "",
+                                    node->type == S_IFLNK ? node->data : "");
+    }
+
+    return out;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static int
+server_accept_data (int *pasv)
+{
+    int data;
+
+    data = accept (*pasv, NULL, NULL);
+    close (*pasv);
+    *pasv = -1;
+    return data;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+server_send_data (int ctl, int *pasv, const char *data, size_t size)
+{
+    int sock;
+
+    sock = server_accept_data (pasv);
+    server_send (ctl, "150 Opening data connection\r\n");
+    while (size != 0)
+    {
+        ssize_t n;
+
+        n = write (sock, data, size);
+        if (n <= 0)
+            break;
+        data += n;
+        size -= n;
+    }
+    close (sock);
+    server_send (ctl, "226 Transfer complete\r\n");
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void *
+server_session (void *arg)
+{
+    int sock = GPOINTER_TO_INT (arg);
+    int pasv = -1;
+    char *cwd;
+    char line[BUF_1K];
+
+    cwd = g_strdup ("");
+    server_send (sock, "220 mc test server\r\n");
+
+    while (server_get_line (sock, line, sizeof (line)))
+    {
+        char *cmd = line;
+        char *param;
+        test_node_t *node;
+
+        /* telnet IP and DM in front of ABOR */
+        while (*cmd != '\0' && !g_ascii_isalpha (*cmd))
+            cmd++;
+
+        param = strchr (cmd, ' ');
+        if (param == NULL)
+            param = cmd + strlen (cmd);
+        else
+            *param++ = '\0';
+
+        if (g_ascii_strcasecmp (cmd, "USER") == 0)
+            server_send (sock, "331 Password required\r\n");
+        else if (g_ascii_strcasecmp (cmd, "PASS") == 0)
+        {
+            pthread_mutex_lock (&server.lock);
+            server.logins++;
+            pthread_mutex_unlock (&server.lock);
+            server_send (sock, "230 Logged in\r\n");
+        }
+        else if (g_ascii_strcasecmp (cmd, "FEAT") == 0)
+        {
+            if (server.mlst)
+                server_send (sock, "211-Features:\r\n MDTM\r\n"
+                             " MLST type*;size*;modify*;UNIX.mode*;UNIX.uid*;UNIX.gid*;\r\n"
+                             " SIZE\r\n211 End\r\n");
+            else
+                server_send (sock, "500 FEAT not understood\r\n");
+        }
+        else if (g_ascii_strcasecmp (cmd, "PWD") == 0)
+            server_send (sock, "257 \"/%s\" is the current directory\r\n", cwd);
+        else if (g_ascii_strcasecmp (cmd, "CWD") == 0)
+        {
+            node = server_lookup (cwd, param);
+            if (node == NULL || node->type != S_IFDIR)
+                server_send (sock, "550 No such directory\r\n");
+            else
+            {
+                g_free (cwd);
+                cwd = g_strdup (node->path);
+                server_send (sock, "250 OK\r\n");
+            }
+        }
+        else if (g_ascii_strcasecmp (cmd, "PASV") == 0)
+        {
+            struct sockaddr_in sa;
+            socklen_t len = sizeof (sa);
+            unsigned int port;
+
+            if (pasv != -1)
+                close (pasv);
+            pasv = socket (AF_INET, SOCK_STREAM, 0);
+            memset (&sa, 0, sizeof (sa));
+            sa.sin_family = AF_INET;
+            sa.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+            bind (pasv, (struct sockaddr *) &sa, sizeof (sa));
+            listen (pasv, 1);
+            getsockname (pasv, (struct sockaddr *) &sa, &len);
+            port = ntohs (sa.sin_port);
+            server_send (sock, "227 Entering Passive Mode (127,0,0,1,%u,%u)\r\n", port >> 8,
+                         port & 0xff);
+        }
+        else if (g_ascii_strcasecmp (cmd, "MLSD") == 0 && server.mlst)
+        {
+            pthread_mutex_lock (&server.lock);
+            server.mlsd++;
+            pthread_mutex_unlock (&server.lock);
+
+            node = server_lookup (cwd, param);
+            if (node == NULL)
+                server_send (sock, "550 No such file or directory\r\n");
+            else if (node->type != S_IFDIR)
+                server_send (sock, "501 Not a directory\r\n");
+            else
+            {
+                GString *out;
+
+                out = server_listing (node, TRUE);
+                server_send_data (sock, &pasv, out->str, out->len);
+                g_string_free (out, TRUE);
+            }
+        }
+        else if (g_ascii_strcasecmp (cmd, "MLST") == 0 && server.mlst)
+        {
+            node = server_lookup (cwd, param);
+            if (node == NULL)
+                server_send (sock, "550 No such file or directory\r\n");
+            else
+            {
+                GString *out;
+
+                out = g_string_new ("250-Listing\r\n ");
+                server_append_facts (out, node);
+                g_string_append_printf (out, " /%s\r\n250 End\r\n", node->path);
+                server_send (sock, "%s", out->str);
+                g_string_free (out, TRUE);
+            }
+        }
+        else if (g_ascii_strcasecmp (cmd, "LIST") == 0)
+        {
+            pthread_mutex_lock (&server.lock);
+            server.list++;
+            pthread_mutex_unlock (&server.lock);
+
+            while (*param == '-')
+            {
+                param = strchr (param, ' ');
+                param = param == NULL ? cwd + strlen (cwd) : param + 1;
+            }
+
+            node = server_lookup (cwd, param);
+            if (node == NULL || node->type != S_IFDIR)
+                server_send (sock, "550 No such directory\r\n");
+            else
+            {
+                GString *out;
+
+                out = server_listing (node, FALSE);
+                server_send_data (sock, &pasv, out->str, out->len);
+                g_string_free (out, TRUE);
+            }
+        }
+        else if (g_ascii_strcasecmp (cmd, "RETR") == 0)
+        {
+            node = server_lookup (cwd, param);
+            if (node == NULL || node->type != S_IFREG)
+                server_send (sock, "550 No such file\r\n");
+            else
+                server_send_data (sock, &pasv, node->data, node->size);
+        }
+        else if (g_ascii_strcasecmp (cmd, "STOR") == 0)
+        {
+            int data;
+            char buf[BUF_8K];
+            ssize_t n;
+            GString *stored;
+
+            data = server_accept_data (&pasv);
+            server_send (sock, "150 Ready to receive\r\n");
+            stored = g_string_new ("");
+            while ((n = read (data, buf, sizeof (buf))) > 0)
+                g_string_append_len (stored, buf, n);
+            close (data);
+
+            pthread_mutex_lock (&server.lock);
+            g_free (server.stored_name);
+            server.stored_name = g_strdup (param);
+            if (server.stored != NULL)
+                g_string_free (server.stored, TRUE);
+            server.stored = stored;
+            pthread_mutex_unlock (&server.lock);
+
+            server_send (sock, "226 Transfer complete\r\n");
+        }
+        else if (g_ascii_strcasecmp (cmd, "TYPE") == 0 || g_ascii_strcasecmp (cmd, "NOOP") == 0)
+            server_send (sock, "200 OK\r\n");
+        else if (g_ascii_strcasecmp (cmd, "ABOR") == 0)
+            server_send (sock, "226 Abort successful\r\n");
+        else if (g_ascii_strcasecmp (cmd, "QUIT") == 0)
+        {
+            server_send (sock, "221 Goodbye\r\n");
+            break;
+        }
+        else
+            server_send (sock, "502 Command not implemented\r\n");
+    }
+
+    pthread_mutex_lock (&server.lock);
+    server.sessions = g_slist_remove (server.sessions, GINT_TO_POINTER (sock));
+    pthread_mutex_unlock (&server.lock);
+
+    if (pasv != -1)
+        close (pasv);
+    close (sock);
+    g_free (cwd);
+    return NULL;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void *
+server_accept (void *arg)
+{
+    (void) arg;
+
+    while (TRUE)
+    {
+        int sock;
+        pthread_t thread;
+
+        sock = accept (server.sock, NULL, NULL);
+        if (sock == -1)
+            break;
+
+        pthread_mutex_lock (&server.lock);
+        server.sessions = g_slist_prepend (server.sessions, GINT_TO_POINTER (sock));
+        pthread_mutex_unlock (&server.lock);
+
+        pthread_create (&thread, NULL, server_session, GINT_TO_POINTER (sock));
+        pthread_detach (thread);
+    }
+
+    return NULL;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+server_start (gboolean mlst)
+{
+    struct sockaddr_in sa;
+    socklen_t len = sizeof (sa);
+
+    server.mlst = mlst;
+    server.sock = socket (AF_INET, SOCK_STREAM, 0);
+    memset (&sa, 0, sizeof (sa));
+    sa.sin_family = AF_INET;
+    sa.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+    fail_unless (bind (server.sock, (struct sockaddr *) &sa, sizeof (sa)) == 0, "cannot bind");
+    listen (server.sock, 8);
+    getsockname (server.sock, (struct sockaddr *) &sa, &len);
+    server.url = g_strdup_printf ("ftp://anonymous@127.0.0.1:%u", ntohs (sa.sin_port));
+
+    pthread_create (&server.thread, NULL, server_accept, NULL);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/* Make the server hang up on every client, as after an idle timeout */
+
+static void
+server_drop_sessions (void)
+{
+    GSList *l;
+    int i;
+
+    pthread_mutex_lock (&server.lock);
+    for (l = server.sessions; l != NULL; l = g_slist_next (l))
+    {
+        server_send (GPOINTER_TO_INT (l->data), "421 Timeout\r\n");
+        shutdown (GPOINTER_TO_INT (l->data), SHUT_RDWR);
+    }
+    pthread_mutex_unlock (&server.lock);
+
+    /* wait for the sessions to end */
+    for (i = 0; i < 500 && server.sessions != NULL; i++)
+        usleep (10000);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static int
+server_get_counter (const int *counter)
+{
+    int ret;
+
+    pthread_mutex_lock (&server.lock);
+    ret = *counter;
+    pthread_mutex_unlock (&server.lock);
+    return ret;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static vfs_path_t *
+test_vpath (const char *path)
+{
+    char *s;
+    vfs_path_t *vpath;
+
+    s = g_strconcat (server.url, PATH_SEP_STR, path, (char *) NULL);
+    vpath = vfs_path_from_str (s);
+    g_free (s);
+
+    return vpath;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static ftp_super_t *
+test_super (void)
+{
+    fail_unless (ftpfs_subclass.supers != NULL, "not connected");
+    return FTP_SUPER (ftpfs_subclass.supers->data);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/* Sorted names in a directory, separated with commas, or NULL */
+
+static char *
+test_list (const char *path)
+{
+    vfs_path_t *vpath;
+    DIR *dir;
+    struct vfs_dirent *d;
+    GPtrArray *names;
+    GString *ret;
+    guint i;
+
+    vpath = test_vpath (path);
+    dir = mc_opendir (vpath);
+    vfs_path_free (vpath);
+    if (dir == NULL)
+        return NULL;
+
+    names = g_ptr_array_new ();
+    while ((d = mc_readdir (dir)) != NULL)
+        if (strcmp (d->d_name, ".") != 0 && strcmp (d->d_name, "..") != 0)
+            g_ptr_array_add (names, g_strdup (d->d_name));
+    mc_closedir (dir);
+
+    g_ptr_array_sort (names, (GCompareFunc) g_ascii_strcasecmp);
+    ret = g_string_new ("");
+    for (i = 0; i < names->len; i++)
+    {
+        if (i != 0)
+            g_string_append_c (ret, ',');
+        g_string_append (ret, (const char *) g_ptr_array_index (names, i));
+        g_free (g_ptr_array_index (names, i));
+    }
+    g_ptr_array_free (names, TRUE);
+
+    return g_string_free (ret, FALSE);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+check_list (const char *path, const char *expected)
+{
+    char *names;
+
+    names = test_list (path);
+    fail_unless (names != NULL, "cannot list %s", path);
+    mctest_assert_str_eq (names, expected);
+    g_free (names);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/* Open a file for streaming and read its first bytes: the transfer holds a connection */
+
+static int
+start_read (const char *path, char *buf, size_t len)
+{
+    vfs_path_t *vpath;
+    int fd;
+
+    vpath = test_vpath (path);
+    fd = mc_open (vpath, O_RDONLY | O_LINEAR);
+    vfs_path_free (vpath);
+    fail_unless (fd != -1, "cannot open %s", path);
+    fail_unless (mc_read (fd, buf, len) == (ssize_t) len, "cannot read %s", path);
+
+    return fd;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+finish_read (int fd, const char *data, size_t size, size_t done)
+{
+    char *buf;
+    ssize_t n;
+
+    buf = g_new (char, size + 1);
+    while ((n = mc_read (fd, buf + done, size + 1 - done)) > 0)
+        done += n;
+    fail_unless (n == 0, "read error");
+    fail_unless (done == size && memcmp (buf + 10, data + 10, size - 10) == 0, "wrong contents");
+    fail_unless (mc_close (fd) == 0, "close error");
+    g_free (buf);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Before */
+static void
+setup (void)
+{
+    size_t i;
+
+    str_init_strings (NULL);
+
+    vfs_init ();
+    vfs_init_localfs ();
+    vfs_init_ftpfs ();
+    vfs_setup_work_dir ();
+
+    ftpfs_use_netrc = FALSE;
+    ftpfs_anonymous_passwd = g_strdup ("mc@test");
+
+    big_data = g_new (char, BIG_SIZE);
+    for (i = 0; i < BIG_SIZE; i++)
+        big_data[i] = (char) (i * 7 + i / 251);
+    test_nodes[3].data = big_data;
+
+    memset (&server, 0, sizeof (server));
+    server.sock = -1;
+    pthread_mutex_init (&server.lock, NULL);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @After */
+static void
+teardown (void)
+{
+    vfs_shut ();
+    str_uninit_strings ();
+
+    if (server.sock != -1)
+    {
+        shutdown (server.sock, SHUT_RDWR);
+        close (server.sock);
+        pthread_join (server.thread, NULL);
+    }
+    g_free (server.url);
+    g_free (server.stored_name);
+    if (server.stored != NULL)
+        g_string_free (server.stored, TRUE);
+
+    g_free (big_data);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* *INDENT-OFF* */
+static const struct test_parse_mlsx_ds
+{
+    const char *line;
+    gboolean result;
+    mode_t mode;
+    off_t size;
+    time_t mtime;
+    uid_t uid;
+    const char *name;
+    const char *linkname;
+} test_parse_mlsx_ds[] =
+{
+    {
+        "type=file;size=1234;modify=20200715120000;UNIX.mode=0640; hello world.txt",
+        TRUE, S_IFREG | 0640, 1234, 1594814400, 0, "hello world.txt", NULL
+    },
+    {
+        "Type=DIR;Modify=19991231235959.123;UNIX.uid=1000; docs\r",
+        TRUE, S_IFDIR | 0755, 0, 946684799, 1000, "docs", NULL
+    },
+    {
+        "type=OS.unix=slink:/etc/passwd;UNIX.mode=0777;modify=20200715120000; passwd",
+        TRUE, S_IFLNK | 0777, 0, 1594814400, 0, "passwd", "/etc/passwd"
+    },
+    /* a link without target can't be followed */
+    {
+        "type=OS.unix=symlink;size=5;modify=20200715120000; lnk",
+        TRUE, S_IFREG | 0644, 5, 1594814400, 0, "lnk", NULL
+    },
+    {
+        "size=7;type=file;perm=r;modify=20200715120000;UNIX.owner=42; a;b c",
+        TRUE, S_IFREG | 0644, 7, 1594814400, 42, "a;b c", NULL
+    },
+    { "type=cdir;modify=20200715120000; /pub", FALSE, 0, 0, 0, 0, NULL, NULL },
+    { "type=pdir;modify=20200715120000; ..", FALSE, 0, 0, 0, 0, NULL, NULL },
+    { "type=file;size=1;", FALSE, 0, 0, 0, 0, NULL, NULL },
+    { " noname", FALSE, 0, 0, 0, 0, NULL, NULL },
+};
+/* *INDENT-ON* */
+
+/* *INDENT-OFF* */
+START_PARAMETRIZED_TEST (test_parse_mlsx, test_parse_mlsx_ds)
+/* *INDENT-ON* */
+{
+    struct stat st;
+    char *name = NULL;
+    char *linkname = NULL;
+    gboolean result;
+
+    memset (&st, 0, sizeof (st));
+    result = ftpfs_parse_mlsx_line (data->line, &st, &name, &linkname);
+
+    mctest_assert_int_eq (result, data->result);
+    if (result)
+    {
+        mctest_assert_int_eq (st.st_mode, data->mode);
+        mctest_assert_int_eq (st.st_size, data->size);
+        mctest_assert_int_eq (st.st_mtime, data->mtime);
+        mctest_assert_int_eq (st.st_uid, data->uid);
+        mctest_assert_str_eq (name, data->name);
+        if (data->linkname == NULL)
+            mctest_assert_null (linkname);
+        else
+            mctest_assert_str_eq (linkname, data->linkname);
+    }
+
+    g_free (name);
+    g_free (linkname);
+}
+/* *INDENT-OFF* */
+END_PARAMETRIZED_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* *INDENT-OFF* */
+START_TEST (test_mlsd)
+/* *INDENT-ON* */
+{
+    vfs_path_t *vpath;
+    struct stat st;
+    char buf[BUF_SMALL];
+
+    server_start (TRUE);
+
+    check_list ("pub", "big.bin,dir with space,empty,link,readme");
+    check_list ("pub/dir with space", "inner");
+    check_list ("pub/empty", "");
+    fail_unless (test_super ()->use_mlst, "MLST was not detected");
+    mctest_assert_int_eq (server_get_counter (&server.list), 0);
+
+    vpath = test_vpath ("pub/big.bin");
+    fail_unless (mc_stat (vpath, &st) == 0, "cannot stat big.bin");
+    vfs_path_free (vpath);
+    fail_unless (S_ISREG (st.st_mode) && (st.st_mode & 07777) == 0644, "big.bin: mode %o",
+                 (unsigned int) st.st_mode);
+    mctest_assert_int_eq (st.st_size, BIG_SIZE);
+    mctest_assert_int_eq (st.st_mtime, 1594814400);
+
+    vpath = test_vpath ("pub/link");
+    fail_unless (mc_lstat (vpath, &st) == 0 && S_ISLNK (st.st_mode), "link is not a symlink");
+    fail_unless (mc_readlink (vpath, buf, sizeof (buf)) == 6 && strncmp (buf, "readme", 6) == 0,
+                 "wrong link target");
+    fail_unless (mc_stat (vpath, &st) == 0 && S_ISREG (st.st_mode) && st.st_size == 13,
+                 "link is not followed");
+    vfs_path_free (vpath);
+
+    /* MLST tells what is wrong with a path that MLSD can't list */
+    vpath = test_vpath ("pub/readme/x");
+    fail_unless (mc_stat (vpath, &st) == -1 && errno == ENOTDIR, "readme/x: errno %d", errno);
+    vfs_path_free (vpath);
+
+    vpath = test_vpath ("pub/nothing/x");
+    fail_unless (mc_stat (vpath, &st) == -1 && errno == ENOENT, "nothing/x: errno %d", errno);
+    vfs_path_free (vpath);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* *INDENT-OFF* */
+START_TEST (test_list_fallback)
+/* *INDENT-ON* */
+{
+    vfs_path_t *vpath;
+    struct stat st;
+
+    server_start (FALSE);
+
+    check_list ("pub", "big.bin,dir with space,empty,link,readme");
+    check_list ("pub/dir with space", "inner");
+    fail_unless (!test_super ()->use_mlst, "MLST was detected");
+    mctest_assert_int_eq (server_get_counter (&server.mlsd), 0);
+    fail_unless (server_get_counter (&server.list) != 0, "LIST was not used");
+
+    vpath = test_vpath ("pub/readme");
+    fail_unless (mc_stat (vpath, &st) == 0 && S_ISREG (st.st_mode) && st.st_size == 13,
+                 "cannot stat readme");
+    vfs_path_free (vpath);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* *INDENT-OFF* */
+START_TEST (test_pool)
+/* *INDENT-ON* */
+{
+    char buf[10];
+    int fd, out;
+    vfs_path_t *vpath;
+    const char *text = "stored while another file was being read\n";
+
+    server_start (TRUE);
+
+    check_list ("pub", "big.bin,dir with space,empty,link,readme");
+    mctest_assert_int_eq (server_get_counter (&server.logins), 1);
+
+    /* browse while a file is being read */
+    fd = start_read ("pub/big.bin", buf, sizeof (buf));
+    fail_unless (memcmp (buf, big_data, sizeof (buf)) == 0, "wrong contents");
+    check_list ("pub/dir with space", "inner");
+    mctest_assert_int_eq (server_get_counter (&server.logins), 2);
+
+    /* write another one on the connection that has just browsed */
+    vpath = test_vpath ("incoming/copy");
+    out = mc_open (vpath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    vfs_path_free (vpath);
+    fail_unless (out != -1, "cannot open incoming/copy for writing");
+    mctest_assert_int_eq (server_get_counter (&server.logins), 2);
+
+    /* and browse while both transfers run */
+    check_list ("pub/empty", "");
+    mctest_assert_int_eq (server_get_counter (&server.logins), 3);
+
+    fail_unless (mc_write (out, text, strlen (text)) == (ssize_t) strlen (text), "write error");
+    fail_unless (mc_close (out) == 0, "close error");
+    mctest_assert_str_eq (server.stored_name, "/incoming/copy");
+    mctest_assert_str_eq (server.stored->str, text);
+
+    finish_read (fd, big_data, BIG_SIZE, sizeof (buf));
+    mctest_assert_int_eq (test_super ()->connections, 3);
+
+    /* finished transfers leave their connections for reuse;
+       the upload has emptied the directory cache, so both requests go to the server */
+    fd = start_read ("pub/readme", buf, sizeof (buf));
+    check_list ("pub/dir with space", "inner");
+    finish_read (fd, "hello, world\n", 13, sizeof (buf));
+    mctest_assert_int_eq (server_get_counter (&server.logins), 3);
+    mctest_assert_int_eq (test_super ()->connections, 3);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* *INDENT-OFF* */
+START_TEST (test_pool_limit)
+/* *INDENT-ON* */
+{
+    char buf[10];
+    int fd[FTPFS_MAX_CONNECTIONS];
+    int i;
+    char *names;
+
+    server_start (TRUE);
+
+    for (i = 0; i < FTPFS_MAX_CONNECTIONS; i++)
+        fd[i] = start_read ("pub/big.bin", buf, sizeof (buf));
+    mctest_assert_int_eq (server_get_counter (&server.logins), FTPFS_MAX_CONNECTIONS);
+
+    /* "pub" is in the directory cache already: list directories that are not */
+    names = test_list ("pub/empty");
+    fail_unless (names == NULL, "too many connections were opened");
+
+    /* an aborted transfer gives its connection up */
+    mc_close (fd[0]);
+    mctest_assert_int_eq (test_super ()->connections, FTPFS_MAX_CONNECTIONS - 1);
+    check_list ("pub/dir with space", "inner");
+    mctest_assert_int_eq (test_super ()->connections, FTPFS_MAX_CONNECTIONS);
+
+    for (i = 1; i < FTPFS_MAX_CONNECTIONS; i++)
+        finish_read (fd[i], big_data, BIG_SIZE, sizeof (buf));
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* *INDENT-OFF* */
+START_TEST (test_reconnect)
+/* *INDENT-ON* */
+{
+    char buf[10];
+    int fd;
+
+    server_start (TRUE);
+
+    check_list ("pub", "big.bin,dir with space,empty,link,readme");
+    fd = start_read ("pub/big.bin", buf, sizeof (buf));
+    check_list ("incoming", "");
+    finish_read (fd, big_data, BIG_SIZE, sizeof (buf));
+    mctest_assert_int_eq (server_get_counter (&server.logins), 2);
+
+    server_drop_sessions ();
+
+    /* the current connection is reopened by ftpfs_reconnect() ... */
+    check_list ("pub/dir with space", "inner");
+    mctest_assert_int_eq (server_get_counter (&server.logins), 3);
+
+    /* ... and so is the idle one when it is needed */
+    fd = start_read ("pub/readme", buf, sizeof (buf));
+    check_list ("pub/empty", "");
+    mctest_assert_int_eq (server_get_counter (&server.logins), 4);
+    finish_read (fd, "hello, world\n", 13, sizeof (buf));
+    mctest_assert_int_eq (test_super ()->connections, 2);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    int number_failed;
+
+    Suite *s = suite_create (TEST_SUITE_NAME);
+    TCase *tc_core = tcase_create ("Core");
+    SRunner *sr;
+
+    tcase_add_checked_fixture (tc_core, setup, teardown);
+    tcase_set_timeout (tc_core, 60);
+
+    /* Add new tests here: *************** */
+    mctest_add_parameterized_test (tc_core, test_parse_mlsx, test_parse_mlsx_ds);
+    tcase_add_test (tc_core, test_mlsd);
+    tcase_add_test (tc_core, test_list_fallback);
+    tcase_add_test (tc_core, test_pool);
+    tcase_add_test (tc_core, test_pool_limit);
+    tcase_add_test (tc_core, test_reconnect);
+    /* *********************************** */
+
+    suite_add_tcase (s, tc_core);
+    sr = srunner_create (s);
+    srunner_set_log (sr, "ftpfs.log");
+    srunner_run_all (sr, CK_ENV);
+    number_failed = srunner_ntests_failed (sr);
+    srunner_free (sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,477 @@
+/*
+   src/vfs/zip - tests for the zip file system
+
+   Copyright (C) 2020
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_SUITE_NAME "/src/vfs/zip"
+
+#include "tests/mctest.h"
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include <zlib.h>
+
+#include "lib/strutil.h"
+#include "lib/vfs/vfs.h"
+
+#include "src/vfs/local/local.c"
+#include "src/vfs/zip/zip.c"
+
+#define BIG_SIZE (3 * 1024 * 1024 + 17)
+
+/* one member of a test archive */
+typedef struct
+{
+    const char *name;
+    const char *data;           /* NULL for directories */
+    size_t size;
+    gboolean deflate;
+} test_member_t;
+
+static char *test_dir = NULL;
+static char *big_data = NULL;
+
+/* --------------------------------------------------------------------------------------------- */
+/* @Mock */
+void
+message (int flags, const char *title, const char *text, ...)
+{
+    (void) flags;
+    (void) title;
+    (void) text;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+put16 (FILE * f, unsigned int v)
+{
+    fputc (v & 0xff, f);
+    fputc ((v >> 8) & 0xff, f);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+put32 (FILE * f, guint32 v)
+{
+    put16 (f, v & 0xffff);
+    put16 (f, v >> 16);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+put64 (FILE * f, guint64 v)
+{
+    put32 (f, (guint32) v);
+    put32 (f, (guint32) (v >> 32));
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static unsigned char *
+deflate_raw (const char *data, size_t size, size_t * out_size)
+{
+    z_stream zs;
+    unsigned char *out;
+    uLong bound;
+
+    memset (&zs, 0, sizeof (zs));
+    deflateInit2 (&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+    bound = deflateBound (&zs, size);
+    out = g_new (unsigned char, bound);
+    zs.next_in = (Bytef *) data;
+    zs.avail_in = size;
+    zs.next_out = out;
+    zs.avail_out = bound;
+    deflate (&zs, Z_FINISH);
+    *out_size = zs.total_out;
+    deflateEnd (&zs);
+
+    return out;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* Write a zip archive; with zip64, sizes and offsets are only in the zip64 extra fields. */
+static char *
+write_archive (const char *name, const test_member_t * members, size_t n, gboolean zip64)
+{
+    char *path;
+    FILE *f;
+    guint32 *offsets, *crcs;
+    size_t *csizes;
+    long cd_start, cd_end;
+    size_t i;
+
+    path = g_build_filename (test_dir, name, (char *) NULL);
+    f = fopen (path, "wb");
+    offsets = g_new (guint32, n);
+    crcs = g_new (guint32, n);
+    csizes = g_new (size_t, n);
+
+    for (i = 0; i < n; i++)
+    {
+        const test_member_t *m = &members[i];
+        unsigned char *packed = NULL;
+        const void *body;
+
+        offsets[i] = (guint32) ftell (f);
+        crcs[i] = m->data == NULL ? 0 : crc32 (0, (const Bytef *) m->data, m->size);
+        if (m->deflate)
+        {
+            packed = deflate_raw (m->data, m->size, &csizes[i]);
+            body = packed;
+        }
+        else
+        {
+            csizes[i] = m->size;
+            body = m->data;
+        }
+
+        put32 (f, ZIP_LOCAL_SIG);
+        put16 (f, zip64 ? 45 : 20);
+        put16 (f, 0);
+        put16 (f, m->deflate ? ZIP_METHOD_DEFLATED : ZIP_METHOD_STORED);
+        put16 (f, 0x6000);      /* 12:00 */
+        put16 (f, (40 << 9) | (7 << 5) | 15);   /* 2020-07-15 */
+        put32 (f, crcs[i]);
+        put32 (f, zip64 ? 0xffffffff : csizes[i]);
+        put32 (f, zip64 ? 0xffffffff : m->size);
+        put16 (f, strlen (m->name));
+        put16 (f, zip64 ? 20 : 0);
+        fwrite (m->name, strlen (m->name), 1, f);
+        if (zip64)
+        {
+            put16 (f, ZIP_EXTRA_ZIP64);
+            put16 (f, 16);
+            put64 (f, m->size);
+            put64 (f, csizes[i]);
+        }
+        if (csizes[i] != 0)
+            fwrite (body, csizes[i], 1, f);
+        g_free (packed);
+    }
+
+    cd_start = ftell (f);
+    for (i = 0; i < n; i++)
+    {
+        const test_member_t *m = &members[i];
+
+        put32 (f, ZIP_CENTRAL_SIG);
+        put16 (f, (ZIP_HOST_UNIX << 8) | 30);
+        put16 (f, zip64 ? 45 : 20);
+        put16 (f, 0);
+        put16 (f, m->deflate ? ZIP_METHOD_DEFLATED : ZIP_METHOD_STORED);
+        put16 (f, 0x6000);
+        put16 (f, (40 << 9) | (7 << 5) | 15);
+        put32 (f, crcs[i]);
+        put32 (f, zip64 ? 0xffffffff : csizes[i]);
+        put32 (f, zip64 ? 0xffffffff : m->size);
+        put16 (f, strlen (m->name));
+        put16 (f, zip64 ? 28 : 0);
+        put16 (f, 0);           /* comment */
+        put16 (f, 0);           /* disk */
+        put16 (f, 0);           /* internal attributes */
+        put32 (f, (guint32) (m->data == NULL ? (S_IFDIR | 0755) : (S_IFREG | 0644)) << 16);
+        put32 (f, zip64 ? 0xffffffff : offsets[i]);
+        fwrite (m->name, strlen (m->name), 1, f);
+        if (zip64)
+        {
+            put16 (f, ZIP_EXTRA_ZIP64);
+            put16 (f, 24);
+            put64 (f, m->size);
+            put64 (f, csizes[i]);
+            put64 (f, offsets[i]);
+        }
+    }
+    cd_end = ftell (f);
+
+    if (zip64)
+    {
+        put32 (f, ZIP64_EOCD_SIG);
+        put64 (f, ZIP64_EOCD_SIZE - 12);
+        put16 (f, 45);
+        put16 (f, 45);
+        put32 (f, 0);
+        put32 (f, 0);
+        put64 (f, n);
+        put64 (f, n);
+        put64 (f, cd_end - cd_start);
+        put64 (f, cd_start);
+
+        put32 (f, ZIP64_LOCATOR_SIG);
+        put32 (f, 0);
+        put64 (f, cd_end);
+        put32 (f, 1);
+    }
+
+    put32 (f, ZIP_EOCD_SIG);
+    put16 (f, 0);
+    put16 (f, 0);
+    put16 (f, zip64 ? 0xffff : n);
+    put16 (f, zip64 ? 0xffff : n);
+    put32 (f, zip64 ? 0xffffffff : (guint32) (cd_end - cd_start));
+    put32 (f, zip64 ? 0xffffffff : (guint32) cd_start);
+    put16 (f, 7);
+    fwrite ("comment", 7, 1, f);
+
+    fclose (f);
+    g_free (csizes);
+    g_free (crcs);
+    g_free (offsets);
+
+    return path;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static vfs_path_t *
+member_vpath (const char *archive, const char *member)
+{
+    char *s;
+    vfs_path_t *vpath;
+
+    s = g_strconcat (archive, "/zip://", member, (char *) NULL);
+    vpath = vfs_path_from_str (s);
+    g_free (s);
+
+    return vpath;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+check_member (const char *archive, const test_member_t * m)
+{
+    vfs_path_t *vpath;
+    struct stat st;
+    char *buf;
+    ssize_t n;
+    size_t got = 0;
+    int fd;
+
+    vpath = member_vpath (archive, m->name);
+    fail_unless (mc_stat (vpath, &st) == 0, "cannot stat %s", m->name);
+    fail_unless (S_ISREG (st.st_mode), "%s is not a regular file", m->name);
+    fail_unless ((size_t) st.st_size == m->size, "%s: size %jd, expected %zu", m->name,
+                 (intmax_t) st.st_size, m->size);
+
+    fd = mc_open (vpath, O_RDONLY);
+    fail_unless (fd != -1, "cannot open %s", m->name);
+
+    buf = g_malloc (m->size + 1);
+    while ((n = mc_read (fd, buf + got, MIN (m->size + 1 - got, 100000))) > 0)
+        got += n;
+    fail_unless (n == 0, "%s: read error", m->name);
+    fail_unless (got == m->size && memcmp (buf, m->data, m->size) == 0, "%s: wrong contents",
+                 m->name);
+
+    /* going back restarts the stream, going forward skips */
+    if (m->size > 10)
+    {
+        off_t pos = m->size / 2;
+
+        fail_unless (mc_lseek (fd, pos, SEEK_SET) == pos, "%s: cannot seek", m->name);
+        n = mc_read (fd, buf, 10);
+        fail_unless (n == 10 && memcmp (buf, m->data + pos, 10) == 0,
+                     "%s: wrong contents after seek back", m->name);
+
+        pos = m->size - 5;
+        fail_unless (mc_lseek (fd, pos, SEEK_SET) == pos, "%s: cannot seek", m->name);
+        n = mc_read (fd, buf, 10);
+        fail_unless (n == 5 && memcmp (buf, m->data + pos, 5) == 0,
+                     "%s: wrong contents after seek forward", m->name);
+    }
+
+    mc_close (fd);
+    g_free (buf);
+    vfs_path_free (vpath);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+check_archive (gboolean zip64)
+{
+    const test_member_t members[] = {
+        {"hello.txt", "Hello, world!\n", 14, FALSE},
+        {"empty", "", 0, FALSE},
+        {"docs/", NULL, 0, FALSE},
+        {"docs/readme", "read me\nread me\nread me\nread me\n", 32, TRUE},
+        /* no entries for the directories above */
+        {"src/vfs/zip/big.bin", big_data, BIG_SIZE, TRUE},
+    };
+    char *archive;
+    vfs_path_t *vpath;
+    struct stat st;
+    DIR *dir;
+    struct vfs_dirent *d;
+    int entries = 0;
+    size_t i;
+
+    archive = write_archive (zip64 ? "test64.zip" : "test.zip", members,
+                             G_N_ELEMENTS (members), zip64);
+
+    for (i = 0; i < G_N_ELEMENTS (members); i++)
+        if (members[i].data != NULL)
+            check_member (archive, &members[i]);
+
+    vpath = member_vpath (archive, "src/vfs");
+    fail_unless (mc_stat (vpath, &st) == 0 && S_ISDIR (st.st_mode), "src/vfs is not a directory");
+    vfs_path_free (vpath);
+
+    vpath = member_vpath (archive, "");
+    dir = mc_opendir (vpath);
+    fail_unless (dir != NULL, "cannot list the archive");
+    while ((d = mc_readdir (dir)) != NULL)
+        if (strcmp (d->d_name, ".") != 0 && strcmp (d->d_name, "..") != 0)
+            entries++;
+    mc_closedir (dir);
+    vfs_path_free (vpath);
+    fail_unless (entries == 4, "%d entries in the root", entries);
+
+    vpath = member_vpath (archive, "hello.txt");
+    fail_unless (mc_open (vpath, O_WRONLY) == -1, "a member was opened for writing");
+    vfs_path_free (vpath);
+
+    unlink (archive);
+    g_free (archive);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Before */
+static void
+setup (void)
+{
+    GRand *r;
+    size_t i;
+
+    str_init_strings (NULL);
+
+    vfs_init ();
+    vfs_init_localfs ();
+    vfs_init_zipfs ();
+    vfs_setup_work_dir ();
+
+    test_dir = g_dir_make_tmp ("mc-zipfs-XXXXXX", NULL);
+
+    /* compressible, but not trivially */
+    r = g_rand_new_with_seed (20200715);
+    big_data = g_new (char, BIG_SIZE);
+    for (i = 0; i < BIG_SIZE; i++)
+        big_data[i] = (i % 100) < 80 ? 'a' + i % 26 : (char) g_rand_int_range (r, 0, 256);
+    g_rand_free (r);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @After */
+static void
+teardown (void)
+{
+    vfs_shut ();
+    str_uninit_strings ();
+
+    rmdir (test_dir);
+    g_free (test_dir);
+    g_free (big_data);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* *INDENT-OFF* */
+START_TEST (test_zip)
+/* *INDENT-ON* */
+{
+    check_archive (FALSE);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* *INDENT-OFF* */
+START_TEST (test_zip64)
+/* *INDENT-ON* */
+{
+    check_archive (TRUE);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* *INDENT-OFF* */
+START_TEST (test_not_zip)
+/* *INDENT-ON* */
+{
+    char *path;
+    vfs_path_t *vpath;
+    struct stat st;
+
+    path = g_build_filename (test_dir, "not.zip", (char *) NULL);
+    g_file_set_contents (path, "PK\003\004 but nothing else", -1, NULL);
+
+    vpath = member_vpath (path, "");
+    fail_unless (mc_stat (vpath, &st) == -1, "a broken archive was opened");
+    vfs_path_free (vpath);
+
+    unlink (path);
+    g_free (path);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    int number_failed;
+
+    Suite *s = suite_create (TEST_SUITE_NAME);
+    TCase *tc_core = tcase_create ("Core");
+    SRunner *sr;
+
+    tcase_add_checked_fixture (tc_core, setup, teardown);
+
+    /* Add new tests here: *************** */
+    tcase_add_test (tc_core, test_zip);
+    tcase_add_test (tc_core, test_zip64);
+    tcase_add_test (tc_core, test_not_zip);
+    /* *********************************** */
+
+    suite_add_tcase (s, tc_core);
+    sr = srunner_create (s);
+    srunner_set_log (sr, "zipfs.log");
+    srunner_run_all (sr, CK_ENV);
+    number_failed = srunner_ntests_failed (sr);
+    srunner_free (sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* --------------------------------------------------------------------------------------------- */